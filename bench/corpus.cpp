@@ -0,0 +1,205 @@
+#include "corpus.h"
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sap_sync/hash.h>
+#include <sap_sync/protocol.h>
+#include <stdexcept>
+
+namespace sap::cloud::bench {
+
+    namespace {
+        constexpr u64 corpus_seed = 0x5a9c10dULL;
+
+        constexpr std::array<std::string_view, 32> vocabulary = {
+            "alpha",   "budget",  "cache",   "deploy",  "editor",   "fixture", "garden", "harbor", "index",  "journal", "kernel",
+            "ledger",  "meeting", "network", "offline", "planning", "query",   "recipe", "sprint", "travel", "upgrade", "vector",
+            "weekly",  "xylem",   "yield",   "zephyr",  "backup",   "invoice", "review", "schema", "taxes",  "holiday"};
+
+        constexpr std::array<std::string_view, 8> folders = {"docs", "photos/2023", "photos/2024", "music", "projects/src",
+                                                             "projects/assets", "archive", "inbox"};
+
+        [[noreturn]] void fail(const std::string& what) { throw std::runtime_error("bench corpus: " + what); }
+
+        template <typename T>
+        void check(const stl::result<T>& result, std::string_view what) {
+            if (!result) {
+                fail(std::string(what) + ": " + std::string(result.error()));
+            }
+        }
+
+        std::string hex_hash(std::mt19937_64& rng) {
+            static constexpr char digits[] = "0123456789abcdef";
+            std::string hash(64, '0');
+            for (size_t i = 0; i < hash.size(); i += 16) {
+                u64 bits = rng();
+                for (size_t j = 0; j < 16; ++j) {
+                    hash[i + j] = digits[(bits >> (j * 4)) & 0xf];
+                }
+            }
+            return hash;
+        }
+
+        std::string sentence(std::mt19937_64& rng, size_t words) {
+            std::string out;
+            for (size_t i = 0; i < words; ++i) {
+                if (i) {
+                    out += ' ';
+                }
+                out += vocabulary[rng() % vocabulary.size()];
+            }
+            return out;
+        }
+
+        // Small deterministic payload for on-disk files; size is not the corpus size
+        std::string file_payload(size_t index) { return "sap-bench-file-" + std::to_string(index) + "\n" + std::string(index % 512, 'x'); }
+    } // namespace
+
+    Corpus& Corpus::get(size_t size) {
+        static std::mutex mutex;
+        static std::map<size_t, std::unique_ptr<Corpus>> corpora;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto& slot = corpora[size];
+        if (!slot) {
+            slot.reset(new Corpus(size));
+        }
+        return *slot;
+    }
+
+    Corpus::Corpus(size_t size) : m_Size(size) {
+        m_Root = std::filesystem::temp_directory_path() / ("sap_cloud_bench_" + std::to_string(size));
+        std::filesystem::remove_all(m_Root);
+        std::filesystem::create_directories(m_Root);
+        std::mt19937_64 rng(corpus_seed ^ size);
+        // Files: spread across a handful of folders, updated_at increasing with index
+        m_Files.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            sync::FileMetadata meta;
+            meta.path = std::string(folders[i % folders.size()]) + "/dir_" + std::to_string(i / 1000) + "/file_" + std::to_string(i) + ".bin";
+            meta.hash = hex_hash(rng);
+            meta.size = static_cast<i64>(rng() % (4 << 20));
+            meta.mtime = corpus_epoch + static_cast<i64>(i);
+            meta.created_at = meta.mtime;
+            meta.updated_at = meta.mtime;
+            meta.is_deleted = (i % 100) == 0;
+            m_Files.push_back(std::move(meta));
+        }
+        // Notes: short titles, 1-3 tags from a small set, ~60 word bodies
+        m_Notes.reserve(size);
+        for (size_t i = 0; i < size; ++i) {
+            GeneratedNote note;
+            note.meta.id = "note-" + std::to_string(i);
+            note.meta.path = note.meta.id + ".md";
+            note.meta.title = sentence(rng, 3);
+            for (size_t t = 0, n = 1 + rng() % 3; t < n; ++t) {
+                note.meta.tags.emplace_back(vocabulary[rng() % 8]);
+            }
+            note.body = "# " + note.meta.title + "\n\n" + sentence(rng, 60) + "\n";
+            note.meta.hash = hex_hash(rng);
+            note.meta.created_at = corpus_epoch + static_cast<i64>(i);
+            note.meta.updated_at = note.meta.created_at;
+            m_Notes.push_back(std::move(note));
+        }
+    }
+
+    Corpus::~Corpus() {
+        m_Store.reset();
+        m_WriteStore.reset();
+        std::error_code ec;
+        std::filesystem::remove_all(m_Root, ec);
+    }
+
+    storage::MetadataStore& Corpus::store() {
+        if (!m_Store) {
+            m_Store = load_store(m_Root / "corpus.db");
+        }
+        return *m_Store;
+    }
+
+    storage::MetadataStore& Corpus::write_store() {
+        if (!m_WriteStore) {
+            m_WriteStore = load_store(m_Root / "corpus-write.db");
+        }
+        return *m_WriteStore;
+    }
+
+    std::unique_ptr<storage::MetadataStore> Corpus::load_store(const std::filesystem::path& path) const {
+        auto opened = storage::MetadataStore::open(path);
+        check(opened, "open store");
+        auto store = std::make_unique<storage::MetadataStore>(std::move(opened.value()));
+        // One transaction for the whole load; autocommit would sync per row
+        check(store->database().execute("BEGIN"), "begin");
+        for (const auto& file : m_Files) {
+            check(store->upsert_file(file), "upsert file");
+        }
+        for (const auto& note : m_Notes) {
+            check(store->upsert_note(note.meta), "upsert note");
+            check(store->set_note_tags(note.meta.id, note.meta.tags), "set tags");
+            check(store->update_fts(note.meta.id, note.meta.title, note.body), "update fts");
+        }
+        check(store->database().execute("COMMIT"), "commit");
+        return store;
+    }
+
+    const std::filesystem::path& Corpus::files_dir() {
+        if (!m_FilesDir.empty()) {
+            return m_FilesDir;
+        }
+        auto dir = m_Root / "files";
+        for (size_t i = 0; i < m_Files.size(); ++i) {
+            auto path = dir / m_Files[i].path;
+            std::filesystem::create_directories(path.parent_path());
+            std::ofstream out(path, std::ios::binary);
+            out << file_payload(i);
+            if (!out) {
+                fail("write " + path.string());
+            }
+        }
+        m_FilesDir = dir;
+        return m_FilesDir;
+    }
+
+    const std::filesystem::path& Corpus::notes_dir() {
+        if (!m_NotesDir.empty()) {
+            return m_NotesDir;
+        }
+        auto dir = m_Root / "notes";
+        std::filesystem::create_directories(dir);
+        for (const auto& note : m_Notes) {
+            sync::ParsedNote parsed;
+            parsed.title = note.meta.title;
+            parsed.tags = note.meta.tags;
+            parsed.content = note.body;
+            std::ofstream out(dir / note.meta.path, std::ios::binary);
+            out << sync::serialize_note(parsed);
+            if (!out) {
+                fail("write " + note.meta.path);
+            }
+        }
+        m_NotesDir = dir;
+        return m_NotesDir;
+    }
+
+    std::filesystem::path Corpus::scratch_db(std::string_view name) const {
+        auto path = m_Root / (std::string(name) + ".db");
+        for (const char* suffix : {"", "-wal", "-shm", "-journal"}) {
+            std::error_code ec;
+            std::filesystem::remove(path.string() + suffix, ec);
+        }
+        return path;
+    }
+
+    std::string_view vocabulary_word(size_t index) { return vocabulary[index % vocabulary.size()]; }
+
+    void corpus_sizes(benchmark::internal::Benchmark* b) {
+        b->Arg(10000)->Arg(100000);
+        const char* large = std::getenv("SAP_BENCH_LARGE");
+        if (large && std::string_view(large) == "1") {
+            b->Arg(1000000);
+        }
+    }
+
+} // namespace sap::cloud::bench
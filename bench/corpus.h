@@ -0,0 +1,86 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <sap_cloud/metadata.h>
+#include <sap_core/types.h>
+#include <sap_sync/sync_types.h>
+#include <string>
+#include <vector>
+
+namespace sap::cloud::bench {
+
+    // =============================================================================
+    // Benchmark Corpus
+    // =============================================================================
+    // Deterministic synthetic files and notes. A corpus of a given size is
+    // identical across runs and machines (fixed seed, fixed timestamps), so
+    // numbers from different builds are comparable.
+    //
+    // Corpora are generated once per size and shared by every benchmark in the
+    // process. Sizes are 10k and 100k; 1M is added when SAP_BENCH_LARGE=1 is
+    // set, since generating it (especially on disk) takes minutes.
+    // =============================================================================
+
+    inline constexpr sync::Timestamp corpus_epoch = 1700000000000;
+
+    struct GeneratedNote {
+        sync::NoteMetadata meta;
+        std::string body; // Markdown without frontmatter
+    };
+
+    class Corpus {
+    public:
+        // Shared corpus of the given size, generated on first use
+        static Corpus& get(size_t size);
+
+        ~Corpus();
+        Corpus(const Corpus&) = delete;
+        Corpus& operator=(const Corpus&) = delete;
+
+        [[nodiscard]] size_t size() const { return m_Size; }
+
+        [[nodiscard]] const std::vector<sync::FileMetadata>& files() const { return m_Files; }
+
+        [[nodiscard]] const std::vector<GeneratedNote>& notes() const { return m_Notes; }
+
+        // Store holding every file and note (with tags and FTS rows). Read-only:
+        // benchmarks that write use write_store(), so read numbers don't
+        // depend on which write benchmarks ran first.
+        [[nodiscard]] storage::MetadataStore& store();
+
+        // Separate store with the same contents, for benchmarks that modify rows
+        [[nodiscard]] storage::MetadataStore& write_store();
+
+        // Directory with one small file per corpus file, written on first call
+        [[nodiscard]] const std::filesystem::path& files_dir();
+
+        // Directory with one markdown file per note, written on first call
+        [[nodiscard]] const std::filesystem::path& notes_dir();
+
+        // Fresh empty database path under the corpus root (removed on reuse)
+        [[nodiscard]] std::filesystem::path scratch_db(std::string_view name) const;
+
+    private:
+        explicit Corpus(size_t size);
+
+        [[nodiscard]] std::unique_ptr<storage::MetadataStore> load_store(const std::filesystem::path& path) const;
+
+        size_t m_Size;
+        std::filesystem::path m_Root;
+        std::vector<sync::FileMetadata> m_Files;
+        std::vector<GeneratedNote> m_Notes;
+        std::unique_ptr<storage::MetadataStore> m_Store;
+        std::unique_ptr<storage::MetadataStore> m_WriteStore;
+        std::filesystem::path m_FilesDir;
+        std::filesystem::path m_NotesDir;
+    };
+
+    // Word from the note vocabulary, for search queries
+    [[nodiscard]] std::string_view vocabulary_word(size_t index);
+
+    // Register the corpus sizes as benchmark arguments
+    void corpus_sizes(benchmark::internal::Benchmark* b);
+
+} // namespace sap::cloud::bench
@@ -0,0 +1,41 @@
+#include <benchmark/benchmark.h>
+#include <random>
+#include <sap_cloud/fast_hash.h>
+#include <sap_sync/hash.h>
+#include <vector>
+
+using namespace sap;
+
+namespace {
+
+    std::vector<u8> random_bytes(size_t size) {
+        std::mt19937_64 rng(42);
+        std::vector<u8> data(size);
+        for (auto& b : data) {
+            b = static_cast<u8>(rng());
+        }
+        return data;
+    }
+
+    // Change detection hash used by scans and the storage watcher
+    void BM_FastHash(benchmark::State& st) {
+        auto data = random_bytes(static_cast<size_t>(st.range(0)));
+        for (auto _ : st) {
+            benchmark::DoNotOptimize(cloud::xxh64(data.data(), data.size()));
+        }
+        st.SetBytesProcessed(st.iterations() * st.range(0));
+    }
+
+    // Sync hash, computed eagerly on upload and lazily for scanned files
+    void BM_StrongHash(benchmark::State& st) {
+        auto data = random_bytes(static_cast<size_t>(st.range(0)));
+        for (auto _ : st) {
+            benchmark::DoNotOptimize(sync::hash_bytes(data.data(), data.size()));
+        }
+        st.SetBytesProcessed(st.iterations() * st.range(0));
+    }
+
+} // namespace
+
+BENCHMARK(BM_FastHash)->Arg(4 << 10)->Arg(1 << 20)->Arg(16 << 20);
+BENCHMARK(BM_StrongHash)->Arg(4 << 10)->Arg(1 << 20)->Arg(16 << 20);
@@ -0,0 +1,60 @@
+#include "corpus.h"
+#include <benchmark/benchmark.h>
+#include <condition_variable>
+#include <mutex>
+#include <sap_cloud/io_engine.h>
+
+using namespace sap;
+using cloud::bench::Corpus;
+
+namespace {
+
+    // Read every corpus file with all reads in flight at once (many
+    // concurrent small downloads); arg 1 selects the backend
+    void BM_IoReadAll(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        const auto& root = corpus.files_dir();
+        cloud::IoOptions options;
+        options.backend = st.range(1) == 0 ? cloud::EIoBackend::Threads : cloud::EIoBackend::Uring;
+        auto engine = cloud::IoEngine::create(options);
+        if (!engine) {
+            st.SkipWithError(engine.error().c_str());
+            return;
+        }
+        std::vector<std::filesystem::path> paths;
+        for (const auto& file : corpus.files()) {
+            paths.push_back(root / file.path);
+        }
+        i64 bytes = 0;
+        for (auto _ : st) {
+            std::mutex mutex;
+            std::condition_variable cv;
+            size_t remaining = paths.size();
+            size_t failed = 0;
+            for (const auto& path : paths) {
+                engine.value()->async_read(path, [&](stl::result<std::vector<u8>> data) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (data) {
+                        bytes += static_cast<i64>(data.value().size());
+                    } else {
+                        ++failed;
+                    }
+                    if (--remaining == 0) {
+                        cv.notify_one();
+                    }
+                });
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [&] { return remaining == 0; });
+            if (failed > 0) {
+                st.SkipWithError("read failed");
+                break;
+            }
+        }
+        st.SetBytesProcessed(bytes);
+        st.SetItemsProcessed(st.iterations() * static_cast<i64>(paths.size()));
+    }
+
+} // namespace
+
+BENCHMARK(BM_IoReadAll)->ArgsProduct({{10000}, {0, 1}})->Unit(benchmark::kMillisecond);
@@ -0,0 +1,109 @@
+#include "corpus.h"
+#include <benchmark/benchmark.h>
+#include <nlohmann/json.hpp>
+#include <sap_cloud/binary_codec.h>
+#include <sap_cloud/json_writer.h>
+#include <sap_sync/protocol.h>
+#include <sap_sync/sync_types.h>
+
+using namespace sap;
+using cloud::bench::Corpus;
+
+namespace {
+
+    sync::SyncState make_sync_state(size_t count) {
+        sync::SyncState state;
+        state.server_time = cloud::bench::corpus_epoch;
+        state.files = Corpus::get(count).files();
+        return state;
+    }
+
+    sync::NoteListResponse make_note_list(size_t count) {
+        sync::NoteListResponse list;
+        const auto& notes = Corpus::get(count).notes();
+        list.total = static_cast<i64>(notes.size());
+        list.notes.reserve(notes.size());
+        for (const auto& note : notes) {
+            sync::NoteListItem item;
+            item.id = note.meta.id;
+            item.title = note.meta.title;
+            item.tags = note.meta.tags;
+            item.updated_at = note.meta.updated_at;
+            item.preview = sync::generate_preview(note.body);
+            list.notes.push_back(std::move(item));
+        }
+        return list;
+    }
+
+    template <typename T>
+    void serialize_nlohmann(benchmark::State& st, const T& value) {
+        for (auto _ : st) {
+            nlohmann::json j = value;
+            std::string out = j.dump();
+            benchmark::DoNotOptimize(out.data());
+        }
+        st.SetItemsProcessed(st.iterations() * st.range(0));
+    }
+
+    // Same path as Server::json_response: per-thread buffer reused across calls
+    template <typename T>
+    void serialize_writer(benchmark::State& st, const T& value) {
+        std::string buffer;
+        for (auto _ : st) {
+            cloud::json::serialize(value, buffer);
+            benchmark::DoNotOptimize(buffer.data());
+        }
+        st.SetItemsProcessed(st.iterations() * st.range(0));
+        st.SetBytesProcessed(st.iterations() * static_cast<i64>(buffer.size()));
+    }
+
+    void BM_SyncState_Binary(benchmark::State& st) {
+        auto state = make_sync_state(static_cast<size_t>(st.range(0)));
+        std::string buffer;
+        for (auto _ : st) {
+            cloud::binary::encode(state, buffer);
+            benchmark::DoNotOptimize(buffer.data());
+        }
+        st.SetItemsProcessed(st.iterations() * st.range(0));
+        st.SetBytesProcessed(st.iterations() * static_cast<i64>(buffer.size()));
+    }
+
+    void BM_SyncStateDecode_Nlohmann(benchmark::State& st) {
+        std::string encoded;
+        cloud::json::serialize(make_sync_state(static_cast<size_t>(st.range(0))), encoded);
+        for (auto _ : st) {
+            auto state = nlohmann::json::parse(encoded).get<sync::SyncState>();
+            benchmark::DoNotOptimize(state.files.data());
+        }
+        st.SetItemsProcessed(st.iterations() * st.range(0));
+        st.SetBytesProcessed(st.iterations() * static_cast<i64>(encoded.size()));
+    }
+
+    void BM_SyncStateDecode_Binary(benchmark::State& st) {
+        std::string encoded;
+        cloud::binary::encode(make_sync_state(static_cast<size_t>(st.range(0))), encoded);
+        for (auto _ : st) {
+            auto state = cloud::binary::decode_sync_state(encoded);
+            benchmark::DoNotOptimize(state.value().files.data());
+        }
+        st.SetItemsProcessed(st.iterations() * st.range(0));
+        st.SetBytesProcessed(st.iterations() * static_cast<i64>(encoded.size()));
+    }
+
+    void BM_SyncState_Nlohmann(benchmark::State& st) { serialize_nlohmann(st, make_sync_state(static_cast<size_t>(st.range(0)))); }
+
+    void BM_SyncState_Writer(benchmark::State& st) { serialize_writer(st, make_sync_state(static_cast<size_t>(st.range(0)))); }
+
+    void BM_NoteList_Nlohmann(benchmark::State& st) { serialize_nlohmann(st, make_note_list(static_cast<size_t>(st.range(0)))); }
+
+    void BM_NoteList_Writer(benchmark::State& st) { serialize_writer(st, make_note_list(static_cast<size_t>(st.range(0)))); }
+
+} // namespace
+
+BENCHMARK(BM_SyncState_Nlohmann)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SyncState_Writer)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SyncState_Binary)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SyncStateDecode_Nlohmann)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SyncStateDecode_Binary)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NoteList_Nlohmann)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NoteList_Writer)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,62 @@
+#include "corpus.h"
+#include <benchmark/benchmark.h>
+#include <sap_cloud/io_engine.h>
+#include <sap_cloud/metadata.h>
+#include <sap_cloud/services/file_service.h>
+#include <sap_cloud/services/notes_service.h>
+#include <sap_fs/fs.h>
+
+using namespace sap;
+using cloud::bench::Corpus;
+
+namespace {
+
+    // Shared by every benchmark; the backend is picked the way the server picks it
+    cloud::IoEngine& io_engine() {
+        static std::unique_ptr<cloud::IoEngine> engine = std::move(cloud::IoEngine::create().value());
+        return *engine;
+    }
+
+    // Startup indexing of a files root into an empty database
+    void BM_FileScanAndIndex(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        fs::Filesystem files(corpus.files_dir());
+        for (auto _ : st) {
+            st.PauseTiming();
+            auto store = cloud::storage::MetadataStore::open(corpus.scratch_db("scan"));
+            if (!store) {
+                st.SkipWithError("open store failed");
+                break;
+            }
+            cloud::services::FileService svc(files, store.value(), io_engine(), corpus.files_dir());
+            st.ResumeTiming();
+            auto indexed = svc.scan_and_index();
+            if (!indexed) {
+                st.SkipWithError("scan_and_index failed");
+                break;
+            }
+            benchmark::DoNotOptimize(indexed.value());
+        }
+        st.SetItemsProcessed(st.iterations() * st.range(0));
+    }
+
+    // First page of the note list (metadata for all notes, content for one page)
+    void BM_NoteListNotes(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        fs::Filesystem notes(corpus.notes_dir());
+        cloud::services::NoteService svc(notes, corpus.store(), io_engine(), corpus.notes_dir());
+        cloud::services::NoteService::ListOptions options;
+        for (auto _ : st) {
+            auto list = svc.list_notes(options);
+            if (!list) {
+                st.SkipWithError("list_notes failed");
+                break;
+            }
+            benchmark::DoNotOptimize(list.value().notes.data());
+        }
+    }
+
+} // namespace
+
+BENCHMARK(BM_FileScanAndIndex)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK(BM_NoteListNotes)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,156 @@
+#include "corpus.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <sap_cloud/file_index.h>
+#include <sap_cloud/metadata.h>
+#include <string>
+
+using namespace sap;
+using cloud::bench::Corpus;
+
+namespace {
+
+    // Update rows of an N-row table in place, cycling through existing paths
+    void BM_UpsertFile(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        auto& store = corpus.write_store();
+        const auto& files = corpus.files();
+        size_t i = 0;
+        for (auto _ : st) {
+            sync::FileMetadata meta = files[i % files.size()];
+            meta.updated_at = cloud::bench::corpus_epoch + static_cast<i64>(files.size());
+            auto r = store.upsert_file(meta);
+            if (!r) {
+                st.SkipWithError("upsert_file failed");
+                break;
+            }
+            ++i;
+        }
+        st.SetItemsProcessed(st.iterations());
+    }
+
+    // Delta sync: the newest 1% of files
+    void BM_GetAllFilesSince(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        auto& store = corpus.store();
+        auto since = cloud::bench::corpus_epoch + static_cast<i64>(corpus.size() - corpus.size() / 100);
+        for (auto _ : st) {
+            auto files = store.get_all_files(since);
+            if (!files) {
+                st.SkipWithError("get_all_files failed");
+                break;
+            }
+            benchmark::DoNotOptimize(files.value().data());
+        }
+    }
+
+    // Delta sync answered from a FileIndex loaded from the same table
+    void BM_FileIndexChangedSince(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        auto files = corpus.store().get_all_files();
+        if (!files) {
+            st.SkipWithError("get_all_files failed");
+            return;
+        }
+        cloud::storage::FileIndex index;
+        index.load(files.value());
+        auto since = cloud::bench::corpus_epoch + static_cast<i64>(corpus.size() - corpus.size() / 100);
+        for (auto _ : st) {
+            auto changed = index.changed_since(since);
+            benchmark::DoNotOptimize(changed.data());
+        }
+    }
+
+    // Full sync: every file
+    void BM_GetAllFiles(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        auto& store = corpus.store();
+        for (auto _ : st) {
+            auto files = store.get_all_files();
+            if (!files) {
+                st.SkipWithError("get_all_files failed");
+                break;
+            }
+            benchmark::DoNotOptimize(files.value().data());
+        }
+        st.SetItemsProcessed(st.iterations() * st.range(0));
+    }
+
+    void BM_SearchNotes(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        auto& store = corpus.store();
+        size_t i = 0;
+        for (auto _ : st) {
+            auto notes = store.search_notes(cloud::bench::vocabulary_word(i++));
+            if (!notes) {
+                st.SkipWithError("search_notes failed");
+                break;
+            }
+            benchmark::DoNotOptimize(notes.value().data());
+        }
+    }
+
+    void BM_SetNoteTags(benchmark::State& st) {
+        auto& corpus = Corpus::get(static_cast<size_t>(st.range(0)));
+        auto& store = corpus.write_store();
+        const auto& notes = corpus.notes();
+        size_t i = 0;
+        for (auto _ : st) {
+            // Rotate tags so every call actually changes the rows
+            const auto& note = notes[i % notes.size()];
+            std::vector<std::string> tags = {std::string(cloud::bench::vocabulary_word(i)), std::string(cloud::bench::vocabulary_word(i + 1))};
+            auto r = store.set_note_tags(note.meta.id, tags);
+            if (!r) {
+                st.SkipWithError("set_note_tags failed");
+                break;
+            }
+            ++i;
+        }
+        st.SetItemsProcessed(st.iterations());
+    }
+
+    // Inserts from concurrent request threads, each committed on its own
+    // (arg 0) or group-committed by the metadata writer (arg 1)
+    void BM_ConcurrentUpsertFile(benchmark::State& st) {
+        static std::unique_ptr<cloud::storage::MetadataStore> store;
+        if (st.thread_index() == 0) {
+            auto opened = cloud::storage::MetadataStore::open(Corpus::get(10000).scratch_db("group_commit"));
+            if (opened && st.range(0) != 0) {
+                auto started = opened.value().start_writer();
+                if (!started) {
+                    st.SkipWithError("start_writer failed");
+                }
+            }
+            if (opened) {
+                store = std::make_unique<cloud::storage::MetadataStore>(std::move(opened.value()));
+            } else {
+                st.SkipWithError("open store failed");
+            }
+        }
+        size_t i = 0;
+        for (auto _ : st) {
+            sync::FileMetadata meta;
+            meta.path = "t" + std::to_string(st.thread_index()) + "/" + std::to_string(i++);
+            meta.hash = "h";
+            meta.created_at = meta.updated_at = cloud::bench::corpus_epoch;
+            auto r = store->upsert_file(meta);
+            if (!r) {
+                st.SkipWithError("upsert_file failed");
+                break;
+            }
+        }
+        st.SetItemsProcessed(st.iterations());
+        if (st.thread_index() == 0) {
+            store.reset();
+        }
+    }
+
+} // namespace
+
+BENCHMARK(BM_ConcurrentUpsertFile)->Arg(0)->Arg(1)->Threads(8)->UseRealTime()->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_UpsertFile)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_GetAllFilesSince)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_FileIndexChangedSince)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_GetAllFiles)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SearchNotes)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SetNoteTags)->Apply(cloud::bench::corpus_sizes)->Unit(benchmark::kMicrosecond);
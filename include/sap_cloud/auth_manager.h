@@ -1,16 +1,40 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <optional>
 #include <sap_cloud/config.h>
 #include <sap_cloud/metadata.h>
 #include <sap_core/result.h>
 #include <sap_core/types.h>
 #include <sap_sync/auth.h>
 #include <string>
-#include <vector>
+#include <unordered_map>
 
 namespace sap::cloud::auth {
 
+    // Authorized key parsed once at load time
+    struct AuthorizedKey {
+        std::string canonical; // "<type> <base64>" without options or comment
+        std::string fingerprint; // As printed by ssh-keygen -l, for logs
+        sync::PublicKey key; // Ready for signature verification
+    };
+
+    // Immutable snapshot of authorized_keys, indexed by the canonical key.
+    // Readers grab the current snapshot without locking; a reload builds a
+    // new one and swaps it in.
+    struct KeySet {
+        std::unordered_map<std::string, AuthorizedKey> by_key;
+    };
+
+    // "<type> <base64>" part of an authorized_keys line or client-supplied key
+    [[nodiscard]] std::optional<std::string> canonical_key(std::string_view line);
+
+    // OpenSSH fingerprint of a canonical key: "SHA256:" and the unpadded base64
+    // SHA-256 of the key blob. Empty if the blob isn't valid base64.
+    [[nodiscard]] std::string key_fingerprint(std::string_view canonical);
+
     // Manages SSH key-based authentication.
     // Authentication flow:
     // 1. Client sends public key to /auth/challenge
@@ -25,7 +49,8 @@ namespace sap::cloud::auth {
         // Load authorized keys from file
         [[nodiscard]] stl::result<> load_authorized_keys();
 
-        // Reload authorized keys (e.g., on SIGHUP)
+        // Reload authorized keys (e.g., on SIGHUP). Requests keep using the
+        // previous key set until the new one is published.
         [[nodiscard]] stl::result<> reload_authorized_keys();
 
         // Generate challenge for a public key
@@ -41,13 +66,17 @@ namespace sap::cloud::auth {
         [[nodiscard]] stl::result<> cleanup_expired();
 
         // Check if a public key is authorized
-        [[nodiscard]] bool is_authorized(std::string_view public_key);
+        [[nodiscard]] bool is_authorized(std::string_view public_key) const;
+
+        // Look up an authorized key (nullptr if not authorized). The result keeps
+        // its snapshot alive across a concurrent reload.
+        [[nodiscard]] std::shared_ptr<const AuthorizedKey> find_key(std::string_view public_key) const;
 
     private:
         storage::MetadataStore& m_Meta;
         AuthConfig m_Config;
-        std::vector<std::string> m_AuthorizedKeys;
-        mutable std::mutex m_KeysMutex;
+        std::atomic<std::shared_ptr<const KeySet>> m_Keys;
+        std::mutex m_ReloadMutex; // Serializes writers only
     };
 
 } // namespace sap::cloud::auth
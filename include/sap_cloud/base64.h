@@ -0,0 +1,17 @@
+#pragma once
+
+#include <sap_core/types.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud {
+
+    // Standard alphabet (RFC 4648 section 4) with '=' padding
+    [[nodiscard]] std::string encode_base64(const u8* data, size_t size);
+
+    // Appends the decoded bytes to out; padding is optional. False on a
+    // character outside the alphabet or a truncated final group.
+    [[nodiscard]] bool decode_base64(std::string_view text, std::vector<u8>& out);
+
+} // namespace sap::cloud
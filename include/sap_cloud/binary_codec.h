@@ -0,0 +1,48 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <sap_sync/sync_types.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud::binary {
+
+    // =============================================================================
+    // Binary Sync Codec
+    // =============================================================================
+    // Compact alternative to the JSON encoding of SyncState and file metadata
+    // lists, served when the request's Accept header lists media_type.
+    //
+    // Layout (varint = unsigned LEB128, svarint = zigzag varint):
+    //   "SAPS" u8 version u8 payload (1 = SyncState, 2 = file list)
+    //   [SyncState only] svarint server_time
+    //   varint count, then per file, sorted by path:
+    //     varint shared   - bytes shared with the previous path
+    //     varint length   - length of the rest, followed by its bytes
+    //     u8 flags        - 1 deleted, 2 hash is 32 digest bytes, 4 hash is text
+    //     hash            - 32 raw bytes, or varint length + bytes, or nothing
+    //     svarint size
+    //     svarint updated_at - delta from the previous file's updated_at
+    //     svarint created_at - delta from this file's updated_at
+    //     svarint mtime      - delta from this file's updated_at
+    //
+    // Decoding reproduces the input exactly, apart from the order of files.
+    // =============================================================================
+
+    inline constexpr std::string_view media_type = "application/vnd.sapcloud.sync";
+
+    // Whether an Accept header value lists media_type (and doesn't refuse it with q=0)
+    [[nodiscard]] bool accepts(std::string_view accept);
+
+    // Encode into out, replacing its contents but keeping its capacity
+    void encode(const sync::SyncState& state, std::string& out);
+
+    void encode(const std::vector<sync::FileMetadata>& files, std::string& out);
+
+    [[nodiscard]] stl::result<sync::SyncState> decode_sync_state(std::string_view data);
+
+    [[nodiscard]] stl::result<std::vector<sync::FileMetadata>> decode_files(std::string_view data);
+
+} // namespace sap::cloud::binary
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud {
+
+    // =============================================================================
+    // Bloom Filter
+    // =============================================================================
+    // Set of content hashes as sent by a client to ask which of its files the
+    // server already holds, without listing every hash.
+    //
+    // Wire format: the filter bits, base64 encoded (standard alphabet, padding
+    // optional); bit j is (byte[j / 8] >> (j % 8)) & 1. A hash sets hash_count
+    // bits at (h1 + i * h2) mod bit_count for i in [0, hash_count), where h1
+    // and h2 are its first and second 16 hex digits read as integers. Content
+    // hashes are SHA-256, so no further hashing is needed; anything shorter
+    // than 32 hex digits is run through sync::hash_string first.
+    // =============================================================================
+
+    class BloomFilter {
+    public:
+        static constexpr u32 max_hash_count = 32;
+        static constexpr size_t max_bytes = 64 * 1024 * 1024;
+
+        // bit_count is rounded up to a whole number of bytes
+        BloomFilter(u64 bit_count, u32 hash_count);
+
+        // Filter from its wire format; rejects bad base64, an empty filter and
+        // hash counts outside [1, max_hash_count]
+        [[nodiscard]] static stl::result<BloomFilter> decode(std::string_view base64, i64 hash_count);
+
+        void add(std::string_view hash);
+
+        // False means hash was never added; true may be a false positive
+        [[nodiscard]] bool may_contain(std::string_view hash) const;
+
+        // The bits in wire format
+        [[nodiscard]] std::string encode() const;
+
+        [[nodiscard]] u64 bit_count() const { return m_Bits.size() * 8; }
+        [[nodiscard]] u32 hash_count() const { return m_HashCount; }
+
+    private:
+        BloomFilter(std::vector<u8> bits, u32 hash_count) : m_Bits(std::move(bits)), m_HashCount(hash_count) {}
+
+        std::vector<u8> m_Bits;
+        u32 m_HashCount;
+    };
+
+} // namespace sap::cloud
@@ -16,22 +16,52 @@ namespace sap::cloud {
         std::string host = "127.0.0.1";
         u16 port = 8080;
         bool multithreaded = true;
+        bool metrics = true; // Expose GET /metrics (Prometheus text format)
     };
 
     struct StorageConfig {
         std::filesystem::path files_root; // Root for generic files
         std::filesystem::path notes_root; // Root for notes
         std::filesystem::path database; // SQLite database path
+        i64 upload_session_expiry = 86400; // Resumable upload lifetime (seconds)
+        bool watch = true; // Index changes made to the roots outside the API as they happen
+        i64 watch_debounce_ms = 250; // Quiet period before touched paths are re-indexed
+        std::string io_backend = "auto"; // File I/O engine: auto, io_uring or threads
+        i64 io_threads = 4; // Thread pool size when io_uring isn't used
+        i64 io_queue_depth = 64; // File operations in flight on the io_uring backend
+        std::string durability = "balanced"; // strict, balanced or fast (see EDurability)
+        i64 cache_mb = 64; // Memory for cached file contents and note bodies (0 disables)
+        i64 cache_max_entry_kb = 64; // Larger files and notes are always read from disk
+        bool group_commit = true; // Commit metadata writes in batches from a single writer thread
+        i64 group_commit_batch = 256; // Writes per batch at most
+        i64 group_commit_window_us = 1000; // How long a batch waits for more writes (microseconds)
+        bool file_index = false; // Answer sync-state queries from an in-memory copy of the file metadata
+        bool file_index_verify = false; // Also run each such query against the database and log differences
+        bool merkle_tree = true; // Keep a hash tree of the live files for /api/v1/sync/tree
     };
 
     struct AuthConfig {
         std::filesystem::path authorized_keys; // SSH authorized_keys file
         i64 token_expiry = 86400; // Token lifetime (seconds)
         i64 challenge_expiry = 300; // Challenge lifetime (seconds)
+        bool watch_authorized_keys = true; // Reload authorized_keys when it changes
     };
 
     struct LoggingConfig {
         std::string level = "info"; // debug, info, warn, error
+        i64 slow_request_ms = 500; // Log span tree of slower requests (0 = off)
+    };
+
+    struct MaintenanceConfig {
+        bool enabled = true; // Run background maintenance jobs
+        i64 slice_ms = 50; // Longest a job may run before yielding
+        i64 batch_size = 500; // Rows touched per step (bounds each write transaction)
+        i64 tombstone_retention_days = 30; // Keep deletions visible to sync clients this long
+        i64 expiry_interval = 300; // Expired tokens, challenges and uploads (seconds)
+        i64 hash_interval = 10; // Strong hashes of files indexed by scans or the watcher; runs even if disabled (seconds)
+        i64 compaction_interval = 3600; // Tombstone compaction and incremental vacuum (seconds)
+        i64 optimize_interval = 86400; // PRAGMA optimize and full-text index merge (seconds)
+        i64 checkpoint_interval = 30; // WAL checkpoint with durability = fast (seconds)
     };
 
     struct Config {
@@ -39,6 +69,7 @@ namespace sap::cloud {
         StorageConfig storage;
         AuthConfig auth;
         LoggingConfig logging;
+        MaintenanceConfig maintenance;
     };
 
     // Load configuration from file
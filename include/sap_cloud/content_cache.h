@@ -0,0 +1,89 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sap_core/types.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sap::cloud {
+
+    struct ContentCacheOptions {
+        size_t capacity_bytes = 64 * 1024 * 1024; // Total budget across shards (0 disables the cache)
+        size_t max_entry_bytes = 64 * 1024; // Larger values are not cached
+        size_t shards = 16;
+    };
+
+    // What a cached value holds; the same content hash maps to a different value per kind
+    enum class ECacheKind : u8 {
+        File, // Raw file content
+        Note, // Note body with the frontmatter parsed off
+    };
+
+    // =============================================================================
+    // Content Cache
+    // =============================================================================
+    // Size-bounded LRU of hot file contents and parsed note bodies, keyed by
+    // content hash. A changed file gets a new hash, so a stale entry is never
+    // looked up again and simply ages out; nothing has to be invalidated.
+    //
+    // Keys are spread over independently locked shards, each an LRU with an
+    // equal share of the budget, so concurrent readers rarely contend. Values
+    // are shared and immutable: a reader keeps its value alive after it is
+    // evicted. Hits and misses are counted in sap_content_cache_requests_total.
+    // =============================================================================
+
+    class ContentCache {
+    public:
+        using Value = std::shared_ptr<const std::string>;
+
+        struct Stats {
+            u64 hits = 0;
+            u64 misses = 0;
+            size_t entries = 0;
+            size_t bytes = 0;
+        };
+
+        explicit ContentCache(const ContentCacheOptions& options = {});
+        ContentCache(const ContentCache&) = delete;
+        ContentCache& operator=(const ContentCache&) = delete;
+
+        // Cached value for hash, or null. An empty hash (not yet computed) never hits.
+        [[nodiscard]] Value get(ECacheKind kind, std::string_view hash);
+
+        // Insert or refresh value for hash, evicting least recently used
+        // entries of its shard to stay in budget. Values over max_entry_bytes
+        // and empty hashes are ignored.
+        void put(ECacheKind kind, std::string_view hash, std::string value);
+
+        // Whether a value of size bytes would be cached
+        [[nodiscard]] bool admits(size_t size) const { return m_ShardCapacity > 0 && size <= m_MaxEntry; }
+
+        [[nodiscard]] Stats stats() const;
+
+    private:
+        struct Entry {
+            std::string key;
+            Value value;
+        };
+
+        struct Shard {
+            mutable std::mutex mutex; // Guards everything below
+            std::list<Entry> lru; // Most recently used first
+            std::unordered_map<std::string_view, std::list<Entry>::iterator> index; // Keys view Entry::key
+            size_t bytes = 0;
+            u64 hits = 0;
+            u64 misses = 0;
+        };
+
+        [[nodiscard]] Shard& shard_for(std::string_view key);
+
+        size_t m_ShardCapacity;
+        size_t m_MaxEntry;
+        std::vector<Shard> m_Shards;
+    };
+
+} // namespace sap::cloud
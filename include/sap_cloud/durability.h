@@ -0,0 +1,31 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <string_view>
+
+namespace sap::cloud {
+
+    // How much of an acknowledged write survives a crash or power loss
+    // ([storage] durability), traded against write latency
+    enum class EDurability : u8 {
+        Strict, // File data and directory entries fsynced; SQLite synchronous = FULL
+        Balanced, // File data fsynced; SQLite synchronous = NORMAL (last commits may be lost, never corrupted)
+        Fast, // Nothing fsynced on the request path; SQLite synchronous = OFF, WAL checkpointed in the background
+    };
+
+    // Parse "strict", "balanced" or "fast"
+    [[nodiscard]] inline stl::result<EDurability> parse_durability(std::string_view name) {
+        if (name == "strict") {
+            return EDurability::Strict;
+        }
+        if (name == "balanced") {
+            return EDurability::Balanced;
+        }
+        if (name == "fast") {
+            return EDurability::Fast;
+        }
+        return stl::make_error<EDurability>("Unknown durability mode '{}' (expected strict, balanced or fast)", name);
+    }
+
+} // namespace sap::cloud
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <sap_cloud/task.h>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace sap::cloud {
+
+    // =============================================================================
+    // Executor
+    // =============================================================================
+    // Fixed set of threads running posted work in FIFO order. Work still queued
+    // when the executor is destroyed runs before the threads exit.
+    // =============================================================================
+
+    class Executor {
+    public:
+        explicit Executor(size_t threads);
+        ~Executor();
+        Executor(const Executor&) = delete;
+        Executor& operator=(const Executor&) = delete;
+
+        // Queue work; safe to call from any thread
+        void post(std::function<void()> work);
+
+    private:
+        void run();
+
+        std::mutex m_Mutex; // Guards m_Queue and m_Stopping
+        std::condition_variable m_Wake;
+        std::deque<std::function<void()>> m_Queue;
+        bool m_Stopping = false;
+        std::vector<std::thread> m_Threads;
+    };
+
+    // co_await run_on(executor, fn): call fn on one of executor's threads and
+    // resume with its result. fn must be copyable and return a value.
+    template <typename Fn>
+    auto run_on(Executor& executor, Fn fn) {
+        using T = std::invoke_result_t<Fn&>;
+        static_assert(!std::is_void_v<T>, "run_on() needs a result to resume with");
+        return await_callback<T>([&executor, fn = std::move(fn)](auto done) { executor.post([fn, done] { done(fn()); }); });
+    }
+
+} // namespace sap::cloud
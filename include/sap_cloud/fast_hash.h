@@ -0,0 +1,25 @@
+#pragma once
+
+#include <sap_core/types.h>
+#include <string>
+#include <string_view>
+
+namespace sap::cloud {
+
+    // =============================================================================
+    // Fast Hash
+    // =============================================================================
+    // XXH64: a non-cryptographic 64-bit hash running at memory bandwidth. Used
+    // to tell whether file content changed without paying for the strong sync
+    // hash; never use it where collisions could be provoked on purpose.
+    // =============================================================================
+
+    // XXH64 digest of data
+    [[nodiscard]] u64 xxh64(const void* data, size_t size, u64 seed = 0);
+
+    // XXH64 digest as 16 lowercase hex digits
+    [[nodiscard]] std::string fast_hash(const void* data, size_t size);
+
+    [[nodiscard]] inline std::string fast_hash(std::string_view data) { return fast_hash(data.data(), data.size()); }
+
+} // namespace sap::cloud
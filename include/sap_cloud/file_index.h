@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sap_core/types.h>
+#include <sap_sync/sync_types.h>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace sap::cloud::storage {
+
+    // =============================================================================
+    // File Index
+    // =============================================================================
+    // In-memory, column-oriented copy of the files table for sync-state queries.
+    //
+    // Each file is a slot; its fields live in parallel arrays indexed by slot:
+    // sizes and timestamps as plain integers, hashes as 32 raw digest bytes and
+    // paths interned once in an append-only arena. A separate array of
+    // (updated_at, slot) pairs is kept sorted, so "changed since" is a binary
+    // search followed by a contiguous scan instead of a table query.
+    //
+    // The index holds no opinion of its own: MetadataStore loads it from the
+    // files table and re-reads every row it commits a change to (see
+    // MetadataStore::enable_file_index). Readers take a shared lock; the
+    // store serializes updates so a re-read and its apply are atomic.
+    // =============================================================================
+
+    class FileIndex {
+    public:
+        FileIndex() = default;
+        FileIndex(const FileIndex&) = delete;
+        FileIndex& operator=(const FileIndex&) = delete;
+
+        // Replace the contents with rows (a full files table read)
+        void load(const std::vector<sync::FileMetadata>& rows);
+
+        // Insert or replace the entry for meta.path
+        void apply(const sync::FileMetadata& meta);
+
+        // Drop the entry for path, if any
+        void erase(std::string_view path);
+
+        [[nodiscard]] std::optional<sync::FileMetadata> find(std::string_view path) const;
+
+        // Files updated after since (all files if unset), oldest change first
+        [[nodiscard]] std::vector<sync::FileMetadata> changed_since(std::optional<sync::Timestamp> since = std::nullopt) const;
+
+        // Differences from rows (a files table read, limited to rows updated
+        // after since if set), one line each; empty if the index holds exactly
+        // these rows. At most limit lines are returned.
+        [[nodiscard]] std::vector<std::string> diff(const std::vector<sync::FileMetadata>& rows, std::optional<sync::Timestamp> since = std::nullopt,
+                                                    size_t limit = 16) const;
+
+        [[nodiscard]] size_t size() const;
+
+        // Bytes of path storage allocated, including bytes of erased paths not yet reclaimed
+        [[nodiscard]] size_t arena_bytes() const;
+
+    private:
+        using Digest = std::array<u8, 32>;
+
+        static constexpr u8 kDeleted = 1 << 0;
+        static constexpr u8 kHashed = 1 << 1; // m_Digests holds the hash
+        static constexpr u8 kOddHash = 1 << 2; // Hash isn't 64 hex digits; kept in m_OddHashes
+
+        struct Stamp {
+            sync::Timestamp updated_at;
+            u32 slot;
+            bool live; // False once the slot's updated_at changed or it was erased
+        };
+
+        // Path bytes live in chunks that never move, so views into them stay
+        // valid as the arena grows. Bytes of erased paths are reclaimed by
+        // compact() once they outweigh the live ones.
+        static constexpr size_t kChunkBytes = 64 * 1024;
+
+        [[nodiscard]] std::string_view intern(std::string_view path);
+        [[nodiscard]] sync::FileMetadata row(u32 slot) const;
+        [[nodiscard]] std::string hash_of(u32 slot) const;
+        void set_row(u32 slot, const sync::FileMetadata& meta);
+        void stamp(u32 slot, sync::Timestamp updated_at);
+        void unstamp(u32 slot);
+        void release_path(u32 slot);
+        void compact();
+        void clear();
+
+        mutable std::shared_mutex m_Mutex; // Guards everything below
+
+        // Columns, indexed by slot
+        std::vector<std::string_view> m_Paths;
+        std::vector<Digest> m_Digests;
+        std::vector<i64> m_Sizes;
+        std::vector<sync::Timestamp> m_Mtimes;
+        std::vector<sync::Timestamp> m_Created;
+        std::vector<sync::Timestamp> m_Updated;
+        std::vector<u8> m_Flags;
+
+        std::vector<Stamp> m_Order; // Sorted by (updated_at, slot); superseded entries are skipped
+        size_t m_Stale = 0; // Superseded entries in m_Order
+        std::vector<u32> m_FreeSlots;
+        std::unordered_map<std::string_view, u32> m_Slots; // Keys view the arena
+        std::unordered_map<u32, std::string> m_OddHashes;
+        std::vector<std::unique_ptr<char[]>> m_Arena;
+        size_t m_ArenaUsed = kChunkBytes; // Bytes used in the last chunk
+        size_t m_ArenaBytes = 0; // Bytes allocated across all chunks
+        size_t m_DeadBytes = 0; // Arena bytes of erased or replaced paths
+    };
+
+} // namespace sap::cloud::storage
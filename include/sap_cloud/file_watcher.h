@@ -0,0 +1,87 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <thread>
+#include <unordered_map>
+
+namespace sap::cloud {
+
+    enum class EWatchEvent : u8 {
+        Written, // File closed after writing, or moved/created into the directory
+        Removed, // File deleted or moved out of the directory
+        Overflow, // Kernel queue overflowed; events were lost, rescan if it matters
+    };
+
+    struct WatchEvent {
+        EWatchEvent kind;
+        std::filesystem::path path; // Empty for Overflow
+    };
+
+    // =============================================================================
+    // File Watcher
+    // =============================================================================
+    // Watches directories for file changes with inotify and delivers events to
+    // a callback on a dedicated background thread. Directories are watched
+    // rather than individual files so that atomic replace-by-rename (how most
+    // editors and tools save) is seen as a write of the target name.
+    //
+    // Trees added with add_tree() follow new subdirectories as they appear.
+    // Files already inside a directory when it appears (moved in, or written
+    // before its watch was in place) are reported as written; a directory
+    // moved or deleted out of the tree is reported as one Removed event for
+    // the directory itself.
+    //
+    // Only available on Linux; create() fails elsewhere.
+    // =============================================================================
+
+    class FileWatcher {
+    public:
+        using Callback = std::function<void(const WatchEvent&)>;
+
+        static stl::result<std::unique_ptr<FileWatcher>> create(Callback callback);
+
+        ~FileWatcher();
+        FileWatcher(const FileWatcher&) = delete;
+        FileWatcher& operator=(const FileWatcher&) = delete;
+
+        // Watch the files directly inside dir
+        [[nodiscard]] stl::result<> add_directory(const std::filesystem::path& dir);
+
+        // Watch every file below root, including subdirectories created later
+        [[nodiscard]] stl::result<> add_tree(const std::filesystem::path& root);
+
+        // Stop the background thread (idempotent)
+        void stop();
+
+    private:
+        FileWatcher(int inotify_fd, int wake_fd, Callback callback);
+
+        struct WatchedDir {
+            std::filesystem::path path;
+            bool recursive = false;
+        };
+
+        void run();
+
+        [[nodiscard]] stl::result<> watch(const std::filesystem::path& dir, bool recursive);
+
+        // A directory appeared inside a watched tree: watch it and report its files
+        void on_directory_added(const std::filesystem::path& dir);
+
+        // A directory left a watched tree: drop the watches below it
+        void on_directory_removed(const std::filesystem::path& dir);
+
+        int m_InotifyFd;
+        int m_WakeFd; // eventfd used to interrupt poll() on stop
+        Callback m_Callback;
+        std::mutex m_Mutex; // Guards m_Dirs
+        std::unordered_map<int, WatchedDir> m_Dirs; // Watch descriptor -> directory
+        std::thread m_Thread;
+    };
+
+} // namespace sap::cloud
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <sap_cloud/config.h>
+#include <sap_cloud/durability.h>
+#include <sap_cloud/task.h>
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud {
+
+    enum class EIoBackend : u8 {
+        Auto, // io_uring when available, otherwise the thread pool
+        Uring,
+        Threads,
+    };
+
+    struct IoOptions {
+        EIoBackend backend = EIoBackend::Auto;
+        size_t threads = 4; // Thread pool size
+        u32 queue_depth = 64; // io_uring submission queue entries (operations in flight)
+        EDurability durability = EDurability::Balanced; // Applied by sync_file() and commit()
+    };
+
+    // Parse "auto", "io_uring" or "threads"
+    [[nodiscard]] stl::result<EIoBackend> parse_io_backend(std::string_view name);
+
+    // Options from the [storage] io_* and durability settings
+    [[nodiscard]] stl::result<IoOptions> io_options(const StorageConfig& storage);
+
+    // Join a client-supplied relative path onto root, rejecting absolute paths
+    // and paths that escape root
+    [[nodiscard]] stl::result<std::filesystem::path> resolve_under(const std::filesystem::path& root, std::string_view path);
+
+    // =============================================================================
+    // I/O Engine
+    // =============================================================================
+    // Performs whole-file reads and writes, fsyncs and renames off the calling
+    // thread. The io_uring backend drives every operation from a single ring
+    // thread, so the number of blocking threads no longer grows with the number
+    // of transfers; the thread pool backend runs the same operations as
+    // ordinary blocking calls on a fixed set of threads and is used where
+    // io_uring is unavailable (old kernels, seccomp-restricted containers) or
+    // not compiled in (SAP_CLOUD_IO_URING).
+    //
+    // Completions run on an engine thread and must not block. Paths are used
+    // as given; callers resolve client paths with resolve_under() first.
+    // =============================================================================
+
+    class IoEngine {
+    public:
+        using ReadDone = std::function<void(stl::result<std::vector<u8>>)>;
+        using Done = std::function<void(stl::result<>)>;
+
+        // Create the engine selected by options; Auto falls back to the thread
+        // pool when io_uring can't be set up
+        static stl::result<std::unique_ptr<IoEngine>> create(const IoOptions& options = {});
+
+        virtual ~IoEngine() = default;
+
+        // Name of the backend in use, for logs
+        [[nodiscard]] virtual std::string_view backend() const = 0;
+
+        // Read the whole file at path
+        virtual void async_read(std::filesystem::path path, ReadDone done) = 0;
+
+        // Create or truncate path and write data, creating missing parent directories
+        void async_write(std::filesystem::path path, std::vector<u8> data, Done done);
+
+        // Flush a file or directory to stable storage
+        virtual void async_fsync(std::filesystem::path path, Done done) = 0;
+
+        // Rename from to to, replacing to (same filesystem)
+        virtual void async_rename(std::filesystem::path from, std::filesystem::path to, Done done) = 0;
+
+        // Blocking forms: submit and wait for the completion
+        [[nodiscard]] stl::result<std::vector<u8>> read(const std::filesystem::path& path);
+
+        // data must stay valid until write() returns; it is not copied
+        [[nodiscard]] stl::result<> write(const std::filesystem::path& path, std::span<const u8> data);
+
+        [[nodiscard]] stl::result<> fsync(const std::filesystem::path& path);
+
+        [[nodiscard]] stl::result<> rename(const std::filesystem::path& from, const std::filesystem::path& to);
+
+        // Durability mode of the write path
+        [[nodiscard]] EDurability durability() const { return m_Durability; }
+
+        // Make a completely written file durable as the mode requires: its
+        // data (strict, balanced) and its directory entry (strict)
+        [[nodiscard]] stl::result<> sync_file(const std::filesystem::path& path);
+
+        // Replace target with a completely written staged file: sync the staged
+        // data (strict, balanced), rename it over target, then sync target's
+        // directory so the rename itself survives a crash (strict)
+        [[nodiscard]] stl::result<> commit(const std::filesystem::path& staged, const std::filesystem::path& target);
+
+        // Move from over to, then sync both directories so the move survives a
+        // crash (strict). The data itself is untouched.
+        [[nodiscard]] stl::result<> move(const std::filesystem::path& from, const std::filesystem::path& to);
+
+        // Create or truncate to with the content of from, creating missing parent
+        // directories: a reflink clone where the filesystem supports one, else
+        // copy_file_range, else a read/write loop. Neither backend has a clone
+        // operation, so this runs on the calling thread; durability is left to
+        // sync_file() or commit().
+        [[nodiscard]] stl::result<> copy(const std::filesystem::path& from, const std::filesystem::path& to);
+
+    protected:
+        IoEngine() = default;
+
+        // async_write() of borrowed data; callers keep data alive until done runs
+        virtual void async_write_view(std::filesystem::path path, std::span<const u8> data, Done done) = 0;
+
+    private:
+        EDurability m_Durability = EDurability::Balanced;
+    };
+
+    // Awaitable forms for coroutines, e.g. auto data = co_await co_read(io, path)
+    [[nodiscard]] inline auto co_read(IoEngine& io, std::filesystem::path path) {
+        return await_callback<stl::result<std::vector<u8>>>(
+            [&io, path = std::move(path)](auto done) { io.async_read(path, std::move(done)); });
+    }
+
+    [[nodiscard]] inline auto co_write(IoEngine& io, std::filesystem::path path, std::vector<u8> data) {
+        return await_callback<stl::result<>>(
+            [&io, path = std::move(path), data = std::move(data)](auto done) mutable { io.async_write(path, std::move(data), std::move(done)); });
+    }
+
+    [[nodiscard]] inline auto co_fsync(IoEngine& io, std::filesystem::path path) {
+        return await_callback<stl::result<>>([&io, path = std::move(path)](auto done) { io.async_fsync(path, std::move(done)); });
+    }
+
+    [[nodiscard]] inline auto co_rename(IoEngine& io, std::filesystem::path from, std::filesystem::path to) {
+        return await_callback<stl::result<>>(
+            [&io, from = std::move(from), to = std::move(to)](auto done) { io.async_rename(from, to, std::move(done)); });
+    }
+
+    namespace detail {
+        // io_uring backend, or an error when it is compiled out or the kernel refuses it
+        stl::result<std::unique_ptr<IoEngine>> create_uring_engine(u32 queue_depth);
+    } // namespace detail
+
+} // namespace sap::cloud
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <sap_sync/sync_types.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud::json {
+
+    // Body of POST /api/v1/sync/hashes: either an exact list of content
+    // hashes or a Bloom filter of them (see BloomFilter)
+    struct HashQuery {
+        std::vector<std::string> hashes;
+        std::string bloom; // Base64 filter bits
+        i64 bloom_hashes = 0; // Bit positions per hash
+    };
+
+    // Body of POST /api/v1/files/move and /api/v1/files/copy
+    struct FileTransfer {
+        std::string from;
+        std::string to;
+        bool overwrite = false; // Replace a live file at to
+    };
+
+    // Request body decoders built on the nlohmann SAX interface.
+    // Fields are decoded straight into the request struct (string tokens are
+    // moved, not copied) without materializing a JSON DOM. Unknown keys are
+    // skipped; wrong types and missing required fields are reported as errors.
+
+    // Required: title. Optional: content, tags.
+    [[nodiscard]] stl::result<sync::NoteCreateRequest> parse_note_create(std::string_view body);
+
+    // All fields optional; null is treated as absent.
+    [[nodiscard]] stl::result<sync::NoteUpdateRequest> parse_note_update(std::string_view body);
+
+    // Required: public_key.
+    [[nodiscard]] stl::result<sync::ChallengeRequest> parse_challenge_request(std::string_view body);
+
+    // Required: public_key, challenge, signature.
+    [[nodiscard]] stl::result<sync::VerifyRequest> parse_verify_request(std::string_view body);
+
+    // Required: from, to. Optional: overwrite.
+    [[nodiscard]] stl::result<FileTransfer> parse_file_transfer(std::string_view body);
+
+    // Exactly one of: hashes, or bloom with bloom_hashes.
+    [[nodiscard]] stl::result<HashQuery> parse_hash_query(std::string_view body);
+
+} // namespace sap::cloud::json
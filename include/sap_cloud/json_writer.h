@@ -0,0 +1,64 @@
+#pragma once
+
+#include <sap_core/types.h>
+#include <sap_sync/sync_types.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud::json {
+
+    // Streaming JSON writer that appends directly to a caller-owned buffer.
+    // Used for hot response types instead of building an nlohmann::json DOM;
+    // output is equivalent to the nlohmann serialization of the same struct.
+    class Writer {
+    public:
+        explicit Writer(std::string& out) : m_Out(out) {}
+
+        void begin_object();
+
+        void end_object();
+
+        void begin_array();
+
+        void end_array();
+
+        void key(std::string_view name);
+
+        void value(std::string_view str);
+
+        void value(i64 number);
+
+        void value(bool flag);
+
+        // Disambiguate string literals from bool
+        void value(const char* str) { value(std::string_view(str)); }
+
+    private:
+        void separator();
+
+        void write_escaped(std::string_view str);
+
+        std::string& m_Out;
+        bool m_NeedComma = false;
+    };
+
+    void write(Writer& w, const sync::FileMetadata& meta);
+
+    void write(Writer& w, const std::vector<sync::FileMetadata>& files);
+
+    void write(Writer& w, const sync::SyncState& state);
+
+    void write(Writer& w, const sync::NoteListResponse& list);
+
+    void write(Writer& w, const sync::TagListResponse& tags);
+
+    // Serialize into out, replacing its contents but keeping its capacity
+    template <typename T>
+    void serialize(const T& value, std::string& out) {
+        out.clear();
+        Writer w(out);
+        write(w, value);
+    }
+
+} // namespace sap::cloud::json
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <sap_cloud/file_watcher.h>
+#include <sap_cloud/services/file_service.h>
+#include <sap_cloud/services/notes_service.h>
+#include <sap_core/result.h>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+namespace sap::cloud {
+
+    // =============================================================================
+    // Live Indexer
+    // =============================================================================
+    // Keeps the metadata and full-text index current with changes made to
+    // files_root and notes_root outside the API (sync tools, editors, cp).
+    // Watch events are coalesced per path and handed to the services'
+    // index_path() once the tree has been quiet for the debounce interval, or
+    // max_delay after the first pending event under a steady stream, so a burst
+    // of writes to one file costs a single re-index. Only touched paths are
+    // looked at; when the kernel drops events the affected root is reconciled
+    // path by path, which re-reads only files whose size or mtime changed.
+    // =============================================================================
+
+    class LiveIndexer {
+    public:
+        struct Options {
+            std::chrono::milliseconds debounce{250};
+            std::chrono::milliseconds max_delay{2000};
+        };
+
+        static stl::result<std::unique_ptr<LiveIndexer>> create(services::FileService& files, const std::filesystem::path& files_root,
+                                                                services::NoteService& notes, const std::filesystem::path& notes_root,
+                                                                Options options);
+
+        ~LiveIndexer();
+        LiveIndexer(const LiveIndexer&) = delete;
+        LiveIndexer& operator=(const LiveIndexer&) = delete;
+
+        // Stop watching and drop pending events (idempotent)
+        void stop();
+
+    private:
+        enum class ERoot : u8 { Files, Notes };
+
+        struct Pending {
+            std::unordered_set<std::string> paths; // Relative to the root
+            bool rescan = false;
+        };
+
+        LiveIndexer(services::FileService& files, std::filesystem::path files_root, services::NoteService& notes,
+                    std::filesystem::path notes_root, Options options);
+
+        void on_event(ERoot root, const WatchEvent& event);
+
+        void run();
+
+        void flush(ERoot root, Pending batch);
+
+        // Re-index every path on disk or in the index for root
+        void reconcile(ERoot root, std::unordered_set<std::string>& paths);
+
+        [[nodiscard]] const std::filesystem::path& root_path(ERoot root) const;
+
+        services::FileService& m_Files;
+        services::NoteService& m_Notes;
+        std::filesystem::path m_FilesRoot;
+        std::filesystem::path m_NotesRoot;
+        Options m_Options;
+
+        std::mutex m_Mutex; // Guards everything below
+        std::condition_variable m_Wake;
+        Pending m_Pending[2]; // Indexed by ERoot
+        std::chrono::steady_clock::time_point m_FirstEvent;
+        std::chrono::steady_clock::time_point m_LastEvent;
+        bool m_Stopping = false;
+        std::thread m_Thread;
+
+        // Declared last so they stop delivering events before the state above is destroyed
+        std::unique_ptr<FileWatcher> m_FilesWatcher;
+        std::unique_ptr<FileWatcher> m_NotesWatcher;
+    };
+
+} // namespace sap::cloud
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <sap_core/result.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sap::cloud {
+
+    // =============================================================================
+    // Maintenance Scheduler
+    // =============================================================================
+    // Runs periodic housekeeping jobs on a single background thread. A job is a
+    // step function that does a bounded amount of work (typically one small
+    // transaction) and reports whether more remains. Steps are repeated until
+    // the job is done or its time slice is spent; a job with backlog is resumed
+    // after a short pause so request handlers can take the write lock in
+    // between, otherwise it sleeps until its next interval.
+    // =============================================================================
+
+    class MaintenanceScheduler {
+    public:
+        using Clock = std::chrono::steady_clock;
+        // Returns true while more work remains
+        using Step = std::function<stl::result<bool>()>;
+
+        explicit MaintenanceScheduler(std::chrono::milliseconds slice);
+        ~MaintenanceScheduler();
+        MaintenanceScheduler(const MaintenanceScheduler&) = delete;
+        MaintenanceScheduler& operator=(const MaintenanceScheduler&) = delete;
+
+        // Register a job; must be called before start(). The first run is one
+        // interval after start().
+        void add_job(std::string name, std::chrono::milliseconds interval, Step step);
+
+        // Start the background thread
+        void start();
+
+        // Stop the background thread, finishing the current step (idempotent)
+        void stop();
+
+    private:
+        struct Job {
+            std::string name;
+            std::chrono::milliseconds interval;
+            Step step;
+            Clock::time_point next_run;
+        };
+
+        void run();
+
+        // Runs steps of job until done, failed or out of time; returns when to run it next
+        Clock::time_point run_slice(Job& job);
+
+        std::chrono::milliseconds m_Slice;
+        std::vector<Job> m_Jobs;
+        std::mutex m_Mutex; // Guards m_Stopping
+        std::condition_variable m_Wake;
+        bool m_Stopping = false;
+        std::thread m_Thread;
+    };
+
+} // namespace sap::cloud
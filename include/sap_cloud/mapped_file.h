@@ -0,0 +1,66 @@
+#pragma once
+
+#include <filesystem>
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud {
+
+    // =============================================================================
+    // Mapped File
+    // =============================================================================
+    // Read-only view of a whole file. Large regular files are memory-mapped so
+    // hashing and downloads read straight from the page cache instead of
+    // copying into a heap buffer first; the mapping is released when the view
+    // is destroyed. Small files, and files that can't be mapped (pipes, some
+    // special or network filesystems), are read into an owned buffer instead.
+    //
+    // The content of a mapped file is only stable while nobody modifies the
+    // file in place, and truncating it under a reader faults the reader
+    // (SIGBUS). Only map files the server owns, such as staged uploads; files
+    // in the user tree can be changed by outside tools and are read instead.
+    // =============================================================================
+
+    class MappedFile {
+    public:
+        enum class EAccess : u8 {
+            Sequential, // Read once front to back (hashing, streaming): aggressive read-ahead
+            Random,
+        };
+
+        // Files smaller than this are read rather than mapped
+        static constexpr size_t min_map_size = 64 * 1024;
+
+        static stl::result<MappedFile> open(const std::filesystem::path& path, EAccess access = EAccess::Sequential);
+
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        [[nodiscard]] const u8* data() const { return m_Data; }
+
+        [[nodiscard]] size_t size() const { return m_Size; }
+
+        [[nodiscard]] std::span<const u8> bytes() const { return {m_Data, m_Size}; }
+
+        [[nodiscard]] std::string_view view() const { return {reinterpret_cast<const char*>(m_Data), m_Size}; }
+
+        // False when the content was read into a buffer
+        [[nodiscard]] bool is_mapped() const { return m_Mapped; }
+
+    private:
+        void release();
+
+        const u8* m_Data = nullptr;
+        size_t m_Size = 0;
+        bool m_Mapped = false;
+        std::vector<u8> m_Buffer; // Owns the content when not mapped
+    };
+
+} // namespace sap::cloud
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sap_cloud/metadata.h>
+#include <sap_core/types.h>
+#include <sap_sync/sync_types.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud {
+
+    // =============================================================================
+    // Merkle Tree
+    // =============================================================================
+    // Directory-shaped hash tree over the live files, so clients can reconcile
+    // by descending only into subtrees whose hash differs from their own
+    // instead of downloading every FileMetadata.
+    //
+    // A file's hash is its content hash. A directory's hash is the hash of its
+    // children in name order, each contributing the line
+    //   name '\0' ('d' | 'f') hash '\n'
+    // so the root hash changes exactly when some live file's path or content
+    // does. Deleted files are not part of the tree.
+    //
+    // Fed by MetadataStore as a FileObserver. A change only marks the
+    // directories on its path dirty; their hashes are recomputed on the next
+    // read, so a burst of writes costs one rehash per touched directory.
+    // =============================================================================
+
+    class MerkleTree : public storage::FileObserver {
+    public:
+        struct Child {
+            std::string name;
+            bool directory = false;
+            std::string hash;
+            u64 files = 0; // Files in the subtree (1 for a file)
+        };
+
+        struct Subtree {
+            std::string path; // Empty for the root
+            bool directory = false;
+            std::string hash;
+            u64 files = 0;
+            std::vector<Child> children; // In name order; empty for a file
+        };
+
+        MerkleTree();
+        MerkleTree(const MerkleTree&) = delete;
+        MerkleTree& operator=(const MerkleTree&) = delete;
+
+        // Replace the contents with the live files among rows
+        void load(const std::vector<sync::FileMetadata>& rows);
+
+        // Insert or replace meta.path; a deleted row removes it
+        void update(const sync::FileMetadata& meta);
+
+        // Drop path (a file) and any directories left empty
+        void remove(std::string_view path);
+
+        // The node at path ("" for the root) with its children's hashes
+        [[nodiscard]] std::optional<Subtree> subtree(std::string_view path);
+
+        [[nodiscard]] std::string root_hash();
+
+        // Live files in the tree
+        [[nodiscard]] u64 size();
+
+        void file_changed(std::string_view path, const sync::FileMetadata* row) override;
+        void files_reloaded(const std::vector<sync::FileMetadata>& rows) override;
+
+    private:
+        struct Node {
+            std::map<std::string, std::unique_ptr<Node>, std::less<>> children;
+            std::string hash; // Content hash of a file; cached for a directory
+            u64 files = 0;
+            bool directory = false;
+            bool dirty = false; // Directory hash needs recomputing
+        };
+
+        void insert(const sync::FileMetadata& meta);
+        void erase(std::string_view path);
+        [[nodiscard]] const std::string& hash_of(Node& node);
+
+        std::mutex m_Mutex; // Guards m_Root
+        std::unique_ptr<Node> m_Root;
+    };
+
+} // namespace sap::cloud
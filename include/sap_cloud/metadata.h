@@ -1,7 +1,13 @@
 #pragma once
 
 #include <filesystem>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
 #include <optional>
+#include <sap_cloud/durability.h>
+#include <sap_cloud/file_index.h>
+#include <sap_cloud/metadata_writer.h>
 #include <sap_core/result.h>
 #include <sap_core/types.h>
 #include <sap_db/database.h>
@@ -10,6 +16,38 @@
 
 namespace sap::cloud::storage {
 
+    // In-progress resumable upload. Content is staged on disk until finalized.
+    struct UploadSession {
+        std::string id;
+        std::string path; // Target path relative to files_root
+        i64 size = -1; // Declared total size (-1 if unknown)
+        i64 offset = 0; // Bytes received so far
+        sync::Timestamp mtime = 0; // Client mtime to apply on finalize (0 if none)
+        sync::Timestamp created_at = 0;
+        sync::Timestamp expires_at = 0;
+    };
+
+    void to_json(nlohmann::json& j, const UploadSession& session);
+
+    // Follows the files table: told about every file row a write through the
+    // store touched, once that write has committed (see add_file_observer)
+    class FileObserver {
+    public:
+        virtual ~FileObserver() = default;
+
+        // row is the row as committed, or null once it no longer exists
+        virtual void file_changed(std::string_view path, const sync::FileMetadata* row) = 0;
+
+        // The whole table, on registration and whenever a change couldn't be re-read
+        virtual void files_reloaded(const std::vector<sync::FileMetadata>& rows) = 0;
+    };
+
+    // Live file whose strong hash has not been computed yet
+    struct UnhashedFile {
+        std::string path;
+        std::string fast_hash; // Empty if unknown
+    };
+
     // =============================================================================
     // Metadata Store
     // =============================================================================
@@ -18,29 +56,91 @@ namespace sap::cloud::storage {
     //   - File paths, hashes, sizes, timestamps
     //   - Note titles, tags, full-text search index
     //   - Sync state (for deleted files)
+    //
+    // Once start_writer() has been called, the per-request writes (files,
+    // notes, tags, full-text entries, tokens, challenges and upload sessions)
+    // are handed to a MetadataWriter and group-committed on its connection;
+    // each call still returns only after its write is committed. Bulk and
+    // maintenance operations keep using this connection directly.
+    //
+    // With enable_file_index(), file metadata is also held in a FileIndex and
+    // get_all_files() is answered from memory. Every file write committed
+    // through this store re-reads the rows it touched into the index (and
+    // any FileObserver) once committed, so they only ever see what SQLite holds.
     // =============================================================================
 
     class MetadataStore {
     public:
-        // Open or create the database
-        static stl::result<MetadataStore> open(const std::filesystem::path& db_path);
+        // Open or create the database; durability selects the journal sync mode
+        static stl::result<MetadataStore> open(const std::filesystem::path& db_path, EDurability durability = EDurability::Balanced);
         MetadataStore(const MetadataStore&) = delete;
         MetadataStore& operator=(const MetadataStore&) = delete;
         MetadataStore(MetadataStore&&) noexcept = default;
         MetadataStore& operator=(MetadataStore&&) noexcept = default;
 
+        // Commit writes through a single writer thread with its own connection
+        // from now on (see MetadataWriter)
+        [[nodiscard]] stl::result<> start_writer(const WriterOptions& options = {});
+
+        // Run fn atomically: as one write intent when the writer is running,
+        // otherwise in a transaction on this connection. fn performs its writes
+        // on the store it is given and must not open a transaction itself.
+        [[nodiscard]] stl::result<> transaction(const MetadataWriter::Intent& fn);
+
+        // Load the files table into a FileIndex and answer get_all_files() from
+        // it from now on; call before serving requests. With verify, every such
+        // query is also run against SQLite: differences that persist on a
+        // second look are logged, counted in sap_file_index_mismatches_total
+        // and answered with the database rows.
+        [[nodiscard]] stl::result<> enable_file_index(bool verify = false);
+
+        // Differences between the file index and the files table, one line each
+        // (empty if they agree, or if no index is enabled)
+        [[nodiscard]] stl::result<std::vector<std::string>> verify_file_index();
+
+        // Seed observer with the files table and keep it informed of every file
+        // write committed through this store. Register before serving requests;
+        // observer must outlive the store.
+        [[nodiscard]] stl::result<> add_file_observer(FileObserver* observer);
+
         // Get metadata for a single file
         [[nodiscard]] stl::result<std::optional<sync::FileMetadata>> get_file(std::string_view path);
 
         // Get all files (optionally changed since timestamp)
         [[nodiscard]] stl::result<std::vector<sync::FileMetadata>> get_all_files(std::optional<sync::Timestamp> since = std::nullopt);
 
-        // Update or insert file metadata
-        [[nodiscard]] stl::result<> upsert_file(const sync::FileMetadata& meta);
+        // Update or insert file metadata. An empty meta.hash marks the strong
+        // hash as pending (see set_strong_hash).
+        [[nodiscard]] stl::result<> upsert_file(const sync::FileMetadata& meta, std::string_view fast_hash = {});
 
         // Mark file as deleted (soft delete for sync)
         [[nodiscard]] stl::result<> mark_deleted(std::string_view path);
 
+        // Store meta (the file's new path) and mark from deleted in one
+        // transaction, so clients see the move as a whole
+        [[nodiscard]] stl::result<> move_file(std::string_view from, const sync::FileMetadata& meta, std::string_view fast_hash = {});
+
+        // Fast (change detection) hash recorded for a file, if any
+        [[nodiscard]] stl::result<std::optional<std::string>> get_fast_hash(std::string_view path);
+
+        // Up to limit live files still waiting for their strong hash
+        [[nodiscard]] stl::result<std::vector<UnhashedFile>> get_unhashed_files(i64 limit);
+
+        // Record the strong hash of a pending file, unless its content changed
+        // (fast hash differs) since it was read. Returns true if stored.
+        [[nodiscard]] stl::result<bool> set_strong_hash(std::string_view path, std::string_view fast_hash, std::string_view hash);
+
+        // Those of hashes that some live file has as its content hash, sorted
+        // and without duplicates
+        [[nodiscard]] stl::result<std::vector<std::string>> find_hashes(std::vector<std::string> hashes);
+
+        // Up to limit distinct content hashes of live files, in order, starting
+        // after after (from the first if empty); for paging through all of them
+        [[nodiscard]] stl::result<std::vector<std::string>> get_live_hashes(std::string_view after, i64 limit);
+
+        // Mark every live file below directory dir as deleted
+        [[nodiscard]] stl::result<> mark_deleted_under(std::string_view dir);
+
         // Permanently remove file record
         [[nodiscard]] stl::result<> remove_file(std::string_view path);
 
@@ -77,28 +177,119 @@ namespace sap::cloud::storage {
         // Remove from FTS index
         [[nodiscard]] stl::result<> remove_fts(std::string_view note_id);
 
+        // Append an FTS entry without removing the note's existing one
+        [[nodiscard]] stl::result<> insert_fts(std::string_view note_id, std::string_view title, std::string_view content);
+
+        // FTS index rebuild: entries are appended to a staging table, in as many
+        // transactions as the caller likes, and swapped in at the end, so the
+        // live index keeps serving searches and taking writes meanwhile.
+        // begin_fts_rebuild() creates the staging table empty, with automerge
+        // off for the load; one left by an interrupted rebuild is dropped.
+        [[nodiscard]] stl::result<> begin_fts_rebuild();
+
+        [[nodiscard]] stl::result<> insert_rebuild_fts(std::string_view note_id, std::string_view title, std::string_view content);
+
+        // Copy a note's row from the live full-text index into the staging table
+        [[nodiscard]] stl::result<> keep_rebuild_fts(std::string_view note_id);
+
+        // Replace the index with the staging table. Entries of notes that other
+        // writers changed after since are taken from the live index instead.
+        [[nodiscard]] stl::result<> finish_fts_rebuild(sync::Timestamp since);
+
+        // Drop the staging table, leaving the live index as it was
+        [[nodiscard]] stl::result<> abandon_fts_rebuild();
+
+        // Merge all FTS segments into one (expensive; after bulk loads)
+        [[nodiscard]] stl::result<> optimize_fts();
+
         // Store auth token
         [[nodiscard]] stl::result<> store_token(std::string_view token, i64 expires_at);
 
-        // Validate and refresh token
+        // Validate token. A read on this connection; last_used is refreshed at
+        // most once a minute, queued on the writer without waiting for it.
         [[nodiscard]] stl::result<bool> validate_token(std::string_view token);
 
         // Remove expired tokens
         [[nodiscard]] stl::result<> cleanup_expired_tokens();
 
+        // Remove expired challenges
+        [[nodiscard]] stl::result<> cleanup_expired_challenges();
+
         // Store challenge
         [[nodiscard]] stl::result<> store_challenge(std::string_view challenge, std::string_view public_key, i64 expires_at);
 
         // Validate and consume challenge
         [[nodiscard]] stl::result<bool> validate_challenge(std::string_view challenge, std::string_view public_key);
 
+        // Create upload session
+        [[nodiscard]] stl::result<> create_upload(const UploadSession& session);
+
+        // Get upload session by ID
+        [[nodiscard]] stl::result<std::optional<UploadSession>> get_upload(std::string_view id);
+
+        // Record bytes received for an upload session
+        [[nodiscard]] stl::result<> set_upload_offset(std::string_view id, i64 offset);
+
+        // Remove upload session
+        [[nodiscard]] stl::result<> remove_upload(std::string_view id);
+
+        // Store file metadata and consume the upload session in one transaction
+        [[nodiscard]] stl::result<> commit_upload(std::string_view id, const sync::FileMetadata& meta, std::string_view fast_hash = {});
+
+        // IDs of upload sessions that expired before now (up to limit)
+        [[nodiscard]] stl::result<std::vector<std::string>> get_expired_uploads(sync::Timestamp now, i64 limit);
+
+        // Permanently remove up to limit file and up to limit note tombstones last
+        // updated before cutoff. Returns the number of rows removed.
+        [[nodiscard]] stl::result<i64> compact_tombstones(sync::Timestamp cutoff, i64 limit);
+
+        // Copy committed WAL content back into the database without waiting
+        // for readers (with EDurability::Fast, where commits don't checkpoint)
+        [[nodiscard]] stl::result<> checkpoint();
+
+        // Let SQLite refresh planner statistics that have gone stale
+        [[nodiscard]] stl::result<> optimize();
+
+        // One bounded incremental merge step on the full-text index. Returns
+        // false once the index had nothing left to merge.
+        [[nodiscard]] stl::result<bool> merge_fts(i64 pages);
+
+        // Release up to pages free pages to the filesystem (only effective with
+        // auto_vacuum = INCREMENTAL). Returns the free pages remaining.
+        [[nodiscard]] stl::result<i64> incremental_vacuum(i64 pages);
+
         // Access underlying database (for transactions)
         [[nodiscard]] db::Database& database() { return m_Db; }
 
     private:
-        explicit MetadataStore(db::Database db);
+        MetadataStore(db::Database db, std::filesystem::path path, EDurability durability);
         stl::result<> init_schema();
+        // Journal mode and sync pragmas for m_Durability
+        stl::result<> apply_durability();
+        // Schema migration for databases created before column existed
+        stl::result<> add_column_if_missing(std::string_view table, std::string_view column, std::string_view type);
+        // Files table read that bypasses the index; dir limits it to rows below dir
+        stl::result<std::vector<sync::FileMetadata>> query_files(std::optional<sync::Timestamp> since, std::string_view dir = {});
+        // A file row (or every row below a directory) whose index entry is stale
+        struct FileChange {
+            std::string path;
+            bool under = false; // path is a directory
+        };
+        // Whether file changes are re-read (an index or observers are attached)
+        [[nodiscard]] bool tracks_files() const { return m_FileIndex || !m_FileObservers.empty(); }
+        // Bring the index and observers up to date with a committed change; inside
+        // transaction() the change is held back until the transaction has committed
+        void file_changed(FileChange change);
+        void refresh_files(const std::vector<FileChange>& changes);
         db::Database m_Db;
+        std::filesystem::path m_Path;
+        EDurability m_Durability;
+        std::unique_ptr<MetadataWriter> m_Writer; // Set by start_writer()
+        std::unique_ptr<FileIndex> m_FileIndex; // Set by enable_file_index()
+        bool m_VerifyIndex = false;
+        std::vector<FileObserver*> m_FileObservers;
+        std::unique_ptr<std::mutex> m_RefreshMutex = std::make_unique<std::mutex>(); // Held from re-reading rows until they are applied
+        std::vector<FileChange>* m_Changes = nullptr; // Collects file changes while transaction() runs
     };
 
 } // namespace sap::cloud::storage
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <sap_cloud/durability.h>
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <semaphore>
+#include <thread>
+#include <vector>
+
+namespace sap::cloud::storage {
+
+    class MetadataStore;
+
+    struct WriterOptions {
+        size_t max_batch = 256; // Writes committed together at most
+        std::chrono::microseconds window{1000}; // How long a batch stays open for more writes
+    };
+
+    // =============================================================================
+    // Metadata Writer
+    // =============================================================================
+    // Single writer thread with its own connection to the metadata database.
+    // Any thread submits write intents; the writer applies them in arrival
+    // order inside one transaction per batch, each under its own SAVEPOINT so
+    // a failing intent is rolled back without affecting the others, and
+    // resolves each intent's future once the batch has committed. Concurrent
+    // writers therefore share one commit (and one journal sync) per batch.
+    //
+    // A batch closes when max_batch intents are collected or window has passed
+    // since its first intent, whichever comes first. Intents submitted while a
+    // batch commits join the next one, so batches grow with load even when
+    // window is zero.
+    // =============================================================================
+
+    class MetadataWriter {
+    public:
+        using Intent = std::function<stl::result<>(MetadataStore&)>;
+
+        // Open a second connection to db_path and start the writer thread
+        static stl::result<std::unique_ptr<MetadataWriter>> start(const std::filesystem::path& db_path, EDurability durability,
+                                                                  const WriterOptions& options = {});
+
+        // Commits everything already submitted, then stops the thread
+        ~MetadataWriter();
+        MetadataWriter(const MetadataWriter&) = delete;
+        MetadataWriter& operator=(const MetadataWriter&) = delete;
+
+        // Queue intent; the future resolves with its result once committed.
+        // Safe to call from any thread; never blocks.
+        [[nodiscard]] std::future<stl::result<>> submit(Intent intent);
+
+        // submit() and wait for the commit
+        [[nodiscard]] stl::result<> write(Intent intent) { return submit(std::move(intent)).get(); }
+
+    private:
+        // Queued intent; nodes form an intrusive lock-free stack
+        struct Node {
+            Intent intent;
+            std::promise<stl::result<>> done;
+            Node* next = nullptr;
+        };
+
+        MetadataWriter(std::unique_ptr<MetadataStore> store, const WriterOptions& options);
+
+        void run();
+
+        // Move everything submitted so far to the backlog, then fill batch
+        // from it, oldest first, up to max_batch
+        void take(std::vector<Node*>& batch);
+
+        // Apply and commit batch, then resolve its futures
+        void commit(std::vector<Node*>& batch);
+
+        std::unique_ptr<MetadataStore> m_Store; // Writer's own connection
+        WriterOptions m_Options;
+        std::atomic<Node*> m_Head{nullptr}; // Most recently submitted intent
+        std::deque<Node*> m_Backlog; // Taken but not yet batched (writer thread only)
+        std::counting_semaphore<> m_Pending{0}; // Released once per submit (and on stop)
+        std::atomic<bool> m_Stopping{false};
+        std::thread m_Thread;
+    };
+
+} // namespace sap::cloud::storage
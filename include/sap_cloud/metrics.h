@@ -0,0 +1,158 @@
+#pragma once
+
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <sap_cloud/trace.h>
+#include <sap_core/types.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sap::cloud::metrics {
+
+    // =============================================================================
+    // Metrics Registry
+    // =============================================================================
+    // Process-wide counters and latency histograms exposed in Prometheus text
+    // format. Every thread writes to its own shard with relaxed loads/stores, so
+    // recording never takes a lock or a contended cache line; shards are only
+    // summed when the registry is rendered. Shards of exited threads are folded
+    // into a retired shard.
+    //
+    // Histograms are log-linear (HDR-style): 8 sub-buckets per power of two of
+    // microseconds, i.e. ~12.5% relative precision from 1us to several hours.
+    // Bucket arrays are allocated per thread on first use of each histogram.
+    // =============================================================================
+
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    inline constexpr u32 invalid_index = std::numeric_limits<u32>::max();
+
+    class Counter {
+    public:
+        Counter() = default;
+
+        void inc(u64 n = 1) const;
+
+    private:
+        friend class Registry;
+        explicit Counter(u32 index) : m_Index(index) {}
+        u32 m_Index = invalid_index;
+    };
+
+    class Histogram {
+    public:
+        Histogram() = default;
+
+        // Record a duration in microseconds
+        void record(u64 micros) const;
+
+        void record(std::chrono::steady_clock::duration elapsed) const {
+            record(static_cast<u64>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+        }
+
+    private:
+        friend class Registry;
+        explicit Histogram(u32 index) : m_Index(index) {}
+        u32 m_Index = invalid_index;
+    };
+
+    // Records the lifetime of the scope into a histogram
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(const Histogram& histogram) : m_Histogram(histogram), m_Start(std::chrono::steady_clock::now()) {}
+        ~ScopedTimer() { m_Histogram.record(std::chrono::steady_clock::now() - m_Start); }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    private:
+        const Histogram& m_Histogram;
+        std::chrono::steady_clock::time_point m_Start;
+    };
+
+    struct Quantiles {
+        u64 count = 0;
+        u64 sum_micros = 0;
+        u64 p50 = 0; // Microseconds (bucket upper bound)
+        u64 p99 = 0;
+        u64 p999 = 0;
+    };
+
+    class Registry {
+    public:
+        static constexpr u32 max_counters = 256;
+        static constexpr u32 max_histograms = 256;
+
+        ~Registry();
+        Registry(const Registry&) = delete;
+        Registry& operator=(const Registry&) = delete;
+
+        // Register (or look up) a metric. Registering the same name and labels
+        // again returns the same handle. Handles past capacity are no-ops.
+        Counter counter(std::string_view name, std::string_view help, Labels labels = {});
+
+        Histogram histogram(std::string_view name, std::string_view help, Labels labels = {});
+
+        // Current value summed over all threads
+        [[nodiscard]] u64 value(const Counter& counter) const;
+
+        [[nodiscard]] Quantiles quantiles(const Histogram& histogram) const;
+
+        // Prometheus text exposition format
+        [[nodiscard]] std::string render() const;
+
+        struct Impl;
+
+    private:
+        friend class Counter;
+        friend class Histogram;
+        friend Registry& registry();
+        Registry();
+        std::unique_ptr<Impl> m_Impl;
+    };
+
+    // Process-wide registry
+    Registry& registry();
+
+    // Run fn and record its duration
+    template <typename Fn>
+    decltype(auto) timed(const Histogram& histogram, Fn&& fn) {
+        ScopedTimer timer(histogram);
+        return fn();
+    }
+
+    // Shared filesystem instrumentation
+    struct FsMetrics {
+        Histogram read;
+        Histogram write;
+        Counter read_bytes;
+        Counter write_bytes;
+    };
+
+    const FsMetrics& fs();
+
+    // Time a read returning stl::result of a sized buffer and count the bytes read
+    template <typename Fn>
+    auto timed_read(Fn&& fn) {
+        trace::Span span("fs.read");
+        auto result = timed(fs().read, std::forward<Fn>(fn));
+        if (result) {
+            fs().read_bytes.inc(result.value().size());
+        }
+        return result;
+    }
+
+    // Time a write of the given size and count the bytes on success
+    template <typename Fn>
+    auto timed_write(size_t bytes, Fn&& fn) {
+        trace::Span span("fs.write");
+        auto result = timed(fs().write, std::forward<Fn>(fn));
+        if (result) {
+            fs().write_bytes.inc(bytes);
+        }
+        return result;
+    }
+
+} // namespace sap::cloud::metrics
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <sap_core/types.h>
+#include <sap_http/net/http.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sap::cloud {
+
+    // Path parameters captured while matching a route.
+    // Values are views into the request path and are only valid for the
+    // lifetime of the request.
+    class RouteParams {
+    public:
+        static constexpr size_t max_params = 4;
+
+        // Get captured value by name (empty if not captured)
+        [[nodiscard]] std::string_view get(std::string_view name) const;
+
+        void push(std::string_view name, std::string_view value);
+
+        void pop() { --m_Count; }
+
+        [[nodiscard]] size_t size() const { return m_Count; }
+
+    private:
+        std::array<std::pair<std::string_view, std::string_view>, max_params> m_Params{};
+        size_t m_Count = 0;
+    };
+
+    using RouteHandler = std::function<http::Response(const http::Request&, const RouteParams&)>;
+
+    // Per-route attributes checked by the dispatcher before the handler runs
+    struct RouteOptions {
+        bool requires_auth = true;
+    };
+
+    struct Route {
+        size_t id; // Registration order, dense from 0
+        http::EMethod method;
+        std::string pattern;
+        RouteHandler handler;
+        RouteOptions options;
+    };
+
+    // Result of matching a request path against the route table
+    struct RouteMatch {
+        const Route* route = nullptr; // Null if nothing matched
+        bool path_matched = false; // Path exists but not for this method
+        RouteParams params;
+    };
+
+    // Radix trie of path segments built once at startup.
+    // Pattern syntax:
+    //   /api/v1/notes          - literal segments
+    //   /api/v1/notes/{id}     - captures exactly one segment
+    //   /api/v1/files/{path*}  - captures the (non-empty) remainder of the path, must be last
+    // Literal segments take priority over captures, single-segment captures over
+    // remainder captures, among the routes for the request's method: POST on
+    // /api/v1/files/move doesn't stop GET /api/v1/files/move reaching
+    // /api/v1/files/{path*}. A trailing slash on the request path is ignored.
+    class Router {
+    public:
+        Router();
+        ~Router();
+        Router(const Router&) = delete;
+        Router& operator=(const Router&) = delete;
+
+        // Register route; pattern must be well-formed
+        void add(http::EMethod method, std::string_view pattern, RouteHandler handler, RouteOptions options = {});
+
+        // Match request method and path
+        [[nodiscard]] RouteMatch match(http::EMethod method, std::string_view path) const;
+
+        // Distinct methods with at least one route
+        [[nodiscard]] const std::vector<http::EMethod>& methods() const { return m_Methods; }
+
+        // All routes in registration order
+        [[nodiscard]] const std::vector<std::unique_ptr<Route>>& routes() const { return m_Routes; }
+
+    private:
+        struct Node;
+
+        // Best node for rest with a route for method (any route if unset)
+        [[nodiscard]] static const Node* find(const Node& node, std::string_view rest, RouteParams& params, std::optional<http::EMethod> method);
+
+        std::unique_ptr<Node> m_Root;
+        std::vector<std::unique_ptr<Route>> m_Routes;
+        std::vector<http::EMethod> m_Methods;
+    };
+
+    // Get query string parameter value (raw, not percent-decoded).
+    // Accepts query with or without the leading '?'.
+    [[nodiscard]] std::string_view query_param(std::string_view query, std::string_view name);
+
+} // namespace sap::cloud
@@ -1,18 +1,29 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <sap_cloud/auth_manager.h>
 #include <sap_cloud/config.h>
+#include <sap_cloud/content_cache.h>
+#include <sap_cloud/file_watcher.h>
+#include <sap_cloud/io_engine.h>
+#include <sap_cloud/live_indexer.h>
+#include <sap_cloud/maintenance.h>
+#include <sap_cloud/merkle_tree.h>
 #include <sap_cloud/metadata.h>
+#include <sap_cloud/metrics.h>
+#include <sap_cloud/router.h>
 #include <sap_cloud/services/file_service.h>
 #include <sap_cloud/services/notes_service.h>
 #include <sap_cloud/services/sync_service.h>
+#include <sap_cloud/services/upload_service.h>
 #include <sap_core/result.h>
 #include <sap_core/types.h>
 #include <sap_fs/fs.h>
 #include <sap_http/net/http.h>
 #include <sap_sync/sync_types.h>
+#include <thread>
 
 namespace sap::cloud {
 
@@ -28,14 +39,46 @@ namespace sap::cloud {
         // Stop the server
         void stop();
 
+        // Re-read authorized_keys; safe to call from any thread
+        void reload_authorized_keys();
+
+        // Start rebuilding the note index in the background. Fails if a
+        // rebuild is already running.
+        stl::result<> start_note_index_rebuild();
+
     private:
         explicit Server(const Config& config);
 
         stl::result<> initialize();
 
+        // Reload authorized_keys whenever it is rewritten or replaced
+        void watch_authorized_keys();
+
+        // Register and start background maintenance jobs
+        void start_maintenance();
+
+        // Keep the index current with outside changes to the storage roots
+        void watch_storage();
+
         // Setup HTTP routes
         void setup_routes();
 
+        // Match request against the route table and record request metrics
+        http::Response dispatch(http::EMethod method, const http::Request& req);
+
+        // Enforce route attributes and run the matched handler
+        http::Response route_request(const RouteMatch& match, const http::Request& req);
+
+        // Metrics route
+        http::Response handle_metrics(const http::Request& req);
+
+        // Admin routes
+        http::Response handle_trace_export(const http::Request& req);
+
+        http::Response handle_start_reindex(const http::Request& req);
+
+        http::Response handle_reindex_status(const http::Request& req);
+
         // Auth routes
         http::Response handle_auth_challenge(const http::Request& req);
 
@@ -44,23 +87,43 @@ namespace sap::cloud {
         // Sync routes
         http::Response handle_sync_state(const http::Request& req);
 
+        http::Response handle_sync_tree(const http::Request& req, std::string_view path);
+
+        http::Response handle_sync_hashes(const http::Request& req);
+
         // File routes
-        http::Response handle_get_file(const http::Request& req);
+        http::Response handle_list_files(const http::Request& req);
+
+        http::Response handle_get_file(const http::Request& req, std::string_view path);
+
+        http::Response handle_put_file(const http::Request& req, std::string_view path);
 
-        http::Response handle_put_file(const http::Request& req);
+        http::Response handle_delete_file(const http::Request& req, std::string_view path);
 
-        http::Response handle_delete_file(const http::Request& req);
+        // POST /api/v1/files/move and /api/v1/files/copy
+        http::Response handle_transfer_file(const http::Request& req, bool copy);
+
+        // Upload session routes
+        http::Response handle_create_upload(const http::Request& req);
+
+        http::Response handle_get_upload(const http::Request& req, std::string_view upload_id);
+
+        http::Response handle_upload_chunk(const http::Request& req, std::string_view upload_id);
+
+        http::Response handle_finalize_upload(const http::Request& req, std::string_view upload_id);
+
+        http::Response handle_abort_upload(const http::Request& req, std::string_view upload_id);
 
         // Note routes
         http::Response handle_list_notes(const http::Request& req);
 
-        http::Response handle_get_note(const http::Request& req);
+        http::Response handle_get_note(const http::Request& req, std::string_view note_id);
 
         http::Response handle_create_note(const http::Request& req);
 
-        http::Response handle_update_note(const http::Request& req);
+        http::Response handle_update_note(const http::Request& req, std::string_view note_id);
 
-        http::Response handle_delete_note(const http::Request& req);
+        http::Response handle_delete_note(const http::Request& req, std::string_view note_id);
 
         http::Response handle_get_tags(const http::Request& req);
 
@@ -72,26 +135,63 @@ namespace sap::cloud {
         // JSON response helpers
         http::Response json_response(i32 status, const nlohmann::json& body);
 
+        // Hot response types are written directly without building a DOM
+        http::Response json_response(i32 status, const sync::SyncState& body);
+
+        http::Response json_response(i32 status, const sync::NoteListResponse& body);
+
+        http::Response json_response(i32 status, const sync::TagListResponse& body);
+
+        http::Response json_response(i32 status, const std::vector<sync::FileMetadata>& body);
+
+        http::Response json_response(i32 status, const sync::FileMetadata& body);
+
         http::Response error_response(i32 status, std::string_view error, std::string_view message);
 
-        // Extract path parameter (e.g., /notes/{id} -> id)
-        std::string extract_path_param(const http::Request& req, std::string_view prefix);
+        // Sync payloads: the binary encoding when the request's Accept header
+        // lists binary::media_type, JSON otherwise
+        http::Response sync_response(const http::Request& req, const sync::SyncState& body);
+
+        http::Response sync_response(const http::Request& req, const std::vector<sync::FileMetadata>& body);
+
+        struct RouteMetrics {
+            metrics::Counter requests;
+            metrics::Histogram latency;
+        };
 
         Config m_Config;
         http::Server m_HttpServer;
+        Router m_Router;
+        std::vector<RouteMetrics> m_RouteMetrics; // Indexed by Route::id
+        RouteMetrics m_UnmatchedMetrics;
 
         // Storage
         std::unique_ptr<fs::Filesystem> m_FilesFs;
         std::unique_ptr<fs::Filesystem> m_NotesFs;
+        std::unique_ptr<MerkleTree> m_Tree; // Observes m_Meta, so declared before it
         std::unique_ptr<storage::MetadataStore> m_Meta;
+        std::unique_ptr<IoEngine> m_Io;
+        std::unique_ptr<ContentCache> m_Cache; // Hot file contents and note bodies
 
         // Services
         std::unique_ptr<services::FileService> m_FileSvc;
         std::unique_ptr<services::NoteService> m_NoteSvc;
         std::unique_ptr<services::SyncService> m_SyncSvc;
+        std::unique_ptr<services::UploadService> m_UploadSvc;
 
         // Auth
         std::unique_ptr<auth::AuthManager> m_Auth;
+
+        // Note index rebuild
+        services::NoteService::RebuildProgress m_RebuildProgress;
+        std::mutex m_RebuildMutex; // Guards m_RebuildError and m_RebuildThread
+        std::optional<std::string> m_RebuildError; // Outcome of the last finished rebuild
+
+        // Background threads are declared last so they stop before anything they call into
+        std::unique_ptr<MaintenanceScheduler> m_Maintenance;
+        std::unique_ptr<LiveIndexer> m_Indexer;
+        std::jthread m_RebuildThread;
+        std::unique_ptr<FileWatcher> m_KeysWatcher;
     };
 
 } // namespace sap::cloud
@@ -1,10 +1,16 @@
 #pragma once
 
+#include <filesystem>
+#include <optional>
+#include <sap_cloud/bloom_filter.h>
+#include <sap_cloud/content_cache.h>
+#include <sap_cloud/io_engine.h>
 #include <sap_cloud/metadata.h>
 #include <sap_core/result.h>
 #include <sap_core/types.h>
 #include <sap_fs/fs.h>
 #include <sap_sync/sync_types.h>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -14,14 +20,29 @@ namespace sap::cloud::services {
     // Coordinates between filesystem (content) and metadata store (index).
     class FileService {
     public:
-        FileService(fs::Filesystem& fs, storage::MetadataStore& meta);
+        // root is the directory fs is rooted at; file content is read and written
+        // there directly, through io. Small files are kept in cache when one is
+        // given.
+        FileService(fs::Filesystem& fs, storage::MetadataStore& meta, IoEngine& io, std::filesystem::path root, ContentCache* cache = nullptr);
 
         // Get file content
         [[nodiscard]] stl::result<std::vector<u8>> get_file(std::string_view path);
 
+        // Location of path under the files root, for reading it through the I/O engine
+        [[nodiscard]] stl::result<std::filesystem::path> resolve(std::string_view path) const;
+
+        // Directory the files live under
+        [[nodiscard]] const std::filesystem::path& root() const { return m_Root; }
+
         // Get file metadata
         [[nodiscard]] stl::result<std::optional<sync::FileMetadata>> get_metadata(std::string_view path);
 
+        // Content of the file described by meta if it is cached, else null
+        [[nodiscard]] ContentCache::Value cached_content(const sync::FileMetadata& meta);
+
+        // Offer content just read for meta to the cache
+        void cache_content(const sync::FileMetadata& meta, std::string_view content);
+
         // Create or update file
         [[nodiscard]] stl::result<sync::FileMetadata> put_file(std::string_view path, const std::vector<u8>& content,
                                                                std::optional<sync::Timestamp> client_mtime = std::nullopt);
@@ -29,21 +50,66 @@ namespace sap::cloud::services {
         // Delete file
         [[nodiscard]] stl::result<> delete_file(std::string_view path);
 
+        // Path as stored in the index: relative to the root and lexically
+        // normalized ("a//./b" is "a/b"); fails where resolve() does
+        [[nodiscard]] stl::result<std::string> normalize(std::string_view path) const;
+
+        // Rename from to to on disk and in the index, keeping its content hash;
+        // from is left as a deletion for sync. An existing to is replaced, but
+        // only once the index has the move; until then it is kept in staging.
+        [[nodiscard]] stl::result<sync::FileMetadata> move_file(std::string_view from, std::string_view to);
+
+        // Copy from to to without the content passing through the server: a
+        // reflink clone where the filesystem has them, else an in-kernel copy.
+        // The copy keeps from's hash, size and mtime. An existing to is replaced,
+        // and restored if the copy can't be recorded in the index.
+        [[nodiscard]] stl::result<sync::FileMetadata> copy_file(std::string_view from, std::string_view to);
+
         // List all files
         [[nodiscard]] stl::result<std::vector<sync::FileMetadata>> list_files();
 
         // Get files changed since timestamp
         [[nodiscard]] stl::result<std::vector<sync::FileMetadata>> get_changed_since(sync::Timestamp since);
 
-        // Scan filesystem and update metadata (for initial sync or repair)
+        // Which of hashes the server holds content for, sorted
+        [[nodiscard]] stl::result<std::vector<std::string>> find_hashes(std::vector<std::string> hashes);
+
+        // Content hashes held by the server that filter may contain, sorted.
+        // Includes false positives; the client checks them against its own set.
+        [[nodiscard]] stl::result<std::vector<std::string>> find_hashes(const BloomFilter& filter);
+
+        // Scan filesystem and update metadata (for initial sync or repair).
+        // Returns the number of new or changed files.
         [[nodiscard]] stl::result<size_t> scan_and_index();
 
+        // Bring the index entry for path in line with the filesystem after an
+        // outside change. A file whose size and mtime match the index is not
+        // re-read; a changed file gets only its fast hash, and its strong hash
+        // is left pending for hash_pending(). A missing path (file or
+        // directory) is marked deleted. Returns true if the index changed.
+        [[nodiscard]] stl::result<bool> index_path(std::string_view path);
+
+        // Compute strong hashes for up to limit files indexed without one.
+        // Returns true while more remain.
+        [[nodiscard]] stl::result<bool> hash_pending(i64 limit);
+
     private:
         fs::Filesystem& m_Fs;
         storage::MetadataStore& m_Meta;
+        IoEngine& m_Io;
+        std::filesystem::path m_Root;
+        ContentCache* m_Cache; // Optional
+
+        // Move an existing target into staging so a failed transfer can restore
+        // it with put_back(); nullopt if there was nothing to move
+        [[nodiscard]] stl::result<std::optional<std::filesystem::path>> set_aside(const std::filesystem::path& target);
+        void put_back(const std::optional<std::filesystem::path>& aside, const std::filesystem::path& target);
+
+        // Read a file under the root for indexing
+        [[nodiscard]] stl::result<std::vector<u8>> read_file(std::string_view path);
 
         // Build metadata from filesystem
-        [[nodiscard]] stl::result<sync::FileMetadata> build_metadata(std::string_view path, const std::vector<u8>& content);
+        [[nodiscard]] stl::result<sync::FileMetadata> build_metadata(std::string_view path, std::span<const u8> content);
     };
 
 } // namespace sap::cloud::services
@@ -1,11 +1,16 @@
 #pragma once
 
+#include <atomic>
+#include <filesystem>
 #include <optional>
+#include <sap_cloud/content_cache.h>
+#include <sap_cloud/io_engine.h>
 #include <sap_cloud/metadata.h>
 #include <sap_core/result.h>
 #include <sap_core/types.h>
 #include <sap_sync/sync_types.h>
 #include <sap_fs/fs.h>
+#include <stop_token>
 #include <string>
 #include <vector>
 
@@ -15,7 +20,9 @@ namespace sap::cloud::services {
     // Notes are stored as .md files with YAML frontmatter for tags.
     class NoteService {
     public:
-        NoteService(fs::Filesystem& fs, storage::MetadataStore& meta);
+        // Note content is read and written under root (the directory fs is rooted at) through io.
+        // Parsed note bodies are kept in cache when one is given.
+        NoteService(fs::Filesystem& fs, storage::MetadataStore& meta, IoEngine& io, std::filesystem::path root, ContentCache* cache = nullptr);
         // CRUD Operations
 
         // Get note by ID
@@ -49,25 +56,69 @@ namespace sap::cloud::services {
         // Search notes
         [[nodiscard]] stl::result<sync::NoteListResponse> search_notes(std::string_view query);
 
+        // Location of a note file path under the notes root, for reading it through the I/O engine
+        [[nodiscard]] stl::result<std::filesystem::path> resolve(std::string_view path) const;
+
+        // Build the API response for a note from its metadata and file content
+        [[nodiscard]] stl::result<sync::NoteResponse> note_response(const sync::NoteMetadata& meta, const std::string& content) const;
+
+        // API response for a note whose body is cached, without reading the file
+        [[nodiscard]] std::optional<sync::NoteResponse> cached_response(const sync::NoteMetadata& meta) const;
+
         // Get note metadata (for sync)
         [[nodiscard]] stl::result<std::optional<sync::NoteMetadata>> get_metadata(std::string_view id);
 
         // Get all note metadata
         [[nodiscard]] stl::result<std::vector<sync::NoteMetadata>> get_all_metadata();
 
-        // Scan filesystem and rebuild index
+        // Scan filesystem and index new or changed notes (rebuild_index
+        // re-indexes everything). Returns the number of notes indexed.
         [[nodiscard]] stl::result<size_t> scan_and_index();
 
+        // Progress of rebuild_index(); safe to read from other threads
+        struct RebuildProgress {
+            std::atomic<bool> running{false};
+            std::atomic<i64> total{0}; // Note files found
+            std::atomic<i64> parsed{0};
+            std::atomic<i64> indexed{0};
+            std::atomic<i64> failed{0}; // Unreadable or unparsable notes, skipped
+        };
+
+        // Re-read every note and rebuild note metadata and the full-text index
+        // from scratch. Notes are parsed on a thread pool while the previous
+        // batch is written, one transaction per batch. The full-text index is
+        // loaded into a staging table with FTS automerge disabled, swapped in
+        // by the last transaction and optimized afterwards, so searches and
+        // other writes aren't held up. Notes that fail to read or parse keep
+        // their previous entry. progress is reset on entry. Returns the number
+        // of notes indexed; stopping through stop keeps the old full-text index.
+        [[nodiscard]] stl::result<size_t> rebuild_index(RebuildProgress& progress, std::stop_token stop = {});
+
+        // Bring the index for the note file at path in line with the filesystem
+        // after an outside change. Content that hashes the same as the indexed
+        // note is not re-parsed; a missing note, or notes below a missing
+        // directory, are marked deleted. Returns true if the index changed.
+        [[nodiscard]] stl::result<bool> index_path(std::string_view path);
+
     private:
         fs::Filesystem& m_Fs;
         storage::MetadataStore& m_Meta;
+        IoEngine& m_Io;
+        std::filesystem::path m_Root;
+        ContentCache* m_Cache; // Optional
 
         // Helper to convert NoteMetadata + content to NoteResponse
         [[nodiscard]] stl::result<sync::NoteResponse> load_note_response(const sync::NoteMetadata& meta);
 
+        // NoteResponse from metadata and the parsed note body
+        [[nodiscard]] static sync::NoteResponse make_response(const sync::NoteMetadata& meta, std::string body);
+
         // Helper to convert NoteMetadata to NoteListItem
         [[nodiscard]] sync::NoteListItem to_list_item(const sync::NoteMetadata& meta, std::string_view content);
 
+        // Parse note content read from path and store its metadata and FTS entry
+        [[nodiscard]] stl::result<> index_note(const std::string& path, const std::string& content);
+
         // Generate file path for note ID
         [[nodiscard]] std::string note_path(std::string_view id) const;
     };
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sap_cloud/io_engine.h>
+#include <sap_cloud/metadata.h>
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <sap_fs/fs.h>
+#include <sap_sync/sync_types.h>
+#include <string>
+#include <unordered_map>
+
+namespace sap::cloud::services {
+
+    // Directory under files_root reserved for staged upload chunks
+    inline constexpr std::string_view UPLOAD_STAGING_DIR = ".uploads";
+
+    // Handles resumable chunked uploads.
+    // Upload flow:
+    // 1. Client creates a session for a target path (optionally with total size)
+    // 2. Client appends chunks at the current offset; a dropped connection resumes
+    //    from the offset reported by the session
+    // 3. Client finalizes; the staged file is hashed, moved into place and the
+    //    metadata is committed together with removal of the session
+    class UploadService {
+    public:
+        UploadService(fs::Filesystem& fs, storage::MetadataStore& meta, IoEngine& io, std::filesystem::path files_root, i64 session_expiry);
+
+        // Start a new upload session. The path is stored normalized; it must not
+        // name the staging area or an existing directory.
+        [[nodiscard]] stl::result<storage::UploadSession> create_session(std::string_view path, i64 size,
+                                                                         std::optional<sync::Timestamp> client_mtime = std::nullopt);
+
+        // Get session state (for progress / resume)
+        [[nodiscard]] stl::result<std::optional<storage::UploadSession>> get_session(std::string_view id);
+
+        // Write chunk at offset; offset must equal the bytes received so far
+        [[nodiscard]] stl::result<storage::UploadSession> append_chunk(std::string_view id, i64 offset, std::string_view data);
+
+        // Commit staged content to the target path. If the metadata can't be
+        // committed, the target is restored and the session can be finalized again.
+        [[nodiscard]] stl::result<sync::FileMetadata> finalize(std::string_view id);
+
+        // Discard session and staged content; fails for unknown or expired sessions
+        [[nodiscard]] stl::result<> abort(std::string_view id);
+
+        // Discard up to limit expired sessions and their staged content.
+        // Returns the number of sessions removed.
+        [[nodiscard]] stl::result<size_t> cleanup_expired(i64 limit);
+
+    private:
+        fs::Filesystem& m_Fs;
+        storage::MetadataStore& m_Meta;
+        IoEngine& m_Io;
+        std::filesystem::path m_FilesRoot;
+        std::filesystem::path m_StagingDir;
+        i64 m_SessionExpiry; // Seconds
+        std::mutex m_LocksMutex;
+        std::unordered_map<std::string, std::weak_ptr<std::mutex>> m_Locks; // Session id -> lock while in use
+
+        // Held while one session's chunks or commit are written; other sessions
+        // go ahead in parallel
+        class SessionLock {
+        public:
+            explicit SessionLock(std::shared_ptr<std::mutex> mutex) : m_Mutex(std::move(mutex)), m_Lock(*m_Mutex) {}
+
+        private:
+            std::shared_ptr<std::mutex> m_Mutex;
+            std::unique_lock<std::mutex> m_Lock;
+        };
+
+        [[nodiscard]] SessionLock lock_session(const std::string& id);
+
+        [[nodiscard]] std::filesystem::path staged_path(std::string_view id) const;
+
+        [[nodiscard]] stl::result<storage::UploadSession> load_active(std::string_view id);
+    };
+
+} // namespace sap::cloud::services
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace sap::cloud {
+
+    // =============================================================================
+    // Coroutines
+    // =============================================================================
+    // Task<T> is a lazily started coroutine: nothing runs until it is awaited
+    // or handed to sync_wait(), and the awaiting coroutine is resumed directly
+    // when it finishes. Operations that complete on another thread (file I/O,
+    // executor work) don't resume their coroutine there; they post it back to
+    // the RunLoop of the thread driving the task, so handler code only ever
+    // runs on that thread and never on an I/O or database thread.
+    //
+    // Route handlers stay synchronous for now: sap_http blocks a worker for
+    // the whole request, so a handler driven by sync_wait() would hold it just
+    // as long and only add thread hops. They become coroutines once the
+    // transport can resume them itself; run_on() work then has to carry the
+    // request's trace::RequestScope across.
+    // =============================================================================
+
+    // Queue of coroutines ready to resume, drained by the thread in sync_wait()
+    class RunLoop {
+    public:
+        // Loop of the calling thread while it is inside sync_wait(), else null
+        [[nodiscard]] static RunLoop* current();
+
+        // Resume handle on the loop's thread; safe to call from any thread
+        void post(std::coroutine_handle<> handle);
+
+        // Resume posted coroutines until stop() is called
+        void run();
+
+        // Make run() return once the current coroutine suspends
+        void stop();
+
+    private:
+        std::mutex m_Mutex; // Guards m_Ready and m_Stopped
+        std::condition_variable m_Wake;
+        std::deque<std::coroutine_handle<>> m_Ready;
+        bool m_Stopped = false;
+    };
+
+    // Makes loop the calling thread's current loop for its lifetime
+    class RunLoopScope {
+    public:
+        explicit RunLoopScope(RunLoop& loop);
+        ~RunLoopScope();
+        RunLoopScope(const RunLoopScope&) = delete;
+        RunLoopScope& operator=(const RunLoopScope&) = delete;
+
+    private:
+        RunLoop* m_Previous;
+    };
+
+    template <typename T = void>
+    class Task;
+
+    namespace detail {
+        struct TaskPromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct FinalAwaiter {
+                bool await_ready() noexcept { return false; }
+
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                    auto next = handle.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            void unhandled_exception() { exception = std::current_exception(); }
+
+            void rethrow() const {
+                if (exception) {
+                    std::rethrow_exception(exception);
+                }
+            }
+        };
+
+        template <typename T>
+        struct TaskPromise : TaskPromiseBase {
+            std::optional<T> value;
+
+            void return_value(T v) { value.emplace(std::move(v)); }
+
+            T result() {
+                rethrow();
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct TaskPromise<void> : TaskPromiseBase {
+            void return_void() {}
+
+            void result() { rethrow(); }
+        };
+    } // namespace detail
+
+    template <typename T>
+    class [[nodiscard]] Task {
+    public:
+        struct promise_type : detail::TaskPromise<T> {
+            Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        };
+
+        Task(Task&& other) noexcept : m_Handle(std::exchange(other.m_Handle, {})) {}
+
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                if (m_Handle) {
+                    m_Handle.destroy();
+                }
+                m_Handle = std::exchange(other.m_Handle, {});
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task() {
+            if (m_Handle) {
+                m_Handle.destroy();
+            }
+        }
+
+        // Awaiting starts the task; the awaiter resumes when it finishes
+        auto operator co_await() && noexcept {
+            struct Awaiter {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() noexcept { return false; }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                T await_resume() { return handle.promise().result(); }
+            };
+            return Awaiter{m_Handle};
+        }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> handle) : m_Handle(handle) {}
+
+        std::coroutine_handle<promise_type> m_Handle;
+    };
+
+    namespace detail {
+        // Coroutine awaiting the task for sync_wait(); stops the loop once it finishes
+        struct SyncWaitDriver {
+            struct promise_type {
+                RunLoop* loop = nullptr;
+                std::exception_ptr exception;
+
+                SyncWaitDriver get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+
+                std::suspend_always initial_suspend() noexcept { return {}; }
+
+                auto final_suspend() noexcept {
+                    struct StopLoop {
+                        bool await_ready() noexcept { return false; }
+
+                        void await_suspend(std::coroutine_handle<promise_type> handle) noexcept { handle.promise().loop->stop(); }
+
+                        void await_resume() noexcept {}
+                    };
+                    return StopLoop{};
+                }
+
+                void return_void() {}
+
+                void unhandled_exception() { exception = std::current_exception(); }
+            };
+
+            std::coroutine_handle<promise_type> handle;
+        };
+
+        template <typename T>
+        SyncWaitDriver drive(Task<T>& task, std::optional<T>& out) {
+            out.emplace(co_await std::move(task));
+        }
+
+        inline SyncWaitDriver drive(Task<void>& task) { co_await std::move(task); }
+
+        // Resume driver on loop until it finishes, then rethrow anything it threw
+        void run_driver(SyncWaitDriver driver, RunLoop& loop);
+    } // namespace detail
+
+    // Run task to completion on the calling thread, blocking while it waits
+    // for I/O or executor work, and return its result
+    template <typename T>
+    T sync_wait(Task<T> task) {
+        RunLoop loop;
+        RunLoopScope scope(loop);
+        if constexpr (std::is_void_v<T>) {
+            detail::run_driver(detail::drive(task), loop);
+        } else {
+            std::optional<T> out;
+            detail::run_driver(detail::drive(task, out), loop);
+            return std::move(*out);
+        }
+    }
+
+    // =============================================================================
+    // Callback Awaitable
+    // =============================================================================
+    // Adapts a callback-style operation to co_await. submit(callback) starts
+    // the operation; callback(value) may run on any thread, even before submit
+    // returns. The awaiting coroutine resumes on its RunLoop, or, when awaited
+    // outside sync_wait(), the awaiting thread blocks until the value arrives.
+    // =============================================================================
+
+    template <typename T, typename Submit>
+    class CallbackAwaitable {
+    public:
+        explicit CallbackAwaitable(Submit submit) : m_Submit(std::move(submit)) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            if (RunLoop* loop = RunLoop::current()) {
+                m_Submit([this, handle, loop](T value) {
+                    m_Value.emplace(std::move(value));
+                    loop->post(handle);
+                });
+                return true;
+            }
+            // Shared so the callback never touches a promise this frame already released
+            auto ready = std::make_shared<std::promise<void>>();
+            auto arrived = ready->get_future();
+            m_Submit([this, ready](T value) {
+                m_Value.emplace(std::move(value));
+                ready->set_value();
+            });
+            arrived.wait();
+            return false;
+        }
+
+        T await_resume() { return std::move(*m_Value); }
+
+    private:
+        Submit m_Submit;
+        std::optional<T> m_Value;
+    };
+
+    template <typename T, typename Submit>
+    CallbackAwaitable<T, Submit> await_callback(Submit submit) {
+        return CallbackAwaitable<T, Submit>(std::move(submit));
+    }
+
+} // namespace sap::cloud
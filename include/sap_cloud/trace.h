@@ -0,0 +1,79 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <sap_core/types.h>
+#include <string>
+#include <vector>
+
+namespace sap::cloud::trace {
+
+    // =============================================================================
+    // Request Tracing
+    // =============================================================================
+    // RAII spans record (name, start, end, depth) into a fixed-size ring buffer
+    // owned by the current thread. A RequestScope marks the root of a request;
+    // spans opened on the same thread while it is alive are tagged with its id.
+    // When the request is slower than the configured threshold its span tree is
+    // written to the log. All rings can be exported in Chrome trace format
+    // (chrome://tracing, Perfetto) for offline analysis.
+    //
+    // Span names are not copied and must outlive the process (string literals
+    // or route patterns owned by the Router).
+    // =============================================================================
+
+    inline constexpr size_t ring_capacity = 4096;
+
+    struct SpanRecord {
+        const char* name = nullptr;
+        u64 request_id = 0; // 0 outside a request
+        i64 start_ns = 0; // Since the process trace epoch
+        i64 end_ns = 0;
+        u32 depth = 0; // 0 for request roots
+        u32 thread_id = 0;
+    };
+
+    class Span {
+    public:
+        explicit Span(const char* name);
+        ~Span();
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* m_Name;
+        i64 m_Start;
+        u32 m_Depth;
+    };
+
+    class RequestScope {
+    public:
+        // description is only used when the request is logged as slow
+        RequestScope(const char* name, std::string description);
+        ~RequestScope();
+        RequestScope(const RequestScope&) = delete;
+        RequestScope& operator=(const RequestScope&) = delete;
+
+        [[nodiscard]] u64 id() const { return m_Id; }
+
+    private:
+        u64 m_Id;
+        u64 m_Parent;
+        std::string m_Description;
+        std::optional<Span> m_Root;
+        i64 m_Start;
+    };
+
+    // Requests slower than this are logged as span trees. Zero disables logging.
+    void set_slow_threshold(std::chrono::milliseconds threshold);
+
+    // Spans of a request still held in the calling thread's ring, ordered by start
+    [[nodiscard]] std::vector<SpanRecord> request_spans(u64 request_id);
+
+    // Indented tree of spans with durations
+    [[nodiscard]] std::string format_tree(const std::vector<SpanRecord>& spans);
+
+    // Chrome trace event JSON for every span currently held in any ring
+    [[nodiscard]] std::string export_chrome_trace();
+
+} // namespace sap::cloud::trace
@@ -1,33 +1,114 @@
 #include "sap_cloud/auth_manager.h"
+#include <algorithm>
+#include <charconv>
+#include <sap_cloud/base64.h>
+#include <sap_cloud/metrics.h>
 #include <sap_core/log.h>
+#include <sap_sync/hash.h>
 
 namespace sap::cloud::auth {
 
-    AuthManager::AuthManager(storage::MetadataStore& meta, const AuthConfig& config) : m_Meta(meta), m_Config(config) {}
+    namespace {
+        metrics::Histogram auth_histogram(std::string_view op) {
+            return metrics::registry().histogram("sap_auth_duration_seconds", "Authentication step latency", {{"op", std::string(op)}});
+        }
+
+        // Key types as they appear in authorized_keys (options may precede them)
+        bool is_key_type(std::string_view token) {
+            return token.starts_with("ssh-") || token.starts_with("ecdsa-sha2-") || token.starts_with("sk-");
+        }
+    } // namespace
+
+    std::optional<std::string> canonical_key(std::string_view line) {
+        // Split on whitespace; the key type is the first token that names one, the blob follows it
+        auto next_token = [&line]() {
+            size_t start = line.find_first_not_of(" \t\r\n");
+            if (start == std::string_view::npos) {
+                line = {};
+                return std::string_view{};
+            }
+            line.remove_prefix(start);
+            size_t end = std::min(line.find_first_of(" \t\r\n"), line.size());
+            auto token = line.substr(0, end);
+            line.remove_prefix(end);
+            return token;
+        };
+        for (auto token = next_token(); !token.empty(); token = next_token()) {
+            if (is_key_type(token)) {
+                auto blob = next_token();
+                if (blob.empty()) {
+                    return std::nullopt;
+                }
+                return std::string(token) + " " + std::string(blob);
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::string key_fingerprint(std::string_view canonical) {
+        std::vector<u8> blob;
+        auto space = canonical.find(' ');
+        if (space == std::string_view::npos || !decode_base64(canonical.substr(space + 1), blob) || blob.empty()) {
+            return {};
+        }
+        auto hex = sync::hash_bytes(blob.data(), blob.size());
+        std::vector<u8> digest(hex.size() / 2);
+        for (size_t i = 0; i < digest.size(); ++i) {
+            std::from_chars(hex.data() + 2 * i, hex.data() + 2 * i + 2, digest[i], 16);
+        }
+        auto encoded = encode_base64(digest.data(), digest.size());
+        while (!encoded.empty() && encoded.back() == '=') {
+            encoded.pop_back();
+        }
+        return "SHA256:" + encoded;
+    }
+
+    AuthManager::AuthManager(storage::MetadataStore& meta, const AuthConfig& config) :
+        m_Meta(meta), m_Config(config), m_Keys(std::make_shared<const KeySet>()) {}
 
     stl::result<> AuthManager::load_authorized_keys() {
-        std::lock_guard<std::mutex> lock(m_KeysMutex);
+        std::lock_guard<std::mutex> lock(m_ReloadMutex);
         auto keys_result = sync::load_authorized_keys(m_Config.authorized_keys);
         if (!keys_result) {
             return stl::make_error<>("{}", keys_result.error());
         }
-        m_AuthorizedKeys = std::move(keys_result.value());
-        log::info("Loaded {} authorized keys", m_AuthorizedKeys.size());
+        // Parse everything up front so requests never pay for it
+        auto keys = std::make_shared<KeySet>();
+        for (const auto& line : keys_result.value()) {
+            auto canonical = canonical_key(line);
+            if (!canonical) {
+                log::warn("Skipping malformed authorized key: {}...", line.substr(0, 30));
+                continue;
+            }
+            auto parsed = sync::parse_public_key(*canonical);
+            if (!parsed) {
+                log::warn("Skipping unsupported authorized key {}...: {}", canonical->substr(0, 30), parsed.error());
+                continue;
+            }
+            auto fingerprint = key_fingerprint(*canonical);
+            if (fingerprint.empty()) {
+                log::warn("Skipping authorized key with a malformed blob: {}...", canonical->substr(0, 30));
+                continue;
+            }
+            log::debug("Authorized key {}", fingerprint);
+            auto key = *canonical;
+            keys->by_key.insert_or_assign(std::move(key), AuthorizedKey{std::move(*canonical), std::move(fingerprint), std::move(parsed.value())});
+        }
+        size_t count = keys->by_key.size();
+        m_Keys.store(std::move(keys), std::memory_order_release);
+        log::info("Loaded {} authorized keys", count);
         return stl::success;
     }
 
     stl::result<> AuthManager::reload_authorized_keys() { return load_authorized_keys(); }
 
     stl::result<sync::AuthChallenge> AuthManager::create_challenge(std::string_view public_key) {
-        // Verify key is authorized
+        static const auto timing = auth_histogram("challenge");
+        metrics::ScopedTimer timer(timing);
+        // Verify key is authorized (authorized keys were validated when loaded)
         if (!is_authorized(public_key)) {
             return stl::make_error<sync::AuthChallenge>("Key not authorized");
         }
-        // Parse key to verify format
-        auto key_result = sync::parse_public_key(public_key);
-        if (!key_result) {
-            return stl::make_error<sync::AuthChallenge>("Invalid public key format: {}", key_result.error());
-        }
         // Generate challenge
         std::string challenge = sync::generate_challenge();
         i64 expires_at = (sync::now_ms() / 1000) + m_Config.challenge_expiry;
@@ -45,6 +126,8 @@ namespace sap::cloud::auth {
     }
 
     stl::result<sync::AuthToken> AuthManager::verify_challenge(const sync::VerifyRequest& req) {
+        static const auto timing = auth_histogram("verify");
+        metrics::ScopedTimer timer(timing);
         // Validate challenge exists and matches public key
         auto valid_result = m_Meta.validate_challenge(req.challenge, req.public_key);
         if (!valid_result) {
@@ -53,13 +136,13 @@ namespace sap::cloud::auth {
         if (!valid_result.value()) {
             return stl::make_error<sync::AuthToken>("Invalid or expired challenge");
         }
-        // Parse public key
-        auto key_result = sync::parse_public_key(req.public_key);
-        if (!key_result) {
-            return stl::make_error<sync::AuthToken>("Invalid public key");
+        // Key may have been revoked since the challenge was issued
+        auto authorized = find_key(req.public_key);
+        if (!authorized) {
+            return stl::make_error<sync::AuthToken>("Key not authorized");
         }
         // Verify signature
-        auto verify_result = sync::verify_signature(key_result.value(), req.challenge, req.signature);
+        auto verify_result = sync::verify_signature(authorized->key, req.challenge, req.signature);
         if (!verify_result) {
             return stl::make_error<sync::AuthToken>("{}", verify_result.error());
         }
@@ -82,19 +165,34 @@ namespace sap::cloud::auth {
         return resp;
     }
 
-    stl::result<bool> AuthManager::validate_token(std::string_view token) { return m_Meta.validate_token(token); }
+    stl::result<bool> AuthManager::validate_token(std::string_view token) {
+        static const auto timing = auth_histogram("token");
+        metrics::ScopedTimer timer(timing);
+        return m_Meta.validate_token(token);
+    }
 
     stl::result<> AuthManager::cleanup_expired() {
         auto r = m_Meta.cleanup_expired_tokens();
         if (!r) {
             return r;
         }
-        return stl::success;
+        return m_Meta.cleanup_expired_challenges();
     }
 
-    bool AuthManager::is_authorized(std::string_view public_key) {
-        std::lock_guard<std::mutex> lock(m_KeysMutex);
-        return sync::is_key_authorized(m_AuthorizedKeys, public_key);
+    bool AuthManager::is_authorized(std::string_view public_key) const { return find_key(public_key) != nullptr; }
+
+    std::shared_ptr<const AuthorizedKey> AuthManager::find_key(std::string_view public_key) const {
+        auto canonical = canonical_key(public_key);
+        if (!canonical) {
+            return nullptr;
+        }
+        auto keys = m_Keys.load(std::memory_order_acquire);
+        auto it = keys->by_key.find(*canonical);
+        if (it == keys->by_key.end()) {
+            return nullptr;
+        }
+        // Aliasing constructor: shares ownership of the whole snapshot
+        return std::shared_ptr<const AuthorizedKey>(std::move(keys), &it->second);
     }
 
 } // namespace sap::cloud::auth
@@ -0,0 +1,69 @@
+#include <sap_cloud/base64.h>
+#include <array>
+
+namespace sap::cloud {
+
+    namespace {
+        constexpr char kBase64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        // Sextet value of each byte, or -1 outside the alphabet
+        constexpr std::array<i8, 256> kBase64Values = [] {
+            std::array<i8, 256> values{};
+            values.fill(-1);
+            for (i8 i = 0; i < 64; ++i) {
+                values[static_cast<u8>(kBase64Digits[i])] = i;
+            }
+            return values;
+        }();
+    } // namespace
+
+    std::string encode_base64(const u8* data, size_t size) {
+        std::string out;
+        out.reserve((size + 2) / 3 * 4);
+        size_t i = 0;
+        for (; i + 2 < size; i += 3) {
+            u32 triple = static_cast<u32>(data[i]) << 16 | static_cast<u32>(data[i + 1]) << 8 | data[i + 2];
+            out.push_back(kBase64Digits[triple >> 18 & 63]);
+            out.push_back(kBase64Digits[triple >> 12 & 63]);
+            out.push_back(kBase64Digits[triple >> 6 & 63]);
+            out.push_back(kBase64Digits[triple & 63]);
+        }
+        if (i < size) {
+            u32 triple = static_cast<u32>(data[i]) << 16;
+            if (i + 1 < size) {
+                triple |= static_cast<u32>(data[i + 1]) << 8;
+            }
+            out.push_back(kBase64Digits[triple >> 18 & 63]);
+            out.push_back(kBase64Digits[triple >> 12 & 63]);
+            out.push_back(i + 1 < size ? kBase64Digits[triple >> 6 & 63] : '=');
+            out.push_back('=');
+        }
+        return out;
+    }
+
+    bool decode_base64(std::string_view text, std::vector<u8>& out) {
+        while (!text.empty() && text.back() == '=') {
+            text.remove_suffix(1);
+        }
+        if (text.size() % 4 == 1) {
+            return false;
+        }
+        out.reserve(out.size() + text.size() / 4 * 3 + 2);
+        u32 buffer = 0;
+        u32 bits = 0;
+        for (char c : text) {
+            i32 value = kBase64Values[static_cast<u8>(c)];
+            if (value < 0) {
+                return false;
+            }
+            buffer = buffer << 6 | static_cast<u32>(value);
+            bits += 6;
+            if (bits >= 8) {
+                bits -= 8;
+                out.push_back(static_cast<u8>(buffer >> bits));
+            }
+        }
+        return true;
+    }
+
+} // namespace sap::cloud
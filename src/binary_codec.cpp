@@ -0,0 +1,303 @@
+#include <sap_cloud/binary_codec.h>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <utility>
+
+namespace sap::cloud::binary {
+
+    namespace {
+        constexpr std::string_view kMagic = "SAPS";
+        constexpr u8 kVersion = 1;
+        constexpr u8 kSyncStatePayload = 1;
+        constexpr u8 kFileListPayload = 2;
+
+        constexpr u8 kDeleted = 1 << 0;
+        constexpr u8 kDigest = 1 << 1;
+        constexpr u8 kTextHash = 1 << 2;
+
+        constexpr size_t kDigestBytes = 32;
+        constexpr char kHexDigits[] = "0123456789abcdef";
+
+        void put_varint(std::string& out, u64 value) {
+            while (value >= 0x80) {
+                out.push_back(static_cast<char>(value | 0x80));
+                value >>= 7;
+            }
+            out.push_back(static_cast<char>(value));
+        }
+
+        void put_svarint(std::string& out, i64 value) { put_varint(out, (static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63)); }
+
+        // Deltas wrap instead of overflowing, so any pair of timestamps round-trips
+        i64 delta(i64 value, i64 base) { return static_cast<i64>(static_cast<u64>(value) - static_cast<u64>(base)); }
+
+        i64 undelta(i64 delta, i64 base) { return static_cast<i64>(static_cast<u64>(base) + static_cast<u64>(delta)); }
+
+        // Nibble value of each byte, or -1 for anything but lowercase hex
+        constexpr std::array<i8, 256> kHexValues = [] {
+            std::array<i8, 256> values{};
+            values.fill(-1);
+            for (i8 i = 0; i < 16; ++i) {
+                values[static_cast<u8>(kHexDigits[i])] = i;
+            }
+            return values;
+        }();
+
+        // Lowercase hex only, so decoding gives back the same string
+        bool decode_hex(std::string_view hex, std::array<u8, kDigestBytes>& digest) {
+            if (hex.size() != kDigestBytes * 2) {
+                return false;
+            }
+            i32 invalid = 0;
+            for (size_t i = 0; i < kDigestBytes; ++i) {
+                i32 hi = kHexValues[static_cast<u8>(hex[2 * i])];
+                i32 lo = kHexValues[static_cast<u8>(hex[2 * i + 1])];
+                invalid |= hi | lo;
+                digest[i] = static_cast<u8>(hi << 4 | lo);
+            }
+            return invalid >= 0;
+        }
+
+        void put_files(std::string& out, const std::vector<sync::FileMetadata>& files) {
+            // Sorted paths share long prefixes; results usually come in another order.
+            // Sort (path, index) pairs so comparisons don't chase each FileMetadata.
+            std::vector<std::pair<std::string_view, u32>> order;
+            order.reserve(files.size());
+            for (u32 i = 0; i < files.size(); ++i) {
+                order.emplace_back(files[i].path, i);
+            }
+            if (!std::is_sorted(order.begin(), order.end())) {
+                std::sort(order.begin(), order.end());
+            }
+            out.reserve(out.size() + files.size() * 56);
+            put_varint(out, files.size());
+            std::string_view previous;
+            sync::Timestamp previous_updated = 0;
+            std::array<u8, kDigestBytes> digest;
+            for (const auto& [path, i] : order) {
+                const auto& meta = files[i];
+                size_t shared = 0;
+                size_t limit = std::min(path.size(), previous.size());
+                while (shared < limit && path[shared] == previous[shared]) {
+                    ++shared;
+                }
+                put_varint(out, shared);
+                put_varint(out, path.size() - shared);
+                out.append(path.substr(shared));
+                previous = path;
+
+                u8 flags = meta.is_deleted ? kDeleted : 0;
+                if (decode_hex(meta.hash, digest)) {
+                    out.push_back(static_cast<char>(flags | kDigest));
+                    out.append(reinterpret_cast<const char*>(digest.data()), digest.size());
+                } else if (!meta.hash.empty()) {
+                    out.push_back(static_cast<char>(flags | kTextHash));
+                    put_varint(out, meta.hash.size());
+                    out.append(meta.hash);
+                } else {
+                    out.push_back(static_cast<char>(flags));
+                }
+                put_svarint(out, meta.size);
+                put_svarint(out, delta(meta.updated_at, previous_updated));
+                put_svarint(out, delta(meta.created_at, meta.updated_at));
+                put_svarint(out, delta(meta.mtime, meta.updated_at));
+                previous_updated = meta.updated_at;
+            }
+        }
+
+        // Bounds-checked cursor; any read past the end or malformed varint
+        // leaves it failed and returns zeroes from then on
+        class Reader {
+        public:
+            explicit Reader(std::string_view data) : m_Data(data) {}
+
+            [[nodiscard]] bool ok() const { return m_Ok; }
+
+            [[nodiscard]] bool at_end() const { return m_Pos == m_Data.size(); }
+
+            u8 byte() {
+                if (!m_Ok || m_Pos >= m_Data.size()) {
+                    m_Ok = false;
+                    return 0;
+                }
+                return static_cast<u8>(m_Data[m_Pos++]);
+            }
+
+            u64 varint() {
+                u64 value = 0;
+                for (u32 shift = 0; shift < 64; shift += 7) {
+                    u8 b = byte();
+                    value |= static_cast<u64>(b & 0x7f) << shift;
+                    if (!(b & 0x80)) {
+                        return value;
+                    }
+                }
+                m_Ok = false;
+                return 0;
+            }
+
+            i64 svarint() {
+                u64 value = varint();
+                return static_cast<i64>(value >> 1) ^ -static_cast<i64>(value & 1);
+            }
+
+            std::string_view bytes(u64 count) {
+                if (!m_Ok || count > m_Data.size() - m_Pos) {
+                    m_Ok = false;
+                    return {};
+                }
+                auto view = m_Data.substr(m_Pos, count);
+                m_Pos += count;
+                return view;
+            }
+
+        private:
+            std::string_view m_Data;
+            size_t m_Pos = 0;
+            bool m_Ok = true;
+        };
+
+        stl::result<> read_header(Reader& in, u8 payload) {
+            if (in.bytes(kMagic.size()) != kMagic) {
+                return stl::make_error("Not a binary sync payload");
+            }
+            u8 version = in.byte();
+            if (version != kVersion) {
+                return stl::make_error("Unsupported binary sync version {}", static_cast<u32>(version));
+            }
+            if (in.byte() != payload) {
+                return stl::make_error("Unexpected binary sync payload type");
+            }
+            return stl::success;
+        }
+
+        stl::result<std::vector<sync::FileMetadata>> read_files(Reader& in) {
+            u64 count = in.varint();
+            std::vector<sync::FileMetadata> files;
+            // A corrupt count must not reserve unbounded memory
+            files.reserve(static_cast<size_t>(std::min<u64>(count, 1 << 20)));
+            std::string previous;
+            sync::Timestamp previous_updated = 0;
+            for (u64 i = 0; i < count && in.ok(); ++i) {
+                sync::FileMetadata meta;
+                u64 shared = in.varint();
+                u64 length = in.varint();
+                if (shared > previous.size()) {
+                    return stl::make_error<std::vector<sync::FileMetadata>>("Corrupt binary sync payload: bad path prefix at entry {}", i);
+                }
+                auto rest = in.bytes(length);
+                meta.path.reserve(shared + rest.size());
+                meta.path.assign(previous, 0, shared);
+                meta.path.append(rest);
+                previous = meta.path;
+
+                u8 flags = in.byte();
+                meta.is_deleted = (flags & kDeleted) != 0;
+                if (flags & kDigest) {
+                    auto digest = in.bytes(kDigestBytes);
+                    meta.hash.resize(digest.size() * 2);
+                    for (size_t b = 0; b < digest.size(); ++b) {
+                        auto value = static_cast<u8>(digest[b]);
+                        meta.hash[2 * b] = kHexDigits[value >> 4];
+                        meta.hash[2 * b + 1] = kHexDigits[value & 0xf];
+                    }
+                } else if (flags & kTextHash) {
+                    meta.hash = std::string(in.bytes(in.varint()));
+                }
+                meta.size = in.svarint();
+                meta.updated_at = undelta(in.svarint(), previous_updated);
+                meta.created_at = undelta(in.svarint(), meta.updated_at);
+                meta.mtime = undelta(in.svarint(), meta.updated_at);
+                previous_updated = meta.updated_at;
+                files.push_back(std::move(meta));
+            }
+            if (!in.ok()) {
+                return stl::make_error<std::vector<sync::FileMetadata>>("Corrupt binary sync payload: truncated");
+            }
+            return files;
+        }
+    } // namespace
+
+    bool accepts(std::string_view accept) {
+        while (!accept.empty()) {
+            auto comma = accept.find(',');
+            auto range = accept.substr(0, comma);
+            accept = comma == std::string_view::npos ? std::string_view{} : accept.substr(comma + 1);
+            auto semicolon = range.find(';');
+            auto type = range.substr(0, semicolon);
+            auto params = semicolon == std::string_view::npos ? std::string_view{} : range.substr(semicolon + 1);
+            while (!type.empty() && type.front() == ' ') {
+                type.remove_prefix(1);
+            }
+            while (!type.empty() && type.back() == ' ') {
+                type.remove_suffix(1);
+            }
+            if (type != media_type) {
+                continue;
+            }
+            auto q = params.find("q=");
+            if (q == std::string_view::npos) {
+                return true;
+            }
+            double quality = 1;
+            auto value = params.substr(q + 2);
+            std::from_chars(value.data(), value.data() + value.size(), quality);
+            return quality > 0;
+        }
+        return false;
+    }
+
+    void encode(const sync::SyncState& state, std::string& out) {
+        out.clear();
+        out.append(kMagic);
+        out.push_back(static_cast<char>(kVersion));
+        out.push_back(static_cast<char>(kSyncStatePayload));
+        put_svarint(out, state.server_time);
+        put_files(out, state.files);
+    }
+
+    void encode(const std::vector<sync::FileMetadata>& files, std::string& out) {
+        out.clear();
+        out.append(kMagic);
+        out.push_back(static_cast<char>(kVersion));
+        out.push_back(static_cast<char>(kFileListPayload));
+        put_files(out, files);
+    }
+
+    stl::result<sync::SyncState> decode_sync_state(std::string_view data) {
+        Reader in(data);
+        auto header = read_header(in, kSyncStatePayload);
+        if (!header) {
+            return stl::make_error<sync::SyncState>("{}", header.error());
+        }
+        sync::SyncState state;
+        state.server_time = in.svarint();
+        auto files = read_files(in);
+        if (!files) {
+            return stl::make_error<sync::SyncState>("{}", files.error());
+        }
+        if (!in.at_end()) {
+            return stl::make_error<sync::SyncState>("Corrupt binary sync payload: trailing bytes");
+        }
+        state.files = std::move(files.value());
+        return state;
+    }
+
+    stl::result<std::vector<sync::FileMetadata>> decode_files(std::string_view data) {
+        Reader in(data);
+        auto header = read_header(in, kFileListPayload);
+        if (!header) {
+            return stl::make_error<std::vector<sync::FileMetadata>>("{}", header.error());
+        }
+        auto files = read_files(in);
+        if (!files) {
+            return files;
+        }
+        if (!in.at_end()) {
+            return stl::make_error<std::vector<sync::FileMetadata>>("Corrupt binary sync payload: trailing bytes");
+        }
+        return files;
+    }
+
+} // namespace sap::cloud::binary
@@ -0,0 +1,69 @@
+#include <sap_cloud/bloom_filter.h>
+#include <sap_cloud/base64.h>
+#include <charconv>
+#include <sap_sync/hash.h>
+#include <utility>
+
+namespace sap::cloud {
+
+    namespace {
+        std::pair<u64, u64> hash_pair(std::string_view hash) {
+            u64 h1 = 0;
+            u64 h2 = 0;
+            if (hash.size() >= 32) {
+                auto first = std::from_chars(hash.data(), hash.data() + 16, h1, 16);
+                auto second = std::from_chars(hash.data() + 16, hash.data() + 32, h2, 16);
+                if (first.ptr == hash.data() + 16 && second.ptr == hash.data() + 32) {
+                    return {h1, h2};
+                }
+            }
+            auto digest = sync::hash_string(hash);
+            std::from_chars(digest.data(), digest.data() + 16, h1, 16);
+            std::from_chars(digest.data() + 16, digest.data() + 32, h2, 16);
+            return {h1, h2};
+        }
+    } // namespace
+
+    BloomFilter::BloomFilter(u64 bit_count, u32 hash_count) : m_Bits(std::max<u64>((bit_count + 7) / 8, 1)), m_HashCount(hash_count) {}
+
+    stl::result<BloomFilter> BloomFilter::decode(std::string_view base64, i64 hash_count) {
+        if (hash_count < 1 || hash_count > max_hash_count) {
+            return stl::make_error<BloomFilter>("Bloom filter hash count must be between 1 and {}", max_hash_count);
+        }
+        if (base64.size() / 4 * 3 > max_bytes) {
+            return stl::make_error<BloomFilter>("Bloom filter is larger than {} bytes", max_bytes);
+        }
+        std::vector<u8> bits;
+        if (!decode_base64(base64, bits)) {
+            return stl::make_error<BloomFilter>("Bloom filter is not valid base64");
+        }
+        if (bits.empty()) {
+            return stl::make_error<BloomFilter>("Bloom filter is empty");
+        }
+        return BloomFilter(std::move(bits), static_cast<u32>(hash_count));
+    }
+
+    void BloomFilter::add(std::string_view hash) {
+        auto [h1, h2] = hash_pair(hash);
+        u64 bits = bit_count();
+        for (u32 i = 0; i < m_HashCount; ++i) {
+            u64 bit = (h1 + i * h2) % bits;
+            m_Bits[bit / 8] |= static_cast<u8>(1u << (bit % 8));
+        }
+    }
+
+    bool BloomFilter::may_contain(std::string_view hash) const {
+        auto [h1, h2] = hash_pair(hash);
+        u64 bits = bit_count();
+        for (u32 i = 0; i < m_HashCount; ++i) {
+            u64 bit = (h1 + i * h2) % bits;
+            if (!(m_Bits[bit / 8] & (1u << (bit % 8)))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string BloomFilter::encode() const { return encode_base64(m_Bits.data(), m_Bits.size()); }
+
+} // namespace sap::cloud
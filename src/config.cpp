@@ -34,6 +34,9 @@ namespace sap::cloud {
                 if (auto mt = (*server)["multithreaded"].value<bool>()) {
                     config.server.multithreaded = *mt;
                 }
+                if (auto metrics = (*server)["metrics"].value<bool>()) {
+                    config.server.metrics = *metrics;
+                }
             }
             // Storage section
             auto data_dir = get_data_dir();
@@ -50,6 +53,51 @@ namespace sap::cloud {
                 if (auto db = (*storage)["database"].value<std::string>()) {
                     config.storage.database = *db;
                 }
+                if (auto ue = (*storage)["upload_session_expiry"].value<i64>()) {
+                    config.storage.upload_session_expiry = *ue;
+                }
+                if (auto watch = (*storage)["watch"].value<bool>()) {
+                    config.storage.watch = *watch;
+                }
+                if (auto debounce = (*storage)["watch_debounce_ms"].value<i64>()) {
+                    config.storage.watch_debounce_ms = *debounce;
+                }
+                if (auto backend = (*storage)["io_backend"].value<std::string>()) {
+                    config.storage.io_backend = *backend;
+                }
+                if (auto threads = (*storage)["io_threads"].value<i64>()) {
+                    config.storage.io_threads = *threads;
+                }
+                if (auto depth = (*storage)["io_queue_depth"].value<i64>()) {
+                    config.storage.io_queue_depth = *depth;
+                }
+                if (auto durability = (*storage)["durability"].value<std::string>()) {
+                    config.storage.durability = *durability;
+                }
+                if (auto cache = (*storage)["cache_mb"].value<i64>()) {
+                    config.storage.cache_mb = *cache;
+                }
+                if (auto entry = (*storage)["cache_max_entry_kb"].value<i64>()) {
+                    config.storage.cache_max_entry_kb = *entry;
+                }
+                if (auto group = (*storage)["group_commit"].value<bool>()) {
+                    config.storage.group_commit = *group;
+                }
+                if (auto batch = (*storage)["group_commit_batch"].value<i64>()) {
+                    config.storage.group_commit_batch = *batch;
+                }
+                if (auto window = (*storage)["group_commit_window_us"].value<i64>()) {
+                    config.storage.group_commit_window_us = *window;
+                }
+                if (auto index = (*storage)["file_index"].value<bool>()) {
+                    config.storage.file_index = *index;
+                }
+                if (auto verify = (*storage)["file_index_verify"].value<bool>()) {
+                    config.storage.file_index_verify = *verify;
+                }
+                if (auto tree = (*storage)["merkle_tree"].value<bool>()) {
+                    config.storage.merkle_tree = *tree;
+                }
             }
             // Auth section
             config.auth.authorized_keys = data_dir / "authorized_keys";
@@ -63,12 +111,48 @@ namespace sap::cloud {
                 if (auto ce = (*auth)["challenge_expiry"].value<i64>()) {
                     config.auth.challenge_expiry = *ce;
                 }
+                if (auto watch = (*auth)["watch_authorized_keys"].value<bool>()) {
+                    config.auth.watch_authorized_keys = *watch;
+                }
             }
             // Logging section
             if (auto logging = tbl["logging"].as_table()) {
                 if (auto level = (*logging)["level"].value<std::string>()) {
                     config.logging.level = *level;
                 }
+                if (auto slow = (*logging)["slow_request_ms"].value<i64>()) {
+                    config.logging.slow_request_ms = *slow;
+                }
+            }
+            // Maintenance section
+            if (auto maintenance = tbl["maintenance"].as_table()) {
+                if (auto enabled = (*maintenance)["enabled"].value<bool>()) {
+                    config.maintenance.enabled = *enabled;
+                }
+                if (auto slice = (*maintenance)["slice_ms"].value<i64>()) {
+                    config.maintenance.slice_ms = *slice;
+                }
+                if (auto batch = (*maintenance)["batch_size"].value<i64>()) {
+                    config.maintenance.batch_size = *batch;
+                }
+                if (auto retention = (*maintenance)["tombstone_retention_days"].value<i64>()) {
+                    config.maintenance.tombstone_retention_days = *retention;
+                }
+                if (auto ei = (*maintenance)["expiry_interval"].value<i64>()) {
+                    config.maintenance.expiry_interval = *ei;
+                }
+                if (auto hi = (*maintenance)["hash_interval"].value<i64>()) {
+                    config.maintenance.hash_interval = *hi;
+                }
+                if (auto ci = (*maintenance)["compaction_interval"].value<i64>()) {
+                    config.maintenance.compaction_interval = *ci;
+                }
+                if (auto oi = (*maintenance)["optimize_interval"].value<i64>()) {
+                    config.maintenance.optimize_interval = *oi;
+                }
+                if (auto wi = (*maintenance)["checkpoint_interval"].value<i64>()) {
+                    config.maintenance.checkpoint_interval = *wi;
+                }
             }
             return config;
         } catch (const toml::parse_error& err) {
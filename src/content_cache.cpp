@@ -0,0 +1,94 @@
+#include <sap_cloud/content_cache.h>
+#include <algorithm>
+#include <functional>
+#include <sap_cloud/metrics.h>
+
+namespace sap::cloud {
+
+    namespace {
+        struct CacheMetrics {
+            metrics::Counter hits;
+            metrics::Counter misses;
+        };
+
+        const CacheMetrics& cache_metrics() {
+            static const CacheMetrics m{
+                metrics::registry().counter("sap_content_cache_requests_total", "Content cache lookups", {{"result", "hit"}}),
+                metrics::registry().counter("sap_content_cache_requests_total", "Content cache lookups", {{"result", "miss"}}),
+            };
+            return m;
+        }
+
+        std::string make_key(ECacheKind kind, std::string_view hash) {
+            std::string key;
+            key.reserve(hash.size() + 1);
+            key.push_back(kind == ECacheKind::File ? 'f' : 'n');
+            key.append(hash);
+            return key;
+        }
+    } // namespace
+
+    ContentCache::ContentCache(const ContentCacheOptions& options) :
+        m_ShardCapacity(options.capacity_bytes / std::max<size_t>(options.shards, 1)),
+        m_MaxEntry(std::min(options.max_entry_bytes, m_ShardCapacity)), m_Shards(std::max<size_t>(options.shards, 1)) {}
+
+    ContentCache::Shard& ContentCache::shard_for(std::string_view key) { return m_Shards[std::hash<std::string_view>{}(key) % m_Shards.size()]; }
+
+    ContentCache::Value ContentCache::get(ECacheKind kind, std::string_view hash) {
+        if (hash.empty() || m_ShardCapacity == 0) {
+            return nullptr;
+        }
+        auto key = make_key(kind, hash);
+        auto& shard = shard_for(key);
+        Value value;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end()) {
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                value = it->second->value;
+                shard.hits++;
+            } else {
+                shard.misses++;
+            }
+        }
+        (value ? cache_metrics().hits : cache_metrics().misses).inc();
+        return value;
+    }
+
+    void ContentCache::put(ECacheKind kind, std::string_view hash, std::string value) {
+        if (hash.empty() || !admits(value.size())) {
+            return;
+        }
+        auto key = make_key(kind, hash);
+        auto shared = std::make_shared<const std::string>(std::move(value));
+        auto& shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (auto it = shard.index.find(key); it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return;
+        }
+        shard.lru.push_front({std::move(key), std::move(shared)});
+        shard.index.emplace(shard.lru.front().key, shard.lru.begin());
+        shard.bytes += shard.lru.front().value->size();
+        while (shard.bytes > m_ShardCapacity) {
+            auto& oldest = shard.lru.back();
+            shard.bytes -= oldest.value->size();
+            shard.index.erase(oldest.key);
+            shard.lru.pop_back();
+        }
+    }
+
+    ContentCache::Stats ContentCache::stats() const {
+        Stats stats;
+        for (const auto& shard : m_Shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            stats.hits += shard.hits;
+            stats.misses += shard.misses;
+            stats.entries += shard.lru.size();
+            stats.bytes += shard.bytes;
+        }
+        return stats;
+    }
+
+} // namespace sap::cloud
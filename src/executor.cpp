@@ -0,0 +1,48 @@
+#include <sap_cloud/executor.h>
+#include <algorithm>
+
+namespace sap::cloud {
+
+    Executor::Executor(size_t threads) {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+            m_Threads.emplace_back([this] { run(); });
+        }
+    }
+
+    Executor::~Executor() {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_Wake.notify_all();
+        for (auto& thread : m_Threads) {
+            thread.join();
+        }
+    }
+
+    void Executor::post(std::function<void()> work) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Queue.push_back(std::move(work));
+        }
+        m_Wake.notify_one();
+    }
+
+    void Executor::run() {
+        while (true) {
+            std::function<void()> work;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [this] { return m_Stopping || !m_Queue.empty(); });
+                // Drain the queue before stopping so every completion runs
+                if (m_Queue.empty()) {
+                    return;
+                }
+                work = std::move(m_Queue.front());
+                m_Queue.pop_front();
+            }
+            work();
+        }
+    }
+
+} // namespace sap::cloud
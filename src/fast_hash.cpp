@@ -0,0 +1,99 @@
+#include <bit>
+#include <cstring>
+#include <sap_cloud/fast_hash.h>
+
+namespace sap::cloud {
+
+    namespace {
+        constexpr u64 prime1 = 0x9E3779B185EBCA87ULL;
+        constexpr u64 prime2 = 0xC2B2AE3D27D4EB4FULL;
+        constexpr u64 prime3 = 0x165667B19E3779F9ULL;
+        constexpr u64 prime4 = 0x85EBCA77C2B2AE63ULL;
+        constexpr u64 prime5 = 0x27D4EB2F165667C5ULL;
+
+        template <typename T>
+        T read_le(const u8* p) {
+            T v;
+            std::memcpy(&v, p, sizeof(v));
+            if constexpr (std::endian::native == std::endian::big) {
+                if constexpr (sizeof(T) == 8) {
+                    v = __builtin_bswap64(v);
+                } else {
+                    v = __builtin_bswap32(v);
+                }
+            }
+            return v;
+        }
+
+        u64 round(u64 acc, u64 input) {
+            acc += input * prime2;
+            acc = std::rotl(acc, 31);
+            return acc * prime1;
+        }
+
+        u64 merge_round(u64 acc, u64 value) {
+            acc ^= round(0, value);
+            return acc * prime1 + prime4;
+        }
+    } // namespace
+
+    u64 xxh64(const void* data, size_t size, u64 seed) {
+        const auto* p = static_cast<const u8*>(data);
+        const u8* end = p + size;
+        u64 h;
+        if (size >= 32) {
+            // Four independent lanes keep the multipliers busy
+            u64 v1 = seed + prime1 + prime2;
+            u64 v2 = seed + prime2;
+            u64 v3 = seed;
+            u64 v4 = seed - prime1;
+            const u8* limit = end - 32;
+            do {
+                v1 = round(v1, read_le<u64>(p));
+                v2 = round(v2, read_le<u64>(p + 8));
+                v3 = round(v3, read_le<u64>(p + 16));
+                v4 = round(v4, read_le<u64>(p + 24));
+                p += 32;
+            } while (p <= limit);
+            h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+            h = merge_round(h, v1);
+            h = merge_round(h, v2);
+            h = merge_round(h, v3);
+            h = merge_round(h, v4);
+        } else {
+            h = seed + prime5;
+        }
+        h += static_cast<u64>(size);
+        for (; p + 8 <= end; p += 8) {
+            h ^= round(0, read_le<u64>(p));
+            h = std::rotl(h, 27) * prime1 + prime4;
+        }
+        if (p + 4 <= end) {
+            h ^= static_cast<u64>(read_le<u32>(p)) * prime1;
+            h = std::rotl(h, 23) * prime2 + prime3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= static_cast<u64>(*p) * prime5;
+            h = std::rotl(h, 11) * prime1;
+        }
+        h ^= h >> 33;
+        h *= prime2;
+        h ^= h >> 29;
+        h *= prime3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    std::string fast_hash(const void* data, size_t size) {
+        static constexpr char digits[] = "0123456789abcdef";
+        u64 h = xxh64(data, size);
+        std::string out(16, '0');
+        for (size_t i = 0; i < 16; ++i) {
+            out[15 - i] = digits[h & 0xF];
+            h >>= 4;
+        }
+        return out;
+    }
+
+} // namespace sap::cloud
@@ -0,0 +1,343 @@
+#include <sap_cloud/file_index.h>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <unordered_set>
+
+namespace sap::cloud::storage {
+
+    namespace {
+        constexpr char kHexDigits[] = "0123456789abcdef";
+
+        i32 hex_value(char c) {
+            if (c >= '0' && c <= '9') {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f') {
+                return c - 'a' + 10;
+            }
+            return -1;
+        }
+
+        // Lowercase hex only, so encoding the digest gives back the same string
+        bool decode_digest(std::string_view hex, std::array<u8, 32>& digest) {
+            if (hex.size() != digest.size() * 2) {
+                return false;
+            }
+            for (size_t i = 0; i < digest.size(); ++i) {
+                i32 hi = hex_value(hex[2 * i]);
+                i32 lo = hex_value(hex[2 * i + 1]);
+                if (hi < 0 || lo < 0) {
+                    return false;
+                }
+                digest[i] = static_cast<u8>(hi << 4 | lo);
+            }
+            return true;
+        }
+
+        bool stamp_less(sync::Timestamp updated_at, u32 slot, sync::Timestamp other_updated_at, u32 other_slot) {
+            return updated_at < other_updated_at || (updated_at == other_updated_at && slot < other_slot);
+        }
+
+        bool same_row(const sync::FileMetadata& a, const sync::FileMetadata& b) {
+            return a.path == b.path && a.hash == b.hash && a.size == b.size && a.mtime == b.mtime && a.created_at == b.created_at &&
+                   a.updated_at == b.updated_at && a.is_deleted == b.is_deleted;
+        }
+
+        std::string describe(const sync::FileMetadata& meta) {
+            std::ostringstream out;
+            out << "hash=" << (meta.hash.empty() ? "-" : meta.hash) << " size=" << meta.size << " mtime=" << meta.mtime
+                << " created_at=" << meta.created_at << " updated_at=" << meta.updated_at << " deleted=" << meta.is_deleted;
+            return out.str();
+        }
+    } // namespace
+
+    void FileIndex::load(const std::vector<sync::FileMetadata>& rows) {
+        std::unique_lock lock(m_Mutex);
+        clear();
+        m_Paths.reserve(rows.size());
+        m_Digests.reserve(rows.size());
+        m_Sizes.reserve(rows.size());
+        m_Mtimes.reserve(rows.size());
+        m_Created.reserve(rows.size());
+        m_Updated.reserve(rows.size());
+        m_Flags.reserve(rows.size());
+        m_Slots.reserve(rows.size());
+        m_Order.reserve(rows.size());
+        for (const auto& meta : rows) {
+            if (m_Slots.contains(meta.path)) {
+                continue;
+            }
+            auto slot = static_cast<u32>(m_Paths.size());
+            auto path = intern(meta.path);
+            m_Paths.push_back(path);
+            m_Digests.emplace_back();
+            m_Sizes.push_back(0);
+            m_Mtimes.push_back(0);
+            m_Created.push_back(0);
+            m_Updated.push_back(0);
+            m_Flags.push_back(0);
+            set_row(slot, meta);
+            m_Slots.emplace(path, slot);
+            m_Order.push_back({meta.updated_at, slot, true});
+        }
+        // One sort instead of an ordered insert per row
+        std::sort(m_Order.begin(), m_Order.end(),
+                  [](const Stamp& a, const Stamp& b) { return stamp_less(a.updated_at, a.slot, b.updated_at, b.slot); });
+    }
+
+    void FileIndex::apply(const sync::FileMetadata& meta) {
+        std::unique_lock lock(m_Mutex);
+        auto it = m_Slots.find(meta.path);
+        if (it != m_Slots.end()) {
+            u32 slot = it->second;
+            if (m_Updated[slot] != meta.updated_at) {
+                unstamp(slot);
+                stamp(slot, meta.updated_at);
+            }
+            set_row(slot, meta);
+            return;
+        }
+        u32 slot;
+        if (!m_FreeSlots.empty()) {
+            slot = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        } else {
+            slot = static_cast<u32>(m_Paths.size());
+            m_Paths.emplace_back();
+            m_Digests.emplace_back();
+            m_Sizes.push_back(0);
+            m_Mtimes.push_back(0);
+            m_Created.push_back(0);
+            m_Updated.push_back(0);
+            m_Flags.push_back(0);
+        }
+        m_Paths[slot] = intern(meta.path);
+        set_row(slot, meta);
+        m_Slots.emplace(m_Paths[slot], slot);
+        stamp(slot, meta.updated_at);
+    }
+
+    void FileIndex::erase(std::string_view path) {
+        std::unique_lock lock(m_Mutex);
+        auto it = m_Slots.find(path);
+        if (it == m_Slots.end()) {
+            return;
+        }
+        u32 slot = it->second;
+        m_Slots.erase(it);
+        unstamp(slot);
+        m_OddHashes.erase(slot);
+        release_path(slot);
+        m_Flags[slot] = 0;
+        m_FreeSlots.push_back(slot);
+    }
+
+    std::optional<sync::FileMetadata> FileIndex::find(std::string_view path) const {
+        std::shared_lock lock(m_Mutex);
+        auto it = m_Slots.find(path);
+        if (it == m_Slots.end()) {
+            return std::nullopt;
+        }
+        return row(it->second);
+    }
+
+    std::vector<sync::FileMetadata> FileIndex::changed_since(std::optional<sync::Timestamp> since) const {
+        std::shared_lock lock(m_Mutex);
+        auto first = m_Order.begin();
+        if (since) {
+            first = std::upper_bound(m_Order.begin(), m_Order.end(), *since,
+                                     [](sync::Timestamp t, const Stamp& stamp) { return t < stamp.updated_at; });
+        }
+        std::vector<sync::FileMetadata> files;
+        files.reserve(static_cast<size_t>(m_Order.end() - first));
+        for (auto it = first; it != m_Order.end(); ++it) {
+            if (it->live) {
+                files.push_back(row(it->slot));
+            }
+        }
+        return files;
+    }
+
+    std::vector<std::string> FileIndex::diff(const std::vector<sync::FileMetadata>& rows, std::optional<sync::Timestamp> since, size_t limit) const {
+        std::shared_lock lock(m_Mutex);
+        std::vector<std::string> differences;
+        std::unordered_set<std::string_view> seen;
+        seen.reserve(rows.size());
+        for (const auto& meta : rows) {
+            if (differences.size() >= limit) {
+                return differences;
+            }
+            seen.insert(meta.path);
+            auto it = m_Slots.find(meta.path);
+            if (it == m_Slots.end()) {
+                differences.push_back(meta.path + ": missing from index (" + describe(meta) + ")");
+                continue;
+            }
+            auto indexed = row(it->second);
+            if (!same_row(indexed, meta)) {
+                differences.push_back(meta.path + ": index has " + describe(indexed) + ", database has " + describe(meta));
+            }
+        }
+        for (const auto& [path, slot] : m_Slots) {
+            if (differences.size() >= limit) {
+                break;
+            }
+            if (!seen.contains(path) && (!since || m_Updated[slot] > *since)) {
+                differences.push_back(std::string(path) + ": not in database (" + describe(row(slot)) + ")");
+            }
+        }
+        return differences;
+    }
+
+    size_t FileIndex::size() const {
+        std::shared_lock lock(m_Mutex);
+        return m_Slots.size();
+    }
+
+    size_t FileIndex::arena_bytes() const {
+        std::shared_lock lock(m_Mutex);
+        return m_ArenaBytes;
+    }
+
+    std::string_view FileIndex::intern(std::string_view path) {
+        if (path.empty()) {
+            return {};
+        }
+        if (path.size() > kChunkBytes) {
+            // Oversized paths get a chunk of their own; the open chunk stays last
+            auto chunk = std::make_unique<char[]>(path.size());
+            m_ArenaBytes += path.size();
+            std::memcpy(chunk.get(), path.data(), path.size());
+            std::string_view view(chunk.get(), path.size());
+            m_Arena.insert(m_Arena.begin(), std::move(chunk));
+            return view;
+        }
+        if (path.size() > kChunkBytes - m_ArenaUsed) {
+            m_Arena.push_back(std::make_unique<char[]>(kChunkBytes));
+            m_ArenaBytes += kChunkBytes;
+            m_ArenaUsed = 0;
+        }
+        char* dest = m_Arena.back().get() + m_ArenaUsed;
+        std::memcpy(dest, path.data(), path.size());
+        m_ArenaUsed += path.size();
+        return {dest, path.size()};
+    }
+
+    sync::FileMetadata FileIndex::row(u32 slot) const {
+        sync::FileMetadata meta;
+        meta.path = std::string(m_Paths[slot]);
+        meta.hash = hash_of(slot);
+        meta.size = m_Sizes[slot];
+        meta.mtime = m_Mtimes[slot];
+        meta.created_at = m_Created[slot];
+        meta.updated_at = m_Updated[slot];
+        meta.is_deleted = (m_Flags[slot] & kDeleted) != 0;
+        return meta;
+    }
+
+    std::string FileIndex::hash_of(u32 slot) const {
+        if (m_Flags[slot] & kOddHash) {
+            return m_OddHashes.at(slot);
+        }
+        if (!(m_Flags[slot] & kHashed)) {
+            return {};
+        }
+        const auto& digest = m_Digests[slot];
+        std::string hex(digest.size() * 2, '\0');
+        for (size_t i = 0; i < digest.size(); ++i) {
+            hex[2 * i] = kHexDigits[digest[i] >> 4];
+            hex[2 * i + 1] = kHexDigits[digest[i] & 0xf];
+        }
+        return hex;
+    }
+
+    void FileIndex::set_row(u32 slot, const sync::FileMetadata& meta) {
+        u8 flags = meta.is_deleted ? kDeleted : 0;
+        m_OddHashes.erase(slot);
+        if (decode_digest(meta.hash, m_Digests[slot])) {
+            flags |= kHashed;
+        } else if (!meta.hash.empty()) {
+            flags |= kOddHash;
+            m_OddHashes[slot] = meta.hash;
+        }
+        m_Sizes[slot] = meta.size;
+        m_Mtimes[slot] = meta.mtime;
+        m_Created[slot] = meta.created_at;
+        m_Updated[slot] = meta.updated_at;
+        m_Flags[slot] = flags;
+    }
+
+    void FileIndex::stamp(u32 slot, sync::Timestamp updated_at) {
+        // Writes mostly carry the newest timestamp, so this is usually an append
+        if (m_Order.empty() || !stamp_less(updated_at, slot, m_Order.back().updated_at, m_Order.back().slot)) {
+            m_Order.push_back({updated_at, slot, true});
+            return;
+        }
+        auto pos = std::upper_bound(m_Order.begin(), m_Order.end(), Stamp{updated_at, slot, true},
+                                    [](const Stamp& a, const Stamp& b) { return stamp_less(a.updated_at, a.slot, b.updated_at, b.slot); });
+        m_Order.insert(pos, {updated_at, slot, true});
+    }
+
+    void FileIndex::unstamp(u32 slot) {
+        auto [first, last] = std::equal_range(m_Order.begin(), m_Order.end(), Stamp{m_Updated[slot], slot, true},
+                                              [](const Stamp& a, const Stamp& b) { return stamp_less(a.updated_at, a.slot, b.updated_at, b.slot); });
+        for (auto it = first; it != last; ++it) {
+            if (it->live) {
+                it->live = false;
+                ++m_Stale;
+                break;
+            }
+        }
+        // Superseded entries only cost scan time; drop them once they outnumber the live ones
+        if (m_Stale > m_Order.size() / 2) {
+            std::erase_if(m_Order, [](const Stamp& stamp) { return !stamp.live; });
+            m_Stale = 0;
+        }
+    }
+
+    void FileIndex::release_path(u32 slot) {
+        m_DeadBytes += m_Paths[slot].size();
+        m_Paths[slot] = {};
+        // Rewriting the live paths costs about as much as they take, so only
+        // once the dead ones outweigh them (and at least a chunk's worth)
+        if (m_DeadBytes > kChunkBytes && m_DeadBytes > m_ArenaBytes - m_DeadBytes) {
+            compact();
+        }
+    }
+
+    void FileIndex::compact() {
+        auto old_arena = std::move(m_Arena);
+        m_Arena.clear();
+        m_ArenaUsed = kChunkBytes;
+        m_ArenaBytes = 0;
+        m_DeadBytes = 0;
+        m_Slots.clear();
+        for (u32 slot = 0; slot < m_Paths.size(); ++slot) {
+            if (!m_Paths[slot].empty()) {
+                m_Paths[slot] = intern(m_Paths[slot]);
+                m_Slots.emplace(m_Paths[slot], slot);
+            }
+        }
+    }
+
+    void FileIndex::clear() {
+        m_Paths.clear();
+        m_Digests.clear();
+        m_Sizes.clear();
+        m_Mtimes.clear();
+        m_Created.clear();
+        m_Updated.clear();
+        m_Flags.clear();
+        m_Order.clear();
+        m_Stale = 0;
+        m_FreeSlots.clear();
+        m_Slots.clear();
+        m_OddHashes.clear();
+        m_Arena.clear();
+        m_ArenaUsed = kChunkBytes;
+        m_ArenaBytes = 0;
+        m_DeadBytes = 0;
+    }
+
+} // namespace sap::cloud::storage
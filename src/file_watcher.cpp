@@ -0,0 +1,217 @@
+#include <sap_cloud/file_watcher.h>
+#include <sap_core/log.h>
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace sap::cloud {
+
+#ifdef __linux__
+
+    stl::result<std::unique_ptr<FileWatcher>> FileWatcher::create(Callback callback) {
+        int inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd < 0) {
+            return stl::make_error<std::unique_ptr<FileWatcher>>("inotify_init1: {}", std::strerror(errno));
+        }
+        int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd < 0) {
+            int err = errno;
+            close(inotify_fd);
+            return stl::make_error<std::unique_ptr<FileWatcher>>("eventfd: {}", std::strerror(err));
+        }
+        auto watcher = std::unique_ptr<FileWatcher>(new FileWatcher(inotify_fd, wake_fd, std::move(callback)));
+        watcher->m_Thread = std::thread([w = watcher.get()] { w->run(); });
+        return watcher;
+    }
+
+    FileWatcher::FileWatcher(int inotify_fd, int wake_fd, Callback callback) :
+        m_InotifyFd(inotify_fd), m_WakeFd(wake_fd), m_Callback(std::move(callback)) {}
+
+    FileWatcher::~FileWatcher() {
+        stop();
+        close(m_InotifyFd);
+        close(m_WakeFd);
+    }
+
+    stl::result<> FileWatcher::add_directory(const std::filesystem::path& dir) { return watch(dir, false); }
+
+    stl::result<> FileWatcher::add_tree(const std::filesystem::path& root) {
+        auto r = watch(root, true);
+        if (!r) {
+            return r;
+        }
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(root, ec); !ec && it != std::filesystem::recursive_directory_iterator();
+             it.increment(ec)) {
+            if (it->is_directory(ec) && !it->is_symlink(ec)) {
+                r = watch(it->path(), true);
+                if (!r) {
+                    return r;
+                }
+            }
+        }
+        if (ec) {
+            return stl::make_error("Cannot walk {}: {}", root.string(), ec.message());
+        }
+        return stl::success;
+    }
+
+    stl::result<> FileWatcher::watch(const std::filesystem::path& dir, bool recursive) {
+        u32 mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM | IN_ONLYDIR;
+        if (recursive) {
+            mask |= IN_CREATE; // Only acted on for subdirectories
+        }
+        int wd = inotify_add_watch(m_InotifyFd, dir.c_str(), mask);
+        if (wd < 0) {
+            return stl::make_error("Cannot watch {}: {}", dir.string(), std::strerror(errno));
+        }
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Dirs[wd] = {dir, recursive};
+        return stl::success;
+    }
+
+    void FileWatcher::on_directory_added(const std::filesystem::path& dir) {
+        auto r = add_tree(dir);
+        if (!r) {
+            log::warn("File watcher: {}", r.error());
+        }
+        // Anything written before the watch was in place would otherwise go unnoticed
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(dir, ec); !ec && it != std::filesystem::recursive_directory_iterator();
+             it.increment(ec)) {
+            if (it->is_regular_file(ec)) {
+                m_Callback({EWatchEvent::Written, it->path()});
+            }
+        }
+    }
+
+    void FileWatcher::on_directory_removed(const std::filesystem::path& dir) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (auto it = m_Dirs.begin(); it != m_Dirs.end();) {
+            auto rel = it->second.path.lexically_relative(dir);
+            if (!rel.empty() && *rel.begin() != "..") {
+                inotify_rm_watch(m_InotifyFd, it->first);
+                it = m_Dirs.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void FileWatcher::stop() {
+        if (!m_Thread.joinable()) {
+            return;
+        }
+        u64 one = 1;
+        [[maybe_unused]] auto n = write(m_WakeFd, &one, sizeof(one));
+        m_Thread.join();
+    }
+
+    void FileWatcher::run() {
+        alignas(inotify_event) char buffer[16384];
+        pollfd fds[2] = {{m_InotifyFd, POLLIN, 0}, {m_WakeFd, POLLIN, 0}};
+        while (true) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                log::error("File watcher poll failed: {}", std::strerror(errno));
+                return;
+            }
+            if (fds[1].revents & POLLIN) {
+                return;
+            }
+            ssize_t len = read(m_InotifyFd, buffer, sizeof(buffer));
+            if (len <= 0) {
+                continue;
+            }
+            for (ssize_t offset = 0; offset < len;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                if (event->mask & IN_Q_OVERFLOW) {
+                    m_Callback({EWatchEvent::Overflow, {}});
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    // Watch removed, by us or because the directory is gone
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_Dirs.erase(event->wd);
+                    continue;
+                }
+                if (event->len == 0) {
+                    continue;
+                }
+                WatchedDir dir;
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    auto it = m_Dirs.find(event->wd);
+                    if (it == m_Dirs.end()) {
+                        continue;
+                    }
+                    dir = it->second;
+                }
+                auto path = dir.path / event->name;
+                if (event->mask & IN_ISDIR) {
+                    if (!dir.recursive) {
+                        continue;
+                    }
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        on_directory_added(path);
+                    } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                        on_directory_removed(path);
+                        m_Callback({EWatchEvent::Removed, path});
+                    }
+                    continue;
+                }
+                // Creation isn't reported on its own: IN_CLOSE_WRITE follows once the writer is done
+                if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                    m_Callback({EWatchEvent::Written, path});
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    m_Callback({EWatchEvent::Removed, path});
+                }
+            }
+        }
+    }
+
+#else
+
+    stl::result<std::unique_ptr<FileWatcher>> FileWatcher::create(Callback callback) {
+        (void)callback;
+        return stl::make_error<std::unique_ptr<FileWatcher>>("File watching is only supported on Linux");
+    }
+
+    FileWatcher::FileWatcher(int inotify_fd, int wake_fd, Callback callback) :
+        m_InotifyFd(inotify_fd), m_WakeFd(wake_fd), m_Callback(std::move(callback)) {}
+
+    FileWatcher::~FileWatcher() = default;
+
+    stl::result<> FileWatcher::add_directory(const std::filesystem::path& dir) {
+        return stl::make_error("File watching is only supported on Linux: {}", dir.string());
+    }
+
+    stl::result<> FileWatcher::add_tree(const std::filesystem::path& root) {
+        return stl::make_error("File watching is only supported on Linux: {}", root.string());
+    }
+
+    stl::result<> FileWatcher::watch(const std::filesystem::path& dir, bool recursive) {
+        (void)recursive;
+        return add_directory(dir);
+    }
+
+    void FileWatcher::on_directory_added(const std::filesystem::path& dir) { (void)dir; }
+
+    void FileWatcher::on_directory_removed(const std::filesystem::path& dir) { (void)dir; }
+
+    void FileWatcher::stop() {}
+
+    void FileWatcher::run() {}
+
+#endif
+
+} // namespace sap::cloud
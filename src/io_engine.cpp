@@ -0,0 +1,410 @@
+#include <sap_cloud/io_engine.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
+#include <sap_cloud/executor.h>
+#include <sap_core/log.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SAP_CLOUD_HAS_POSIX_IO 1
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#endif
+#else
+#include <fstream>
+#endif
+
+namespace sap::cloud {
+
+    namespace {
+        // Submit through async and block until its completion arrives
+        template <typename T, typename Submit>
+        stl::result<T> wait_for(Submit&& submit) {
+            // Shared so the completion never touches a promise the waiter already destroyed
+            auto promise = std::make_shared<std::promise<stl::result<T>>>();
+            auto future = promise->get_future();
+            submit([promise](stl::result<T> result) { promise->set_value(std::move(result)); });
+            return future.get();
+        }
+
+        stl::result<> create_parent(const std::filesystem::path& path) {
+            if (!path.has_parent_path()) {
+                return stl::success;
+            }
+            std::error_code ec;
+            std::filesystem::create_directories(path.parent_path(), ec);
+            if (ec) {
+                return stl::make_error("Cannot create {}: {}", path.parent_path().string(), ec.message());
+            }
+            return stl::success;
+        }
+
+#ifdef SAP_CLOUD_HAS_POSIX_IO
+        stl::result<std::vector<u8>> read_file(const std::filesystem::path& path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return stl::make_error<std::vector<u8>>("Cannot open {}: {}", path.string(), std::strerror(errno));
+            }
+            struct stat st{};
+            if (fstat(fd, &st) != 0) {
+                int err = errno;
+                ::close(fd);
+                return stl::make_error<std::vector<u8>>("Cannot stat {}: {}", path.string(), std::strerror(err));
+            }
+            // Regular files are read to the size stat reported; anything else until EOF
+            bool regular = S_ISREG(st.st_mode);
+            std::vector<u8> buffer(regular ? static_cast<size_t>(st.st_size) : 64 * 1024);
+            size_t filled = 0;
+            while (!regular || filled < buffer.size()) {
+                if (filled == buffer.size()) {
+                    buffer.resize(buffer.size() * 2);
+                }
+                ssize_t n = ::read(fd, buffer.data() + filled, buffer.size() - filled);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0) {
+                    int err = errno;
+                    ::close(fd);
+                    return stl::make_error<std::vector<u8>>("Cannot read {}: {}", path.string(), std::strerror(err));
+                }
+                if (n == 0) {
+                    break;
+                }
+                filled += static_cast<size_t>(n);
+            }
+            ::close(fd);
+            buffer.resize(filled);
+            return buffer;
+        }
+
+        stl::result<> write_file(const std::filesystem::path& path, std::span<const u8> data) {
+            int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                return stl::make_error("Cannot open {}: {}", path.string(), std::strerror(errno));
+            }
+            size_t written = 0;
+            while (written < data.size()) {
+                ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0) {
+                    int err = errno;
+                    ::close(fd);
+                    return stl::make_error("Cannot write {}: {}", path.string(), std::strerror(err));
+                }
+                written += static_cast<size_t>(n);
+            }
+            if (::close(fd) != 0) {
+                return stl::make_error("Cannot write {}: {}", path.string(), std::strerror(errno));
+            }
+            return stl::success;
+        }
+
+        // Copy the rest of in to out through a buffer
+        bool copy_loop(int in, int out) {
+            std::vector<u8> buffer(1024 * 1024);
+            while (true) {
+                ssize_t n = ::read(in, buffer.data(), buffer.size());
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    return n == 0;
+                }
+                size_t written = 0;
+                while (written < static_cast<size_t>(n)) {
+                    ssize_t w = ::write(out, buffer.data() + written, static_cast<size_t>(n) - written);
+                    if (w < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    if (w < 0) {
+                        return false;
+                    }
+                    written += static_cast<size_t>(w);
+                }
+            }
+        }
+
+        // Copy in to out in the kernel; false with errno set on failure
+        bool copy_fds(int in, int out) {
+#ifdef __linux__
+            // Shares the source's extents (btrfs, XFS, bcachefs): no data is copied at all
+            if (::ioctl(out, FICLONE, in) == 0) {
+                return true;
+            }
+            // Server-side on NFS and SMB, in-kernel elsewhere. Both offsets advance,
+            // so the buffered loop can pick up wherever this stops.
+            while (true) {
+                ssize_t n = ::copy_file_range(in, nullptr, out, nullptr, 1 << 30, 0);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                    break;
+                }
+                if (n <= 0) {
+                    return n == 0;
+                }
+            }
+#endif
+            return copy_loop(in, out);
+        }
+
+        stl::result<> copy_path(const std::filesystem::path& from, const std::filesystem::path& to) {
+            int in = ::open(from.c_str(), O_RDONLY | O_CLOEXEC);
+            if (in < 0) {
+                return stl::make_error("Cannot open {}: {}", from.string(), std::strerror(errno));
+            }
+            int out = ::open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (out < 0) {
+                int err = errno;
+                ::close(in);
+                return stl::make_error("Cannot open {}: {}", to.string(), std::strerror(err));
+            }
+            bool copied = copy_fds(in, out);
+            int err = errno;
+            ::close(in);
+            if (::close(out) != 0 && copied) {
+                copied = false;
+                err = errno;
+            }
+            if (!copied) {
+                return stl::make_error("Cannot copy {} to {}: {}", from.string(), to.string(), std::strerror(err));
+            }
+            return stl::success;
+        }
+
+        stl::result<> fsync_path(const std::filesystem::path& path) {
+            // O_RDONLY so directories can be synced too
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return stl::make_error("Cannot open {}: {}", path.string(), std::strerror(errno));
+            }
+            int rc = ::fsync(fd);
+            int err = errno;
+            ::close(fd);
+            if (rc != 0) {
+                return stl::make_error("Cannot fsync {}: {}", path.string(), std::strerror(err));
+            }
+            return stl::success;
+        }
+#else
+        stl::result<std::vector<u8>> read_file(const std::filesystem::path& path) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) {
+                return stl::make_error<std::vector<u8>>("Cannot open {}", path.string());
+            }
+            std::vector<u8> buffer;
+            char chunk[64 * 1024];
+            while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+                buffer.insert(buffer.end(), chunk, chunk + in.gcount());
+            }
+            if (in.bad()) {
+                return stl::make_error<std::vector<u8>>("Cannot read {}", path.string());
+            }
+            return buffer;
+        }
+
+        stl::result<> write_file(const std::filesystem::path& path, std::span<const u8> data) {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!out.flush()) {
+                return stl::make_error("Cannot write {}", path.string());
+            }
+            return stl::success;
+        }
+
+        stl::result<> copy_path(const std::filesystem::path& from, const std::filesystem::path& to) {
+            std::error_code ec;
+            std::filesystem::copy_file(from, to, std::filesystem::copy_options::overwrite_existing, ec);
+            if (ec) {
+                return stl::make_error("Cannot copy {} to {}: {}", from.string(), to.string(), ec.message());
+            }
+            return stl::success;
+        }
+
+        stl::result<> fsync_path(const std::filesystem::path& path) {
+            (void)path;
+            return stl::success;
+        }
+#endif
+
+        stl::result<> rename_path(const std::filesystem::path& from, const std::filesystem::path& to) {
+            std::error_code ec;
+            std::filesystem::rename(from, to, ec);
+            if (ec) {
+                return stl::make_error("Cannot rename {} to {}: {}", from.string(), to.string(), ec.message());
+            }
+            return stl::success;
+        }
+
+        // Runs each operation as one blocking call on a fixed pool of threads
+        class ThreadPoolEngine final : public IoEngine {
+        public:
+            explicit ThreadPoolEngine(size_t threads) : m_Pool(threads) {}
+
+            [[nodiscard]] std::string_view backend() const override { return "threads"; }
+
+            void async_read(std::filesystem::path path, ReadDone done) override {
+                m_Pool.post([path = std::move(path), done = std::move(done)] { done(read_file(path)); });
+            }
+
+            void async_fsync(std::filesystem::path path, Done done) override {
+                m_Pool.post([path = std::move(path), done = std::move(done)] { done(fsync_path(path)); });
+            }
+
+            void async_rename(std::filesystem::path from, std::filesystem::path to, Done done) override {
+                m_Pool.post([from = std::move(from), to = std::move(to), done = std::move(done)] { done(rename_path(from, to)); });
+            }
+
+        protected:
+            void async_write_view(std::filesystem::path path, std::span<const u8> data, Done done) override {
+                m_Pool.post([path = std::move(path), data, done = std::move(done)] {
+                    auto parent = create_parent(path);
+                    done(parent ? write_file(path, data) : parent);
+                });
+            }
+
+        private:
+            Executor m_Pool;
+        };
+    } // namespace
+
+    stl::result<EIoBackend> parse_io_backend(std::string_view name) {
+        if (name == "auto") {
+            return EIoBackend::Auto;
+        }
+        if (name == "io_uring") {
+            return EIoBackend::Uring;
+        }
+        if (name == "threads") {
+            return EIoBackend::Threads;
+        }
+        return stl::make_error<EIoBackend>("Unknown I/O backend '{}' (expected auto, io_uring or threads)", name);
+    }
+
+    stl::result<IoOptions> io_options(const StorageConfig& storage) {
+        auto backend = parse_io_backend(storage.io_backend);
+        if (!backend) {
+            return stl::make_error<IoOptions>("{}", backend.error());
+        }
+        IoOptions options;
+        options.backend = backend.value();
+        options.threads = static_cast<size_t>(std::max<i64>(storage.io_threads, 1));
+        options.queue_depth = static_cast<u32>(std::clamp<i64>(storage.io_queue_depth, 1, 4096));
+        auto durability = parse_durability(storage.durability);
+        if (!durability) {
+            return stl::make_error<IoOptions>("{}", durability.error());
+        }
+        options.durability = durability.value();
+        return options;
+    }
+
+    stl::result<std::filesystem::path> resolve_under(const std::filesystem::path& root, std::string_view path) {
+        std::filesystem::path rel = std::filesystem::path(std::string(path)).lexically_normal();
+        if (path.empty() || rel.empty() || rel.is_absolute() || rel.has_root_name() || *rel.begin() == "..") {
+            return stl::make_error<std::filesystem::path>("Invalid path: {}", path);
+        }
+        return root / rel;
+    }
+
+    stl::result<std::unique_ptr<IoEngine>> IoEngine::create(const IoOptions& options) {
+        std::unique_ptr<IoEngine> engine;
+        if (options.backend != EIoBackend::Threads) {
+            auto uring = detail::create_uring_engine(options.queue_depth);
+            if (!uring && options.backend == EIoBackend::Uring) {
+                return uring;
+            }
+            if (uring) {
+                engine = std::move(uring.value());
+            } else {
+                log::info("io_uring unavailable ({}), using a thread pool for file I/O", uring.error());
+            }
+        }
+        if (!engine) {
+            engine = std::make_unique<ThreadPoolEngine>(options.threads);
+        }
+        engine->m_Durability = options.durability;
+        return engine;
+    }
+
+    void IoEngine::async_write(std::filesystem::path path, std::vector<u8> data, Done done) {
+        auto owned = std::make_shared<std::vector<u8>>(std::move(data));
+        std::span<const u8> view(*owned);
+        async_write_view(std::move(path), view, [owned, done = std::move(done)](stl::result<> result) { done(std::move(result)); });
+    }
+
+    stl::result<std::vector<u8>> IoEngine::read(const std::filesystem::path& path) {
+        return wait_for<std::vector<u8>>([&](ReadDone done) { async_read(path, std::move(done)); });
+    }
+
+    stl::result<> IoEngine::write(const std::filesystem::path& path, std::span<const u8> data) {
+        return wait_for<void>([&](Done done) { async_write_view(path, data, std::move(done)); });
+    }
+
+    stl::result<> IoEngine::fsync(const std::filesystem::path& path) {
+        return wait_for<void>([&](Done done) { async_fsync(path, std::move(done)); });
+    }
+
+    stl::result<> IoEngine::rename(const std::filesystem::path& from, const std::filesystem::path& to) {
+        return wait_for<void>([&](Done done) { async_rename(from, to, std::move(done)); });
+    }
+
+    stl::result<> IoEngine::sync_file(const std::filesystem::path& path) {
+        if (m_Durability == EDurability::Fast) {
+            return stl::success;
+        }
+        auto data = fsync(path);
+        if (!data || m_Durability != EDurability::Strict || !path.has_parent_path()) {
+            return data;
+        }
+        return fsync(path.parent_path());
+    }
+
+    stl::result<> IoEngine::commit(const std::filesystem::path& staged, const std::filesystem::path& target) {
+        if (m_Durability != EDurability::Fast) {
+            auto data = fsync(staged);
+            if (!data) {
+                return data;
+            }
+        }
+        auto moved = rename(staged, target);
+        if (!moved || m_Durability != EDurability::Strict || !target.has_parent_path()) {
+            return moved;
+        }
+        return fsync(target.parent_path());
+    }
+
+    stl::result<> IoEngine::move(const std::filesystem::path& from, const std::filesystem::path& to) {
+        auto moved = rename(from, to);
+        if (!moved || m_Durability != EDurability::Strict) {
+            return moved;
+        }
+        if (to.has_parent_path()) {
+            auto synced = fsync(to.parent_path());
+            if (!synced) {
+                return synced;
+            }
+        }
+        if (!from.has_parent_path() || from.parent_path() == to.parent_path()) {
+            return stl::success;
+        }
+        return fsync(from.parent_path());
+    }
+
+    stl::result<> IoEngine::copy(const std::filesystem::path& from, const std::filesystem::path& to) {
+        auto parent = create_parent(to);
+        if (!parent) {
+            return parent;
+        }
+        return copy_path(from, to);
+    }
+
+} // namespace sap::cloud
@@ -0,0 +1,456 @@
+#include <sap_cloud/io_engine.h>
+
+#ifdef SAP_CLOUD_IO_URING
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <mutex>
+#include <sap_core/log.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#endif
+
+namespace sap::cloud::detail {
+
+#ifdef SAP_CLOUD_IO_URING
+
+    namespace {
+        // Raw syscalls: the handful of ring operations used here don't justify a liburing dependency
+        int ring_setup(u32 entries, io_uring_params* params) { return static_cast<int>(syscall(__NR_io_uring_setup, entries, params)); }
+
+        int ring_enter(int fd, u32 to_submit, u32 min_complete, u32 flags) {
+            return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+        }
+
+        int ring_register(int fd, u32 opcode, void* arg, u32 count) {
+            return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+        }
+
+        u32 load_acquire(const u32* p) { return std::atomic_ref<const u32>(*p).load(std::memory_order_acquire); }
+
+        void store_release(u32* p, u32 value) { std::atomic_ref<u32>(*p).store(value, std::memory_order_release); }
+
+        // Largest single read or write submitted; longer transfers take several steps
+        constexpr size_t max_transfer = size_t{1} << 30;
+
+        // user_data of the eventfd read that wakes the ring thread for new submissions
+        constexpr u64 wake_tag = 0;
+
+        // One file operation, advanced one kernel request (step) at a time
+        struct Op {
+            enum class EKind : u8 { Read, Write, Fsync, Rename };
+            enum class EStep : u8 { Stat, Open, Transfer, Sync, Close, Rename };
+
+            EKind kind;
+            EStep step;
+            std::filesystem::path path;
+            std::filesystem::path to; // Rename target
+            std::vector<u8> buffer; // Read destination, sized from statx
+            std::span<const u8> data; // Write source, owned by the caller
+            size_t offset = 0;
+            int fd = -1;
+            int error = 0; // errno of the first failed step
+            struct statx stx{};
+            IoEngine::ReadDone on_read;
+            IoEngine::Done on_done;
+
+            [[nodiscard]] size_t total() const { return kind == EKind::Read ? buffer.size() : data.size(); }
+        };
+
+        class UringEngine final : public IoEngine {
+        public:
+            static stl::result<std::unique_ptr<IoEngine>> create(u32 queue_depth) {
+                // One entry per operation in flight plus the wake read
+                u32 depth = std::max<u32>(queue_depth, 1);
+                io_uring_params params{};
+                params.flags = IORING_SETUP_CLAMP;
+                int ring_fd = ring_setup(depth + 1, &params);
+                if (ring_fd < 0) {
+                    return stl::make_error<std::unique_ptr<IoEngine>>("io_uring_setup: {}", std::strerror(errno));
+                }
+                auto engine = std::unique_ptr<UringEngine>(new UringEngine(ring_fd, std::min(depth, params.sq_entries - 1)));
+                auto r = engine->map_rings(params);
+                if (!r) {
+                    return stl::make_error<std::unique_ptr<IoEngine>>("{}", r.error());
+                }
+                engine->m_WakeFd = eventfd(0, EFD_CLOEXEC);
+                if (engine->m_WakeFd < 0) {
+                    return stl::make_error<std::unique_ptr<IoEngine>>("eventfd: {}", std::strerror(errno));
+                }
+                engine->m_Thread = std::thread([e = engine.get()] { e->run(); });
+                return std::unique_ptr<IoEngine>(std::move(engine));
+            }
+
+            ~UringEngine() override {
+                if (m_Thread.joinable()) {
+                    {
+                        std::lock_guard<std::mutex> lock(m_Mutex);
+                        m_Stopping = true;
+                    }
+                    wake();
+                    m_Thread.join();
+                }
+                if (m_Sqes != MAP_FAILED) {
+                    munmap(m_Sqes, m_SqesSize);
+                }
+                if (m_Ring != MAP_FAILED) {
+                    munmap(m_Ring, m_RingSize);
+                }
+                if (m_WakeFd >= 0) {
+                    close(m_WakeFd);
+                }
+                close(m_RingFd);
+            }
+
+            [[nodiscard]] std::string_view backend() const override { return "io_uring"; }
+
+            void async_read(std::filesystem::path path, ReadDone done) override {
+                auto op = std::make_unique<Op>();
+                op->kind = Op::EKind::Read;
+                op->step = Op::EStep::Stat;
+                op->path = std::move(path);
+                op->on_read = std::move(done);
+                submit(std::move(op));
+            }
+
+            void async_fsync(std::filesystem::path path, Done done) override {
+                auto op = std::make_unique<Op>();
+                op->kind = Op::EKind::Fsync;
+                op->step = Op::EStep::Open;
+                op->path = std::move(path);
+                op->on_done = std::move(done);
+                submit(std::move(op));
+            }
+
+            void async_rename(std::filesystem::path from, std::filesystem::path to, Done done) override {
+                auto op = std::make_unique<Op>();
+                op->kind = Op::EKind::Rename;
+                op->step = Op::EStep::Rename;
+                op->path = std::move(from);
+                op->to = std::move(to);
+                op->on_done = std::move(done);
+                submit(std::move(op));
+            }
+
+        protected:
+            void async_write_view(std::filesystem::path path, std::span<const u8> data, Done done) override {
+                // Directory creation is rare and cheap enough to do on the caller's thread
+                if (path.has_parent_path()) {
+                    std::error_code ec;
+                    std::filesystem::create_directories(path.parent_path(), ec);
+                    if (ec) {
+                        done(stl::make_error("Cannot create {}: {}", path.parent_path().string(), ec.message()));
+                        return;
+                    }
+                }
+                auto op = std::make_unique<Op>();
+                op->kind = Op::EKind::Write;
+                op->step = Op::EStep::Open;
+                op->path = std::move(path);
+                op->data = data;
+                op->on_done = std::move(done);
+                submit(std::move(op));
+            }
+
+        private:
+            UringEngine(int ring_fd, u32 max_active) : m_RingFd(ring_fd), m_MaxActive(max_active) {}
+
+            stl::result<> map_rings(const io_uring_params& params) {
+                if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+                    return stl::make_error("io_uring: kernel too old (no IORING_FEAT_SINGLE_MMAP)");
+                }
+                // Every opcode used must be supported; RENAMEAT is the newest (5.11)
+                std::vector<u8> probe_buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+                auto* probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+                if (ring_register(m_RingFd, IORING_REGISTER_PROBE, probe, 256) < 0) {
+                    return stl::make_error("io_uring probe: {}", std::strerror(errno));
+                }
+                for (u8 opcode : {IORING_OP_STATX, IORING_OP_OPENAT, IORING_OP_READ, IORING_OP_WRITE, IORING_OP_FSYNC, IORING_OP_CLOSE,
+                                  IORING_OP_RENAMEAT}) {
+                    if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+                        return stl::make_error("io_uring: kernel lacks opcode {}", static_cast<int>(opcode));
+                    }
+                }
+                m_RingSize = std::max(params.sq_off.array + params.sq_entries * sizeof(u32), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+                m_Ring = mmap(nullptr, m_RingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQ_RING);
+                if (m_Ring == MAP_FAILED) {
+                    return stl::make_error("io_uring ring mmap: {}", std::strerror(errno));
+                }
+                m_SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+                m_Sqes = mmap(nullptr, m_SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_RingFd, IORING_OFF_SQES);
+                if (m_Sqes == MAP_FAILED) {
+                    return stl::make_error("io_uring sqe mmap: {}", std::strerror(errno));
+                }
+                auto* base = static_cast<u8*>(m_Ring);
+                m_SqHead = reinterpret_cast<u32*>(base + params.sq_off.head);
+                m_SqTail = reinterpret_cast<u32*>(base + params.sq_off.tail);
+                m_SqMask = *reinterpret_cast<u32*>(base + params.sq_off.ring_mask);
+                m_SqArray = reinterpret_cast<u32*>(base + params.sq_off.array);
+                m_CqHead = reinterpret_cast<u32*>(base + params.cq_off.head);
+                m_CqTail = reinterpret_cast<u32*>(base + params.cq_off.tail);
+                m_CqMask = *reinterpret_cast<u32*>(base + params.cq_off.ring_mask);
+                m_Cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+                return stl::success;
+            }
+
+            void submit(std::unique_ptr<Op> op) {
+                {
+                    std::lock_guard<std::mutex> lock(m_Mutex);
+                    m_Incoming.push_back(std::move(op));
+                }
+                wake();
+            }
+
+            void wake() {
+                u64 one = 1;
+                [[maybe_unused]] auto n = ::write(m_WakeFd, &one, sizeof(one));
+            }
+
+            io_uring_sqe& next_sqe(u64 user_data) {
+                u32 tail = *m_SqTail;
+                u32 index = tail & m_SqMask;
+                auto& sqe = static_cast<io_uring_sqe*>(m_Sqes)[index];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.user_data = user_data;
+                m_SqArray[index] = index;
+                store_release(m_SqTail, tail + 1);
+                return sqe;
+            }
+
+            // Queue the kernel request for op's current step
+            void prepare(Op& op) {
+                auto& sqe = next_sqe(reinterpret_cast<u64>(&op));
+                switch (op.step) {
+                case Op::EStep::Stat:
+                    sqe.opcode = IORING_OP_STATX;
+                    sqe.fd = AT_FDCWD;
+                    sqe.addr = reinterpret_cast<u64>(op.path.c_str());
+                    sqe.len = STATX_SIZE;
+                    sqe.addr2 = reinterpret_cast<u64>(&op.stx);
+                    break;
+                case Op::EStep::Open:
+                    sqe.opcode = IORING_OP_OPENAT;
+                    sqe.fd = AT_FDCWD;
+                    sqe.addr = reinterpret_cast<u64>(op.path.c_str());
+                    if (op.kind == Op::EKind::Write) {
+                        sqe.open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+                        sqe.len = 0644;
+                    } else {
+                        sqe.open_flags = O_RDONLY | O_CLOEXEC;
+                    }
+                    break;
+                case Op::EStep::Transfer: {
+                    size_t len = std::min(op.total() - op.offset, max_transfer);
+                    sqe.fd = op.fd;
+                    sqe.len = static_cast<u32>(len);
+                    sqe.off = op.offset;
+                    if (op.kind == Op::EKind::Read) {
+                        sqe.opcode = IORING_OP_READ;
+                        sqe.addr = reinterpret_cast<u64>(op.buffer.data() + op.offset);
+                    } else {
+                        sqe.opcode = IORING_OP_WRITE;
+                        sqe.addr = reinterpret_cast<u64>(op.data.data() + op.offset);
+                    }
+                    break;
+                }
+                case Op::EStep::Sync:
+                    sqe.opcode = IORING_OP_FSYNC;
+                    sqe.fd = op.fd;
+                    break;
+                case Op::EStep::Close:
+                    sqe.opcode = IORING_OP_CLOSE;
+                    sqe.fd = op.fd;
+                    break;
+                case Op::EStep::Rename:
+                    sqe.opcode = IORING_OP_RENAMEAT;
+                    sqe.fd = AT_FDCWD;
+                    sqe.addr = reinterpret_cast<u64>(op.path.c_str());
+                    sqe.len = static_cast<u32>(AT_FDCWD);
+                    sqe.addr2 = reinterpret_cast<u64>(op.to.c_str());
+                    break;
+                }
+            }
+
+            // Handle the completion of op's current step; returns false once op is finished
+            bool advance(Op& op, int res) {
+                if (res < 0) {
+                    if (op.error == 0) {
+                        op.error = -res;
+                    }
+                    if (op.fd >= 0 && op.step != Op::EStep::Close) {
+                        op.step = Op::EStep::Close;
+                        return true;
+                    }
+                    op.fd = -1;
+                    return false;
+                }
+                switch (op.step) {
+                case Op::EStep::Stat:
+                    op.buffer.resize(static_cast<size_t>(op.stx.stx_size));
+                    op.step = Op::EStep::Open;
+                    return true;
+                case Op::EStep::Open:
+                    op.fd = res;
+                    if (op.kind == Op::EKind::Fsync) {
+                        op.step = Op::EStep::Sync;
+                    } else {
+                        op.step = op.total() > 0 ? Op::EStep::Transfer : Op::EStep::Close;
+                    }
+                    return true;
+                case Op::EStep::Transfer:
+                    if (res == 0) {
+                        // The file shrank after statx; a write making no progress is an error
+                        if (op.kind == Op::EKind::Read) {
+                            op.buffer.resize(op.offset);
+                        } else {
+                            op.error = EIO;
+                        }
+                        op.step = Op::EStep::Close;
+                        return true;
+                    }
+                    op.offset += static_cast<size_t>(res);
+                    if (op.offset == op.total()) {
+                        op.step = Op::EStep::Close;
+                    }
+                    return true;
+                case Op::EStep::Sync:
+                    op.step = Op::EStep::Close;
+                    return true;
+                case Op::EStep::Close:
+                    op.fd = -1;
+                    return false;
+                case Op::EStep::Rename:
+                    return false;
+                }
+                return false;
+            }
+
+            void finish(std::unique_ptr<Op> op) {
+                const char* verb = "";
+                switch (op->kind) {
+                case Op::EKind::Read:
+                    verb = "read";
+                    break;
+                case Op::EKind::Write:
+                    verb = "write";
+                    break;
+                case Op::EKind::Fsync:
+                    verb = "fsync";
+                    break;
+                case Op::EKind::Rename:
+                    verb = "rename";
+                    break;
+                }
+                if (op->kind == Op::EKind::Read) {
+                    if (op->error != 0) {
+                        op->on_read(stl::make_error<std::vector<u8>>("Cannot {} {}: {}", verb, op->path.string(), std::strerror(op->error)));
+                    } else {
+                        op->on_read(std::move(op->buffer));
+                    }
+                } else if (op->error != 0) {
+                    op->on_done(stl::make_error("Cannot {} {}: {}", verb, op->path.string(), std::strerror(op->error)));
+                } else {
+                    op->on_done(stl::success);
+                }
+            }
+
+            void run() {
+                std::deque<Op*> ready; // Ops whose next step still has to be queued
+                size_t active = 0; // Ops accepted and not yet finished
+                bool wake_armed = false;
+                while (true) {
+                    {
+                        std::lock_guard<std::mutex> lock(m_Mutex);
+                        while (active < m_MaxActive && !m_Incoming.empty()) {
+                            ready.push_back(m_Incoming.front().release());
+                            m_Incoming.pop_front();
+                            ++active;
+                        }
+                        if (m_Stopping && active == 0 && m_Incoming.empty()) {
+                            return;
+                        }
+                    }
+                    // Each active op has at most one request queued and the ring holds
+                    // m_MaxActive + 1 entries, so the submission queue can't overflow
+                    for (Op* op : ready) {
+                        prepare(*op);
+                    }
+                    ready.clear();
+                    if (!wake_armed) {
+                        auto& sqe = next_sqe(wake_tag);
+                        sqe.opcode = IORING_OP_READ;
+                        sqe.fd = m_WakeFd;
+                        sqe.addr = reinterpret_cast<u64>(&m_WakeValue);
+                        sqe.len = sizeof(m_WakeValue);
+                        wake_armed = true;
+                    }
+                    u32 pending = *m_SqTail - load_acquire(m_SqHead);
+                    if (ring_enter(m_RingFd, pending, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                        log::error("io_uring_enter failed: {}", std::strerror(errno));
+                        return;
+                    }
+                    u32 head = *m_CqHead;
+                    u32 tail = load_acquire(m_CqTail);
+                    for (; head != tail; ++head) {
+                        const auto& cqe = m_Cqes[head & m_CqMask];
+                        if (cqe.user_data == wake_tag) {
+                            wake_armed = false;
+                            continue;
+                        }
+                        auto* op = reinterpret_cast<Op*>(cqe.user_data);
+                        if (advance(*op, cqe.res)) {
+                            ready.push_back(op);
+                        } else {
+                            --active;
+                            finish(std::unique_ptr<Op>(op));
+                        }
+                    }
+                    store_release(m_CqHead, head);
+                }
+            }
+
+            int m_RingFd;
+            int m_WakeFd = -1; // eventfd written by submitters to interrupt io_uring_enter
+            u64 m_WakeValue = 0; // Target of the wake read
+            u32 m_MaxActive; // Operations in flight at once; the rest wait in m_Incoming
+
+            void* m_Ring = MAP_FAILED; // Submission and completion rings (single mmap)
+            size_t m_RingSize = 0;
+            void* m_Sqes = MAP_FAILED;
+            size_t m_SqesSize = 0;
+            u32* m_SqHead = nullptr;
+            u32* m_SqTail = nullptr;
+            u32 m_SqMask = 0;
+            u32* m_SqArray = nullptr;
+            u32* m_CqHead = nullptr;
+            u32* m_CqTail = nullptr;
+            u32 m_CqMask = 0;
+            io_uring_cqe* m_Cqes = nullptr;
+
+            std::mutex m_Mutex; // Guards m_Incoming and m_Stopping
+            std::deque<std::unique_ptr<Op>> m_Incoming;
+            bool m_Stopping = false;
+            std::thread m_Thread;
+        };
+    } // namespace
+
+    stl::result<std::unique_ptr<IoEngine>> create_uring_engine(u32 queue_depth) { return UringEngine::create(queue_depth); }
+
+#else
+
+    stl::result<std::unique_ptr<IoEngine>> create_uring_engine(u32 queue_depth) {
+        (void)queue_depth;
+        return stl::make_error<std::unique_ptr<IoEngine>>("io_uring support not compiled in (SAP_CLOUD_IO_URING)");
+    }
+
+#endif
+
+} // namespace sap::cloud::detail
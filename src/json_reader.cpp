@@ -0,0 +1,294 @@
+#include <nlohmann/json.hpp>
+#include <limits>
+#include <sap_cloud/json_reader.h>
+#include <span>
+
+namespace sap::cloud::json {
+
+    namespace {
+        struct Field {
+            std::string_view name;
+            std::string* str = nullptr; // String target
+            std::vector<std::string>* list = nullptr; // String array target
+            i64* integer = nullptr; // Integer target
+            bool* flag = nullptr; // Boolean target
+            bool required = false;
+            bool seen = false;
+        };
+
+        // SAX handler for a flat object of string / string-array / integer / boolean fields
+        class ObjectReader final : public nlohmann::json_sax<nlohmann::json> {
+        public:
+            explicit ObjectReader(std::span<Field> fields) : m_Fields(fields) {}
+
+            // null leaves a field absent
+            bool null() override {
+                if (m_Depth == 0) {
+                    return fail("expected JSON object");
+                }
+                return m_InList ? mismatch() : true;
+            }
+
+            bool boolean(bool val) override {
+                if (m_SkipDepth == 0 && !m_InList && m_Depth == 1 && m_Current && m_Current->flag) {
+                    *m_Current->flag = val;
+                    m_Current->seen = true;
+                    return true;
+                }
+                return mismatch();
+            }
+
+            bool number_integer(number_integer_t val) override { return integer(val); }
+
+            bool number_unsigned(number_unsigned_t val) override {
+                if (val > static_cast<number_unsigned_t>(std::numeric_limits<i64>::max())) {
+                    return mismatch();
+                }
+                return integer(static_cast<i64>(val));
+            }
+
+            bool number_float(number_float_t, const string_t&) override { return mismatch(); }
+
+            bool binary(binary_t&) override { return mismatch(); }
+
+            bool string(string_t& val) override {
+                if (m_SkipDepth != 0) {
+                    return true;
+                }
+                if (m_InList) {
+                    m_Current->list->push_back(std::move(val));
+                    return true;
+                }
+                if (m_Depth == 1 && m_Current && m_Current->str) {
+                    *m_Current->str = std::move(val);
+                    m_Current->seen = true;
+                    return true;
+                }
+                return mismatch();
+            }
+
+            bool start_object(std::size_t) override {
+                if (m_Depth == 0) {
+                    m_Depth = 1;
+                    return true;
+                }
+                return start_nested();
+            }
+
+            bool end_object() override { return end_container(); }
+
+            bool start_array(std::size_t) override {
+                if (m_Depth == 0) {
+                    return fail("expected JSON object");
+                }
+                if (m_SkipDepth == 0 && m_Depth == 1 && m_Current && m_Current->list) {
+                    m_Current->list->clear();
+                    m_Current->seen = true;
+                    m_InList = true;
+                    ++m_Depth;
+                    return true;
+                }
+                return start_nested();
+            }
+
+            bool end_array() override {
+                m_InList = false;
+                return end_container();
+            }
+
+            bool key(string_t& val) override {
+                if (m_SkipDepth != 0) {
+                    return true;
+                }
+                m_Current = nullptr;
+                for (auto& field : m_Fields) {
+                    if (field.name == val) {
+                        m_Current = &field;
+                        break;
+                    }
+                }
+                return true;
+            }
+
+            bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override { return fail(ex.what()); }
+
+            [[nodiscard]] const std::string& error() const { return m_Error; }
+
+        private:
+            bool integer(i64 val) {
+                if (m_SkipDepth == 0 && !m_InList && m_Depth == 1 && m_Current && m_Current->integer) {
+                    *m_Current->integer = val;
+                    m_Current->seen = true;
+                    return true;
+                }
+                return mismatch();
+            }
+
+            // Value whose type does not match the field it belongs to
+            bool mismatch() {
+                if (m_SkipDepth != 0) {
+                    return true;
+                }
+                if (m_Depth == 0) {
+                    return fail("expected JSON object");
+                }
+                if (!m_InList && !m_Current) {
+                    return true; // Unknown key
+                }
+                return fail(std::string("invalid type for '") + std::string(m_Current->name) + "'");
+            }
+
+            // Container that is not a recognized field value
+            bool start_nested() {
+                if (m_SkipDepth == 0 && (m_Depth > 1 || m_Current)) {
+                    return fail(std::string("invalid type for '") + std::string(m_Current ? m_Current->name : "") + "'");
+                }
+                if (m_SkipDepth == 0) {
+                    m_SkipDepth = m_Depth;
+                }
+                ++m_Depth;
+                return true;
+            }
+
+            bool end_container() {
+                --m_Depth;
+                if (m_SkipDepth != 0 && m_Depth == m_SkipDepth) {
+                    m_SkipDepth = 0;
+                }
+                return true;
+            }
+
+            bool fail(std::string message) {
+                if (m_Error.empty()) {
+                    m_Error = std::move(message);
+                }
+                return false;
+            }
+
+            std::span<Field> m_Fields;
+            Field* m_Current = nullptr;
+            int m_Depth = 0;
+            int m_SkipDepth = 0; // Depth at which an unknown container started (0 = not skipping)
+            bool m_InList = false;
+            std::string m_Error;
+        };
+
+        stl::result<> read_object(std::string_view body, std::span<Field> fields) {
+            ObjectReader reader(fields);
+            bool ok = nlohmann::json::sax_parse(body.begin(), body.end(), &reader);
+            if (!ok) {
+                return stl::make_error("Invalid JSON: {}", reader.error().empty() ? std::string("parse error") : reader.error());
+            }
+            for (const auto& field : fields) {
+                if (field.required && !field.seen) {
+                    return stl::make_error("Invalid JSON: missing field '{}'", field.name);
+                }
+            }
+            return stl::success;
+        }
+    } // namespace
+
+    stl::result<sync::NoteCreateRequest> parse_note_create(std::string_view body) {
+        sync::NoteCreateRequest req;
+        Field fields[] = {
+            {.name = "title", .str = &req.title, .required = true},
+            {.name = "content", .str = &req.content},
+            {.name = "tags", .list = &req.tags},
+        };
+        auto r = read_object(body, fields);
+        if (!r) {
+            return stl::make_error<sync::NoteCreateRequest>("{}", r.error());
+        }
+        return req;
+    }
+
+    stl::result<sync::NoteUpdateRequest> parse_note_update(std::string_view body) {
+        std::string title;
+        std::string content;
+        std::vector<std::string> tags;
+        Field fields[] = {
+            {.name = "title", .str = &title},
+            {.name = "content", .str = &content},
+            {.name = "tags", .list = &tags},
+        };
+        auto r = read_object(body, fields);
+        if (!r) {
+            return stl::make_error<sync::NoteUpdateRequest>("{}", r.error());
+        }
+        sync::NoteUpdateRequest req;
+        if (fields[0].seen) {
+            req.title = std::move(title);
+        }
+        if (fields[1].seen) {
+            req.content = std::move(content);
+        }
+        if (fields[2].seen) {
+            req.tags = std::move(tags);
+        }
+        return req;
+    }
+
+    stl::result<sync::ChallengeRequest> parse_challenge_request(std::string_view body) {
+        sync::ChallengeRequest req;
+        Field fields[] = {
+            {.name = "public_key", .str = &req.public_key, .required = true},
+        };
+        auto r = read_object(body, fields);
+        if (!r) {
+            return stl::make_error<sync::ChallengeRequest>("{}", r.error());
+        }
+        return req;
+    }
+
+    stl::result<sync::VerifyRequest> parse_verify_request(std::string_view body) {
+        sync::VerifyRequest req;
+        Field fields[] = {
+            {.name = "public_key", .str = &req.public_key, .required = true},
+            {.name = "challenge", .str = &req.challenge, .required = true},
+            {.name = "signature", .str = &req.signature, .required = true},
+        };
+        auto r = read_object(body, fields);
+        if (!r) {
+            return stl::make_error<sync::VerifyRequest>("{}", r.error());
+        }
+        return req;
+    }
+
+    stl::result<FileTransfer> parse_file_transfer(std::string_view body) {
+        FileTransfer req;
+        Field fields[] = {
+            {.name = "from", .str = &req.from, .required = true},
+            {.name = "to", .str = &req.to, .required = true},
+            {.name = "overwrite", .flag = &req.overwrite},
+        };
+        auto r = read_object(body, fields);
+        if (!r) {
+            return stl::make_error<FileTransfer>("{}", r.error());
+        }
+        return req;
+    }
+
+    stl::result<HashQuery> parse_hash_query(std::string_view body) {
+        HashQuery req;
+        Field fields[] = {
+            {.name = "hashes", .list = &req.hashes},
+            {.name = "bloom", .str = &req.bloom},
+            {.name = "bloom_hashes", .integer = &req.bloom_hashes},
+        };
+        auto r = read_object(body, fields);
+        if (!r) {
+            return stl::make_error<HashQuery>("{}", r.error());
+        }
+        if (fields[0].seen == fields[1].seen) {
+            return stl::make_error<HashQuery>("Invalid JSON: expected exactly one of 'hashes' or 'bloom'");
+        }
+        if (fields[1].seen && req.bloom.empty()) {
+            return stl::make_error<HashQuery>("Invalid JSON: 'bloom' is empty");
+        }
+        if (fields[1].seen && !fields[2].seen) {
+            return stl::make_error<HashQuery>("Invalid JSON: missing field 'bloom_hashes'");
+        }
+        return req;
+    }
+
+} // namespace sap::cloud::json
@@ -0,0 +1,193 @@
+#include <charconv>
+#include <sap_cloud/json_writer.h>
+
+namespace sap::cloud::json {
+
+    void Writer::separator() {
+        if (m_NeedComma) {
+            m_Out.push_back(',');
+        }
+    }
+
+    void Writer::begin_object() {
+        separator();
+        m_Out.push_back('{');
+        m_NeedComma = false;
+    }
+
+    void Writer::end_object() {
+        m_Out.push_back('}');
+        m_NeedComma = true;
+    }
+
+    void Writer::begin_array() {
+        separator();
+        m_Out.push_back('[');
+        m_NeedComma = false;
+    }
+
+    void Writer::end_array() {
+        m_Out.push_back(']');
+        m_NeedComma = true;
+    }
+
+    void Writer::key(std::string_view name) {
+        separator();
+        write_escaped(name);
+        m_Out.push_back(':');
+        m_NeedComma = false;
+    }
+
+    void Writer::value(std::string_view str) {
+        separator();
+        write_escaped(str);
+        m_NeedComma = true;
+    }
+
+    void Writer::value(i64 number) {
+        separator();
+        char buf[24];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), number);
+        (void)ec;
+        m_Out.append(buf, end);
+        m_NeedComma = true;
+    }
+
+    void Writer::value(bool flag) {
+        separator();
+        m_Out.append(flag ? "true" : "false");
+        m_NeedComma = true;
+    }
+
+    void Writer::write_escaped(std::string_view str) {
+        static constexpr char hex[] = "0123456789abcdef";
+        m_Out.push_back('"');
+        size_t run_start = 0;
+        for (size_t i = 0; i < str.size(); ++i) {
+            auto c = static_cast<unsigned char>(str[i]);
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+            // Flush the unescaped run in one append
+            m_Out.append(str.data() + run_start, i - run_start);
+            run_start = i + 1;
+            switch (c) {
+                case '"':
+                    m_Out.append("\\\"");
+                    break;
+                case '\\':
+                    m_Out.append("\\\\");
+                    break;
+                case '\b':
+                    m_Out.append("\\b");
+                    break;
+                case '\f':
+                    m_Out.append("\\f");
+                    break;
+                case '\n':
+                    m_Out.append("\\n");
+                    break;
+                case '\r':
+                    m_Out.append("\\r");
+                    break;
+                case '\t':
+                    m_Out.append("\\t");
+                    break;
+                default: {
+                    char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+                    m_Out.append(esc, sizeof(esc));
+                    break;
+                }
+            }
+        }
+        m_Out.append(str.data() + run_start, str.size() - run_start);
+        m_Out.push_back('"');
+    }
+
+    namespace {
+        void write_strings(Writer& w, const std::vector<std::string>& values) {
+            w.begin_array();
+            for (const auto& v : values) {
+                w.value(std::string_view(v));
+            }
+            w.end_array();
+        }
+    } // namespace
+
+    void write(Writer& w, const sync::FileMetadata& meta) {
+        w.begin_object();
+        w.key("path");
+        w.value(std::string_view(meta.path));
+        w.key("hash");
+        w.value(std::string_view(meta.hash));
+        w.key("size");
+        w.value(static_cast<i64>(meta.size));
+        w.key("mtime");
+        w.value(static_cast<i64>(meta.mtime));
+        w.key("created_at");
+        w.value(static_cast<i64>(meta.created_at));
+        w.key("updated_at");
+        w.value(static_cast<i64>(meta.updated_at));
+        w.key("is_deleted");
+        w.value(meta.is_deleted);
+        w.end_object();
+    }
+
+    void write(Writer& w, const std::vector<sync::FileMetadata>& files) {
+        w.begin_array();
+        for (const auto& meta : files) {
+            write(w, meta);
+        }
+        w.end_array();
+    }
+
+    void write(Writer& w, const sync::SyncState& state) {
+        w.begin_object();
+        w.key("server_time");
+        w.value(static_cast<i64>(state.server_time));
+        w.key("files");
+        write(w, state.files);
+        w.end_object();
+    }
+
+    void write(Writer& w, const sync::NoteListResponse& list) {
+        w.begin_object();
+        w.key("notes");
+        w.begin_array();
+        for (const auto& item : list.notes) {
+            w.begin_object();
+            w.key("id");
+            w.value(std::string_view(item.id));
+            w.key("title");
+            w.value(std::string_view(item.title));
+            w.key("tags");
+            write_strings(w, item.tags);
+            w.key("updated_at");
+            w.value(static_cast<i64>(item.updated_at));
+            w.key("preview");
+            w.value(std::string_view(item.preview));
+            w.end_object();
+        }
+        w.end_array();
+        w.key("total");
+        w.value(static_cast<i64>(list.total));
+        w.end_object();
+    }
+
+    void write(Writer& w, const sync::TagListResponse& tags) {
+        w.begin_object();
+        w.key("tags");
+        w.begin_array();
+        for (const auto& tag : tags.tags) {
+            w.begin_object();
+            w.key("name");
+            w.value(std::string_view(tag.name));
+            w.key("count");
+            w.value(static_cast<i64>(tag.count));
+            w.end_object();
+        }
+        w.end_array();
+        w.end_object();
+    }
+
+} // namespace sap::cloud::json
@@ -0,0 +1,161 @@
+#include <sap_cloud/live_indexer.h>
+#include <sap_core/log.h>
+
+namespace sap::cloud {
+
+    stl::result<std::unique_ptr<LiveIndexer>> LiveIndexer::create(services::FileService& files, const std::filesystem::path& files_root,
+                                                                  services::NoteService& notes, const std::filesystem::path& notes_root,
+                                                                  Options options) {
+        auto indexer = std::unique_ptr<LiveIndexer>(
+            new LiveIndexer(files, std::filesystem::absolute(files_root), notes, std::filesystem::absolute(notes_root), options));
+        for (ERoot root : {ERoot::Files, ERoot::Notes}) {
+            auto watcher = FileWatcher::create([w = indexer.get(), root](const WatchEvent& event) { w->on_event(root, event); });
+            if (!watcher) {
+                return stl::make_error<std::unique_ptr<LiveIndexer>>("{}", watcher.error());
+            }
+            auto add_result = watcher.value()->add_tree(indexer->root_path(root));
+            if (!add_result) {
+                return stl::make_error<std::unique_ptr<LiveIndexer>>("{}", add_result.error());
+            }
+            (root == ERoot::Files ? indexer->m_FilesWatcher : indexer->m_NotesWatcher) = std::move(watcher.value());
+        }
+        indexer->m_Thread = std::thread([w = indexer.get()] { w->run(); });
+        return indexer;
+    }
+
+    LiveIndexer::LiveIndexer(services::FileService& files, std::filesystem::path files_root, services::NoteService& notes,
+                             std::filesystem::path notes_root, Options options) :
+        m_Files(files), m_Notes(notes), m_FilesRoot(std::move(files_root)), m_NotesRoot(std::move(notes_root)), m_Options(options) {}
+
+    LiveIndexer::~LiveIndexer() { stop(); }
+
+    const std::filesystem::path& LiveIndexer::root_path(ERoot root) const { return root == ERoot::Files ? m_FilesRoot : m_NotesRoot; }
+
+    void LiveIndexer::stop() {
+        if (m_FilesWatcher) {
+            m_FilesWatcher->stop();
+        }
+        if (m_NotesWatcher) {
+            m_NotesWatcher->stop();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_Wake.notify_all();
+        if (m_Thread.joinable()) {
+            m_Thread.join();
+        }
+    }
+
+    void LiveIndexer::on_event(ERoot root, const WatchEvent& event) {
+        std::string rel;
+        if (event.kind != EWatchEvent::Overflow) {
+            auto relative = event.path.lexically_relative(root_path(root));
+            if (relative.empty() || *relative.begin() == "..") {
+                return;
+            }
+            rel = relative.generic_string();
+        }
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        bool was_idle = m_Pending[0].paths.empty() && !m_Pending[0].rescan && m_Pending[1].paths.empty() && !m_Pending[1].rescan;
+        auto& pending = m_Pending[static_cast<size_t>(root)];
+        if (event.kind == EWatchEvent::Overflow) {
+            pending.rescan = true;
+        } else {
+            pending.paths.insert(std::move(rel));
+        }
+        if (was_idle) {
+            m_FirstEvent = now;
+            m_Wake.notify_one();
+        }
+        m_LastEvent = now;
+    }
+
+    void LiveIndexer::run() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        auto has_pending = [this] {
+            return !m_Pending[0].paths.empty() || m_Pending[0].rescan || !m_Pending[1].paths.empty() || m_Pending[1].rescan;
+        };
+        while (true) {
+            m_Wake.wait(lock, [&] { return m_Stopping || has_pending(); });
+            if (m_Stopping) {
+                return;
+            }
+            // Wait for a quiet period, re-checking as new events push it back
+            auto due = std::min(m_LastEvent + m_Options.debounce, m_FirstEvent + m_Options.max_delay);
+            while (std::chrono::steady_clock::now() < due) {
+                if (m_Wake.wait_until(lock, due, [this] { return m_Stopping; })) {
+                    return;
+                }
+                due = std::min(m_LastEvent + m_Options.debounce, m_FirstEvent + m_Options.max_delay);
+            }
+            Pending files = std::move(m_Pending[static_cast<size_t>(ERoot::Files)]);
+            Pending notes = std::move(m_Pending[static_cast<size_t>(ERoot::Notes)]);
+            m_Pending[0] = {};
+            m_Pending[1] = {};
+            lock.unlock();
+            flush(ERoot::Files, std::move(files));
+            flush(ERoot::Notes, std::move(notes));
+            lock.lock();
+        }
+    }
+
+    void LiveIndexer::flush(ERoot root, Pending batch) {
+        if (batch.rescan) {
+            log::warn("File watch events were lost, reconciling {}", root_path(root).string());
+            reconcile(root, batch.paths);
+        }
+        size_t changed = 0;
+        for (const auto& path : batch.paths) {
+            // Files inside an existing directory arrive as their own events
+            std::error_code ec;
+            if (std::filesystem::is_directory(root_path(root) / path, ec)) {
+                continue;
+            }
+            auto result = root == ERoot::Files ? m_Files.index_path(path) : m_Notes.index_path(path);
+            if (!result) {
+                log::warn("Failed to index {}: {}", path, result.error());
+                continue;
+            }
+            changed += result.value() ? 1 : 0;
+        }
+        if (changed > 0) {
+            log::debug("Live index: {} of {} touched paths changed", changed, batch.paths.size());
+        }
+    }
+
+    void LiveIndexer::reconcile(ERoot root, std::unordered_set<std::string>& paths) {
+        const auto& base = root_path(root);
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(base, ec); !ec && it != std::filesystem::recursive_directory_iterator();
+             it.increment(ec)) {
+            if (it->is_regular_file(ec)) {
+                paths.insert(it->path().lexically_relative(base).generic_string());
+            }
+        }
+        if (ec) {
+            log::warn("Failed to walk {}: {}", base.string(), ec.message());
+        }
+        // Indexed entries whose files are gone
+        if (root == ERoot::Files) {
+            auto files_result = m_Files.list_files();
+            if (files_result) {
+                for (const auto& meta : files_result.value()) {
+                    if (!meta.is_deleted) {
+                        paths.insert(meta.path);
+                    }
+                }
+            }
+        } else {
+            auto notes_result = m_Notes.get_all_metadata();
+            if (notes_result) {
+                for (const auto& meta : notes_result.value()) {
+                    paths.insert(meta.path);
+                }
+            }
+        }
+    }
+
+} // namespace sap::cloud
@@ -1,9 +1,14 @@
 #include <csignal>
 #include <filesystem>
 #include <iostream>
+#include <pthread.h>
 #include <sap_cloud/config.h>
+#include <sap_cloud/io_engine.h>
+#include <sap_cloud/metadata.h>
 #include <sap_cloud/server.h>
+#include <sap_cloud/services/notes_service.h>
 #include <sap_core/log.h>
+#include <thread>
 
 namespace {
     sap::cloud::Server* g_Server = nullptr;
@@ -18,10 +23,57 @@ void signal_handler(int sig) {
     }
 }
 
+// SIGHUP is blocked in every thread and consumed here, so the reload runs on
+// an ordinary thread instead of inside a signal handler
+std::jthread start_reload_thread(sap::cloud::Server& server) {
+    return std::jthread([&server](std::stop_token stop) {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGHUP);
+        const timespec poll_interval{0, 500'000'000};
+        while (!stop.stop_requested()) {
+            if (sigtimedwait(&set, nullptr, &poll_interval) == SIGHUP) {
+                sap::log::info("Received SIGHUP, reloading authorized keys");
+                server.reload_authorized_keys();
+            }
+        }
+    });
+}
+
+// Offline rebuild of the note metadata and full-text index. Run it with the server
+// stopped; a running server rebuilds through POST /api/v1/admin/notes/reindex
+int rebuild_note_index(const sap::cloud::Config& config) {
+    auto io_config = sap::cloud::io_options(config.storage);
+    if (!io_config) {
+        sap::log::error("{}", io_config.error());
+        return 1;
+    }
+    auto store = sap::cloud::storage::MetadataStore::open(config.storage.database, io_config.value().durability);
+    if (!store) {
+        sap::log::error("Failed to open database: {}", store.error());
+        return 1;
+    }
+    auto io = sap::cloud::IoEngine::create(io_config.value());
+    if (!io) {
+        sap::log::error("Failed to start file I/O engine: {}", io.error());
+        return 1;
+    }
+    sap::fs::Filesystem notes_fs(config.storage.notes_root);
+    sap::cloud::services::NoteService notes(notes_fs, store.value(), *io.value(), config.storage.notes_root);
+    sap::cloud::services::NoteService::RebuildProgress progress;
+    auto result = notes.rebuild_index(progress);
+    if (!result) {
+        sap::log::error("{}", result.error());
+        return 1;
+    }
+    return progress.failed > 0 ? 2 : 0;
+}
+
 void print_usage(const char* progname) {
     std::cout << "Usage: " << progname << " [options]\n"
               << "\nOptions:\n"
               << "  -c, --config <path>   Path to config file\n"
+              << "  --rebuild-index       Rebuild the note index and exit\n"
               << "  -h, --help            Show this help message\n"
               << "  -v, --version         Show version\n"
               << "\nDefault config locations:\n"
@@ -32,6 +84,7 @@ void print_usage(const char* progname) {
 int main(int argc, char* argv[]) {
     // Parse command line arguments
     std::filesystem::path config_path;
+    bool rebuild_index = false;
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "-h" || arg == "--help") {
@@ -45,6 +98,9 @@ int main(int argc, char* argv[]) {
         if ((arg == "-c" || arg == "--config") && i + 1 < argc) {
             config_path = argv[++i];
         }
+        if (arg == "--rebuild-index") {
+            rebuild_index = true;
+        }
     }
     // Load configuration
     sap::stl::result<sap::cloud::Config> config_result;
@@ -59,6 +115,14 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     auto& config = config_result.value();
+    if (rebuild_index) {
+        return rebuild_note_index(config);
+    }
+    // Block SIGHUP before any threads exist so they all inherit the mask
+    sigset_t hup;
+    sigemptyset(&hup);
+    sigaddset(&hup, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &hup, nullptr);
     // Create server
     auto server_result = sap::cloud::Server::create(config);
     if (!server_result) {
@@ -70,6 +134,7 @@ int main(int argc, char* argv[]) {
     // Setup signal handlers
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
+    auto reload_thread = start_reload_thread(*server);
     // Run server
     sap::log::info("sap_cloud v0.1.0 starting...");
     sap::log::info("Data directory: {}", sap::cloud::get_data_dir().string());
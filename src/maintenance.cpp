@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <sap_cloud/maintenance.h>
+#include <sap_core/log.h>
+
+namespace sap::cloud {
+
+    MaintenanceScheduler::MaintenanceScheduler(std::chrono::milliseconds slice) : m_Slice(slice) {}
+
+    MaintenanceScheduler::~MaintenanceScheduler() { stop(); }
+
+    void MaintenanceScheduler::add_job(std::string name, std::chrono::milliseconds interval, Step step) {
+        m_Jobs.push_back({std::move(name), interval, std::move(step), {}});
+    }
+
+    void MaintenanceScheduler::start() {
+        if (m_Thread.joinable() || m_Jobs.empty()) {
+            return;
+        }
+        auto now = Clock::now();
+        for (auto& job : m_Jobs) {
+            job.next_run = now + job.interval;
+        }
+        m_Stopping = false;
+        m_Thread = std::thread([this] { run(); });
+    }
+
+    void MaintenanceScheduler::stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_Wake.notify_all();
+        if (m_Thread.joinable()) {
+            m_Thread.join();
+        }
+    }
+
+    void MaintenanceScheduler::run() {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while (!m_Stopping) {
+            auto due = std::min_element(m_Jobs.begin(), m_Jobs.end(), [](const Job& a, const Job& b) { return a.next_run < b.next_run; });
+            if (m_Wake.wait_until(lock, due->next_run, [this] { return m_Stopping; })) {
+                return;
+            }
+            if (Clock::now() < due->next_run) {
+                continue;
+            }
+            lock.unlock();
+            due->next_run = run_slice(*due);
+            lock.lock();
+        }
+    }
+
+    MaintenanceScheduler::Clock::time_point MaintenanceScheduler::run_slice(Job& job) {
+        auto start = Clock::now();
+        auto deadline = start + m_Slice;
+        size_t steps = 0;
+        while (true) {
+            auto r = job.step();
+            ++steps;
+            if (!r) {
+                log::warn("Maintenance job {} failed: {}", job.name, r.error());
+                return Clock::now() + job.interval;
+            }
+            if (!r.value()) {
+                break;
+            }
+            auto now = Clock::now();
+            if (now >= deadline) {
+                // Backlog left: pause long enough that queued requests get the database first
+                log::debug("Maintenance job {} yielding after {} steps", job.name, steps);
+                return now + 4 * m_Slice;
+            }
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Stopping) {
+                return now;
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+        log::debug("Maintenance job {} finished in {} ms ({} steps)", job.name, elapsed.count(), steps);
+        return Clock::now() + job.interval;
+    }
+
+} // namespace sap::cloud
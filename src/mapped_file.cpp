@@ -0,0 +1,105 @@
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sap_cloud/mapped_file.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SAP_CLOUD_HAS_MMAP 1
+#endif
+
+namespace sap::cloud {
+
+    namespace {
+        stl::result<std::vector<u8>> read_buffered(const std::filesystem::path& path) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) {
+                return stl::make_error<std::vector<u8>>("Cannot open {}", path.string());
+            }
+            std::vector<u8> buffer;
+            char chunk[64 * 1024];
+            while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+                buffer.insert(buffer.end(), chunk, chunk + in.gcount());
+            }
+            if (in.bad()) {
+                return stl::make_error<std::vector<u8>>("Failed to read {}", path.string());
+            }
+            return buffer;
+        }
+    } // namespace
+
+    stl::result<MappedFile> MappedFile::open(const std::filesystem::path& path, EAccess access) {
+        MappedFile file;
+#ifdef SAP_CLOUD_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return stl::make_error<MappedFile>("Cannot open {}: {}", path.string(), std::strerror(errno));
+        }
+        struct stat st{};
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && static_cast<size_t>(st.st_size) >= min_map_size) {
+            auto size = static_cast<size_t>(st.st_size);
+            void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                madvise(addr, size, access == EAccess::Sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+                file.m_Data = static_cast<const u8*>(addr);
+                file.m_Size = size;
+                file.m_Mapped = true;
+            }
+        }
+        ::close(fd);
+        if (file.m_Mapped) {
+            return file;
+        }
+#else
+        (void)access;
+#endif
+        // Small, special or unmappable: a plain read is as cheap and always works
+        auto buffer = read_buffered(path);
+        if (!buffer) {
+            return stl::make_error<MappedFile>("{}", buffer.error());
+        }
+        file.m_Buffer = std::move(buffer.value());
+        file.m_Data = file.m_Buffer.data();
+        file.m_Size = file.m_Buffer.size();
+        return file;
+    }
+
+    MappedFile::~MappedFile() { release(); }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept :
+        m_Data(other.m_Data), m_Size(other.m_Size), m_Mapped(other.m_Mapped), m_Buffer(std::move(other.m_Buffer)) {
+        other.m_Data = nullptr;
+        other.m_Size = 0;
+        other.m_Mapped = false;
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            release();
+            m_Data = other.m_Data;
+            m_Size = other.m_Size;
+            m_Mapped = other.m_Mapped;
+            m_Buffer = std::move(other.m_Buffer);
+            other.m_Data = nullptr;
+            other.m_Size = 0;
+            other.m_Mapped = false;
+        }
+        return *this;
+    }
+
+    void MappedFile::release() {
+#ifdef SAP_CLOUD_HAS_MMAP
+        if (m_Mapped) {
+            munmap(const_cast<u8*>(m_Data), m_Size);
+        }
+#endif
+        m_Data = nullptr;
+        m_Size = 0;
+        m_Mapped = false;
+        m_Buffer.clear();
+    }
+
+} // namespace sap::cloud
@@ -0,0 +1,186 @@
+#include <sap_cloud/merkle_tree.h>
+#include <sap_sync/hash.h>
+
+namespace sap::cloud {
+
+    namespace {
+        // Path segments; empty ones (leading, trailing or doubled '/') are skipped
+        std::vector<std::string_view> split(std::string_view path) {
+            std::vector<std::string_view> segments;
+            while (!path.empty()) {
+                auto slash = path.find('/');
+                auto segment = path.substr(0, slash);
+                if (!segment.empty()) {
+                    segments.push_back(segment);
+                }
+                if (slash == std::string_view::npos) {
+                    break;
+                }
+                path.remove_prefix(slash + 1);
+            }
+            return segments;
+        }
+    } // namespace
+
+    MerkleTree::MerkleTree() : m_Root(std::make_unique<Node>()) {
+        m_Root->directory = true;
+        m_Root->dirty = true;
+    }
+
+    void MerkleTree::load(const std::vector<sync::FileMetadata>& rows) {
+        std::lock_guard lock(m_Mutex);
+        m_Root = std::make_unique<Node>();
+        m_Root->directory = true;
+        m_Root->dirty = true;
+        for (const auto& meta : rows) {
+            if (!meta.is_deleted) {
+                insert(meta);
+            }
+        }
+    }
+
+    void MerkleTree::update(const sync::FileMetadata& meta) {
+        std::lock_guard lock(m_Mutex);
+        if (meta.is_deleted) {
+            erase(meta.path);
+        } else {
+            insert(meta);
+        }
+    }
+
+    void MerkleTree::remove(std::string_view path) {
+        std::lock_guard lock(m_Mutex);
+        erase(path);
+    }
+
+    std::optional<MerkleTree::Subtree> MerkleTree::subtree(std::string_view path) {
+        std::lock_guard lock(m_Mutex);
+        Node* node = m_Root.get();
+        Subtree subtree;
+        for (auto segment : split(path)) {
+            if (!node->directory) {
+                return std::nullopt;
+            }
+            auto it = node->children.find(segment);
+            if (it == node->children.end()) {
+                return std::nullopt;
+            }
+            node = it->second.get();
+            if (!subtree.path.empty()) {
+                subtree.path.push_back('/');
+            }
+            subtree.path.append(segment);
+        }
+        subtree.directory = node->directory;
+        subtree.hash = hash_of(*node);
+        subtree.files = node->files;
+        subtree.children.reserve(node->children.size());
+        for (const auto& [name, child] : node->children) {
+            subtree.children.push_back({name, child->directory, hash_of(*child), child->files});
+        }
+        return subtree;
+    }
+
+    std::string MerkleTree::root_hash() {
+        std::lock_guard lock(m_Mutex);
+        return hash_of(*m_Root);
+    }
+
+    u64 MerkleTree::size() {
+        std::lock_guard lock(m_Mutex);
+        (void)hash_of(*m_Root); // Brings the file counts up to date
+        return m_Root->files;
+    }
+
+    void MerkleTree::file_changed(std::string_view path, const sync::FileMetadata* row) {
+        std::lock_guard lock(m_Mutex);
+        if (row && !row->is_deleted) {
+            insert(*row);
+        } else {
+            erase(path);
+        }
+    }
+
+    void MerkleTree::files_reloaded(const std::vector<sync::FileMetadata>& rows) { load(rows); }
+
+    void MerkleTree::insert(const sync::FileMetadata& meta) {
+        auto segments = split(meta.path);
+        if (segments.empty()) {
+            return;
+        }
+        Node* node = m_Root.get();
+        node->dirty = true;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            auto it = node->children.find(segments[i]);
+            if (it == node->children.end()) {
+                it = node->children.emplace(std::string(segments[i]), nullptr).first;
+            }
+            auto& child = it->second;
+            bool leaf = i + 1 == segments.size();
+            // A file where a directory was (or the reverse) replaces it outright
+            if (!child || child->directory == leaf) {
+                child = std::make_unique<Node>();
+                child->directory = !leaf;
+            }
+            if (leaf) {
+                child->hash = meta.hash;
+                child->files = 1;
+            } else {
+                child->dirty = true;
+            }
+            node = child.get();
+        }
+    }
+
+    void MerkleTree::erase(std::string_view path) {
+        auto segments = split(path);
+        if (segments.empty()) {
+            return;
+        }
+        std::vector<Node*> nodes{m_Root.get()};
+        for (size_t i = 0; i + 1 < segments.size(); ++i) {
+            auto it = nodes.back()->children.find(segments[i]);
+            if (it == nodes.back()->children.end() || !it->second->directory) {
+                return;
+            }
+            nodes.push_back(it->second.get());
+        }
+        auto leaf = nodes.back()->children.find(segments.back());
+        if (leaf == nodes.back()->children.end() || leaf->second->directory) {
+            return;
+        }
+        nodes.back()->children.erase(leaf);
+        // Directories exist only while they hold files
+        for (size_t i = nodes.size() - 1; i > 0; --i) {
+            if (!nodes[i]->children.empty()) {
+                break;
+            }
+            nodes[i - 1]->children.erase(nodes[i - 1]->children.find(segments[i - 1]));
+            nodes.pop_back();
+        }
+        for (auto* node : nodes) {
+            node->dirty = true;
+        }
+    }
+
+    const std::string& MerkleTree::hash_of(Node& node) {
+        if (!node.directory || !node.dirty) {
+            return node.hash;
+        }
+        std::string listing;
+        node.files = 0;
+        for (const auto& [name, child] : node.children) {
+            const auto& hash = hash_of(*child);
+            node.files += child->files;
+            listing.append(name);
+            listing.push_back('\0');
+            listing.push_back(child->directory ? 'd' : 'f');
+            listing.append(hash);
+            listing.push_back('\n');
+        }
+        node.hash = sync::hash_string(listing);
+        node.dirty = false;
+        return node.hash;
+    }
+
+} // namespace sap::cloud
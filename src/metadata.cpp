@@ -1,25 +1,269 @@
 #include "sap_cloud/metadata.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <sap_cloud/metrics.h>
+#include <sap_cloud/trace.h>
 #include <sap_core/log.h>
 #include <sstream>
+#include <unordered_map>
 
 namespace sap::cloud::storage {
 
-    MetadataStore::MetadataStore(db::Database db) : m_Db(std::move(db)) {}
+    namespace {
+        // Times a MetadataStore call into sap_sqlite_duration_seconds{op} and
+        // traces it as MetadataStore::<op>
+        class Instrumented {
+        public:
+            Instrumented(const metrics::Histogram& histogram, const char* span) : m_Timer(histogram), m_Span(span) {}
 
-    stl::result<MetadataStore> MetadataStore::open(const std::filesystem::path& db_path) {
+        private:
+            metrics::ScopedTimer m_Timer;
+            trace::Span m_Span;
+        };
+
+        // op must be a string literal. Each thread resolves it once; the registry
+        // lookup and span name are shared by all threads and live for the process.
+        Instrumented instrument(const char* op) {
+            struct Site {
+                metrics::Histogram histogram;
+                const char* span = nullptr;
+            };
+            thread_local std::unordered_map<const char*, Site> sites;
+            auto it = sites.find(op);
+            if (it == sites.end()) {
+                static std::mutex mutex;
+                static std::map<std::string, std::string, std::less<>> spans;
+                std::lock_guard<std::mutex> lock(mutex);
+                auto span = spans.try_emplace(op, std::string("MetadataStore::") + op).first;
+                auto histogram =
+                    metrics::registry().histogram("sap_sqlite_duration_seconds", "MetadataStore call latency", {{"op", span->first}});
+                it = sites.emplace(op, Site{histogram, span->second.c_str()}).first;
+            }
+            return Instrumented(it->second.histogram, it->second.span);
+        }
+
+        const metrics::Counter& index_mismatches() {
+            static const auto counter =
+                metrics::registry().counter("sap_file_index_mismatches_total", "File index queries that disagreed with the database");
+            return counter;
+        }
+
+        // Columns of notes_fts and of the staging table rebuilds load into
+        constexpr const char* fts_columns = "note_id, title, content, tokenize='porter unicode61'";
+
+        sync::FileMetadata file_from_row(const db::Row& row) {
+            sync::FileMetadata meta;
+            meta.path = row.get<std::string>("path");
+            meta.hash = row.get<std::string>("hash");
+            meta.size = row.get<i64>("size");
+            meta.mtime = row.get<i64>("mtime");
+            meta.created_at = row.get<i64>("created_at");
+            meta.updated_at = row.get<i64>("updated_at");
+            meta.is_deleted = row.get<i64>("is_deleted") != 0;
+            return meta;
+        }
+    } // namespace
+
+    void to_json(nlohmann::json& j, const UploadSession& session) {
+        j = nlohmann::json{{"id", session.id},
+                           {"path", session.path},
+                           {"size", session.size},
+                           {"offset", session.offset},
+                           {"created_at", session.created_at},
+                           {"expires_at", session.expires_at}};
+        if (session.mtime != 0) {
+            j["mtime"] = session.mtime;
+        }
+    }
+
+    MetadataStore::MetadataStore(db::Database db, std::filesystem::path path, EDurability durability) :
+        m_Db(std::move(db)), m_Path(std::move(path)), m_Durability(durability) {}
+
+    stl::result<MetadataStore> MetadataStore::open(const std::filesystem::path& db_path, EDurability durability) {
         auto db_result = db::Database::open(db_path);
         if (!db_result) {
             return stl::make_error<MetadataStore>("Failed to open database: {}", db_result.error());
         }
-        MetadataStore store(std::move(db_result.value()));
+        MetadataStore store(std::move(db_result.value()), db_path, durability);
+        // The writer holds the write lock on its own connection, as may another
+        // process; wait for it instead of failing
+        store.m_Db.execute("PRAGMA busy_timeout = 5000");
         auto init_result = store.init_schema();
         if (!init_result) {
             return stl::make_error<MetadataStore>("{}", init_result.error());
         }
+        auto durability_result = store.apply_durability();
+        if (!durability_result) {
+            return stl::make_error<MetadataStore>("Failed to configure database durability: {}", durability_result.error());
+        }
         return store;
     }
 
+    stl::result<> MetadataStore::apply_durability() {
+        // After the schema: auto_vacuum only takes effect if set before anything else is written
+        auto wal = m_Db.execute("PRAGMA journal_mode = WAL");
+        if (!wal)
+            return wal;
+        // Per connection, so the writer's connection applies it too
+        switch (m_Durability) {
+        case EDurability::Strict:
+            return m_Db.execute("PRAGMA synchronous = FULL");
+        case EDurability::Balanced:
+            return m_Db.execute("PRAGMA synchronous = NORMAL");
+        case EDurability::Fast: {
+            auto sync = m_Db.execute("PRAGMA synchronous = OFF");
+            if (!sync)
+                return sync;
+            // Commits never pay for a checkpoint; checkpoint() is run in the background instead
+            return m_Db.execute("PRAGMA wal_autocheckpoint = 0");
+        }
+        }
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::start_writer(const WriterOptions& options) {
+        if (m_Writer) {
+            return stl::success;
+        }
+        auto writer = MetadataWriter::start(m_Path, m_Durability, options);
+        if (!writer) {
+            return stl::make_error("Failed to start metadata writer: {}", writer.error());
+        }
+        m_Writer = std::move(writer.value());
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::transaction(const MetadataWriter::Intent& fn) {
+        // File changes are collected on whichever store runs fn (the writer's
+        // or this one) and re-read once the outcome is known
+        std::vector<FileChange> changes;
+        MetadataWriter::Intent collect = [&](MetadataStore& store) {
+            struct Collecting {
+                MetadataStore& store;
+                ~Collecting() { store.m_Changes = nullptr; }
+            } collecting{store};
+            store.m_Changes = &changes;
+            return fn(store);
+        };
+        const auto& run = tracks_files() ? collect : fn;
+        stl::result<> r = stl::success;
+        if (m_Writer) {
+            r = m_Writer->write(run);
+        } else {
+            auto begin = m_Db.execute("BEGIN IMMEDIATE");
+            if (!begin)
+                return begin;
+            r = run(*this);
+            if (r) {
+                r = m_Db.execute("COMMIT");
+            }
+            if (!r) {
+                m_Db.execute("ROLLBACK");
+            }
+        }
+        // Rows are re-read, so a rolled back change just refreshes to the old row
+        if (!changes.empty())
+            refresh_files(changes);
+        return r;
+    }
+
+    stl::result<> MetadataStore::enable_file_index(bool verify) {
+        auto rows = query_files(std::nullopt);
+        if (!rows)
+            return stl::make_error("Failed to load file index: {}", rows.error());
+        auto index = std::make_unique<FileIndex>();
+        index->load(rows.value());
+        log::info("File index loaded: {} files{}", index->size(), verify ? " (verifying queries)" : "");
+        m_FileIndex = std::move(index);
+        m_VerifyIndex = verify;
+        return stl::success;
+    }
+
+    stl::result<std::vector<std::string>> MetadataStore::verify_file_index() {
+        if (!m_FileIndex)
+            return std::vector<std::string>{};
+        std::lock_guard<std::mutex> lock(*m_RefreshMutex);
+        auto rows = query_files(std::nullopt);
+        if (!rows)
+            return stl::make_error<std::vector<std::string>>("{}", rows.error());
+        return m_FileIndex->diff(rows.value());
+    }
+
+    stl::result<> MetadataStore::add_file_observer(FileObserver* observer) {
+        // Seeded under the refresh lock, so no change lands between the read and registration
+        std::lock_guard<std::mutex> lock(*m_RefreshMutex);
+        auto rows = query_files(std::nullopt);
+        if (!rows)
+            return stl::make_error("Failed to read files for observer: {}", rows.error());
+        observer->files_reloaded(rows.value());
+        m_FileObservers.push_back(observer);
+        return stl::success;
+    }
+
+    void MetadataStore::file_changed(FileChange change) {
+        if (m_Changes) {
+            m_Changes->push_back(std::move(change));
+            return;
+        }
+        if (tracks_files())
+            refresh_files({std::move(change)});
+    }
+
+    void MetadataStore::refresh_files(const std::vector<FileChange>& changes) {
+        trace::Span span("MetadataStore::refresh_files");
+        // Held across each read and apply, so an older read never overwrites a newer one
+        std::lock_guard<std::mutex> lock(*m_RefreshMutex);
+        auto apply = [&](std::string_view path, const sync::FileMetadata* row) {
+            if (m_FileIndex) {
+                if (row)
+                    m_FileIndex->apply(*row);
+                else
+                    m_FileIndex->erase(path);
+            }
+            for (auto* observer : m_FileObservers) {
+                observer->file_changed(path, row);
+            }
+        };
+        std::optional<std::string> failure;
+        for (const auto& change : changes) {
+            if (change.under) {
+                auto rows = query_files(std::nullopt, change.path);
+                if (!rows) {
+                    failure = rows.error();
+                    break;
+                }
+                for (const auto& meta : rows.value()) {
+                    apply(meta.path, &meta);
+                }
+                continue;
+            }
+            auto row = get_file(change.path);
+            if (!row) {
+                failure = row.error();
+                break;
+            }
+            apply(change.path, row.value() ? &*row.value() : nullptr);
+        }
+        if (!failure)
+            return;
+        // The change is committed but unknown to the index; start over from the table
+        log::warn("File change could not be re-read, reloading all files: {}", *failure);
+        auto rows = query_files(std::nullopt);
+        if (!rows) {
+            log::error("File reload failed: {}", rows.error());
+            return;
+        }
+        if (m_FileIndex)
+            m_FileIndex->load(rows.value());
+        for (auto* observer : m_FileObservers) {
+            observer->files_reloaded(rows.value());
+        }
+    }
+
     stl::result<> MetadataStore::init_schema() {
+        // Only takes effect on a new (empty) database; existing ones keep their mode until a full VACUUM
+        m_Db.execute("PRAGMA auto_vacuum = INCREMENTAL");
         // Files table
         auto r1 = m_Db.execute(R"(
         CREATE TABLE IF NOT EXISTS files (
@@ -30,11 +274,15 @@ namespace sap::cloud::storage {
             mtime       INTEGER NOT NULL,
             created_at  INTEGER NOT NULL,
             updated_at  INTEGER NOT NULL,
-            is_deleted  INTEGER DEFAULT 0
+            is_deleted  INTEGER DEFAULT 0,
+            fast_hash   TEXT
         )
     )");
         if (!r1)
             return r1;
+        auto migrate_result = add_column_if_missing("files", "fast_hash", "TEXT");
+        if (!migrate_result)
+            return migrate_result;
         // Notes table
         auto r2 = m_Db.execute(R"(
         CREATE TABLE IF NOT EXISTS notes (
@@ -69,14 +317,7 @@ namespace sap::cloud::storage {
         if (!r4)
             return r4;
         // Full-text search
-        auto r5 = m_Db.execute(R"(
-        CREATE VIRTUAL TABLE IF NOT EXISTS notes_fts USING fts5(
-            note_id,
-            title,
-            content,
-            tokenize='porter unicode61'
-        )
-    )");
+        auto r5 = m_Db.execute(std::string("CREATE VIRTUAL TABLE IF NOT EXISTS notes_fts USING fts5(") + fts_columns + ")");
         if (!r5)
             return r5;
         // Auth tokens
@@ -100,9 +341,26 @@ namespace sap::cloud::storage {
     )");
         if (!r7)
             return r7;
+        // Resumable upload sessions
+        auto r8 = m_Db.execute(R"(
+        CREATE TABLE IF NOT EXISTS upload_sessions (
+            id              TEXT PRIMARY KEY,
+            path            TEXT NOT NULL,
+            size            INTEGER NOT NULL,
+            received_bytes  INTEGER NOT NULL DEFAULT 0,
+            mtime           INTEGER NOT NULL DEFAULT 0,
+            created_at      INTEGER NOT NULL,
+            expires_at      INTEGER NOT NULL
+        )
+    )");
+        if (!r8)
+            return r8;
         // Indexes
         m_Db.execute("CREATE INDEX IF NOT EXISTS idx_files_path ON files(path)");
         m_Db.execute("CREATE INDEX IF NOT EXISTS idx_files_updated ON files(updated_at)");
+        m_Db.execute("CREATE INDEX IF NOT EXISTS idx_files_unhashed ON files(id) WHERE hash = '' AND is_deleted = 0");
+        // Partial: queries must repeat "hash != '' AND is_deleted = 0" to use it
+        m_Db.execute("CREATE INDEX IF NOT EXISTS idx_files_hash ON files(hash) WHERE hash != '' AND is_deleted = 0");
         m_Db.execute("CREATE INDEX IF NOT EXISTS idx_notes_path ON notes(path)");
         m_Db.execute("CREATE INDEX IF NOT EXISTS idx_note_tags_note ON note_tags(note_id)");
         m_Db.execute("CREATE INDEX IF NOT EXISTS idx_note_tags_tag ON note_tags(tag_id)");
@@ -111,6 +369,7 @@ namespace sap::cloud::storage {
     }
 
     stl::result<std::optional<sync::FileMetadata>> MetadataStore::get_file(std::string_view path) {
+        auto scope = instrument("get_file");
         auto stmt = m_Db.prepare("SELECT path, hash, size, mtime, created_at, updated_at, is_deleted "
                                  "FROM files WHERE path = ?");
         if (!stmt)
@@ -121,56 +380,98 @@ namespace sap::cloud::storage {
             return stl::make_error<std::optional<sync::FileMetadata>>("{}", row.error());
         if (!row.value())
             return std::optional<sync::FileMetadata>{};
-        sync::FileMetadata meta;
-        meta.path = row.value()->get<std::string>("path");
-        meta.hash = row.value()->get<std::string>("hash");
-        meta.size = row.value()->get<i64>("size");
-        meta.mtime = row.value()->get<i64>("mtime");
-        meta.created_at = row.value()->get<i64>("created_at");
-        meta.updated_at = row.value()->get<i64>("updated_at");
-        meta.is_deleted = row.value()->get<i64>("is_deleted") != 0;
-        return {meta};
+        return std::optional<sync::FileMetadata>{file_from_row(*row.value())};
     }
 
     stl::result<std::vector<sync::FileMetadata>> MetadataStore::get_all_files(std::optional<sync::Timestamp> since) {
-        std::string sql = "SELECT path, hash, size, mtime, created_at, updated_at, is_deleted FROM files";
+        if (!m_FileIndex)
+            return query_files(since);
+        trace::Span span("MetadataStore::get_all_files (index)");
+        if (!m_VerifyIndex)
+            return m_FileIndex->changed_since(since);
+        // A write that has committed but not yet been re-read into the index
+        // differs once; wait out refreshes in flight and only count a repeat
+        for (int attempt = 1;; ++attempt) {
+            auto rows = query_files(since);
+            if (!rows)
+                return rows;
+            auto differences = m_FileIndex->diff(rows.value(), since);
+            if (differences.empty())
+                return m_FileIndex->changed_since(since);
+            if (attempt == 2) {
+                index_mismatches().inc();
+                log::warn("File index disagrees with the database ({} shown):", differences.size());
+                for (const auto& line : differences) {
+                    log::warn("  {}", line);
+                }
+                return rows;
+            }
+            std::lock_guard<std::mutex> lock(*m_RefreshMutex);
+        }
+    }
+
+    stl::result<std::vector<sync::FileMetadata>> MetadataStore::query_files(std::optional<sync::Timestamp> since, std::string_view dir) {
+        auto scope = instrument("get_all_files");
+        std::string sql = "SELECT path, hash, size, mtime, created_at, updated_at, is_deleted FROM files WHERE 1";
         if (since) {
-            sql += " WHERE updated_at > ?";
+            sql += " AND updated_at > ?";
+        }
+        if (!dir.empty()) {
+            // Range over "dir/" .. "dir0" ('0' follows '/') so the path index is used
+            sql += " AND path > ? AND path < ?";
         }
         auto stmt = m_Db.prepare(sql);
         if (!stmt)
             return stl::make_error<std::vector<sync::FileMetadata>>("{}", stmt.error());
+        int param = 1;
         if (since) {
-            stmt->bind(1, *since);
+            stmt->bind(param++, *since);
+        }
+        if (!dir.empty()) {
+            stmt->bind(param++, std::string(dir) + "/");
+            stmt->bind(param++, std::string(dir) + "0");
         }
         auto rows = stmt->fetch_all();
         if (!rows)
             return stl::make_error<std::vector<sync::FileMetadata>>("{}", rows.error());
         std::vector<sync::FileMetadata> files;
+        files.reserve(rows.value().size());
         for (const auto& row : rows.value()) {
-            sync::FileMetadata meta;
-            meta.path = row.get<std::string>("path");
-            meta.hash = row.get<std::string>("hash");
-            meta.size = row.get<i64>("size");
-            meta.mtime = row.get<i64>("mtime");
-            meta.created_at = row.get<i64>("created_at");
-            meta.updated_at = row.get<i64>("updated_at");
-            meta.is_deleted = row.get<i64>("is_deleted") != 0;
-            files.push_back(std::move(meta));
+            files.push_back(file_from_row(row));
         }
         return files;
     }
 
-    stl::result<> MetadataStore::upsert_file(const sync::FileMetadata& meta) {
+    stl::result<> MetadataStore::add_column_if_missing(std::string_view table, std::string_view column, std::string_view type) {
+        auto columns = m_Db.query("PRAGMA table_info(" + std::string(table) + ")");
+        if (!columns)
+            return stl::make_error("{}", columns.error());
+        for (const auto& row : columns.value()) {
+            if (row.get<std::string>("name") == column)
+                return stl::success;
+        }
+        log::info("Migrating database: adding {}.{}", table, column);
+        return m_Db.execute("ALTER TABLE " + std::string(table) + " ADD COLUMN " + std::string(column) + " " + std::string(type));
+    }
+
+    stl::result<> MetadataStore::upsert_file(const sync::FileMetadata& meta, std::string_view fast_hash) {
+        if (m_Writer) {
+            auto r = m_Writer->write([&](MetadataStore& store) { return store.upsert_file(meta, fast_hash); });
+            if (r)
+                file_changed({meta.path});
+            return r;
+        }
+        auto scope = instrument("upsert_file");
         auto stmt = m_Db.prepare(R"(
-        INSERT INTO files (path, hash, size, mtime, created_at, updated_at, is_deleted)
-        VALUES (?, ?, ?, ?, ?, ?, ?)
+        INSERT INTO files (path, hash, size, mtime, created_at, updated_at, is_deleted, fast_hash)
+        VALUES (?, ?, ?, ?, ?, ?, ?, NULLIF(?, ''))
         ON CONFLICT(path) DO UPDATE SET
             hash = excluded.hash,
             size = excluded.size,
             mtime = excluded.mtime,
             updated_at = excluded.updated_at,
-            is_deleted = excluded.is_deleted
+            is_deleted = excluded.is_deleted,
+            fast_hash = excluded.fast_hash
     )");
         if (!stmt)
             return stl::make_error("{}", stmt.error());
@@ -181,13 +482,137 @@ namespace sap::cloud::storage {
         stmt->bind(5, meta.created_at);
         stmt->bind(6, meta.updated_at);
         stmt->bind(7, static_cast<i64>(meta.is_deleted ? 1LL : 0LL));
+        stmt->bind(8, fast_hash);
         auto r = stmt->execute();
         if (!r)
             return stl::make_error("{}", r.error());
+        file_changed({meta.path});
         return stl::success;
     }
 
+    stl::result<std::optional<std::string>> MetadataStore::get_fast_hash(std::string_view path) {
+        auto scope = instrument("get_fast_hash");
+        auto stmt = m_Db.prepare("SELECT fast_hash FROM files WHERE path = ?");
+        if (!stmt)
+            return stl::make_error<std::optional<std::string>>("{}", stmt.error());
+        stmt->bind(1, path);
+        auto row = stmt->fetch_one();
+        if (!row)
+            return stl::make_error<std::optional<std::string>>("{}", row.error());
+        if (!row.value())
+            return std::optional<std::string>{};
+        return row.value()->try_get<std::string>("fast_hash");
+    }
+
+    stl::result<std::vector<UnhashedFile>> MetadataStore::get_unhashed_files(i64 limit) {
+        auto scope = instrument("get_unhashed_files");
+        auto stmt = m_Db.prepare("SELECT path, fast_hash FROM files WHERE hash = '' AND is_deleted = 0 ORDER BY id LIMIT ?");
+        if (!stmt)
+            return stl::make_error<std::vector<UnhashedFile>>("{}", stmt.error());
+        stmt->bind(1, limit);
+        auto rows = stmt->fetch_all();
+        if (!rows)
+            return stl::make_error<std::vector<UnhashedFile>>("{}", rows.error());
+        std::vector<UnhashedFile> files;
+        files.reserve(rows.value().size());
+        for (const auto& row : rows.value()) {
+            files.push_back({row.get<std::string>("path"), row.try_get<std::string>("fast_hash").value_or("")});
+        }
+        return files;
+    }
+
+    stl::result<bool> MetadataStore::set_strong_hash(std::string_view path, std::string_view fast_hash, std::string_view hash) {
+        if (m_Writer) {
+            bool stored = false;
+            auto r = m_Writer->write([&](MetadataStore& store) -> stl::result<> {
+                auto inner = store.set_strong_hash(path, fast_hash, hash);
+                if (!inner)
+                    return stl::make_error("{}", inner.error());
+                stored = inner.value();
+                return stl::success;
+            });
+            if (!r)
+                return stl::make_error<bool>("{}", r.error());
+            if (stored)
+                file_changed({std::string(path)});
+            return stored;
+        }
+        auto scope = instrument("set_strong_hash");
+        // Bump updated_at so clients that saw the entry without a hash pick it up again.
+        // RETURNING tells whether this statement matched, whatever else runs on the connection.
+        auto stmt = m_Db.prepare("UPDATE files SET hash = ?, updated_at = ? WHERE path = ? AND hash = '' AND fast_hash = ? RETURNING id");
+        if (!stmt)
+            return stl::make_error<bool>("{}", stmt.error());
+        stmt->bind(1, hash);
+        stmt->bind(2, sync::now_ms());
+        stmt->bind(3, path);
+        stmt->bind(4, fast_hash);
+        auto updated = stmt->fetch_one();
+        if (!updated)
+            return stl::make_error<bool>("{}", updated.error());
+        if (!updated.value())
+            return false;
+        file_changed({std::string(path)});
+        return true;
+    }
+
+    stl::result<std::vector<std::string>> MetadataStore::find_hashes(std::vector<std::string> hashes) {
+        auto scope = instrument("find_hashes");
+        if (!std::is_sorted(hashes.begin(), hashes.end()))
+            std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+        // One statement for every batch; slots past the end of the last batch are
+        // bound to '', which the index predicate excludes
+        constexpr size_t batch = 256;
+        std::string sql = "SELECT DISTINCT hash FROM files WHERE hash IN (?";
+        for (size_t i = 1; i < batch; ++i)
+            sql += ",?";
+        sql += ") AND hash != '' AND is_deleted = 0 ORDER BY hash";
+        auto stmt = m_Db.prepare(sql);
+        if (!stmt)
+            return stl::make_error<std::vector<std::string>>("{}", stmt.error());
+        std::vector<std::string> found;
+        for (size_t first = 0; first < hashes.size(); first += batch) {
+            for (size_t i = 0; i < batch; ++i) {
+                size_t index = first + i;
+                stmt->bind(static_cast<int>(i + 1), index < hashes.size() ? std::string_view(hashes[index]) : std::string_view());
+            }
+            auto rows = stmt->fetch_all();
+            if (!rows)
+                return stl::make_error<std::vector<std::string>>("{}", rows.error());
+            for (const auto& row : rows.value()) {
+                found.push_back(row.get<std::string>("hash"));
+            }
+        }
+        return found;
+    }
+
+    stl::result<std::vector<std::string>> MetadataStore::get_live_hashes(std::string_view after, i64 limit) {
+        auto scope = instrument("get_live_hashes");
+        auto stmt = m_Db.prepare("SELECT DISTINCT hash FROM files WHERE hash > ? AND hash != '' AND is_deleted = 0 ORDER BY hash LIMIT ?");
+        if (!stmt)
+            return stl::make_error<std::vector<std::string>>("{}", stmt.error());
+        stmt->bind(1, after);
+        stmt->bind(2, limit);
+        auto rows = stmt->fetch_all();
+        if (!rows)
+            return stl::make_error<std::vector<std::string>>("{}", rows.error());
+        std::vector<std::string> hashes;
+        hashes.reserve(rows.value().size());
+        for (const auto& row : rows.value()) {
+            hashes.push_back(row.get<std::string>("hash"));
+        }
+        return hashes;
+    }
+
     stl::result<> MetadataStore::mark_deleted(std::string_view path) {
+        if (m_Writer) {
+            auto r = m_Writer->write([&](MetadataStore& store) { return store.mark_deleted(path); });
+            if (r)
+                file_changed({std::string(path)});
+            return r;
+        }
+        auto scope = instrument("mark_deleted");
         auto now = sync::now_ms();
         auto stmt = m_Db.prepare("UPDATE files SET is_deleted = 1, updated_at = ? WHERE path = ?");
         if (!stmt)
@@ -197,10 +622,51 @@ namespace sap::cloud::storage {
         auto r = stmt->execute();
         if (!r)
             return stl::make_error("{}", r.error());
+        file_changed({std::string(path)});
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::move_file(std::string_view from, const sync::FileMetadata& meta, std::string_view fast_hash) {
+        auto scope = instrument("move_file");
+        return transaction([&](MetadataStore& store) -> stl::result<> {
+            auto upsert_result = store.upsert_file(meta, fast_hash);
+            if (!upsert_result)
+                return upsert_result;
+            return store.mark_deleted(from);
+        });
+    }
+
+    stl::result<> MetadataStore::mark_deleted_under(std::string_view dir) {
+        if (m_Writer) {
+            auto r = m_Writer->write([&](MetadataStore& store) { return store.mark_deleted_under(dir); });
+            if (r)
+                file_changed({std::string(dir), true});
+            return r;
+        }
+        auto scope = instrument("mark_deleted_under");
+        auto now = sync::now_ms();
+        // Range over "dir/" .. "dir0" ('0' follows '/') so the path index is used
+        auto stmt = m_Db.prepare("UPDATE files SET is_deleted = 1, updated_at = ? WHERE path > ? AND path < ? AND is_deleted = 0");
+        if (!stmt)
+            return stl::make_error("{}", stmt.error());
+        stmt->bind(1, now);
+        stmt->bind(2, std::string(dir) + "/");
+        stmt->bind(3, std::string(dir) + "0");
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error("{}", r.error());
+        file_changed({std::string(dir), true});
         return stl::success;
     }
 
     stl::result<> MetadataStore::remove_file(std::string_view path) {
+        if (m_Writer) {
+            auto r = m_Writer->write([&](MetadataStore& store) { return store.remove_file(path); });
+            if (r)
+                file_changed({std::string(path)});
+            return r;
+        }
+        auto scope = instrument("remove_file");
         auto stmt = m_Db.prepare("DELETE FROM files WHERE path = ?");
         if (!stmt)
             return stl::make_error("{}", stmt.error());
@@ -208,10 +674,12 @@ namespace sap::cloud::storage {
         auto r = stmt->execute();
         if (!r)
             return stl::make_error("{}", r.error());
+        file_changed({std::string(path)});
         return stl::success;
     }
 
     stl::result<std::optional<sync::NoteMetadata>> MetadataStore::get_note(std::string_view id) {
+        auto scope = instrument("get_note");
         auto stmt = m_Db.prepare(R"(
         SELECT n.id, n.path, n.title, n.hash, n.created_at, n.updated_at, n.is_deleted,
                GROUP_CONCAT(t.name) as tags
@@ -250,6 +718,7 @@ namespace sap::cloud::storage {
     }
 
     stl::result<std::optional<sync::NoteMetadata>> MetadataStore::get_note_by_path(std::string_view path) {
+        auto scope = instrument("get_note_by_path");
         auto stmt = m_Db.prepare("SELECT id FROM notes WHERE path = ?");
         if (!stmt)
             return stl::make_error<std::optional<sync::NoteMetadata>>("{}", stmt.error());
@@ -263,6 +732,7 @@ namespace sap::cloud::storage {
     }
 
     stl::result<std::vector<sync::NoteMetadata>> MetadataStore::get_all_notes() {
+        auto scope = instrument("get_all_notes");
         auto rows = m_Db.query(R"(
         SELECT n.id, n.path, n.title, n.hash, n.created_at, n.updated_at, n.is_deleted,
                GROUP_CONCAT(t.name) as tags
@@ -299,6 +769,7 @@ namespace sap::cloud::storage {
     }
 
     stl::result<std::vector<sync::NoteMetadata>> MetadataStore::get_notes_by_tag(std::string_view tag) {
+        auto scope = instrument("get_notes_by_tag");
         auto stmt = m_Db.prepare(R"(
         SELECT n.id, n.path, n.title, n.hash, n.created_at, n.updated_at, n.is_deleted,
                GROUP_CONCAT(t2.name) as tags
@@ -341,6 +812,7 @@ namespace sap::cloud::storage {
     }
 
     stl::result<std::vector<sync::NoteMetadata>> MetadataStore::search_notes(std::string_view query) {
+        auto scope = instrument("search_notes");
         auto stmt = m_Db.prepare(R"(
         SELECT n.id, n.path, n.title, n.hash, n.created_at, n.updated_at, n.is_deleted,
                GROUP_CONCAT(t.name) as tags
@@ -382,6 +854,9 @@ namespace sap::cloud::storage {
     }
 
     stl::result<> MetadataStore::upsert_note(const sync::NoteMetadata& meta) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.upsert_note(meta); });
+        auto scope = instrument("upsert_note");
         auto stmt = m_Db.prepare(R"(
         INSERT INTO notes (id, path, title, hash, created_at, updated_at, is_deleted)
         VALUES (?, ?, ?, ?, ?, ?, ?)
@@ -412,6 +887,9 @@ namespace sap::cloud::storage {
     }
 
     stl::result<> MetadataStore::delete_note(std::string_view id) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.delete_note(id); });
+        auto scope = instrument("delete_note");
         auto now = sync::now_ms();
         auto stmt = m_Db.prepare("UPDATE notes SET is_deleted = 1, updated_at = ? WHERE id = ?");
         if (!stmt)
@@ -429,6 +907,7 @@ namespace sap::cloud::storage {
     }
 
     stl::result<std::vector<sync::TagInfo>> MetadataStore::get_all_tags() {
+        auto scope = instrument("get_all_tags");
         auto rows = m_Db.query(R"(
         SELECT t.name, COUNT(nt.note_id) as count
         FROM tags t
@@ -451,6 +930,9 @@ namespace sap::cloud::storage {
     }
 
     stl::result<> MetadataStore::set_note_tags(std::string_view note_id, const std::vector<std::string>& tags) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.set_note_tags(note_id, tags); });
+        auto scope = instrument("set_note_tags");
         // Remove existing tags
         auto del_stmt = m_Db.prepare("DELETE FROM note_tags WHERE note_id = ?");
         if (!del_stmt)
@@ -486,11 +968,19 @@ namespace sap::cloud::storage {
     }
 
     stl::result<> MetadataStore::update_fts(std::string_view note_id, std::string_view title, std::string_view content) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.update_fts(note_id, title, content); });
+        auto scope = instrument("update_fts");
         // Remove existing entry
         auto res = remove_fts(note_id);
         if (!res)
             return res;
         // Insert new entry
+        return insert_fts(note_id, title, content);
+    }
+
+    stl::result<> MetadataStore::insert_fts(std::string_view note_id, std::string_view title, std::string_view content) {
+        auto scope = instrument("insert_fts");
         auto stmt = m_Db.prepare("INSERT INTO notes_fts (note_id, title, content) VALUES (?, ?, ?)");
         if (!stmt)
             return stl::make_error("{}", stmt.error());
@@ -503,7 +993,85 @@ namespace sap::cloud::storage {
         return stl::success;
     }
 
+    stl::result<> MetadataStore::begin_fts_rebuild() {
+        auto scope = instrument("begin_fts_rebuild");
+        auto dropped = m_Db.execute("DROP TABLE IF EXISTS notes_fts_rebuild");
+        if (!dropped)
+            return dropped;
+        auto created = m_Db.execute(std::string("CREATE VIRTUAL TABLE notes_fts_rebuild USING fts5(") + fts_columns + ")");
+        if (!created)
+            return created;
+        // Segments are merged once by optimize_fts() after the swap instead
+        return m_Db.execute("INSERT INTO notes_fts_rebuild(notes_fts_rebuild, rank) VALUES('automerge', 0)");
+    }
+
+    stl::result<> MetadataStore::insert_rebuild_fts(std::string_view note_id, std::string_view title, std::string_view content) {
+        auto scope = instrument("insert_rebuild_fts");
+        auto stmt = m_Db.prepare("INSERT INTO notes_fts_rebuild (note_id, title, content) VALUES (?, ?, ?)");
+        if (!stmt)
+            return stl::make_error("{}", stmt.error());
+        stmt->bind(1, note_id);
+        stmt->bind(2, title);
+        stmt->bind(3, content);
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error("{}", r.error());
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::keep_rebuild_fts(std::string_view note_id) {
+        auto scope = instrument("keep_rebuild_fts");
+        auto stmt = m_Db.prepare("INSERT INTO notes_fts_rebuild (note_id, title, content) SELECT note_id, title, content FROM notes_fts WHERE note_id = ?");
+        if (!stmt)
+            return stl::make_error("{}", stmt.error());
+        stmt->bind(1, note_id);
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error("{}", r.error());
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::finish_fts_rebuild(sync::Timestamp since) {
+        auto scope = instrument("finish_fts_rebuild");
+        const char* carry_over[] = {
+            "DELETE FROM notes_fts_rebuild WHERE note_id IN (SELECT id FROM notes WHERE updated_at > ?)",
+            "INSERT INTO notes_fts_rebuild (note_id, title, content) SELECT note_id, title, content FROM notes_fts "
+            "WHERE note_id IN (SELECT id FROM notes WHERE updated_at > ? AND is_deleted = 0)",
+        };
+        for (const char* sql : carry_over) {
+            auto stmt = m_Db.prepare(sql);
+            if (!stmt)
+                return stl::make_error("{}", stmt.error());
+            stmt->bind(1, since);
+            auto r = stmt->execute();
+            if (!r)
+                return stl::make_error("{}", r.error());
+        }
+        for (const char* sql : {"INSERT INTO notes_fts_rebuild(notes_fts_rebuild, rank) VALUES('automerge', 4)", "DROP TABLE notes_fts",
+                                "ALTER TABLE notes_fts_rebuild RENAME TO notes_fts"}) {
+            auto r = m_Db.execute(sql);
+            if (!r)
+                return r;
+        }
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::abandon_fts_rebuild() {
+        auto scope = instrument("abandon_fts_rebuild");
+        return m_Db.execute("DROP TABLE IF EXISTS notes_fts_rebuild");
+    }
+
+    stl::result<> MetadataStore::optimize_fts() {
+        if (m_Writer)
+            return m_Writer->write([](MetadataStore& store) { return store.optimize_fts(); });
+        auto scope = instrument("optimize_fts");
+        return m_Db.execute("INSERT INTO notes_fts(notes_fts) VALUES('optimize')");
+    }
+
     stl::result<> MetadataStore::remove_fts(std::string_view note_id) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.remove_fts(note_id); });
+        auto scope = instrument("remove_fts");
         auto stmt = m_Db.prepare("DELETE FROM notes_fts WHERE note_id = ?");
         if (!stmt)
             return stl::make_error("{}", stmt.error());
@@ -513,6 +1081,9 @@ namespace sap::cloud::storage {
     }
 
     stl::result<> MetadataStore::store_token(std::string_view token, i64 expires_at) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.store_token(token, expires_at); });
+        auto scope = instrument("store_token");
         auto now = sync::now_ms() / 1000; // Seconds
         auto stmt = m_Db.prepare("INSERT INTO auth_tokens (token, created_at, expires_at) VALUES (?, ?, ?)");
         if (!stmt)
@@ -527,8 +1098,9 @@ namespace sap::cloud::storage {
     }
 
     stl::result<bool> MetadataStore::validate_token(std::string_view token) {
+        auto scope = instrument("validate_token");
         auto now = sync::now_ms() / 1000;
-        auto stmt = m_Db.prepare("SELECT 1 FROM auth_tokens WHERE token = ? AND expires_at > ?");
+        auto stmt = m_Db.prepare("SELECT last_used FROM auth_tokens WHERE token = ? AND expires_at > ?");
         if (!stmt)
             return stl::make_error<bool>("{}", stmt.error());
         stmt->bind(1, token);
@@ -538,27 +1110,63 @@ namespace sap::cloud::storage {
             return stl::make_error<bool>("{}", row.error());
         if (!row.value())
             return false;
-        // Update last_used
-        auto update = m_Db.prepare("UPDATE auth_tokens SET last_used = ? WHERE token = ?");
-        if (update) {
-            update->bind(1, now);
-            update->bind(2, token);
-            update->execute();
+        // last_used is informational: refreshed at most once a minute, and
+        // through the writer without waiting, so requests never queue behind a batch
+        auto last_used = row.value()->try_get<i64>("last_used").value_or(0);
+        if (now - last_used >= 60) {
+            auto touch = [token = std::string(token), now](MetadataStore& store) -> stl::result<> {
+                auto update = store.m_Db.prepare("UPDATE auth_tokens SET last_used = ? WHERE token = ?");
+                if (!update)
+                    return stl::make_error("{}", update.error());
+                update->bind(1, now);
+                update->bind(2, token);
+                auto r = update->execute();
+                if (!r)
+                    return stl::make_error("{}", r.error());
+                return stl::success;
+            };
+            if (m_Writer)
+                static_cast<void>(m_Writer->submit(std::move(touch)));
+            else
+                static_cast<void>(touch(*this));
         }
         return true;
     }
 
     stl::result<> MetadataStore::cleanup_expired_tokens() {
+        if (m_Writer)
+            return m_Writer->write([](MetadataStore& store) { return store.cleanup_expired_tokens(); });
+        auto scope = instrument("cleanup_expired_tokens");
         auto now = sync::now_ms() / 1000;
         auto stmt = m_Db.prepare("DELETE FROM auth_tokens WHERE expires_at < ?");
         if (!stmt)
             return stl::make_error("{}", stmt.error());
         stmt->bind(1, now);
-        stmt->execute();
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error("{}", r.error());
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::cleanup_expired_challenges() {
+        if (m_Writer)
+            return m_Writer->write([](MetadataStore& store) { return store.cleanup_expired_challenges(); });
+        auto scope = instrument("cleanup_expired_challenges");
+        auto now = sync::now_ms() / 1000;
+        auto stmt = m_Db.prepare("DELETE FROM auth_challenges WHERE expires_at < ?");
+        if (!stmt)
+            return stl::make_error("{}", stmt.error());
+        stmt->bind(1, now);
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error("{}", r.error());
         return stl::success;
     }
 
     stl::result<> MetadataStore::store_challenge(std::string_view challenge, std::string_view public_key, i64 expires_at) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.store_challenge(challenge, public_key, expires_at); });
+        auto scope = instrument("store_challenge");
         auto stmt = m_Db.prepare("INSERT INTO auth_challenges (challenge, public_key, expires_at) VALUES (?, ?, ?)");
         if (!stmt)
             return stl::make_error("{}", stmt.error());
@@ -572,10 +1180,26 @@ namespace sap::cloud::storage {
     }
 
     stl::result<bool> MetadataStore::validate_challenge(std::string_view challenge, std::string_view public_key) {
+        if (m_Writer) {
+            bool valid = false;
+            auto r = m_Writer->write([&](MetadataStore& store) -> stl::result<> {
+                auto inner = store.validate_challenge(challenge, public_key);
+                if (!inner)
+                    return stl::make_error("{}", inner.error());
+                valid = inner.value();
+                return stl::success;
+            });
+            if (!r)
+                return stl::make_error<bool>("{}", r.error());
+            return valid;
+        }
+        auto scope = instrument("validate_challenge");
         auto now = sync::now_ms() / 1000;
+        // Checked and consumed (one-time use) in one statement
         auto stmt = m_Db.prepare(R"(
-        SELECT 1 FROM auth_challenges 
+        DELETE FROM auth_challenges
         WHERE challenge = ? AND public_key = ? AND expires_at > ?
+        RETURNING 1 AS valid
     )");
         if (!stmt)
             return stl::make_error<bool>("{}", stmt.error());
@@ -585,15 +1209,252 @@ namespace sap::cloud::storage {
         auto row = stmt->fetch_one();
         if (!row)
             return stl::make_error<bool>("{}", row.error());
+        return row.value().has_value();
+    }
+
+    stl::result<> MetadataStore::create_upload(const UploadSession& session) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.create_upload(session); });
+        auto scope = instrument("create_upload");
+        auto stmt = m_Db.prepare(R"(
+        INSERT INTO upload_sessions (id, path, size, received_bytes, mtime, created_at, expires_at)
+        VALUES (?, ?, ?, ?, ?, ?, ?)
+    )");
+        if (!stmt)
+            return stl::make_error("{}", stmt.error());
+        stmt->bind(1, session.id);
+        stmt->bind(2, session.path);
+        stmt->bind(3, session.size);
+        stmt->bind(4, session.offset);
+        stmt->bind(5, session.mtime);
+        stmt->bind(6, session.created_at);
+        stmt->bind(7, session.expires_at);
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error("{}", r.error());
+        return stl::success;
+    }
+
+    stl::result<std::optional<UploadSession>> MetadataStore::get_upload(std::string_view id) {
+        auto scope = instrument("get_upload");
+        auto stmt = m_Db.prepare("SELECT id, path, size, received_bytes, mtime, created_at, expires_at "
+                                 "FROM upload_sessions WHERE id = ?");
+        if (!stmt)
+            return stl::make_error<std::optional<UploadSession>>("{}", stmt.error());
+        stmt->bind(1, id);
+        auto row = stmt->fetch_one();
+        if (!row)
+            return stl::make_error<std::optional<UploadSession>>("{}", row.error());
         if (!row.value())
-            return false;
-        // Consume the challenge (one-time use)
-        auto del = m_Db.prepare("DELETE FROM auth_challenges WHERE challenge = ?");
-        if (del) {
-            del->bind(1, challenge);
-            del->execute();
+            return std::optional<UploadSession>{};
+        UploadSession session;
+        session.id = row.value()->get<std::string>("id");
+        session.path = row.value()->get<std::string>("path");
+        session.size = row.value()->get<i64>("size");
+        session.offset = row.value()->get<i64>("received_bytes");
+        session.mtime = row.value()->get<i64>("mtime");
+        session.created_at = row.value()->get<i64>("created_at");
+        session.expires_at = row.value()->get<i64>("expires_at");
+        return {session};
+    }
+
+    stl::result<> MetadataStore::set_upload_offset(std::string_view id, i64 offset) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.set_upload_offset(id, offset); });
+        auto scope = instrument("set_upload_offset");
+        auto stmt = m_Db.prepare("UPDATE upload_sessions SET received_bytes = ? WHERE id = ?");
+        if (!stmt)
+            return stl::make_error("{}", stmt.error());
+        stmt->bind(1, offset);
+        stmt->bind(2, id);
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error("{}", r.error());
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::remove_upload(std::string_view id) {
+        if (m_Writer)
+            return m_Writer->write([&](MetadataStore& store) { return store.remove_upload(id); });
+        auto scope = instrument("remove_upload");
+        auto stmt = m_Db.prepare("DELETE FROM upload_sessions WHERE id = ?");
+        if (!stmt)
+            return stl::make_error("{}", stmt.error());
+        stmt->bind(1, id);
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error("{}", r.error());
+        return stl::success;
+    }
+
+    stl::result<> MetadataStore::commit_upload(std::string_view id, const sync::FileMetadata& meta, std::string_view fast_hash) {
+        auto scope = instrument("commit_upload");
+        return transaction([&](MetadataStore& store) -> stl::result<> {
+            auto upsert_result = store.upsert_file(meta, fast_hash);
+            if (!upsert_result)
+                return upsert_result;
+            return store.remove_upload(id);
+        });
+    }
+
+    stl::result<std::vector<std::string>> MetadataStore::get_expired_uploads(sync::Timestamp now, i64 limit) {
+        auto scope = instrument("get_expired_uploads");
+        auto stmt = m_Db.prepare("SELECT id FROM upload_sessions WHERE expires_at < ? LIMIT ?");
+        if (!stmt)
+            return stl::make_error<std::vector<std::string>>("{}", stmt.error());
+        stmt->bind(1, now);
+        stmt->bind(2, limit);
+        auto rows = stmt->fetch_all();
+        if (!rows)
+            return stl::make_error<std::vector<std::string>>("{}", rows.error());
+        std::vector<std::string> ids;
+        for (const auto& row : rows.value()) {
+            ids.push_back(row.get<std::string>("id"));
         }
-        return true;
+        return ids;
+    }
+
+    stl::result<i64> MetadataStore::compact_tombstones(sync::Timestamp cutoff, i64 limit) {
+        auto scope = instrument("compact_tombstones");
+        // Each batch is selected the same way by every statement below; the
+        // transaction keeps the selection stable between them
+        constexpr const char* file_batch = "SELECT id FROM files WHERE is_deleted = 1 AND updated_at < ? ORDER BY updated_at LIMIT ?";
+        constexpr const char* note_batch = "SELECT id FROM notes WHERE is_deleted = 1 AND updated_at < ? ORDER BY updated_at LIMIT ?";
+        const std::string statements[] = {
+            std::string("SELECT COUNT(*) AS n FROM (") + file_batch + ")",
+            std::string("DELETE FROM files WHERE id IN (") + file_batch + ")",
+            std::string("SELECT COUNT(*) AS n FROM (") + note_batch + ")",
+            std::string("DELETE FROM note_tags WHERE note_id IN (") + note_batch + ")",
+            std::string("DELETE FROM notes_fts WHERE note_id IN (") + note_batch + ")",
+            std::string("DELETE FROM notes WHERE id IN (") + note_batch + ")",
+        };
+        // Runs as one write intent, so it takes its turn with the writer's
+        // batches instead of holding the write lock on this shared connection
+        bool report_files = tracks_files();
+        i64 removed = 0;
+        auto r = transaction([&](MetadataStore& store) -> stl::result<> {
+            // Paths of the file batch, reported gone once the batch commits
+            if (report_files) {
+                auto stmt = store.m_Db.prepare(std::string("SELECT path FROM files WHERE id IN (") + file_batch + ")");
+                if (!stmt)
+                    return stl::make_error("{}", stmt.error());
+                stmt->bind(1, cutoff);
+                stmt->bind(2, limit);
+                auto rows = stmt->fetch_all();
+                if (!rows)
+                    return stl::make_error("{}", rows.error());
+                for (const auto& row : rows.value()) {
+                    store.file_changed({row.get<std::string>("path")});
+                }
+            }
+            for (const auto& sql : statements) {
+                auto stmt = store.m_Db.prepare(sql);
+                if (!stmt)
+                    return stl::make_error("{}", stmt.error());
+                stmt->bind(1, cutoff);
+                stmt->bind(2, limit);
+                if (sql.starts_with("SELECT")) {
+                    auto row = stmt->fetch_one();
+                    if (!row)
+                        return stl::make_error("{}", row.error());
+                    removed += row.value() ? row.value()->get<i64>("n") : 0;
+                    continue;
+                }
+                auto executed = stmt->execute();
+                if (!executed)
+                    return executed;
+            }
+            return stl::success;
+        });
+        if (!r)
+            return stl::make_error<i64>("{}", r.error());
+        return removed;
+    }
+
+    stl::result<> MetadataStore::optimize() {
+        auto scope = instrument("optimize");
+        return m_Db.execute("PRAGMA optimize");
+    }
+
+    stl::result<> MetadataStore::checkpoint() {
+        auto scope = instrument("checkpoint");
+        auto rows = m_Db.query("PRAGMA wal_checkpoint(PASSIVE)");
+        if (!rows)
+            return stl::make_error("{}", rows.error());
+        return stl::success;
+    }
+
+    stl::result<bool> MetadataStore::merge_fts(i64 pages) {
+        if (m_Writer) {
+            bool merged = false;
+            auto r = m_Writer->write([&](MetadataStore& store) -> stl::result<> {
+                auto inner = store.merge_fts(pages);
+                if (!inner)
+                    return stl::make_error("{}", inner.error());
+                merged = inner.value();
+                return stl::success;
+            });
+            if (!r)
+                return stl::make_error<bool>("{}", r.error());
+            return merged;
+        }
+        auto scope = instrument("merge_fts");
+        // The change count is per connection: exact on the writer's, which runs
+        // one intent at a time, and a hint on a connection shared with others
+        auto changes = m_Db.prepare("SELECT total_changes() AS n");
+        if (!changes)
+            return stl::make_error<bool>("{}", changes.error());
+        auto before = changes->fetch_one();
+        if (!before || !before.value())
+            return stl::make_error<bool>("Failed to read change count");
+        auto stmt = m_Db.prepare("INSERT INTO notes_fts(notes_fts, rank) VALUES('merge', ?)");
+        if (!stmt)
+            return stl::make_error<bool>("{}", stmt.error());
+        stmt->bind(1, pages);
+        auto r = stmt->execute();
+        if (!r)
+            return stl::make_error<bool>("{}", r.error());
+        auto after = changes->fetch_one();
+        if (!after || !after.value())
+            return stl::make_error<bool>("Failed to read change count");
+        // FTS5 reports fewer than two changed rows when there was nothing to merge
+        return after.value()->get<i64>("n") - before.value()->get<i64>("n") >= 2;
+    }
+
+    stl::result<i64> MetadataStore::incremental_vacuum(i64 pages) {
+        if (m_Writer) {
+            i64 remaining = 0;
+            auto r = m_Writer->write([&](MetadataStore& store) -> stl::result<> {
+                auto inner = store.incremental_vacuum(pages);
+                if (!inner)
+                    return stl::make_error("{}", inner.error());
+                remaining = inner.value();
+                return stl::success;
+            });
+            if (!r)
+                return stl::make_error<i64>("{}", r.error());
+            return remaining;
+        }
+        auto scope = instrument("incremental_vacuum");
+        auto mode = m_Db.prepare("PRAGMA auto_vacuum");
+        if (!mode)
+            return stl::make_error<i64>("{}", mode.error());
+        auto mode_row = mode->fetch_one();
+        if (!mode_row)
+            return stl::make_error<i64>("{}", mode_row.error());
+        // 2 = INCREMENTAL; in other modes free pages are only reclaimed by a full VACUUM
+        if (!mode_row.value() || mode_row.value()->get<i64>("auto_vacuum") != 2)
+            return 0;
+        auto vacuum = m_Db.execute("PRAGMA incremental_vacuum(" + std::to_string(pages) + ")");
+        if (!vacuum)
+            return stl::make_error<i64>("{}", vacuum.error());
+        auto freelist = m_Db.prepare("PRAGMA freelist_count");
+        if (!freelist)
+            return stl::make_error<i64>("{}", freelist.error());
+        auto row = freelist->fetch_one();
+        if (!row)
+            return stl::make_error<i64>("{}", row.error());
+        return row.value() ? row.value()->get<i64>("freelist_count") : 0;
     }
 
 } // namespace sap::cloud::storage
@@ -0,0 +1,150 @@
+#include <sap_cloud/metadata_writer.h>
+#include <algorithm>
+#include <exception>
+#include <sap_cloud/metadata.h>
+#include <sap_cloud/metrics.h>
+#include <sap_cloud/trace.h>
+
+namespace sap::cloud::storage {
+
+    namespace {
+        struct WriterMetrics {
+            metrics::Histogram commit;
+            metrics::Counter batches;
+            metrics::Counter writes;
+        };
+
+        const WriterMetrics& writer_metrics() {
+            static const WriterMetrics m{
+                metrics::registry().histogram("sap_sqlite_duration_seconds", "MetadataStore call latency", {{"op", "group_commit"}}),
+                metrics::registry().counter("sap_sqlite_group_commits_total", "Write batches committed by the metadata writer"),
+                metrics::registry().counter("sap_sqlite_group_commit_writes_total", "Writes committed by the metadata writer"),
+            };
+            return m;
+        }
+    } // namespace
+
+    stl::result<std::unique_ptr<MetadataWriter>> MetadataWriter::start(const std::filesystem::path& db_path, EDurability durability,
+                                                                       const WriterOptions& options) {
+        auto store = MetadataStore::open(db_path, durability);
+        if (!store) {
+            return stl::make_error<std::unique_ptr<MetadataWriter>>("{}", store.error());
+        }
+        auto writer = std::unique_ptr<MetadataWriter>(new MetadataWriter(std::make_unique<MetadataStore>(std::move(store.value())), options));
+        writer->m_Thread = std::thread([w = writer.get()] { w->run(); });
+        return writer;
+    }
+
+    MetadataWriter::MetadataWriter(std::unique_ptr<MetadataStore> store, const WriterOptions& options) :
+        m_Store(std::move(store)), m_Options(options) {
+        m_Options.max_batch = std::max<size_t>(m_Options.max_batch, 1);
+    }
+
+    MetadataWriter::~MetadataWriter() {
+        if (m_Thread.joinable()) {
+            m_Stopping = true;
+            m_Pending.release();
+            m_Thread.join();
+        }
+    }
+
+    std::future<stl::result<>> MetadataWriter::submit(Intent intent) {
+        auto* node = new Node{std::move(intent), {}, nullptr};
+        auto future = node->done.get_future();
+        node->next = m_Head.load(std::memory_order_relaxed);
+        while (!m_Head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        m_Pending.release();
+        return future;
+    }
+
+    void MetadataWriter::run() {
+        std::vector<Node*> batch;
+        batch.reserve(m_Options.max_batch);
+        while (true) {
+            take(batch);
+            if (batch.empty()) {
+                // Checked before waiting: the destructor sets the flag before its release
+                if (m_Stopping) {
+                    return;
+                }
+                m_Pending.acquire();
+                continue;
+            }
+            auto deadline = std::chrono::steady_clock::now() + m_Options.window;
+            while (batch.size() < m_Options.max_batch && !m_Stopping && m_Pending.try_acquire_until(deadline)) {
+                take(batch);
+            }
+            commit(batch);
+        }
+    }
+
+    void MetadataWriter::take(std::vector<Node*>& batch) {
+        // The stack holds the newest intent first; reverse it into arrival order
+        Node* newest = m_Head.exchange(nullptr, std::memory_order_acquire);
+        Node* oldest = nullptr;
+        while (newest) {
+            Node* next = newest->next;
+            newest->next = oldest;
+            oldest = newest;
+            newest = next;
+        }
+        for (Node* node = oldest; node; node = node->next) {
+            m_Backlog.push_back(node);
+        }
+        while (batch.size() < m_Options.max_batch && !m_Backlog.empty()) {
+            batch.push_back(m_Backlog.front());
+            m_Backlog.pop_front();
+        }
+    }
+
+    void MetadataWriter::commit(std::vector<Node*>& batch) {
+        const auto& metrics = writer_metrics();
+        metrics::ScopedTimer timer(metrics.commit);
+        trace::Span span("MetadataWriter::commit");
+        auto& db = m_Store->database();
+        std::vector<stl::result<>> results;
+        results.reserve(batch.size());
+        auto begin = db.execute("BEGIN IMMEDIATE");
+        for (Node* node : batch) {
+            if (!begin) {
+                results.push_back(begin);
+                continue;
+            }
+            // A failed intent is undone on its own; the rest of the batch still commits
+            auto savepoint = db.execute("SAVEPOINT write_intent");
+            if (!savepoint) {
+                results.push_back(savepoint);
+                continue;
+            }
+            stl::result<> r = stl::success;
+            try {
+                r = node->intent(*m_Store);
+            } catch (const std::exception& e) {
+                r = stl::make_error("{}", e.what());
+            }
+            if (!r) {
+                db.execute("ROLLBACK TO write_intent");
+            }
+            db.execute("RELEASE write_intent");
+            results.push_back(std::move(r));
+        }
+        if (begin) {
+            auto commit = db.execute("COMMIT");
+            if (!commit) {
+                db.execute("ROLLBACK");
+                for (auto& r : results) {
+                    r = stl::make_error("Commit failed: {}", commit.error());
+                }
+            }
+        }
+        metrics.batches.inc();
+        metrics.writes.inc(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            batch[i]->done.set_value(std::move(results[i]));
+            delete batch[i];
+        }
+        batch.clear();
+    }
+
+} // namespace sap::cloud::storage
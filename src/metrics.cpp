@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <map>
+#include <mutex>
+#include <sap_cloud/metrics.h>
+#include <sap_core/log.h>
+#include <sstream>
+
+namespace sap::cloud::metrics {
+
+    namespace {
+        constexpr u32 sub_bits = 3;
+        constexpr u32 sub_count = 1u << sub_bits;
+        constexpr u32 max_exponent = 34; // 2^34us ~ 4.8h
+        constexpr u32 bucket_count = (max_exponent - sub_bits + 2) * sub_count;
+
+        u32 bucket_index(u64 micros) {
+            if (micros < sub_count) {
+                return static_cast<u32>(micros);
+            }
+            u32 exponent = 63u - static_cast<u32>(std::countl_zero(micros));
+            u32 index = (exponent - sub_bits + 1) * sub_count + static_cast<u32>((micros >> (exponent - sub_bits)) & (sub_count - 1));
+            return std::min(index, bucket_count - 1);
+        }
+
+        // Exclusive upper bound of a bucket in microseconds
+        u64 bucket_upper(u32 index) {
+            if (index < sub_count) {
+                return index + 1;
+            }
+            u32 group = index / sub_count;
+            u32 sub = index % sub_count;
+            u32 shift = group - 1;
+            return (static_cast<u64>(sub_count + sub) << shift) + (1ull << shift);
+        }
+
+        // Single-writer cell: only the owning thread stores, readers load
+        struct Cell {
+            std::atomic<u64> v{0};
+            void add(u64 n) { v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+            [[nodiscard]] u64 get() const { return v.load(std::memory_order_relaxed); }
+        };
+
+        struct HistogramCells {
+            std::array<Cell, bucket_count> buckets;
+            Cell count;
+            Cell sum;
+        };
+
+        struct Shard {
+            std::array<Cell, Registry::max_counters> counters;
+            // Allocated by the owning thread on first record, published with release
+            std::array<std::atomic<HistogramCells*>, Registry::max_histograms> histograms{};
+
+            Shard() = default;
+            Shard(const Shard&) = delete;
+            Shard& operator=(const Shard&) = delete;
+
+            ~Shard() {
+                for (auto& cells : histograms) {
+                    delete cells.load(std::memory_order_relaxed);
+                }
+            }
+
+            // Owner thread only
+            HistogramCells& writable(u32 index) {
+                HistogramCells* cells = histograms[index].load(std::memory_order_relaxed);
+                if (!cells) {
+                    cells = new HistogramCells();
+                    histograms[index].store(cells, std::memory_order_release);
+                }
+                return *cells;
+            }
+
+            [[nodiscard]] const HistogramCells* readable(u32 index) const { return histograms[index].load(std::memory_order_acquire); }
+        };
+
+        struct MetricInfo {
+            std::string name;
+            std::string help;
+            Labels labels;
+        };
+
+        std::string format_labels(const Labels& labels, std::string_view extra_key = {}, std::string_view extra_value = {}) {
+            if (labels.empty() && extra_key.empty()) {
+                return {};
+            }
+            std::string out = "{";
+            bool first = true;
+            auto append = [&](std::string_view key, std::string_view value) {
+                if (!first) {
+                    out += ',';
+                }
+                first = false;
+                out += key;
+                out += "=\"";
+                for (char c : value) {
+                    if (c == '"' || c == '\\') {
+                        out += '\\';
+                        out += c;
+                    } else if (c == '\n') {
+                        out += "\\n";
+                    } else {
+                        out += c;
+                    }
+                }
+                out += '"';
+            };
+            for (const auto& [key, value] : labels) {
+                append(key, value);
+            }
+            if (!extra_key.empty()) {
+                append(extra_key, extra_value);
+            }
+            out += '}';
+            return out;
+        }
+    } // namespace
+
+    struct Registry::Impl {
+        mutable std::mutex mutex;
+        std::vector<MetricInfo> counters;
+        std::vector<MetricInfo> histograms;
+        std::map<std::string, u32> counter_index; // name + labels -> index
+        std::map<std::string, u32> histogram_index;
+        std::vector<Shard*> shards; // Live thread shards
+        std::unique_ptr<Shard> retired = std::make_unique<Shard>(); // Totals of exited threads
+
+        void fold(const Shard& shard) {
+            for (u32 i = 0; i < max_counters; ++i) {
+                retired->counters[i].add(shard.counters[i].get());
+            }
+            for (u32 h = 0; h < max_histograms; ++h) {
+                const HistogramCells* cells = shard.readable(h);
+                if (!cells) {
+                    continue;
+                }
+                const auto& src = *cells;
+                auto& dst = retired->writable(h);
+                for (u32 b = 0; b < bucket_count; ++b) {
+                    dst.buckets[b].add(src.buckets[b].get());
+                }
+                dst.count.add(src.count.get());
+                dst.sum.add(src.sum.get());
+            }
+        }
+    };
+
+    namespace {
+        // Registers the calling thread's shard on first use and folds it into
+        // the retired totals when the thread exits
+        struct LocalShard {
+            std::unique_ptr<Shard> shard = std::make_unique<Shard>();
+            Registry::Impl& impl;
+
+            explicit LocalShard(Registry::Impl& owner) : impl(owner) {
+                std::lock_guard<std::mutex> lock(impl.mutex);
+                impl.shards.push_back(shard.get());
+            }
+
+            ~LocalShard() {
+                std::lock_guard<std::mutex> lock(impl.mutex);
+                impl.fold(*shard);
+                std::erase(impl.shards, shard.get());
+            }
+        };
+    } // namespace
+
+    Registry::Registry() : m_Impl(std::make_unique<Impl>()) {}
+
+    Registry::~Registry() = default;
+
+    Registry& registry() {
+        static Registry instance;
+        return instance;
+    }
+
+    namespace {
+        Shard& local_shard(Registry::Impl& impl) {
+            thread_local LocalShard local(impl);
+            return *local.shard;
+        }
+
+        std::string metric_key(std::string_view name, const Labels& labels) { return std::string(name) + format_labels(labels); }
+    } // namespace
+
+    Counter Registry::counter(std::string_view name, std::string_view help, Labels labels) {
+        std::lock_guard<std::mutex> lock(m_Impl->mutex);
+        auto key = metric_key(name, labels);
+        if (auto it = m_Impl->counter_index.find(key); it != m_Impl->counter_index.end()) {
+            return Counter(it->second);
+        }
+        if (m_Impl->counters.size() >= max_counters) {
+            log::warn("Metrics counter capacity exceeded, dropping {}", key);
+            return Counter();
+        }
+        auto index = static_cast<u32>(m_Impl->counters.size());
+        m_Impl->counters.push_back({std::string(name), std::string(help), std::move(labels)});
+        m_Impl->counter_index.emplace(std::move(key), index);
+        return Counter(index);
+    }
+
+    Histogram Registry::histogram(std::string_view name, std::string_view help, Labels labels) {
+        std::lock_guard<std::mutex> lock(m_Impl->mutex);
+        auto key = metric_key(name, labels);
+        if (auto it = m_Impl->histogram_index.find(key); it != m_Impl->histogram_index.end()) {
+            return Histogram(it->second);
+        }
+        if (m_Impl->histograms.size() >= max_histograms) {
+            log::warn("Metrics histogram capacity exceeded, dropping {}", key);
+            return Histogram();
+        }
+        auto index = static_cast<u32>(m_Impl->histograms.size());
+        m_Impl->histograms.push_back({std::string(name), std::string(help), std::move(labels)});
+        m_Impl->histogram_index.emplace(std::move(key), index);
+        return Histogram(index);
+    }
+
+    void Counter::inc(u64 n) const {
+        if (m_Index == invalid_index) {
+            return;
+        }
+        local_shard(*registry().m_Impl).counters[m_Index].add(n);
+    }
+
+    void Histogram::record(u64 micros) const {
+        if (m_Index == invalid_index) {
+            return;
+        }
+        auto& cells = local_shard(*registry().m_Impl).writable(m_Index);
+        cells.buckets[bucket_index(micros)].add(1);
+        cells.count.add(1);
+        cells.sum.add(micros);
+    }
+
+    u64 Registry::value(const Counter& counter) const {
+        if (counter.m_Index == invalid_index) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(m_Impl->mutex);
+        u64 total = m_Impl->retired->counters[counter.m_Index].get();
+        for (const Shard* shard : m_Impl->shards) {
+            total += shard->counters[counter.m_Index].get();
+        }
+        return total;
+    }
+
+    Quantiles Registry::quantiles(const Histogram& histogram) const {
+        Quantiles q;
+        if (histogram.m_Index == invalid_index) {
+            return q;
+        }
+        std::array<u64, bucket_count> buckets{};
+        {
+            std::lock_guard<std::mutex> lock(m_Impl->mutex);
+            auto accumulate = [&](const Shard& shard) {
+                const HistogramCells* cells = shard.readable(histogram.m_Index);
+                if (!cells) {
+                    return;
+                }
+                for (u32 b = 0; b < bucket_count; ++b) {
+                    buckets[b] += cells->buckets[b].get();
+                }
+                q.sum_micros += cells->sum.get();
+            };
+            accumulate(*m_Impl->retired);
+            for (const Shard* shard : m_Impl->shards) {
+                accumulate(*shard);
+            }
+        }
+        // Count from buckets so quantiles are consistent with each other
+        for (u64 n : buckets) {
+            q.count += n;
+        }
+        if (q.count == 0) {
+            return q;
+        }
+        auto at_rank = [&](double quantile) {
+            auto rank = static_cast<u64>(quantile * static_cast<double>(q.count - 1)) + 1;
+            u64 seen = 0;
+            for (u32 b = 0; b < bucket_count; ++b) {
+                seen += buckets[b];
+                if (seen >= rank) {
+                    return bucket_upper(b);
+                }
+            }
+            return bucket_upper(bucket_count - 1);
+        };
+        q.p50 = at_rank(0.5);
+        q.p99 = at_rank(0.99);
+        q.p999 = at_rank(0.999);
+        return q;
+    }
+
+    const FsMetrics& fs() {
+        static const FsMetrics instance{
+            registry().histogram("sap_fs_duration_seconds", "Filesystem operation latency", {{"op", "read"}}),
+            registry().histogram("sap_fs_duration_seconds", "Filesystem operation latency", {{"op", "write"}}),
+            registry().counter("sap_fs_bytes_total", "Bytes read from or written to storage", {{"op", "read"}}),
+            registry().counter("sap_fs_bytes_total", "Bytes read from or written to storage", {{"op", "write"}}),
+        };
+        return instance;
+    }
+
+    std::string Registry::render() const {
+        std::vector<MetricInfo> counters;
+        std::vector<MetricInfo> histograms;
+        {
+            std::lock_guard<std::mutex> lock(m_Impl->mutex);
+            counters = m_Impl->counters;
+            histograms = m_Impl->histograms;
+        }
+        // Group series of the same metric family under one HELP/TYPE header
+        auto by_name = [](const std::vector<MetricInfo>& infos) {
+            std::vector<u32> order(infos.size());
+            for (u32 i = 0; i < order.size(); ++i) {
+                order[i] = i;
+            }
+            std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) { return infos[a].name < infos[b].name; });
+            return order;
+        };
+        std::ostringstream out;
+        std::string last_name;
+        for (u32 i : by_name(counters)) {
+            const auto& info = counters[i];
+            if (info.name != last_name) {
+                out << "# HELP " << info.name << ' ' << info.help << '\n';
+                out << "# TYPE " << info.name << " counter\n";
+                last_name = info.name;
+            }
+            out << info.name << format_labels(info.labels) << ' ' << value(Counter(i)) << '\n';
+        }
+        last_name.clear();
+        for (u32 i : by_name(histograms)) {
+            const auto& info = histograms[i];
+            if (info.name != last_name) {
+                out << "# HELP " << info.name << ' ' << info.help << '\n';
+                out << "# TYPE " << info.name << " summary\n";
+                last_name = info.name;
+            }
+            auto q = quantiles(Histogram(i));
+            auto seconds = [](u64 micros) { return static_cast<double>(micros) / 1e6; };
+            out << info.name << format_labels(info.labels, "quantile", "0.5") << ' ' << seconds(q.p50) << '\n';
+            out << info.name << format_labels(info.labels, "quantile", "0.99") << ' ' << seconds(q.p99) << '\n';
+            out << info.name << format_labels(info.labels, "quantile", "0.999") << ' ' << seconds(q.p999) << '\n';
+            out << info.name << "_sum" << format_labels(info.labels) << ' ' << seconds(q.sum_micros) << '\n';
+            out << info.name << "_count" << format_labels(info.labels) << ' ' << q.count << '\n';
+        }
+        return out.str();
+    }
+
+} // namespace sap::cloud::metrics
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cassert>
+#include <sap_cloud/router.h>
+
+namespace sap::cloud {
+
+    std::string_view RouteParams::get(std::string_view name) const {
+        for (size_t i = 0; i < m_Count; ++i) {
+            if (m_Params[i].first == name) {
+                return m_Params[i].second;
+            }
+        }
+        return {};
+    }
+
+    void RouteParams::push(std::string_view name, std::string_view value) {
+        assert(m_Count < max_params);
+        m_Params[m_Count++] = {name, value};
+    }
+
+    struct Router::Node {
+        std::string segment; // Literal segment (empty for root)
+        std::vector<std::unique_ptr<Node>> children; // Literal children
+        std::unique_ptr<Node> param_child; // {name}
+        std::string param_name;
+        std::unique_ptr<Node> wildcard_child; // {name*}
+        std::string wildcard_name;
+        std::vector<const Route*> routes; // Routes terminating here, one per method
+    };
+
+    namespace {
+        // Split off the first segment of a path (without leading '/')
+        std::pair<std::string_view, std::string_view> next_segment(std::string_view path) {
+            auto slash = path.find('/');
+            if (slash == std::string_view::npos) {
+                return {path, {}};
+            }
+            return {path.substr(0, slash), path.substr(slash + 1)};
+        }
+
+        std::string_view trim_slashes(std::string_view path) {
+            while (!path.empty() && path.front() == '/') {
+                path.remove_prefix(1);
+            }
+            while (!path.empty() && path.back() == '/') {
+                path.remove_suffix(1);
+            }
+            return path;
+        }
+    } // namespace
+
+    Router::Router() : m_Root(std::make_unique<Node>()) {}
+
+    Router::~Router() = default;
+
+    void Router::add(http::EMethod method, std::string_view pattern, RouteHandler handler, RouteOptions options) {
+        auto route = std::make_unique<Route>(Route{m_Routes.size(), method, std::string(pattern), std::move(handler), options});
+        Node* node = m_Root.get();
+        std::string_view rest = trim_slashes(pattern);
+        size_t captures = 0;
+        while (!rest.empty()) {
+            auto [segment, tail] = next_segment(rest);
+            rest = tail;
+            if (segment.size() > 2 && segment.front() == '{' && segment.back() == '}') {
+                std::string_view name = segment.substr(1, segment.size() - 2);
+                ++captures;
+                if (name.back() == '*') {
+                    assert(rest.empty() && "remainder capture must be the last segment");
+                    if (!node->wildcard_child) {
+                        node->wildcard_child = std::make_unique<Node>();
+                        node->wildcard_name = std::string(name.substr(0, name.size() - 1));
+                    }
+                    assert(node->wildcard_name == name.substr(0, name.size() - 1) && "conflicting capture names");
+                    node = node->wildcard_child.get();
+                } else {
+                    if (!node->param_child) {
+                        node->param_child = std::make_unique<Node>();
+                        node->param_name = std::string(name);
+                    }
+                    assert(node->param_name == name && "conflicting capture names");
+                    node = node->param_child.get();
+                }
+                continue;
+            }
+            auto it = std::find_if(node->children.begin(), node->children.end(), [&](const auto& c) { return c->segment == segment; });
+            if (it == node->children.end()) {
+                node->children.push_back(std::make_unique<Node>());
+                node->children.back()->segment = std::string(segment);
+                it = std::prev(node->children.end());
+            }
+            node = it->get();
+        }
+        assert(captures <= RouteParams::max_params);
+        (void)captures;
+        assert(std::none_of(node->routes.begin(), node->routes.end(), [&](const Route* r) { return r->method == method; }) &&
+               "duplicate route");
+        node->routes.push_back(route.get());
+        if (std::find(m_Methods.begin(), m_Methods.end(), method) == m_Methods.end()) {
+            m_Methods.push_back(method);
+        }
+        m_Routes.push_back(std::move(route));
+    }
+
+    namespace {
+        template <typename Node>
+        bool serves(const Node& node, std::optional<http::EMethod> method) {
+            if (!method) {
+                return !node.routes.empty();
+            }
+            return std::any_of(node.routes.begin(), node.routes.end(), [&](const Route* route) { return route->method == *method; });
+        }
+    } // namespace
+
+    const Router::Node* Router::find(const Node& node, std::string_view rest, RouteParams& params, std::optional<http::EMethod> method) {
+        if (rest.empty()) {
+            return serves(node, method) ? &node : nullptr;
+        }
+        auto [segment, tail] = next_segment(rest);
+        for (const auto& child : node.children) {
+            if (child->segment == segment) {
+                if (const Node* found = find(*child, tail, params, method)) {
+                    return found;
+                }
+                break;
+            }
+        }
+        if (node.param_child && !segment.empty()) {
+            params.push(node.param_name, segment);
+            if (const Node* found = find(*node.param_child, tail, params, method)) {
+                return found;
+            }
+            params.pop();
+        }
+        if (node.wildcard_child && serves(*node.wildcard_child, method)) {
+            params.push(node.wildcard_name, rest);
+            return node.wildcard_child.get();
+        }
+        return nullptr;
+    }
+
+    RouteMatch Router::match(http::EMethod method, std::string_view path) const {
+        RouteMatch result;
+        // Ignore query string if the caller passed the raw target
+        auto query = path.find('?');
+        if (query != std::string_view::npos) {
+            path = path.substr(0, query);
+        }
+        path = trim_slashes(path);
+        const Node* node = find(*m_Root, path, result.params, method);
+        if (!node) {
+            // Only a miss pays for the second walk, to tell 405 from 404
+            RouteParams params;
+            result.path_matched = find(*m_Root, path, params, std::nullopt) != nullptr;
+            return result;
+        }
+        result.path_matched = true;
+        for (const Route* route : node->routes) {
+            if (route->method == method) {
+                result.route = route;
+                break;
+            }
+        }
+        return result;
+    }
+
+    std::string_view query_param(std::string_view query, std::string_view name) {
+        if (!query.empty() && query.front() == '?') {
+            query.remove_prefix(1);
+        }
+        while (!query.empty()) {
+            auto amp = query.find('&');
+            std::string_view pair = query.substr(0, amp);
+            auto eq = pair.find('=');
+            if (pair.substr(0, eq) == name) {
+                return eq == std::string_view::npos ? std::string_view{} : pair.substr(eq + 1);
+            }
+            if (amp == std::string_view::npos) {
+                break;
+            }
+            query.remove_prefix(amp + 1);
+        }
+        return {};
+    }
+
+} // namespace sap::cloud
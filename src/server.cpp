@@ -1,8 +1,105 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <sap_cloud/binary_codec.h>
+#include <sap_cloud/json_reader.h>
+#include <sap_cloud/json_writer.h>
 #include <sap_cloud/server.h>
+#include <sap_cloud/trace.h>
 #include <sap_core/log.h>
 
 namespace sap::cloud {
 
+    namespace {
+        // Scratch buffers larger than this are released after use
+        constexpr size_t max_retained_json_buffer = 16 * 1024 * 1024;
+
+        const metrics::Histogram& json_serialize_histogram() {
+            static const auto histogram = metrics::registry().histogram("sap_json_serialize_duration_seconds", "Response serialization time");
+            return histogram;
+        }
+
+        const metrics::Histogram& binary_serialize_histogram() {
+            static const auto histogram =
+                metrics::registry().histogram("sap_binary_serialize_duration_seconds", "Binary sync response serialization time");
+            return histogram;
+        }
+
+        struct HttpMetrics {
+            metrics::Counter bytes_in;
+            metrics::Counter bytes_out;
+            std::array<metrics::Counter, 5> responses; // By status class 1xx..5xx
+        };
+
+        const HttpMetrics& http_metrics() {
+            static const HttpMetrics instance = [] {
+                auto& reg = metrics::registry();
+                HttpMetrics m;
+                m.bytes_in = reg.counter("sap_http_request_bytes_total", "Request body bytes received");
+                m.bytes_out = reg.counter("sap_http_response_bytes_total", "Response body bytes sent");
+                for (size_t i = 0; i < m.responses.size(); ++i) {
+                    m.responses[i] = reg.counter("sap_http_responses_total", "Responses by status class",
+                                                 {{"class", std::to_string(i + 1) + "xx"}});
+                }
+                return m;
+            }();
+            return instance;
+        }
+
+        std::string_view method_name(http::EMethod method) {
+            switch (method) {
+                case http::EMethod::GET:
+                    return "GET";
+                case http::EMethod::POST:
+                    return "POST";
+                case http::EMethod::PUT:
+                    return "PUT";
+                case http::EMethod::DELETE:
+                    return "DELETE";
+                default:
+                    return "OTHER";
+            }
+        }
+
+        template <typename T>
+        http::Response write_json_response(i32 status, const T& body) {
+            // Serialize into a per-thread buffer that keeps its capacity across requests
+            thread_local std::string buffer;
+            {
+                trace::Span span("serialize");
+                metrics::timed(json_serialize_histogram(), [&] { json::serialize(body, buffer); });
+            }
+            http::Response resp(status, buffer);
+            resp.headers.set("Content-Type", "application/json");
+            if (buffer.capacity() > max_retained_json_buffer) {
+                std::string().swap(buffer);
+            }
+            return resp;
+        }
+
+        template <typename T>
+        http::Response write_binary_response(i32 status, const T& body) {
+            thread_local std::string buffer;
+            {
+                trace::Span span("serialize");
+                metrics::timed(binary_serialize_histogram(), [&] { binary::encode(body, buffer); });
+            }
+            http::Response resp(status, buffer);
+            resp.headers.set("Content-Type", std::string(binary::media_type));
+            if (buffer.capacity() > max_retained_json_buffer) {
+                std::string().swap(buffer);
+            }
+            return resp;
+        }
+
+        template <typename T>
+        http::Response negotiate_sync_response(const http::Request& req, i32 status, const T& body) {
+            auto resp = binary::accepts(req.headers.get("Accept")) ? write_binary_response(status, body) : write_json_response(status, body);
+            resp.headers.set("Vary", "Accept");
+            return resp;
+        }
+    } // namespace
+
     Server::Server(const Config& config) : m_Config(config), m_HttpServer({-1, config.server.host, config.server.port, config.server.multithreaded}) {}
 
     stl::result<std::unique_ptr<Server>> Server::create(const Config& config) {
@@ -19,22 +116,68 @@ namespace sap::cloud {
         if (!dirs_result) {
             return dirs_result;
         }
-        auto meta_result = storage::MetadataStore::open(m_Config.storage.database);
+        auto io_config = io_options(m_Config.storage);
+        if (!io_config) {
+            return stl::make_error("{}", io_config.error());
+        }
+        auto meta_result = storage::MetadataStore::open(m_Config.storage.database, io_config.value().durability);
         if (!meta_result) {
             return stl::make_error("Failed to open database: {}", meta_result.error());
         }
         m_Meta = std::make_unique<storage::MetadataStore>(std::move(meta_result.value()));
+        if (m_Config.storage.group_commit) {
+            storage::WriterOptions writer_options;
+            writer_options.max_batch = static_cast<size_t>(std::max<i64>(m_Config.storage.group_commit_batch, 1));
+            writer_options.window = std::chrono::microseconds(std::max<i64>(m_Config.storage.group_commit_window_us, 0));
+            auto writer_result = m_Meta->start_writer(writer_options);
+            if (!writer_result) {
+                return writer_result;
+            }
+        }
+        if (m_Config.storage.file_index) {
+            auto index_result = m_Meta->enable_file_index(m_Config.storage.file_index_verify);
+            if (!index_result) {
+                return index_result;
+            }
+        }
+        if (m_Config.storage.merkle_tree) {
+            m_Tree = std::make_unique<MerkleTree>();
+            auto tree_result = m_Meta->add_file_observer(m_Tree.get());
+            if (!tree_result) {
+                return tree_result;
+            }
+        }
+        auto io_result = IoEngine::create(io_config.value());
+        if (!io_result) {
+            return stl::make_error("Failed to start file I/O engine: {}", io_result.error());
+        }
+        m_Io = std::move(io_result.value());
+        log::info("File I/O backend: {}, durability: {}", m_Io->backend(), m_Config.storage.durability);
         m_FilesFs = std::make_unique<fs::Filesystem>(m_Config.storage.files_root);
         m_NotesFs = std::make_unique<fs::Filesystem>(m_Config.storage.notes_root);
-        m_FileSvc = std::make_unique<services::FileService>(*m_FilesFs, *m_Meta);
-        m_NoteSvc = std::make_unique<services::NoteService>(*m_NotesFs, *m_Meta);
+        ContentCacheOptions cache_options;
+        cache_options.capacity_bytes = static_cast<size_t>(std::max<i64>(m_Config.storage.cache_mb, 0)) * 1024 * 1024;
+        cache_options.max_entry_bytes = static_cast<size_t>(std::max<i64>(m_Config.storage.cache_max_entry_kb, 0)) * 1024;
+        m_Cache = std::make_unique<ContentCache>(cache_options);
+        m_FileSvc = std::make_unique<services::FileService>(*m_FilesFs, *m_Meta, *m_Io, m_Config.storage.files_root, m_Cache.get());
+        m_NoteSvc = std::make_unique<services::NoteService>(*m_NotesFs, *m_Meta, *m_Io, m_Config.storage.notes_root, m_Cache.get());
         m_SyncSvc = std::make_unique<services::SyncService>(*m_FileSvc, *m_NoteSvc);
+        m_UploadSvc =
+            std::make_unique<services::UploadService>(*m_FilesFs, *m_Meta, *m_Io, m_Config.storage.files_root, m_Config.storage.upload_session_expiry);
         m_Auth = std::make_unique<auth::AuthManager>(*m_Meta, m_Config.auth);
+        trace::set_slow_threshold(std::chrono::milliseconds(m_Config.logging.slow_request_ms));
         auto auth_result = m_Auth->load_authorized_keys();
         if (!auth_result) {
             log::warn("Failed to load authorized keys: {}", auth_result.error());
         }
+        if (m_Config.auth.watch_authorized_keys) {
+            watch_authorized_keys();
+        }
         setup_routes();
+        // Watch before the startup scan so nothing changed during it is missed
+        if (m_Config.storage.watch) {
+            watch_storage();
+        }
         auto file_scan_res = m_FileSvc->scan_and_index();
         if (!file_scan_res) {
             return stl::make_error("{}", file_scan_res.error());
@@ -43,6 +186,10 @@ namespace sap::cloud {
         if (!note_scan_res) {
             return stl::make_error("{}", note_scan_res.error());
         }
+        // Fast durability relies on the checkpoint job, so the scheduler runs even with maintenance disabled
+        if (m_Config.maintenance.enabled || m_Io->durability() == EDurability::Fast) {
+            start_maintenance();
+        }
         log::info("Server initialized");
         return stl::success;
     }
@@ -60,94 +207,262 @@ namespace sap::cloud {
     void Server::stop() {
         log::info("Stopping server");
         m_HttpServer.stop();
+        if (m_Maintenance) {
+            m_Maintenance->stop();
+        }
+        if (m_Indexer) {
+            m_Indexer->stop();
+        }
+        m_RebuildThread.request_stop();
     }
 
-    void Server::setup_routes() {
-        // Auth Routes
-        m_HttpServer.route("/api/v1/auth/challenge", http::EMethod::POST,
-                           [this](const http::Request& req) { return handle_auth_challenge(req); });
-        m_HttpServer.route("/api/v1/auth/verify", http::EMethod::POST,
-                           [this](const http::Request& req) { return handle_auth_verify(req); });
-        // Sync Routes
-        m_HttpServer.route("/api/v1/sync/state", http::EMethod::GET, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
-            if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
-            }
-            return handle_sync_state(req);
-        });
-        // File Routes
-        // Note: sap_http doesn't have path params yet, so we use prefix matching
-        m_HttpServer.route("/api/v1/files", http::EMethod::GET, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
-            if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
+    void Server::reload_authorized_keys() {
+        auto result = m_Auth->reload_authorized_keys();
+        if (!result) {
+            log::warn("Failed to reload authorized keys, keeping previous set: {}", result.error());
+        }
+    }
+
+    stl::result<> Server::start_note_index_rebuild() {
+        std::lock_guard<std::mutex> lock(m_RebuildMutex);
+        if (m_RebuildProgress.running.exchange(true)) {
+            return stl::make_error("A note index rebuild is already running");
+        }
+        if (m_RebuildThread.joinable()) {
+            m_RebuildThread.join();
+        }
+        m_RebuildError.reset();
+        m_RebuildThread = std::jthread([this](std::stop_token stop) {
+            auto result = m_NoteSvc->rebuild_index(m_RebuildProgress, stop);
+            if (!result) {
+                log::error("{}", result.error());
             }
-            return handle_get_file(req);
-        });
-        m_HttpServer.route("/api/v1/files", http::EMethod::PUT, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
-            if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
+            std::lock_guard<std::mutex> lock(m_RebuildMutex);
+            if (!result) {
+                m_RebuildError = result.error();
             }
-            return handle_put_file(req);
+            m_RebuildProgress.running = false;
         });
-        m_HttpServer.route("/api/v1/files", http::EMethod::DELETE, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
-            if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
+        return stl::success;
+    }
+
+    void Server::watch_authorized_keys() {
+        auto keys_path = std::filesystem::absolute(m_Config.auth.authorized_keys);
+        auto watcher = FileWatcher::create([this, keys_path](const WatchEvent& event) {
+            // A removal keeps the current keys; writing the replacement triggers the reload
+            if (event.kind == EWatchEvent::Overflow || (event.kind == EWatchEvent::Written && event.path == keys_path)) {
+                log::info("authorized_keys changed, reloading");
+                reload_authorized_keys();
             }
-            return handle_delete_file(req);
         });
-        // Note Routes
-        m_HttpServer.route("/api/v1/notes", http::EMethod::GET, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
+        if (!watcher) {
+            log::warn("Not watching authorized_keys: {}", watcher.error());
+            return;
+        }
+        auto add_result = watcher.value()->add_directory(keys_path.parent_path());
+        if (!add_result) {
+            log::warn("Not watching authorized_keys: {}", add_result.error());
+            return;
+        }
+        m_KeysWatcher = std::move(watcher.value());
+    }
+
+    void Server::watch_storage() {
+        LiveIndexer::Options options;
+        options.debounce = std::chrono::milliseconds(m_Config.storage.watch_debounce_ms);
+        options.max_delay = std::max(options.max_delay, 4 * options.debounce);
+        auto indexer = LiveIndexer::create(*m_FileSvc, m_Config.storage.files_root, *m_NoteSvc, m_Config.storage.notes_root, options);
+        if (!indexer) {
+            log::warn("Not watching storage for outside changes: {}", indexer.error());
+            return;
+        }
+        m_Indexer = std::move(indexer.value());
+    }
+
+    void Server::start_maintenance() {
+        using std::chrono::milliseconds;
+        using std::chrono::seconds;
+        const auto& cfg = m_Config.maintenance;
+        const i64 batch = std::max<i64>(cfg.batch_size, 1);
+        m_Maintenance = std::make_unique<MaintenanceScheduler>(milliseconds(cfg.slice_ms));
+        if (m_Io->durability() == EDurability::Fast) {
+            m_Maintenance->add_job("checkpoint", seconds(std::max<i64>(cfg.checkpoint_interval, 1)), [this]() -> stl::result<bool> {
+                auto r = m_Meta->checkpoint();
+                if (!r) {
+                    return stl::make_error<bool>("{}", r.error());
+                }
+                return false;
+            });
+        }
+        // Scans and the watcher index files with an empty strong hash; until this
+        // fills it in they are missing from /sync/hashes, so it always runs
+        m_Maintenance->add_job("hash", seconds(cfg.hash_interval), [this, batch]() -> stl::result<bool> { return m_FileSvc->hash_pending(batch); });
+        if (!cfg.enabled) {
+            m_Maintenance->start();
+            return;
+        }
+        m_Maintenance->add_job("expire", seconds(cfg.expiry_interval), [this, batch]() -> stl::result<bool> {
+            auto auth_result = m_Auth->cleanup_expired();
             if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
+                return stl::make_error<bool>("{}", auth_result.error());
             }
-            // Check if this is a list or single note request
-            std::string path = req.url.path;
-            if (path == "/api/v1/notes" || path == "/api/v1/notes/") {
-                return handle_list_notes(req);
+            auto uploads = m_UploadSvc->cleanup_expired(batch);
+            if (!uploads) {
+                return stl::make_error<bool>("{}", uploads.error());
             }
-            return handle_get_note(req);
+            return static_cast<i64>(uploads.value()) >= batch;
         });
-        m_HttpServer.route("/api/v1/notes", http::EMethod::POST, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
-            if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
+        const i64 retention_ms = cfg.tombstone_retention_days * 86400 * 1000;
+        m_Maintenance->add_job("tombstones", seconds(cfg.compaction_interval), [this, batch, retention_ms]() -> stl::result<bool> {
+            auto removed = m_Meta->compact_tombstones(sync::now_ms() - retention_ms, batch);
+            if (!removed) {
+                return stl::make_error<bool>("{}", removed.error());
             }
-            return handle_create_note(req);
-        });
-        m_HttpServer.route("/api/v1/notes", http::EMethod::PUT, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
-            if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
+            if (removed.value() > 0) {
+                log::debug("Compacted {} tombstones", removed.value());
             }
-            return handle_update_note(req);
+            return removed.value() >= batch;
         });
-        m_HttpServer.route("/api/v1/notes", http::EMethod::DELETE, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
-            if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
+        m_Maintenance->add_job("vacuum", seconds(cfg.compaction_interval), [this, batch]() -> stl::result<bool> {
+            auto remaining = m_Meta->incremental_vacuum(batch);
+            if (!remaining) {
+                return stl::make_error<bool>("{}", remaining.error());
             }
-            return handle_delete_note(req);
+            return remaining.value() > 0;
         });
-        m_HttpServer.route("/api/v1/notes/tags", http::EMethod::GET, [this](const http::Request& req) {
-            auto auth_result = authenticate(req);
-            if (!auth_result) {
-                return error_response(401, "unauthorized", auth_result.error());
+        m_Maintenance->add_job("optimize", seconds(cfg.optimize_interval), [this]() -> stl::result<bool> {
+            auto r = m_Meta->optimize();
+            if (!r) {
+                return stl::make_error<bool>("{}", r.error());
             }
-            return handle_get_tags(req);
+            return false;
         });
-        m_HttpServer.route("/api/v1/notes/search", http::EMethod::GET, [this](const http::Request& req) {
+        m_Maintenance->add_job("fts_merge", seconds(cfg.optimize_interval), [this, batch]() -> stl::result<bool> { return m_Meta->merge_fts(batch); });
+        m_Maintenance->start();
+    }
+
+    void Server::setup_routes() {
+        const RouteOptions public_route{.requires_auth = false};
+        // Auth Routes
+        m_Router.add(
+            http::EMethod::POST, "/api/v1/auth/challenge",
+            [this](const http::Request& req, const RouteParams&) { return handle_auth_challenge(req); }, public_route);
+        m_Router.add(
+            http::EMethod::POST, "/api/v1/auth/verify", [this](const http::Request& req, const RouteParams&) { return handle_auth_verify(req); },
+            public_route);
+        // Sync Routes
+        m_Router.add(http::EMethod::GET, "/api/v1/sync/state",
+                     [this](const http::Request& req, const RouteParams&) { return handle_sync_state(req); });
+        m_Router.add(http::EMethod::GET, "/api/v1/sync/tree",
+                     [this](const http::Request& req, const RouteParams&) { return handle_sync_tree(req, ""); });
+        m_Router.add(http::EMethod::GET, "/api/v1/sync/tree/{path*}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_sync_tree(req, params.get("path")); });
+        m_Router.add(http::EMethod::POST, "/api/v1/sync/hashes",
+                     [this](const http::Request& req, const RouteParams&) { return handle_sync_hashes(req); });
+        // File Routes
+        m_Router.add(http::EMethod::GET, "/api/v1/files", [this](const http::Request& req, const RouteParams&) { return handle_list_files(req); });
+        m_Router.add(http::EMethod::GET, "/api/v1/files/{path*}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_get_file(req, params.get("path")); });
+        m_Router.add(http::EMethod::PUT, "/api/v1/files/{path*}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_put_file(req, params.get("path")); });
+        m_Router.add(http::EMethod::DELETE, "/api/v1/files/{path*}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_delete_file(req, params.get("path")); });
+        // POST only: GET /api/v1/files/move still reaches a file named "move"
+        m_Router.add(http::EMethod::POST, "/api/v1/files/move",
+                     [this](const http::Request& req, const RouteParams&) { return handle_transfer_file(req, false); });
+        m_Router.add(http::EMethod::POST, "/api/v1/files/copy",
+                     [this](const http::Request& req, const RouteParams&) { return handle_transfer_file(req, true); });
+        // Upload Routes
+        m_Router.add(http::EMethod::POST, "/api/v1/uploads",
+                     [this](const http::Request& req, const RouteParams&) { return handle_create_upload(req); });
+        m_Router.add(http::EMethod::GET, "/api/v1/uploads/{id}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_get_upload(req, params.get("id")); });
+        m_Router.add(http::EMethod::PUT, "/api/v1/uploads/{id}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_upload_chunk(req, params.get("id")); });
+        m_Router.add(http::EMethod::POST, "/api/v1/uploads/{id}/complete",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_finalize_upload(req, params.get("id")); });
+        m_Router.add(http::EMethod::DELETE, "/api/v1/uploads/{id}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_abort_upload(req, params.get("id")); });
+        // Note Routes
+        m_Router.add(http::EMethod::GET, "/api/v1/notes", [this](const http::Request& req, const RouteParams&) { return handle_list_notes(req); });
+        m_Router.add(http::EMethod::GET, "/api/v1/notes/tags",
+                     [this](const http::Request& req, const RouteParams&) { return handle_get_tags(req); });
+        m_Router.add(http::EMethod::GET, "/api/v1/notes/search",
+                     [this](const http::Request& req, const RouteParams&) { return handle_search_notes(req); });
+        m_Router.add(http::EMethod::GET, "/api/v1/notes/{id}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_get_note(req, params.get("id")); });
+        m_Router.add(http::EMethod::POST, "/api/v1/notes",
+                     [this](const http::Request& req, const RouteParams&) { return handle_create_note(req); });
+        m_Router.add(http::EMethod::PUT, "/api/v1/notes/{id}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_update_note(req, params.get("id")); });
+        m_Router.add(http::EMethod::DELETE, "/api/v1/notes/{id}",
+                     [this](const http::Request& req, const RouteParams& params) { return handle_delete_note(req, params.get("id")); });
+        // Admin Routes
+        m_Router.add(http::EMethod::GET, "/api/v1/admin/trace",
+                     [this](const http::Request& req, const RouteParams&) { return handle_trace_export(req); });
+        m_Router.add(http::EMethod::POST, "/api/v1/admin/notes/reindex",
+                     [this](const http::Request& req, const RouteParams&) { return handle_start_reindex(req); });
+        m_Router.add(http::EMethod::GET, "/api/v1/admin/notes/reindex",
+                     [this](const http::Request& req, const RouteParams&) { return handle_reindex_status(req); });
+        // Metrics Routes
+        if (m_Config.server.metrics) {
+            m_Router.add(
+                http::EMethod::GET, "/metrics", [this](const http::Request& req, const RouteParams&) { return handle_metrics(req); },
+                public_route);
+            m_HttpServer.route("/metrics", http::EMethod::GET, [this](const http::Request& req) { return dispatch(http::EMethod::GET, req); });
+        }
+        // sap_http only does prefix matching, so hand everything under /api to the route table
+        for (http::EMethod method : m_Router.methods()) {
+            m_HttpServer.route("/api", method, [this, method](const http::Request& req) { return dispatch(method, req); });
+        }
+        // Per-route metrics, labelled by pattern so path parameters don't explode cardinality
+        auto& reg = metrics::registry();
+        for (const auto& route : m_Router.routes()) {
+            metrics::Labels labels = {{"method", std::string(method_name(route->method))}, {"route", route->pattern}};
+            m_RouteMetrics.push_back({reg.counter("sap_http_requests_total", "HTTP requests by route", labels),
+                                      reg.histogram("sap_http_request_duration_seconds", "HTTP request latency by route", labels)});
+        }
+        metrics::Labels unmatched = {{"method", "ANY"}, {"route", "unmatched"}};
+        m_UnmatchedMetrics = {reg.counter("sap_http_requests_total", "HTTP requests by route", unmatched),
+                              reg.histogram("sap_http_request_duration_seconds", "HTTP request latency by route", unmatched)};
+        log::debug("Routes configured");
+    }
+
+    http::Response Server::dispatch(http::EMethod method, const http::Request& req) {
+        auto start = std::chrono::steady_clock::now();
+        auto match = m_Router.match(method, req.url.path);
+        http::Response resp = [&] {
+            std::string description = std::string(method_name(method)) + " " + std::string(req.url.path);
+            trace::RequestScope scope(match.route ? match.route->pattern.c_str() : "unmatched", std::move(description));
+            return route_request(match, req);
+        }();
+        const RouteMetrics& route_metrics = match.route ? m_RouteMetrics[match.route->id] : m_UnmatchedMetrics;
+        route_metrics.latency.record(std::chrono::steady_clock::now() - start);
+        route_metrics.requests.inc();
+        const auto& totals = http_metrics();
+        totals.bytes_in.inc(req.body.size());
+        totals.bytes_out.inc(resp.body.size());
+        if (resp.status >= 100 && resp.status < 600) {
+            totals.responses[static_cast<size_t>(resp.status / 100 - 1)].inc();
+        }
+        return resp;
+    }
+
+    http::Response Server::route_request(const RouteMatch& match, const http::Request& req) {
+        if (!match.route) {
+            if (match.path_matched) {
+                return error_response(405, "method_not_allowed", "Method not allowed");
+            }
+            return error_response(404, "not_found", "No such endpoint");
+        }
+        if (match.route->options.requires_auth) {
+            trace::Span span("authenticate");
             auto auth_result = authenticate(req);
             if (!auth_result) {
                 return error_response(401, "unauthorized", auth_result.error());
             }
-            return handle_search_notes(req);
-        });
-        log::debug("Routes configured");
+        }
+        return match.route->handler(req, match.params);
     }
 
     stl::result<> Server::authenticate(const http::Request& req) {
@@ -156,11 +471,12 @@ namespace sap::cloud {
             return stl::make_error("Missing Authorization header");
         }
         // Extract Bearer token
-        const std::string prefix = "Bearer ";
-        if (auth_header.size() <= prefix.size() || auth_header.substr(0, prefix.size()) != prefix) {
+        constexpr std::string_view prefix = "Bearer ";
+        std::string_view header = auth_header;
+        if (header.size() <= prefix.size() || header.substr(0, prefix.size()) != prefix) {
             return stl::make_error("Invalid Authorization header format");
         }
-        std::string token = auth_header.substr(prefix.size());
+        std::string_view token = header.substr(prefix.size());
         auto valid_header = m_Auth->validate_token(token);
         if (!valid_header) {
             return stl::make_error("{}", valid_header.error());
@@ -172,11 +488,33 @@ namespace sap::cloud {
     }
 
     http::Response Server::json_response(i32 status, const nlohmann::json& body) {
-        http::Response resp(status, body.dump());
+        trace::Span span("serialize");
+        auto dumped = metrics::timed(json_serialize_histogram(), [&] { return body.dump(); });
+        http::Response resp(status, std::move(dumped));
         resp.headers.set("Content-Type", "application/json");
         return resp;
     }
 
+    http::Response Server::json_response(i32 status, const sync::SyncState& body) { return write_json_response(status, body); }
+
+    http::Response Server::json_response(i32 status, const sync::NoteListResponse& body) { return write_json_response(status, body); }
+
+    http::Response Server::json_response(i32 status, const sync::TagListResponse& body) { return write_json_response(status, body); }
+
+    http::Response Server::json_response(i32 status, const std::vector<sync::FileMetadata>& body) {
+        return write_json_response(status, body);
+    }
+
+    http::Response Server::json_response(i32 status, const sync::FileMetadata& body) { return write_json_response(status, body); }
+
+    http::Response Server::sync_response(const http::Request& req, const sync::SyncState& body) {
+        return negotiate_sync_response(req, 200, body);
+    }
+
+    http::Response Server::sync_response(const http::Request& req, const std::vector<sync::FileMetadata>& body) {
+        return negotiate_sync_response(req, 200, body);
+    }
+
     http::Response Server::error_response(i32 status, std::string_view err, std::string_view message) {
         sync::ErrorResponse err_resp;
         err_resp.error = std::string(err);
@@ -184,89 +522,180 @@ namespace sap::cloud {
         return json_response(status, err_resp);
     }
 
-    std::string Server::extract_path_param(const http::Request& req, std::string_view prefix) {
-        std::string path = req.url.path;
-        if (path.size() > prefix.size() && path.substr(0, prefix.size()) == prefix) {
-            return path.substr(prefix.size());
+    http::Response Server::handle_trace_export(const http::Request& req) {
+        (void)req;
+        http::Response resp(200, trace::export_chrome_trace());
+        resp.headers.set("Content-Type", "application/json");
+        return resp;
+    }
+
+    http::Response Server::handle_start_reindex(const http::Request& req) {
+        auto result = start_note_index_rebuild();
+        if (!result) {
+            return error_response(409, "conflict", result.error());
         }
-        return "";
+        auto resp = handle_reindex_status(req);
+        resp.status = 202;
+        return resp;
+    }
+
+    http::Response Server::handle_reindex_status(const http::Request& req) {
+        (void)req;
+        nlohmann::json body = {
+            {"running", m_RebuildProgress.running.load()},
+            {"total", m_RebuildProgress.total.load()},
+            {"parsed", m_RebuildProgress.parsed.load()},
+            {"indexed", m_RebuildProgress.indexed.load()},
+            {"failed", m_RebuildProgress.failed.load()},
+        };
+        std::lock_guard<std::mutex> lock(m_RebuildMutex);
+        if (m_RebuildError) {
+            body["error"] = *m_RebuildError;
+        }
+        return json_response(200, body);
+    }
+
+    http::Response Server::handle_metrics(const http::Request& req) {
+        (void)req;
+        http::Response resp(200, metrics::registry().render());
+        resp.headers.set("Content-Type", "text/plain; version=0.0.4");
+        return resp;
     }
 
     http::Response Server::handle_auth_challenge(const http::Request& req) {
-        try {
-            auto json = nlohmann::json::parse(req.body);
-            sync::ChallengeRequest chall_req = json.get<sync::ChallengeRequest>();
-            auto result = m_Auth->create_challenge(chall_req.public_key);
-            if (!result) {
-                return error_response(401, "auth_failed", result.error());
-            }
-            return json_response(200, result.value());
-        } catch (const nlohmann::json::exception& e) {
-            return error_response(400, "bad_request", "Invalid JSON: " + std::string(e.what()));
+        auto chall_req = json::parse_challenge_request(req.body);
+        if (!chall_req) {
+            return error_response(400, "bad_request", chall_req.error());
+        }
+        auto result = m_Auth->create_challenge(chall_req->public_key);
+        if (!result) {
+            return error_response(401, "auth_failed", result.error());
         }
+        return json_response(200, result.value());
     }
 
     http::Response Server::handle_auth_verify(const http::Request& req) {
-        try {
-            auto json = nlohmann::json::parse(req.body);
-            sync::VerifyRequest verify_req = json.get<sync::VerifyRequest>();
-            auto result = m_Auth->verify_challenge(verify_req);
-            if (!result) {
-                return error_response(401, "auth_failed", result.error());
-            }
-            return json_response(200, result.value());
-        } catch (const nlohmann::json::exception& e) {
-            return error_response(400, "bad_request", "Invalid JSON");
+        auto verify_req = json::parse_verify_request(req.body);
+        if (!verify_req) {
+            return error_response(400, "bad_request", verify_req.error());
+        }
+        auto result = m_Auth->verify_challenge(verify_req.value());
+        if (!result) {
+            return error_response(401, "auth_failed", result.error());
         }
+        return json_response(200, result.value());
     }
 
     http::Response Server::handle_sync_state(const http::Request& req) {
         std::optional<sync::Timestamp> since;
         // Parse query param: ?since=<timestamp>
-        std::string query = req.url.query;
-        if (!query.empty() && query[0] == '?') {
-            query = query.substr(1);
-        }
-        auto since_pos = query.find("since=");
-        if (since_pos != std::string::npos) {
-            try {
-                since = std::stoll(query.substr(since_pos + 6));
-            } catch (...) {
-                // Ignore parse errors
+        std::string_view since_param = query_param(req.url.query, "since");
+        if (!since_param.empty()) {
+            sync::Timestamp value = 0;
+            auto [ptr, ec] = std::from_chars(since_param.data(), since_param.data() + since_param.size(), value);
+            // Ignore parse errors
+            if (ec == std::errc{}) {
+                since = value;
+            }
+        }
+        // Tombstones older than the retention window may have been compacted away, so a
+        // delta from before it could miss deletions; send the full state instead
+        if (since && m_Config.maintenance.enabled) {
+            auto retention_ms = m_Config.maintenance.tombstone_retention_days * 86400 * 1000;
+            if (*since < sync::now_ms() - retention_ms) {
+                since.reset();
             }
         }
         auto result = m_SyncSvc->get_sync_state(since);
         if (!result) {
             return error_response(500, "internal_error", result.error());
         }
-        return json_response(200, result.value());
+        return sync_response(req, result.value());
     }
 
-    http::Response Server::handle_get_file(const http::Request& req) {
-        std::string file_path = extract_path_param(req, "/api/v1/files/");
-        if (file_path.empty()) {
-            // List all files
-            auto result = m_FileSvc->list_files();
-            if (!result) {
-                return error_response(500, "internal_error", result.error());
+    http::Response Server::handle_sync_tree(const http::Request& req, std::string_view path) {
+        (void)req;
+        if (!m_Tree) {
+            return error_response(404, "not_found", "Sync tree is disabled");
+        }
+        auto subtree = m_Tree->subtree(path);
+        if (!subtree) {
+            return error_response(404, "not_found", "Path not found");
+        }
+        nlohmann::json children = nlohmann::json::array();
+        for (const auto& child : subtree->children) {
+            children.push_back({{"name", child.name}, {"type", child.directory ? "dir" : "file"}, {"hash", child.hash}, {"files", child.files}});
+        }
+        nlohmann::json body = {{"path", subtree->path},
+                               {"type", subtree->directory ? "dir" : "file"},
+                               {"hash", subtree->hash},
+                               {"files", subtree->files},
+                               {"children", std::move(children)}};
+        return json_response(200, body);
+    }
+
+    http::Response Server::handle_sync_hashes(const http::Request& req) {
+        auto query = json::parse_hash_query(req.body);
+        if (!query) {
+            return error_response(400, "bad_request", query.error());
+        }
+        // An exact list is answered exactly; a Bloom filter with every live hash
+        // it may contain, for the client to check against its own set
+        stl::result<std::vector<std::string>> known;
+        bool exact = query.value().bloom.empty();
+        if (exact) {
+            known = m_FileSvc->find_hashes(std::move(query.value().hashes));
+        } else {
+            auto filter = BloomFilter::decode(query.value().bloom, query.value().bloom_hashes);
+            if (!filter) {
+                return error_response(400, "bad_request", filter.error());
             }
-            return json_response(200, result.value());
+            known = m_FileSvc->find_hashes(filter.value());
+        }
+        if (!known) {
+            return error_response(500, "internal_error", known.error());
         }
-        // Get specific file
-        auto result = m_FileSvc->get_file(file_path);
+        return json_response(200, nlohmann::json{{"known", std::move(known.value())}, {"exact", exact}});
+    }
+
+    http::Response Server::handle_list_files(const http::Request& req) {
+        auto result = m_FileSvc->list_files();
         if (!result) {
-            return error_response(404, "not_found", result.error());
+            return error_response(500, "internal_error", result.error());
+        }
+        return sync_response(req, result.value());
+    }
+
+    http::Response Server::handle_get_file(const http::Request& req, std::string_view file_path) {
+        (void)req;
+        auto meta = m_FileSvc->get_metadata(file_path);
+        if (!meta) {
+            return error_response(500, "internal_error", meta.error());
+        }
+        if (!meta.value() || meta.value()->is_deleted) {
+            return error_response(404, "not_found", "File not found");
+        }
+        std::string body;
+        if (auto cached = m_FileSvc->cached_content(*meta.value())) {
+            body = *cached;
+        } else {
+            auto source = m_FileSvc->resolve(file_path);
+            if (!source) {
+                return error_response(404, "not_found", source.error());
+            }
+            auto content = metrics::timed_read([&] { return m_Io->read(source.value()); });
+            if (!content) {
+                return error_response(404, "not_found", content.error());
+            }
+            body.assign(content.value().begin(), content.value().end());
+            m_FileSvc->cache_content(*meta.value(), body);
         }
-        http::Response resp(200, std::string(result.value().begin(), result.value().end()));
+        http::Response resp(200, std::move(body));
         resp.headers.set("Content-Type", "application/octet-stream");
         return resp;
     }
 
-    http::Response Server::handle_put_file(const http::Request& req) {
-        std::string file_path = extract_path_param(req, "/api/v1/files/");
-        if (file_path.empty()) {
-            return error_response(400, "bad_request", "File path required");
-        }
+    http::Response Server::handle_put_file(const http::Request& req, std::string_view file_path) {
         std::vector<u8> content(req.body.begin(), req.body.end());
         auto result = m_FileSvc->put_file(file_path, content);
         if (!result) {
@@ -275,11 +704,8 @@ namespace sap::cloud {
         return json_response(200, result.value());
     }
 
-    http::Response Server::handle_delete_file(const http::Request& req) {
-        std::string file_path = extract_path_param(req, "/api/v1/files/");
-        if (file_path.empty()) {
-            return error_response(400, "bad_request", "File path required");
-        }
+    http::Response Server::handle_delete_file(const http::Request& req, std::string_view file_path) {
+        (void)req;
         auto result = m_FileSvc->delete_file(file_path);
         if (!result) {
             return error_response(500, "internal_error", result.error());
@@ -287,18 +713,154 @@ namespace sap::cloud {
         return http::Response(204);
     }
 
+    http::Response Server::handle_transfer_file(const http::Request& req, bool copy) {
+        auto transfer = json::parse_file_transfer(req.body);
+        if (!transfer) {
+            return error_response(400, "bad_request", transfer.error());
+        }
+        const auto& [from, to, overwrite] = transfer.value();
+        auto from_path = m_FileSvc->normalize(from);
+        if (!from_path) {
+            return error_response(400, "bad_request", from_path.error());
+        }
+        auto to_path = m_FileSvc->normalize(to);
+        if (!to_path) {
+            return error_response(400, "bad_request", to_path.error());
+        }
+        // Also catches spellings that differ but land on one file, e.g. through a symlinked directory
+        std::error_code ec;
+        if (from_path.value() == to_path.value() ||
+            std::filesystem::equivalent(m_FileSvc->root() / from_path.value(), m_FileSvc->root() / to_path.value(), ec)) {
+            return error_response(400, "bad_request", "Source and target are the same file");
+        }
+        // Directories have no row, so the check below would let one be replaced
+        if (std::filesystem::is_directory(m_FileSvc->root() / to_path.value(), ec)) {
+            return error_response(409, "conflict", "Target is a directory: " + to_path.value());
+        }
+        auto source = m_FileSvc->get_metadata(from_path.value());
+        if (!source) {
+            return error_response(500, "internal_error", source.error());
+        }
+        if (!source.value() || source.value()->is_deleted) {
+            return error_response(404, "not_found", "File not found");
+        }
+        // Advisory only: a PUT to the target landing between this check and the
+        // transfer is replaced without a 409. Clients needing exclusive creation
+        // must check the target's hash afterwards and retry.
+        if (!overwrite) {
+            auto target = m_FileSvc->get_metadata(to_path.value());
+            if (!target) {
+                return error_response(500, "internal_error", target.error());
+            }
+            if (target.value() && !target.value()->is_deleted) {
+                return error_response(409, "conflict", "File exists: " + to_path.value());
+            }
+        }
+        auto result = copy ? m_FileSvc->copy_file(from, to) : m_FileSvc->move_file(from, to);
+        if (!result) {
+            return error_response(500, "internal_error", result.error());
+        }
+        return json_response(copy ? 201 : 200, result.value());
+    }
+
+    http::Response Server::handle_create_upload(const http::Request& req) {
+        try {
+            auto json = nlohmann::json::parse(req.body);
+            std::string path = json.at("path").get<std::string>();
+            i64 size = json.value("size", static_cast<i64>(-1));
+            std::optional<sync::Timestamp> mtime;
+            if (json.contains("mtime")) {
+                mtime = json.at("mtime").get<sync::Timestamp>();
+            }
+            auto result = m_UploadSvc->create_session(path, size, mtime);
+            if (!result) {
+                return error_response(400, "bad_request", result.error());
+            }
+            return json_response(201, result.value());
+        } catch (const nlohmann::json::exception& e) {
+            return error_response(400, "bad_request", "Invalid JSON");
+        }
+    }
+
+    http::Response Server::handle_get_upload(const http::Request& req, std::string_view upload_id) {
+        (void)req;
+        auto result = m_UploadSvc->get_session(upload_id);
+        if (!result) {
+            return error_response(500, "internal_error", result.error());
+        }
+        if (!result.value()) {
+            return error_response(404, "not_found", "Upload session not found");
+        }
+        return json_response(200, result.value().value());
+    }
+
+    http::Response Server::handle_upload_chunk(const http::Request& req, std::string_view upload_id) {
+        // Parse query param: ?offset=<bytes>
+        std::string_view offset_param = query_param(req.url.query, "offset");
+        if (offset_param.empty()) {
+            return error_response(400, "bad_request", "Query parameter 'offset' required");
+        }
+        i64 offset = 0;
+        auto [ptr, ec] = std::from_chars(offset_param.data(), offset_param.data() + offset_param.size(), offset);
+        if (ec != std::errc{} || ptr != offset_param.data() + offset_param.size()) {
+            return error_response(400, "bad_request", "Invalid offset");
+        }
+        auto session_result = m_UploadSvc->get_session(upload_id);
+        if (!session_result) {
+            return error_response(500, "internal_error", session_result.error());
+        }
+        if (!session_result.value()) {
+            return error_response(404, "not_found", "Upload session not found");
+        }
+        // Report the current offset so the client can resume from it
+        if (session_result.value()->offset != offset) {
+            return json_response(409, session_result.value().value());
+        }
+        auto result = m_UploadSvc->append_chunk(upload_id, offset, req.body);
+        if (!result) {
+            return error_response(400, "bad_request", result.error());
+        }
+        return json_response(200, result.value());
+    }
+
+    http::Response Server::handle_finalize_upload(const http::Request& req, std::string_view upload_id) {
+        (void)req;
+        auto session_result = m_UploadSvc->get_session(upload_id);
+        if (!session_result) {
+            return error_response(500, "internal_error", session_result.error());
+        }
+        if (!session_result.value()) {
+            return error_response(404, "not_found", "Upload session not found");
+        }
+        auto result = m_UploadSvc->finalize(upload_id);
+        if (!result) {
+            return error_response(409, "conflict", result.error());
+        }
+        return json_response(200, result.value());
+    }
+
+    http::Response Server::handle_abort_upload(const http::Request& req, std::string_view upload_id) {
+        (void)req;
+        auto session_result = m_UploadSvc->get_session(upload_id);
+        if (!session_result) {
+            return error_response(500, "internal_error", session_result.error());
+        }
+        if (!session_result.value()) {
+            return error_response(404, "not_found", "Upload session not found");
+        }
+        auto result = m_UploadSvc->abort(upload_id);
+        if (!result) {
+            return error_response(409, "conflict", result.error());
+        }
+        return http::Response(204);
+    }
+
     http::Response Server::handle_list_notes(const http::Request& req) {
         services::NoteService::ListOptions options;
         // Parse query params
-        std::string query = req.url.query;
-        if (!query.empty() && query[0] == '?') {
-            query = query.substr(1);
-        }
-        // Simple query parsing
-        auto tag_pos = query.find("tag=");
-        if (tag_pos != std::string::npos) {
-            auto end_pos = query.find('&', tag_pos);
-            options.tag = query.substr(tag_pos + 4, end_pos == std::string::npos ? std::string::npos : end_pos - tag_pos - 4);
+        std::string_view tag = query_param(req.url.query, "tag");
+        if (!tag.empty()) {
+            options.tag = std::string(tag);
         }
         auto result = m_NoteSvc->list_notes(options);
         if (!result) {
@@ -307,11 +869,8 @@ namespace sap::cloud {
         return json_response(200, result.value());
     }
 
-    http::Response Server::handle_get_note(const http::Request& req) {
-        std::string note_id = extract_path_param(req, "/api/v1/notes/");
-        if (note_id.empty()) {
-            return error_response(400, "bad_request", "Note ID required");
-        }
+    http::Response Server::handle_get_note(const http::Request& req, std::string_view note_id) {
+        (void)req;
         auto result = m_NoteSvc->get_note(note_id);
         if (!result) {
             return error_response(500, "internal_error", result.error());
@@ -323,42 +882,31 @@ namespace sap::cloud {
     }
 
     http::Response Server::handle_create_note(const http::Request& req) {
-        try {
-            auto json = nlohmann::json::parse(req.body);
-            sync::NoteCreateRequest create_req = json.get<sync::NoteCreateRequest>();
-            auto result = m_NoteSvc->create_note(create_req);
-            if (!result) {
-                return error_response(500, "internal_error", result.error());
-            }
-            return json_response(201, result.value());
-        } catch (const nlohmann::json::exception& e) {
-            return error_response(400, "bad_request", "Invalid JSON");
+        auto create_req = json::parse_note_create(req.body);
+        if (!create_req) {
+            return error_response(400, "bad_request", create_req.error());
         }
+        auto result = m_NoteSvc->create_note(create_req.value());
+        if (!result) {
+            return error_response(500, "internal_error", result.error());
+        }
+        return json_response(201, result.value());
     }
 
-    http::Response Server::handle_update_note(const http::Request& req) {
-        std::string note_id = extract_path_param(req, "/api/v1/notes/");
-        if (note_id.empty()) {
-            return error_response(400, "bad_request", "Note ID required");
+    http::Response Server::handle_update_note(const http::Request& req, std::string_view note_id) {
+        auto update_req = json::parse_note_update(req.body);
+        if (!update_req) {
+            return error_response(400, "bad_request", update_req.error());
         }
-        try {
-            auto json = nlohmann::json::parse(req.body);
-            sync::NoteUpdateRequest update_req = json.get<sync::NoteUpdateRequest>();
-            auto result = m_NoteSvc->update_note(note_id, update_req);
-            if (!result) {
-                return error_response(500, "internal_error", result.error());
-            }
-            return json_response(200, result.value());
-        } catch (const nlohmann::json::exception& e) {
-            return error_response(400, "bad_request", "Invalid JSON");
+        auto result = m_NoteSvc->update_note(note_id, update_req.value());
+        if (!result) {
+            return error_response(500, "internal_error", result.error());
         }
+        return json_response(200, result.value());
     }
 
-    http::Response Server::handle_delete_note(const http::Request& req) {
-        std::string note_id = extract_path_param(req, "/api/v1/notes/");
-        if (note_id.empty()) {
-            return error_response(400, "bad_request", "Note ID required");
-        }
+    http::Response Server::handle_delete_note(const http::Request& req, std::string_view note_id) {
+        (void)req;
         auto result = m_NoteSvc->delete_note(note_id);
         if (!result) {
             return error_response(500, "internal_error", result.error());
@@ -376,16 +924,10 @@ namespace sap::cloud {
     }
 
     http::Response Server::handle_search_notes(const http::Request& req) {
-        std::string query = req.url.query;
-        if (!query.empty() && query[0] == '?') {
-            query = query.substr(1);
-        }
-        auto q_pos = query.find("q=");
-        if (q_pos == std::string::npos) {
+        std::string_view search_query = query_param(req.url.query, "q");
+        if (search_query.empty()) {
             return error_response(400, "bad_request", "Query parameter 'q' required");
         }
-        auto end_pos = query.find('&', q_pos);
-        std::string search_query = query.substr(q_pos + 2, end_pos == std::string::npos ? std::string::npos : end_pos - q_pos - 2);
         auto result = m_NoteSvc->search_notes(search_query);
         if (!result) {
             return error_response(500, "internal_error", result.error());
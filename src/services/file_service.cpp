@@ -1,12 +1,27 @@
 #include <sap_cloud/services/file_service.h>
+#include <sap_cloud/fast_hash.h>
+#include <sap_cloud/metrics.h>
+#include <sap_cloud/services/upload_service.h>
+#include <sap_cloud/trace.h>
 #include <sap_core/log.h>
 #include <sap_sync/hash.h>
+#include <sap_sync/protocol.h>
 
 namespace sap::cloud::services {
 
-    FileService::FileService(fs::Filesystem& fs, storage::MetadataStore& meta) : m_Fs(fs), m_Meta(meta) {}
+    namespace {
+        // Judged on the normalized path, so "a/../.uploads/x" is caught too
+        bool is_staging_path(std::string_view path) {
+            auto rel = std::filesystem::path(std::string(path)).lexically_normal();
+            return !rel.empty() && rel.begin()->string() == UPLOAD_STAGING_DIR;
+        }
+    } // namespace
+
+    FileService::FileService(fs::Filesystem& fs, storage::MetadataStore& meta, IoEngine& io, std::filesystem::path root, ContentCache* cache) :
+        m_Fs(fs), m_Meta(meta), m_Io(io), m_Root(std::move(root)), m_Cache(cache) {}
 
     stl::result<std::vector<u8>> FileService::get_file(std::string_view path) {
+        trace::Span span("FileService::get_file");
         auto meta_result = m_Meta.get_file(path);
         if (!meta_result) {
             return stl::make_error<std::vector<u8>>("{}", meta_result.error());
@@ -14,24 +29,89 @@ namespace sap::cloud::services {
         if (!meta_result.value() || meta_result.value()->is_deleted) {
             return stl::make_error<std::vector<u8>>("File not found");
         }
-        return m_Fs.read(path);
+        if (auto cached = cached_content(*meta_result.value())) {
+            return std::vector<u8>(cached->begin(), cached->end());
+        }
+        auto source = resolve(path);
+        if (!source) {
+            return stl::make_error<std::vector<u8>>("{}", source.error());
+        }
+        auto content = metrics::timed_read([&] { return m_Io.read(source.value()); });
+        if (content) {
+            cache_content(*meta_result.value(), std::string_view(reinterpret_cast<const char*>(content.value().data()), content.value().size()));
+        }
+        return content;
+    }
+
+    ContentCache::Value FileService::cached_content(const sync::FileMetadata& meta) {
+        if (!m_Cache || !m_Cache->admits(static_cast<size_t>(meta.size))) {
+            return nullptr;
+        }
+        return m_Cache->get(ECacheKind::File, meta.hash);
+    }
+
+    void FileService::cache_content(const sync::FileMetadata& meta, std::string_view content) {
+        // The file may have changed since meta was read; only content matching its hash may be cached under it
+        if (m_Cache && !meta.hash.empty() && m_Cache->admits(content.size()) && sync::hash_string(content) == meta.hash) {
+            m_Cache->put(ECacheKind::File, meta.hash, std::string(content));
+        }
+    }
+
+    stl::result<std::filesystem::path> FileService::resolve(std::string_view path) const {
+        if (is_staging_path(path)) {
+            return stl::make_error<std::filesystem::path>("Path is reserved: {}", path);
+        }
+        return resolve_under(m_Root, path);
+    }
+
+    stl::result<std::vector<u8>> FileService::read_file(std::string_view path) {
+        // Read rather than mapped: outside tools may truncate files in the tree
+        // while they are read, which faults a mapping (SIGBUS) but only shortens a read
+        if (!m_Fs.exists(path)) {
+            return stl::make_error<std::vector<u8>>("File not found: {}", path);
+        }
+        auto source = resolve_under(m_Root, path);
+        if (!source) {
+            return stl::make_error<std::vector<u8>>("{}", source.error());
+        }
+        return metrics::timed_read([&] { return m_Io.read(source.value()); });
     }
 
     stl::result<std::optional<sync::FileMetadata>> FileService::get_metadata(std::string_view path) { return m_Meta.get_file(path); }
 
     stl::result<sync::FileMetadata> FileService::put_file(std::string_view path, const std::vector<u8>& content,
                                                           std::optional<sync::Timestamp> client_mtime) {
+        trace::Span span("FileService::put_file");
+        if (is_staging_path(path)) {
+            return stl::make_error<sync::FileMetadata>("Path is reserved: {}", path);
+        }
         // Check if file exists (for created_at)
         auto existing_result = m_Meta.get_file(path);
         sync::Timestamp created_at = sync::now_ms();
         if (existing_result && existing_result.value()) {
             created_at = existing_result.value()->created_at;
         }
-        // Write to filesystem
-        auto write_result = m_Fs.write(path, content);
+        // Write to filesystem: stage, then rename into place so readers (and mappings) never see a partial file
+        auto target = resolve_under(m_Root, path);
+        if (!target) {
+            return stl::make_error<sync::FileMetadata>("{}", target.error());
+        }
+        auto staged = m_Root / UPLOAD_STAGING_DIR / ("put-" + sync::generate_uuid());
+        auto write_result = metrics::timed_write(content.size(), [&] { return m_Io.write(staged, content); });
         if (!write_result) {
             return stl::make_error<sync::FileMetadata>("{}", write_result.error());
         }
+        std::error_code ec;
+        std::filesystem::create_directories(target.value().parent_path(), ec);
+        if (ec) {
+            std::filesystem::remove(staged, ec);
+            return stl::make_error<sync::FileMetadata>("Cannot create directory for {}", path);
+        }
+        auto rename_result = m_Io.commit(staged, target.value());
+        if (!rename_result) {
+            std::filesystem::remove(staged, ec);
+            return stl::make_error<sync::FileMetadata>("{}", rename_result.error());
+        }
         // Set mtime if provided
         if (client_mtime) {
             auto res = m_Fs.set_mtime(path, *client_mtime);
@@ -48,7 +128,7 @@ namespace sap::cloud::services {
         if (client_mtime) {
             meta.mtime = *client_mtime;
         }
-        auto store_result = m_Meta.upsert_file(meta);
+        auto store_result = m_Meta.upsert_file(meta, fast_hash(content.data(), content.size()));
         if (!store_result) {
             return stl::make_error<sync::FileMetadata>("{}", store_result.error());
         }
@@ -57,6 +137,10 @@ namespace sap::cloud::services {
     }
 
     stl::result<> FileService::delete_file(std::string_view path) {
+        trace::Span span("FileService::delete_file");
+        if (is_staging_path(path)) {
+            return stl::make_error("Path is reserved: {}", path);
+        }
         // Remove from filesystem
         auto remove_result = m_Fs.remove(path);
         if (!remove_result) {
@@ -71,41 +155,362 @@ namespace sap::cloud::services {
         return stl::success;
     }
 
+    stl::result<std::string> FileService::normalize(std::string_view path) const {
+        auto resolved = resolve(path);
+        if (!resolved) {
+            return stl::make_error<std::string>("{}", resolved.error());
+        }
+        return resolved.value().lexically_relative(m_Root).generic_string();
+    }
+
+    stl::result<std::optional<std::filesystem::path>> FileService::set_aside(const std::filesystem::path& target) {
+        std::error_code ec;
+        auto status = std::filesystem::symlink_status(target, ec);
+        if (!std::filesystem::exists(status)) {
+            return std::optional<std::filesystem::path>{};
+        }
+        // Only a file is replaced; a directory would end up stranded in staging
+        if (!std::filesystem::is_regular_file(status)) {
+            return stl::make_error<std::optional<std::filesystem::path>>("Target is not a regular file: {}", target.string());
+        }
+        auto staging = m_Root / UPLOAD_STAGING_DIR;
+        std::filesystem::create_directories(staging, ec);
+        auto aside = staging / ("replaced-" + sync::generate_uuid());
+        auto moved = m_Io.move(target, aside);
+        if (!moved) {
+            return stl::make_error<std::optional<std::filesystem::path>>("Cannot move {} aside: {}", target.string(), moved.error());
+        }
+        return std::optional<std::filesystem::path>{std::move(aside)};
+    }
+
+    void FileService::put_back(const std::optional<std::filesystem::path>& aside, const std::filesystem::path& target) {
+        if (!aside) {
+            return;
+        }
+        auto restored = m_Io.move(*aside, target);
+        if (!restored) {
+            log::error("Cannot restore {} from {}: {}", target.string(), aside->string(), restored.error());
+        }
+    }
+
+    stl::result<sync::FileMetadata> FileService::move_file(std::string_view from, std::string_view to) {
+        trace::Span span("FileService::move_file");
+        auto from_path = normalize(from);
+        if (!from_path) {
+            return stl::make_error<sync::FileMetadata>("{}", from_path.error());
+        }
+        auto to_path = normalize(to);
+        if (!to_path) {
+            return stl::make_error<sync::FileMetadata>("{}", to_path.error());
+        }
+        if (from_path.value() == to_path.value()) {
+            return stl::make_error<sync::FileMetadata>("Source and target are the same file: {}", from_path.value());
+        }
+        auto source = m_Root / from_path.value();
+        auto target = m_Root / to_path.value();
+        auto existing_result = m_Meta.get_file(from_path.value());
+        if (!existing_result) {
+            return stl::make_error<sync::FileMetadata>("{}", existing_result.error());
+        }
+        if (!existing_result.value() || existing_result.value()->is_deleted) {
+            return stl::make_error<sync::FileMetadata>("File not found: {}", from_path.value());
+        }
+        auto fast = m_Meta.get_fast_hash(from_path.value());
+        if (!fast) {
+            return stl::make_error<sync::FileMetadata>("{}", fast.error());
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(target.parent_path(), ec);
+        if (ec) {
+            return stl::make_error<sync::FileMetadata>("Cannot create directory for {}", to_path.value());
+        }
+        // A file being replaced is kept until the index agrees, so a failed move can restore it
+        auto aside = set_aside(target);
+        if (!aside) {
+            return stl::make_error<sync::FileMetadata>("{}", aside.error());
+        }
+        auto move_result = m_Io.move(source, target);
+        if (!move_result) {
+            put_back(aside.value(), target);
+            return stl::make_error<sync::FileMetadata>("{}", move_result.error());
+        }
+        // rename(2) keeps the content and mtime, so the entry carries over as is
+        sync::FileMetadata meta = *existing_result.value();
+        meta.path = to_path.value();
+        meta.updated_at = sync::now_ms();
+        auto store_result = m_Meta.move_file(from_path.value(), meta, fast.value().value_or(""));
+        if (!store_result) {
+            // Put both files back so disk and index still agree
+            auto restored = m_Io.move(target, source);
+            if (!restored) {
+                log::error("Cannot move {} back to {} after a failed move: {}", to_path.value(), from_path.value(), restored.error());
+            } else {
+                put_back(aside.value(), target);
+            }
+            return stl::make_error<sync::FileMetadata>("{}", store_result.error());
+        }
+        if (aside.value()) {
+            std::filesystem::remove(*aside.value(), ec);
+        }
+        log::debug("Moved file: {} -> {}", from_path.value(), to_path.value());
+        return meta;
+    }
+
+    stl::result<sync::FileMetadata> FileService::copy_file(std::string_view from, std::string_view to) {
+        trace::Span span("FileService::copy_file");
+        auto from_path = normalize(from);
+        if (!from_path) {
+            return stl::make_error<sync::FileMetadata>("{}", from_path.error());
+        }
+        auto to_path = normalize(to);
+        if (!to_path) {
+            return stl::make_error<sync::FileMetadata>("{}", to_path.error());
+        }
+        if (from_path.value() == to_path.value()) {
+            return stl::make_error<sync::FileMetadata>("Source and target are the same file: {}", from_path.value());
+        }
+        auto source = m_Root / from_path.value();
+        auto target = m_Root / to_path.value();
+        auto existing_result = m_Meta.get_file(from_path.value());
+        if (!existing_result) {
+            return stl::make_error<sync::FileMetadata>("{}", existing_result.error());
+        }
+        if (!existing_result.value() || existing_result.value()->is_deleted) {
+            return stl::make_error<sync::FileMetadata>("File not found: {}", from_path.value());
+        }
+        auto fast = m_Meta.get_fast_hash(from_path.value());
+        if (!fast) {
+            return stl::make_error<sync::FileMetadata>("{}", fast.error());
+        }
+        sync::Timestamp created_at = sync::now_ms();
+        auto target_result = m_Meta.get_file(to_path.value());
+        if (target_result && target_result.value()) {
+            created_at = target_result.value()->created_at;
+        }
+        // Stage, then rename into place, as put_file() does
+        auto staged = m_Root / UPLOAD_STAGING_DIR / ("copy-" + sync::generate_uuid());
+        auto copy_result = m_Io.copy(source, staged);
+        std::error_code ec;
+        if (!copy_result) {
+            std::filesystem::remove(staged, ec);
+            return stl::make_error<sync::FileMetadata>("{}", copy_result.error());
+        }
+        std::filesystem::create_directories(target.parent_path(), ec);
+        if (ec) {
+            std::filesystem::remove(staged, ec);
+            return stl::make_error<sync::FileMetadata>("Cannot create directory for {}", to_path.value());
+        }
+        auto aside = set_aside(target);
+        if (!aside) {
+            std::filesystem::remove(staged, ec);
+            return stl::make_error<sync::FileMetadata>("{}", aside.error());
+        }
+        auto commit_result = m_Io.commit(staged, target);
+        if (!commit_result) {
+            std::filesystem::remove(staged, ec);
+            put_back(aside.value(), target);
+            return stl::make_error<sync::FileMetadata>("{}", commit_result.error());
+        }
+        // Until the index has the copy, a failure takes it off disk again
+        auto roll_back = [&] {
+            std::filesystem::remove(target, ec);
+            put_back(aside.value(), target);
+        };
+        sync::FileMetadata meta = *existing_result.value();
+        // The copy gets the source's mtime, so outside-change detection sees it unchanged
+        auto mtime_result = m_Fs.set_mtime(to_path.value(), meta.mtime);
+        if (!mtime_result) {
+            roll_back();
+            return stl::make_error<sync::FileMetadata>("{}", mtime_result.error());
+        }
+        meta.path = to_path.value();
+        meta.created_at = created_at;
+        meta.updated_at = sync::now_ms();
+        auto store_result = m_Meta.upsert_file(meta, fast.value().value_or(""));
+        if (!store_result) {
+            roll_back();
+            return stl::make_error<sync::FileMetadata>("{}", store_result.error());
+        }
+        if (aside.value()) {
+            std::filesystem::remove(*aside.value(), ec);
+        }
+        log::debug("Copied file: {} -> {}", from_path.value(), to_path.value());
+        return meta;
+    }
+
     stl::result<std::vector<sync::FileMetadata>> FileService::list_files() { return m_Meta.get_all_files(); }
 
     stl::result<std::vector<sync::FileMetadata>> FileService::get_changed_since(sync::Timestamp since) {
+        trace::Span span("FileService::get_changed_since");
         return m_Meta.get_all_files(since);
     }
 
+    stl::result<std::vector<std::string>> FileService::find_hashes(std::vector<std::string> hashes) {
+        trace::Span span("FileService::find_hashes");
+        return m_Meta.find_hashes(std::move(hashes));
+    }
+
+    stl::result<std::vector<std::string>> FileService::find_hashes(const BloomFilter& filter) {
+        trace::Span span("FileService::find_hashes (bloom)");
+        // Page through the hash index instead of holding every hash at once
+        constexpr i64 page = 4096;
+        std::vector<std::string> candidates;
+        std::string after;
+        while (true) {
+            auto hashes = m_Meta.get_live_hashes(after, page);
+            if (!hashes) {
+                return hashes;
+            }
+            bool last = hashes.value().size() < static_cast<size_t>(page);
+            if (!last) {
+                after = hashes.value().back();
+            }
+            for (auto& hash : hashes.value()) {
+                if (filter.may_contain(hash)) {
+                    candidates.push_back(std::move(hash));
+                }
+            }
+            if (last) {
+                return candidates;
+            }
+        }
+    }
+
     stl::result<size_t> FileService::scan_and_index() {
+        trace::Span span("FileService::scan_and_index");
         auto files_result = m_Fs.list_recursive();
         if (!files_result) {
             return stl::make_error<size_t>("{}", files_result.error());
         }
+        // Unchanged files cost a stat; changed ones a fast hash. Strong hashes are
+        // filled in later by hash_pending()
         size_t indexed = 0;
         for (const auto& path : files_result.value()) {
-            auto content_result = m_Fs.read(path);
+            auto index_result = index_path(path);
+            if (!index_result) {
+                log::warn("Failed to index {}: {}", path, index_result.error());
+                continue;
+            }
+            indexed += index_result.value() ? 1 : 0;
+        }
+        log::info("Indexed {} new or changed files of {}", indexed, files_result.value().size());
+        return indexed;
+    }
+
+    stl::result<bool> FileService::index_path(std::string_view path) {
+        trace::Span span("FileService::index_path");
+        if (is_staging_path(path)) {
+            return false;
+        }
+        auto existing_result = m_Meta.get_file(path);
+        if (!existing_result) {
+            return stl::make_error<bool>("{}", existing_result.error());
+        }
+        const auto& existing = existing_result.value();
+        if (!m_Fs.exists(path)) {
+            // Either a file or a whole directory went away
+            auto under_result = m_Meta.mark_deleted_under(path);
+            if (!under_result) {
+                return stl::make_error<bool>("{}", under_result.error());
+            }
+            if (!existing || existing->is_deleted) {
+                return false;
+            }
+            auto mark_result = m_Meta.mark_deleted(path);
+            if (!mark_result) {
+                return stl::make_error<bool>("{}", mark_result.error());
+            }
+            log::debug("Indexed removal: {}", path);
+            return true;
+        }
+        auto size_result = m_Fs.size(path);
+        auto mtime_result = m_Fs.mtime(path);
+        if (existing && !existing->is_deleted && size_result && mtime_result && existing->size == size_result.value() &&
+            existing->mtime == mtime_result.value()) {
+            return false;
+        }
+        auto content_result = read_file(path);
+        if (!content_result) {
+            return stl::make_error<bool>("{}", content_result.error());
+        }
+        const auto& content = content_result.value();
+        auto now = sync::now_ms();
+        sync::FileMetadata meta;
+        meta.path = std::string(path);
+        meta.size = static_cast<i64>(content.size());
+        meta.mtime = mtime_result ? mtime_result.value() : now;
+        meta.created_at = now;
+        meta.updated_at = now;
+        meta.is_deleted = false;
+        std::string fast = fast_hash(content.data(), content.size());
+        if (existing && !existing->is_deleted) {
+            meta.created_at = existing->created_at;
+            auto fast_result = m_Meta.get_fast_hash(path);
+            // Touched but identical: keep the strong hash, clients already have the content
+            if (fast_result && fast_result.value() == fast) {
+                meta.hash = existing->hash;
+                meta.updated_at = existing->updated_at;
+            }
+        }
+        auto store_result = m_Meta.upsert_file(meta, fast);
+        if (!store_result) {
+            return stl::make_error<bool>("{}", store_result.error());
+        }
+        log::debug("Indexed change: {} ({} bytes)", path, meta.size);
+        return true;
+    }
+
+    stl::result<bool> FileService::hash_pending(i64 limit) {
+        trace::Span span("FileService::hash_pending");
+        auto pending_result = m_Meta.get_unhashed_files(limit);
+        if (!pending_result) {
+            return stl::make_error<bool>("{}", pending_result.error());
+        }
+        size_t hashed = 0;
+        for (const auto& pending : pending_result.value()) {
+            if (!m_Fs.exists(pending.path)) {
+                auto mark_result = m_Meta.mark_deleted(pending.path);
+                if (!mark_result) {
+                    return stl::make_error<bool>("{}", mark_result.error());
+                }
+                ++hashed;
+                continue;
+            }
+            auto content_result = read_file(pending.path);
             if (!content_result) {
-                log::warn("Failed to read file for indexing: {}", path);
+                log::warn("Failed to read {} for hashing: {}", pending.path, content_result.error());
                 continue;
             }
-            auto meta_result = build_metadata(path, content_result.value());
-            if (!meta_result) {
-                log::warn("Failed to build metadata for: {}", path);
+            const auto& content = content_result.value();
+            std::string fast = fast_hash(content.data(), content.size());
+            if (fast == pending.fast_hash) {
+                auto set_result = m_Meta.set_strong_hash(pending.path, fast, sync::hash_bytes(content.data(), content.size()));
+                if (!set_result) {
+                    return stl::make_error<bool>("{}", set_result.error());
+                }
+                hashed += set_result.value() ? 1 : 0;
                 continue;
             }
-            auto store_result = m_Meta.upsert_file(meta_result.value());
+            // Changed since it was indexed: record what was just read, both hashes at once
+            auto meta_result = build_metadata(pending.path, content);
+            if (!meta_result) {
+                return stl::make_error<bool>("{}", meta_result.error());
+            }
+            auto existing_result = m_Meta.get_file(pending.path);
+            if (existing_result && existing_result.value()) {
+                meta_result.value().created_at = existing_result.value()->created_at;
+            }
+            auto store_result = m_Meta.upsert_file(meta_result.value(), fast);
             if (!store_result) {
-                log::warn("Failed to store metadata for: {}", path);
-                continue;
+                return stl::make_error<bool>("{}", store_result.error());
             }
-            indexed++;
+            ++hashed;
         }
-        log::info("Indexed {} files", indexed);
-        return indexed;
+        // Stop early when nothing could be hashed so unreadable files don't spin the job
+        return hashed > 0 && static_cast<i64>(pending_result.value().size()) >= limit;
     }
 
-    stl::result<sync::FileMetadata> FileService::build_metadata(std::string_view path, const std::vector<u8>& content) {
+    stl::result<sync::FileMetadata> FileService::build_metadata(std::string_view path, std::span<const u8> content) {
         sync::FileMetadata meta;
         meta.path = std::string(path);
         meta.hash = sync::hash_bytes(content.data(), content.size());
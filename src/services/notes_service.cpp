@@ -1,15 +1,92 @@
 #include <sap_cloud/services/notes_service.h>
+#include <algorithm>
+#include <future>
+#include <sap_cloud/metrics.h>
+#include <sap_cloud/trace.h>
 #include <sap_core/log.h>
 #include <sap_sync/hash.h>
 #include <sap_sync/protocol.h>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace sap::cloud::services {
 
-    NoteService::NoteService(fs::Filesystem& fs, storage::MetadataStore& meta) : m_Fs(fs), m_Meta(meta) {}
+    namespace {
+        // Notes parsed per rebuild batch; bounds memory while the next batch is parsed
+        constexpr size_t rebuild_batch_size = 1024;
+
+        bool is_note_path(std::string_view path) { return path.size() >= 3 && path.substr(path.size() - 3) == ".md"; }
+
+        struct ParsedFile {
+            std::string path;
+            std::string hash;
+            std::optional<sync::ParsedNote> note;
+            std::string error;
+        };
+
+        stl::result<std::string> read_note(IoEngine& io, const std::filesystem::path& root, std::string_view path) {
+            auto source = resolve_under(root, path);
+            if (!source) {
+                return stl::make_error<std::string>("{}", source.error());
+            }
+            auto bytes = io.read(source.value());
+            if (!bytes) {
+                return stl::make_error<std::string>("{}", bytes.error());
+            }
+            return std::string(bytes.value().begin(), bytes.value().end());
+        }
+
+        stl::result<> write_note(IoEngine& io, const std::filesystem::path& root, std::string_view path, std::string_view content) {
+            auto target = resolve_under(root, path);
+            if (!target) {
+                return stl::make_error("{}", target.error());
+            }
+            auto written = io.write(target.value(), std::span(reinterpret_cast<const u8*>(content.data()), content.size()));
+            if (!written) {
+                return written;
+            }
+            return io.sync_file(target.value());
+        }
+
+        std::vector<ParsedFile> parse_batch(IoEngine& io, const std::filesystem::path& root, std::span<const std::string> paths,
+                                            NoteService::RebuildProgress& progress) {
+            std::vector<ParsedFile> parsed(paths.size());
+            std::atomic<size_t> next{0};
+            auto worker = [&] {
+                for (size_t i = next++; i < paths.size(); i = next++) {
+                    auto& out = parsed[i];
+                    out.path = paths[i];
+                    auto content = metrics::timed_read([&] { return read_note(io, root, out.path); });
+                    if (!content) {
+                        out.error = content.error();
+                    } else if (auto note = sync::parse_note(content.value()); !note) {
+                        out.error = note.error();
+                    } else {
+                        out.hash = sync::hash_string(content.value());
+                        out.note = std::move(note.value());
+                    }
+                    progress.parsed++;
+                }
+            };
+            size_t workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), paths.size());
+            std::vector<std::jthread> pool;
+            for (size_t i = 1; i < workers; ++i) {
+                pool.emplace_back(worker);
+            }
+            worker();
+            return parsed;
+        }
+    } // namespace
+
+    NoteService::NoteService(fs::Filesystem& fs, storage::MetadataStore& meta, IoEngine& io, std::filesystem::path root, ContentCache* cache) :
+        m_Fs(fs), m_Meta(meta), m_Io(io), m_Root(std::move(root)), m_Cache(cache) {}
 
     std::string NoteService::note_path(std::string_view id) const { return std::string(id) + ".md"; }
 
     stl::result<std::optional<sync::NoteResponse>> NoteService::get_note(std::string_view id) {
+        trace::Span span("NoteService::get_note");
         auto meta_result = m_Meta.get_note(id);
         if (!meta_result) {
             return stl::make_error<std::optional<sync::NoteResponse>>("{}", meta_result.error());
@@ -25,6 +102,7 @@ namespace sap::cloud::services {
     }
 
     stl::result<sync::NoteResponse> NoteService::create_note(const sync::NoteCreateRequest& req) {
+        trace::Span span("NoteService::create_note");
         // Generate new ID
         std::string id = sync::generate_uuid();
         std::string path = note_path(id);
@@ -35,7 +113,7 @@ namespace sap::cloud::services {
         parsed.content = "# " + req.title + "\n\n" + req.content;
         std::string content = sync::serialize_note(parsed);
         // Write to filesystem
-        auto write_result = m_Fs.write(path, content);
+        auto write_result = metrics::timed_write(content.size(), [&] { return write_note(m_Io, m_Root, path, content); });
         if (!write_result) {
             return stl::make_error<sync::NoteResponse>("{}", write_result.error());
         }
@@ -72,6 +150,7 @@ namespace sap::cloud::services {
     }
 
     stl::result<sync::NoteResponse> NoteService::update_note(std::string_view id, const sync::NoteUpdateRequest& req) {
+        trace::Span span("NoteService::update_note");
         // Get existing note
         auto existing_result = m_Meta.get_note(id);
         if (!existing_result) {
@@ -82,7 +161,7 @@ namespace sap::cloud::services {
         }
         auto& existing = existing_result.value().value();
         // Load current content
-        auto content_result = m_Fs.read_string(existing.path);
+        auto content_result = metrics::timed_read([&] { return read_note(m_Io, m_Root, existing.path); });
         if (!content_result) {
             return stl::make_error<sync::NoteResponse>("{}", content_result.error());
         }
@@ -102,7 +181,7 @@ namespace sap::cloud::services {
         parsed.content = new_content;
         std::string serialized = sync::serialize_note(parsed);
         // Write to filesystem
-        auto write_result = m_Fs.write(existing.path, serialized);
+        auto write_result = metrics::timed_write(serialized.size(), [&] { return write_note(m_Io, m_Root, existing.path, serialized); });
         if (!write_result) {
             return stl::make_error<sync::NoteResponse>("{}", write_result.error());
         }
@@ -138,6 +217,7 @@ namespace sap::cloud::services {
     }
 
     stl::result<> NoteService::delete_note(std::string_view id) {
+        trace::Span span("NoteService::delete_note");
         auto meta_result = m_Meta.get_note(id);
         if (!meta_result) {
             return stl::make_error("{}", meta_result.error());
@@ -159,6 +239,7 @@ namespace sap::cloud::services {
     }
 
     stl::result<sync::NoteListResponse> NoteService::list_notes(const ListOptions& options) {
+        trace::Span span("NoteService::list_notes");
         std::vector<sync::NoteMetadata> notes;
         if (options.search) {
             auto search_result = m_Meta.search_notes(*options.search);
@@ -187,7 +268,7 @@ namespace sap::cloud::services {
         for (size_t i = start; i < end; ++i) {
             auto& meta = notes[i];
             // Load content for preview
-            auto content_result = m_Fs.read_string(meta.path);
+            auto content_result = metrics::timed_read([&] { return read_note(m_Io, m_Root, meta.path); });
             std::string content = content_result ? content_result.value() : "";
             resp.notes.push_back(to_list_item(meta, content));
         }
@@ -195,6 +276,7 @@ namespace sap::cloud::services {
     }
 
     stl::result<sync::TagListResponse> NoteService::get_tags() {
+        trace::Span span("NoteService::get_tags");
         auto tags_result = m_Meta.get_all_tags();
         if (!tags_result) {
             return stl::make_error<sync::TagListResponse>("{}", tags_result.error());
@@ -205,12 +287,14 @@ namespace sap::cloud::services {
     }
 
     stl::result<sync::NoteListResponse> NoteService::get_notes_by_tag(std::string_view tag) {
+        trace::Span span("NoteService::get_notes_by_tag");
         ListOptions options;
         options.tag = std::string(tag);
         return list_notes(options);
     }
 
     stl::result<sync::NoteListResponse> NoteService::search_notes(std::string_view query) {
+        trace::Span span("NoteService::search_notes");
         ListOptions options;
         options.search = std::string(query);
         return list_notes(options);
@@ -221,6 +305,7 @@ namespace sap::cloud::services {
     stl::result<std::vector<sync::NoteMetadata>> NoteService::get_all_metadata() { return m_Meta.get_all_notes(); }
 
     stl::result<size_t> NoteService::scan_and_index() {
+        trace::Span span("NoteService::scan_and_index");
         auto files_result = m_Fs.list_recursive();
         if (!files_result) {
             return stl::make_error<size_t>("{}", files_result.error());
@@ -228,66 +313,307 @@ namespace sap::cloud::services {
         size_t indexed = 0;
         for (const auto& path : files_result.value()) {
             // Only process .md files
-            if (path.size() < 3 || path.substr(path.size() - 3) != ".md") {
+            if (!is_note_path(path)) {
                 continue;
             }
-            auto content_result = m_Fs.read_string(path);
-            if (!content_result) {
-                log::warn("Failed to read note: {}", path);
+            // Unchanged notes (same content hash) are not re-parsed or re-indexed
+            auto index_result = index_path(path);
+            if (!index_result) {
+                log::warn("Failed to index note {}: {}", path, index_result.error());
                 continue;
             }
-            auto parse_result = sync::parse_note(content_result.value());
-            if (!parse_result) {
-                log::warn("Failed to parse note: {}", path);
-                continue;
+            indexed += index_result.value() ? 1 : 0;
+        }
+        log::info("Indexed {} new or changed notes of {}", indexed, files_result.value().size());
+        return indexed;
+    }
+
+    stl::result<size_t> NoteService::rebuild_index(RebuildProgress& progress, std::stop_token stop) {
+        trace::Span span("NoteService::rebuild_index");
+        progress.total = 0;
+        progress.parsed = 0;
+        progress.indexed = 0;
+        progress.failed = 0;
+        auto files_result = m_Fs.list_recursive();
+        if (!files_result) {
+            return stl::make_error<size_t>("{}", files_result.error());
+        }
+        std::vector<std::string> paths;
+        for (auto& path : files_result.value()) {
+            if (is_note_path(path)) {
+                paths.push_back(std::move(path));
             }
-            auto& parsed = parse_result.value();
-            // Extract ID from path (remove .md extension)
-            std::string id = path.substr(0, path.size() - 3);
-            // Check if already exists
-            auto existing_result = m_Meta.get_note(id);
-            sync::Timestamp created_at = sync::now_ms();
-            if (existing_result && existing_result.value()) {
-                created_at = existing_result.value()->created_at;
+        }
+        progress.total = static_cast<i64>(paths.size());
+        log::info("Rebuilding note index from {} notes", paths.size());
+        // Creation times, and modification times of unchanged notes, survive the
+        // rebuild; notes left over at the end no longer exist on disk
+        auto existing_result = m_Meta.get_all_notes();
+        if (!existing_result) {
+            return stl::make_error<size_t>("{}", existing_result.error());
+        }
+        std::unordered_map<std::string, sync::NoteMetadata> existing;
+        std::unordered_set<std::string> stale;
+        for (auto& note : existing_result.value()) {
+            stale.insert(note.id);
+            existing.emplace(note.id, std::move(note));
+        }
+        size_t indexed = 0;
+        // Metadata is written a batch per transaction; the full-text index is
+        // loaded into a staging table and swapped in by the last one, so
+        // searches keep using the old index and other writes go on meanwhile.
+        // Notes another writer touches after `now` keep that writer's version.
+        auto now = sync::now_ms();
+        auto begin_result = m_Meta.transaction([](storage::MetadataStore& store) { return store.begin_fts_rebuild(); });
+        if (!begin_result) {
+            return stl::make_error<size_t>("Note index rebuild failed: {}", begin_result.error());
+        }
+        auto fail = [&](std::string_view error) {
+            auto abandon_result = m_Meta.transaction([](storage::MetadataStore& store) { return store.abandon_fts_rebuild(); });
+            if (!abandon_result) {
+                log::warn("Failed to drop the note index staging table: {}", abandon_result.error());
             }
-            // Build metadata
-            sync::NoteMetadata meta;
-            meta.id = id;
-            meta.path = path;
-            meta.title = parsed.title;
-            meta.tags = parsed.tags;
-            meta.hash = sync::hash_string(content_result.value());
-            meta.created_at = created_at;
-            meta.updated_at = sync::now_ms();
-            meta.is_deleted = false;
-            auto store_result = m_Meta.upsert_note(meta);
-            if (!store_result) {
-                log::warn("Failed to store note metadata: {}", path);
-                continue;
+            return stl::make_error<size_t>("Note index rebuild failed: {}", error);
+        };
+        // Whether id was changed by another writer since the rebuild started
+        auto changed_since_start = [&](storage::MetadataStore& store, const std::string& id) -> stl::result<bool> {
+            auto existing = store.get_note(id);
+            if (!existing) {
+                return stl::make_error<bool>("{}", existing.error());
+            }
+            return existing.value() && existing.value()->updated_at > now;
+        };
+        auto parse = [&](size_t start) {
+            return parse_batch(m_Io, m_Root, std::span(paths).subspan(start, std::min(rebuild_batch_size, paths.size() - start)), progress);
+        };
+        std::future<std::vector<ParsedFile>> next;
+        if (!paths.empty()) {
+            next = std::async(std::launch::async, parse, 0);
+        }
+        i64 logged_decile = 0;
+        for (size_t start = 0; start < paths.size(); start += rebuild_batch_size) {
+            auto batch = next.get();
+            if (start + rebuild_batch_size < paths.size()) {
+                next = std::async(std::launch::async, parse, start + rebuild_batch_size);
+            }
+            if (stop.stop_requested()) {
+                return fail("cancelled");
+            }
+            auto batch_result = m_Meta.transaction([&](storage::MetadataStore& store) -> stl::result<> {
+                for (auto& file : batch) {
+                    sync::NoteMetadata meta;
+                    meta.id = file.path.substr(0, file.path.size() - 3);
+                    // Still on disk, so never removed, even if it can't be read this time
+                    stale.erase(meta.id);
+                    if (!file.note) {
+                        progress.failed++;
+                        log::warn("Skipping note {}: {}", file.path, file.error);
+                        // Its row stays as it was; keep it searchable by its last indexed text
+                        auto keep_result = store.keep_rebuild_fts(meta.id);
+                        if (!keep_result) {
+                            return keep_result;
+                        }
+                        continue;
+                    }
+                    auto& parsed = file.note.value();
+                    auto changed = changed_since_start(store, meta.id);
+                    if (!changed) {
+                        return stl::make_error("{}", changed.error());
+                    }
+                    if (changed.value()) {
+                        continue;
+                    }
+                    meta.path = file.path;
+                    meta.title = parsed.title;
+                    meta.tags = parsed.tags;
+                    meta.hash = std::move(file.hash);
+                    meta.created_at = now;
+                    meta.updated_at = now;
+                    if (auto it = existing.find(meta.id); it != existing.end()) {
+                        meta.created_at = it->second.created_at;
+                        if (!it->second.is_deleted && it->second.hash == meta.hash) {
+                            meta.updated_at = it->second.updated_at;
+                        }
+                    }
+                    meta.is_deleted = false;
+                    auto store_result = store.upsert_note(meta);
+                    if (!store_result) {
+                        return store_result;
+                    }
+                    auto fts_result = store.insert_rebuild_fts(meta.id, parsed.title, parsed.content);
+                    if (!fts_result) {
+                        return fts_result;
+                    }
+                    progress.indexed++;
+                    indexed++;
+                }
+                return stl::success;
+            });
+            if (!batch_result) {
+                return fail(batch_result.error());
             }
-            // Update FTS
-            auto update_result = m_Meta.update_fts(id, parsed.title, parsed.content);
-            if(!update_result)
-                return stl::make_error<size_t>("{}", update_result.error());
-            indexed++;
+            i64 decile = progress.parsed * 10 / std::max<i64>(progress.total, 1);
+            if (decile > logged_decile) {
+                logged_decile = decile;
+                log::info("Rebuilding note index: {}/{} notes", progress.parsed.load(), progress.total.load());
+            }
+        }
+        auto finish_result = m_Meta.transaction([&](storage::MetadataStore& store) -> stl::result<> {
+            for (const auto& id : stale) {
+                auto changed = changed_since_start(store, id);
+                if (!changed) {
+                    return stl::make_error("{}", changed.error());
+                }
+                if (changed.value()) {
+                    continue;
+                }
+                auto delete_result = store.delete_note(id);
+                if (!delete_result) {
+                    return delete_result;
+                }
+            }
+            return store.finish_fts_rebuild(now);
+        });
+        if (!finish_result) {
+            return fail(finish_result.error());
+        }
+        auto optimize_result = m_Meta.optimize_fts();
+        if (!optimize_result) {
+            log::warn("Full-text index optimize failed: {}", optimize_result.error());
         }
-        log::info("Indexed {} notes", indexed);
+        log::info("Rebuilt note index: {} notes indexed, {} skipped, {} removed", indexed, progress.failed.load(), stale.size());
         return indexed;
     }
 
+    stl::result<bool> NoteService::index_path(std::string_view path) {
+        trace::Span span("NoteService::index_path");
+        bool is_note = is_note_path(path);
+        if (!m_Fs.exists(path)) {
+            std::vector<std::string> removed;
+            if (is_note) {
+                auto existing_result = m_Meta.get_note(path.substr(0, path.size() - 3));
+                if (!existing_result) {
+                    return stl::make_error<bool>("{}", existing_result.error());
+                }
+                if (existing_result.value() && !existing_result.value()->is_deleted) {
+                    removed.push_back(existing_result.value()->id);
+                }
+            } else {
+                // A removed directory takes every note below it along
+                auto notes_result = m_Meta.get_all_notes();
+                if (!notes_result) {
+                    return stl::make_error<bool>("{}", notes_result.error());
+                }
+                std::string dir_prefix = std::string(path) + "/";
+                for (const auto& note : notes_result.value()) {
+                    if (note.path.starts_with(dir_prefix)) {
+                        removed.push_back(note.id);
+                    }
+                }
+            }
+            for (const auto& id : removed) {
+                auto delete_result = m_Meta.delete_note(id);
+                if (!delete_result) {
+                    return stl::make_error<bool>("{}", delete_result.error());
+                }
+                log::debug("Indexed note removal: {}", id);
+            }
+            return !removed.empty();
+        }
+        if (!is_note) {
+            return false;
+        }
+        auto content_result = metrics::timed_read([&] { return read_note(m_Io, m_Root, path); });
+        if (!content_result) {
+            return stl::make_error<bool>("{}", content_result.error());
+        }
+        std::string id(path.substr(0, path.size() - 3));
+        auto existing_result = m_Meta.get_note(id);
+        if (existing_result && existing_result.value() && !existing_result.value()->is_deleted &&
+            existing_result.value()->hash == sync::hash_string(content_result.value())) {
+            return false;
+        }
+        auto index_result = index_note(std::string(path), content_result.value());
+        if (!index_result) {
+            return stl::make_error<bool>("{}", index_result.error());
+        }
+        log::debug("Indexed note change: {}", path);
+        return true;
+    }
+
+    stl::result<> NoteService::index_note(const std::string& path, const std::string& content) {
+        auto parse_result = sync::parse_note(content);
+        if (!parse_result) {
+            return stl::make_error("Failed to parse note: {}", parse_result.error());
+        }
+        auto& parsed = parse_result.value();
+        // Extract ID from path (remove .md extension)
+        std::string id = path.substr(0, path.size() - 3);
+        // Check if already exists
+        auto existing_result = m_Meta.get_note(id);
+        sync::Timestamp created_at = sync::now_ms();
+        if (existing_result && existing_result.value()) {
+            created_at = existing_result.value()->created_at;
+        }
+        // Build metadata
+        sync::NoteMetadata meta;
+        meta.id = id;
+        meta.path = path;
+        meta.title = parsed.title;
+        meta.tags = parsed.tags;
+        meta.hash = sync::hash_string(content);
+        meta.created_at = created_at;
+        meta.updated_at = sync::now_ms();
+        meta.is_deleted = false;
+        auto store_result = m_Meta.upsert_note(meta);
+        if (!store_result) {
+            return stl::make_error("Failed to store note metadata: {}", store_result.error());
+        }
+        return m_Meta.update_fts(id, parsed.title, parsed.content);
+    }
+
     stl::result<sync::NoteResponse> NoteService::load_note_response(const sync::NoteMetadata& meta) {
-        auto content_result = m_Fs.read_string(meta.path);
+        trace::Span span("NoteService::load_note_response");
+        if (auto cached = cached_response(meta)) {
+            return std::move(*cached);
+        }
+        auto content_result = metrics::timed_read([&] { return read_note(m_Io, m_Root, meta.path); });
         if (!content_result) {
             return stl::make_error<sync::NoteResponse>("{}", content_result.error());
         }
-        auto parse_result = sync::parse_note(content_result.value());
+        return note_response(meta, content_result.value());
+    }
+
+    stl::result<std::filesystem::path> NoteService::resolve(std::string_view path) const { return resolve_under(m_Root, path); }
+
+    stl::result<sync::NoteResponse> NoteService::note_response(const sync::NoteMetadata& meta, const std::string& content) const {
+        auto parse_result = sync::parse_note(content);
         if (!parse_result) {
             return stl::make_error<sync::NoteResponse>("{}", parse_result.error());
         }
+        // Only cache content that still matches the indexed hash
+        if (m_Cache && m_Cache->admits(parse_result.value().content.size()) && sync::hash_string(content) == meta.hash) {
+            m_Cache->put(ECacheKind::Note, meta.hash, parse_result.value().content);
+        }
+        return make_response(meta, std::move(parse_result.value().content));
+    }
+
+    std::optional<sync::NoteResponse> NoteService::cached_response(const sync::NoteMetadata& meta) const {
+        if (!m_Cache) {
+            return std::nullopt;
+        }
+        auto body = m_Cache->get(ECacheKind::Note, meta.hash);
+        if (!body) {
+            return std::nullopt;
+        }
+        return make_response(meta, *body);
+    }
+
+    sync::NoteResponse NoteService::make_response(const sync::NoteMetadata& meta, std::string body) {
         sync::NoteResponse resp;
         resp.id = meta.id;
         resp.title = meta.title;
-        resp.content = parse_result.value().content;
+        resp.content = std::move(body);
         resp.tags = meta.tags;
         resp.created_at = meta.created_at;
         resp.updated_at = meta.updated_at;
@@ -0,0 +1,303 @@
+#include <fstream>
+#include <sap_cloud/fast_hash.h>
+#include <sap_cloud/mapped_file.h>
+#include <sap_cloud/metrics.h>
+#include <sap_cloud/services/upload_service.h>
+#include <sap_core/log.h>
+#include <sap_sync/hash.h>
+#include <sap_sync/protocol.h>
+
+namespace sap::cloud::services {
+
+    namespace {
+        // Relative, non-escaping path outside the staging area, normalized as
+        // the index stores it; nullopt if path is not one
+        std::optional<std::string> normalize_target(std::string_view path) {
+            if (path.empty() || path.front() == '/') {
+                return std::nullopt;
+            }
+            std::filesystem::path rel = std::filesystem::path(std::string(path)).lexically_normal();
+            if (rel.empty() || rel.is_absolute()) {
+                return std::nullopt;
+            }
+            auto first = rel.begin()->string();
+            if (first == ".." || first == "." || first == UPLOAD_STAGING_DIR) {
+                return std::nullopt;
+            }
+            return rel.generic_string();
+        }
+    } // namespace
+
+    UploadService::UploadService(fs::Filesystem& fs, storage::MetadataStore& meta, IoEngine& io, std::filesystem::path files_root,
+                                 i64 session_expiry) :
+        m_Fs(fs), m_Meta(meta), m_Io(io), m_FilesRoot(std::move(files_root)), m_StagingDir(m_FilesRoot / UPLOAD_STAGING_DIR),
+        m_SessionExpiry(session_expiry) {}
+
+    std::filesystem::path UploadService::staged_path(std::string_view id) const { return m_StagingDir / (std::string(id) + ".part"); }
+
+    UploadService::SessionLock UploadService::lock_session(const std::string& id) {
+        std::shared_ptr<std::mutex> mutex;
+        {
+            std::lock_guard<std::mutex> lock(m_LocksMutex);
+            auto& slot = m_Locks[id];
+            mutex = slot.lock();
+            if (!mutex) {
+                // The last holder drops the entry, unless a new lock has taken its place
+                mutex = std::shared_ptr<std::mutex>(new std::mutex, [this, id](std::mutex* m) {
+                    {
+                        std::lock_guard<std::mutex> lock(m_LocksMutex);
+                        auto it = m_Locks.find(id);
+                        if (it != m_Locks.end() && it->second.expired()) {
+                            m_Locks.erase(it);
+                        }
+                    }
+                    delete m;
+                });
+                slot = mutex;
+            }
+        }
+        return SessionLock(std::move(mutex));
+    }
+
+    stl::result<storage::UploadSession> UploadService::load_active(std::string_view id) {
+        auto session_result = m_Meta.get_upload(id);
+        if (!session_result) {
+            return stl::make_error<storage::UploadSession>("{}", session_result.error());
+        }
+        if (!session_result.value()) {
+            return stl::make_error<storage::UploadSession>("Upload session not found");
+        }
+        if (session_result.value()->expires_at < sync::now_ms()) {
+            return stl::make_error<storage::UploadSession>("Upload session expired");
+        }
+        return session_result.value().value();
+    }
+
+    stl::result<storage::UploadSession> UploadService::create_session(std::string_view path, i64 size,
+                                                                      std::optional<sync::Timestamp> client_mtime) {
+        auto target = normalize_target(path);
+        if (!target) {
+            return stl::make_error<storage::UploadSession>("Invalid upload path: {}", path);
+        }
+        std::error_code ec;
+        if (std::filesystem::is_directory(m_FilesRoot / *target, ec)) {
+            return stl::make_error<storage::UploadSession>("Upload target is a directory: {}", *target);
+        }
+        std::filesystem::create_directories(m_StagingDir, ec);
+        if (ec) {
+            return stl::make_error<storage::UploadSession>("Failed to create staging directory: {}", ec.message());
+        }
+        auto now = sync::now_ms();
+        storage::UploadSession session;
+        session.id = sync::generate_uuid();
+        session.path = std::move(*target);
+        session.size = size;
+        session.offset = 0;
+        session.mtime = client_mtime.value_or(0);
+        session.created_at = now;
+        session.expires_at = now + m_SessionExpiry * 1000;
+        std::ofstream staged(staged_path(session.id), std::ios::binary | std::ios::trunc);
+        if (!staged) {
+            return stl::make_error<storage::UploadSession>("Failed to create staging file");
+        }
+        auto store_result = m_Meta.create_upload(session);
+        if (!store_result) {
+            return stl::make_error<storage::UploadSession>("{}", store_result.error());
+        }
+        log::debug("Created upload session {} for {}", session.id, session.path);
+        return session;
+    }
+
+    stl::result<std::optional<storage::UploadSession>> UploadService::get_session(std::string_view id) { return m_Meta.get_upload(id); }
+
+    stl::result<storage::UploadSession> UploadService::append_chunk(std::string_view id, i64 offset, std::string_view data) {
+        auto lock = lock_session(std::string(id));
+        auto session_result = load_active(id);
+        if (!session_result) {
+            return session_result;
+        }
+        auto& session = session_result.value();
+        if (offset != session.offset) {
+            return stl::make_error<storage::UploadSession>("Offset mismatch: expected {}, got {}", session.offset, offset);
+        }
+        i64 new_offset = offset + static_cast<i64>(data.size());
+        if (session.size >= 0 && new_offset > session.size) {
+            return stl::make_error<storage::UploadSession>("Chunk exceeds declared upload size");
+        }
+        // Bytes past the recorded offset (from an interrupted write) are overwritten
+        std::fstream staged(staged_path(id), std::ios::binary | std::ios::in | std::ios::out);
+        if (!staged) {
+            return stl::make_error<storage::UploadSession>("Staging file missing for upload {}", id);
+        }
+        {
+            metrics::ScopedTimer timer(metrics::fs().write);
+            staged.seekp(offset);
+            staged.write(data.data(), static_cast<std::streamsize>(data.size()));
+            staged.flush();
+        }
+        if (!staged) {
+            return stl::make_error<storage::UploadSession>("Failed to write chunk for upload {}", id);
+        }
+        metrics::fs().write_bytes.inc(data.size());
+        staged.close();
+        // The recorded offset must never run ahead of the bytes that survive a crash
+        if (m_Io.durability() != EDurability::Fast) {
+            auto sync_result = m_Io.fsync(staged_path(id));
+            if (!sync_result) {
+                return stl::make_error<storage::UploadSession>("{}", sync_result.error());
+            }
+        }
+        auto offset_result = m_Meta.set_upload_offset(id, new_offset);
+        if (!offset_result) {
+            return stl::make_error<storage::UploadSession>("{}", offset_result.error());
+        }
+        session.offset = new_offset;
+        return session;
+    }
+
+    stl::result<sync::FileMetadata> UploadService::finalize(std::string_view id) {
+        auto lock = lock_session(std::string(id));
+        auto session_result = load_active(id);
+        if (!session_result) {
+            return stl::make_error<sync::FileMetadata>("{}", session_result.error());
+        }
+        auto& session = session_result.value();
+        if (session.size >= 0 && session.offset != session.size) {
+            return stl::make_error<sync::FileMetadata>("Upload incomplete: {} of {} bytes", session.offset, session.size);
+        }
+        auto staged = staged_path(id);
+        std::error_code ec;
+        std::filesystem::resize_file(staged, static_cast<std::uintmax_t>(session.offset), ec);
+        if (ec) {
+            return stl::make_error<sync::FileMetadata>("Failed to truncate staged upload: {}", ec.message());
+        }
+        // Hash staged content
+        std::string hash;
+        std::string fast;
+        {
+            auto content = metrics::timed_read([&] { return MappedFile::open(staged, MappedFile::EAccess::Sequential); });
+            if (!content) {
+                return stl::make_error<sync::FileMetadata>("Failed to read staged upload {}: {}", id, content.error());
+            }
+            hash = sync::hash_bytes(content.value().data(), content.value().size());
+            fast = fast_hash(content.value().data(), content.value().size());
+        }
+        // Sessions created before paths were normalized hold the raw request path
+        session.path = std::filesystem::path(session.path).lexically_normal().generic_string();
+        // Preserve created_at of an existing file
+        auto existing_result = m_Meta.get_file(session.path);
+        auto now = sync::now_ms();
+        sync::Timestamp created_at = now;
+        if (existing_result && existing_result.value() && !existing_result.value()->is_deleted) {
+            created_at = existing_result.value()->created_at;
+        }
+        // Move into place (same filesystem, so this is atomic)
+        auto target = m_FilesRoot / session.path;
+        std::filesystem::create_directories(target.parent_path(), ec);
+        if (ec) {
+            return stl::make_error<sync::FileMetadata>("Failed to create directory: {}", ec.message());
+        }
+        // A file being replaced is set aside rather than overwritten, so a failed
+        // metadata commit can restore it and leave the session retryable
+        auto previous = m_StagingDir / (std::string(id) + ".prev");
+        auto status = std::filesystem::symlink_status(target, ec);
+        // A directory created since the session started is never set aside
+        if (std::filesystem::exists(status) && !std::filesystem::is_regular_file(status)) {
+            return stl::make_error<sync::FileMetadata>("Upload target is not a regular file: {}", session.path);
+        }
+        bool replacing = std::filesystem::exists(status);
+        if (replacing) {
+            auto aside = m_Io.rename(target, previous);
+            if (!aside) {
+                return stl::make_error<sync::FileMetadata>("Failed to move replaced file aside: {}", aside.error());
+            }
+        }
+        auto roll_back = [&](bool committed) {
+            if (committed) {
+                auto back = m_Io.rename(target, staged);
+                if (!back) {
+                    log::error("Cannot return upload {} to staging: {}", id, back.error());
+                }
+            }
+            if (replacing) {
+                auto restored = m_Io.rename(previous, target);
+                if (!restored) {
+                    log::error("Cannot restore {} after a failed upload: {}", session.path, restored.error());
+                }
+            }
+        };
+        auto move_result = m_Io.commit(staged, target);
+        if (!move_result) {
+            roll_back(false);
+            return stl::make_error<sync::FileMetadata>("Failed to move upload into place: {}", move_result.error());
+        }
+        if (session.mtime != 0) {
+            auto res = m_Fs.set_mtime(session.path, session.mtime);
+            if (!res) {
+                roll_back(true);
+                return stl::make_error<sync::FileMetadata>("{}", res.error());
+            }
+        }
+        sync::FileMetadata meta;
+        meta.path = session.path;
+        meta.hash = std::move(hash);
+        meta.size = session.offset;
+        if (session.mtime != 0) {
+            meta.mtime = session.mtime;
+        } else {
+            auto mtime_result = m_Fs.mtime(session.path);
+            meta.mtime = mtime_result ? mtime_result.value() : now;
+        }
+        meta.created_at = created_at;
+        meta.updated_at = now;
+        meta.is_deleted = false;
+        auto commit_result = m_Meta.commit_upload(id, meta, fast);
+        if (!commit_result) {
+            roll_back(true);
+            return stl::make_error<sync::FileMetadata>("{}", commit_result.error());
+        }
+        if (replacing) {
+            std::filesystem::remove(previous, ec);
+        }
+        log::debug("Finalized upload {}: {} ({} bytes)", id, meta.path, meta.size);
+        return meta;
+    }
+
+    stl::result<> UploadService::abort(std::string_view id) {
+        auto lock = lock_session(std::string(id));
+        auto session_result = load_active(id);
+        if (!session_result) {
+            return stl::make_error("{}", session_result.error());
+        }
+        std::error_code ec;
+        std::filesystem::remove(staged_path(id), ec);
+        if (ec) {
+            log::warn("Failed to remove staged upload {}: {}", id, ec.message());
+        }
+        return m_Meta.remove_upload(id);
+    }
+
+    stl::result<size_t> UploadService::cleanup_expired(i64 limit) {
+        auto ids = m_Meta.get_expired_uploads(sync::now_ms(), limit);
+        if (!ids) {
+            return stl::make_error<size_t>("{}", ids.error());
+        }
+        for (const auto& id : ids.value()) {
+            auto lock = lock_session(id);
+            std::error_code ec;
+            std::filesystem::remove(staged_path(id), ec);
+            if (ec) {
+                log::warn("Failed to remove staged upload {}: {}", id, ec.message());
+            }
+            auto r = m_Meta.remove_upload(id);
+            if (!r) {
+                return stl::make_error<size_t>("{}", r.error());
+            }
+        }
+        if (!ids->empty()) {
+            log::debug("Removed {} expired upload sessions", ids->size());
+        }
+        return ids->size();
+    }
+
+} // namespace sap::cloud::services
@@ -0,0 +1,60 @@
+#include <sap_cloud/task.h>
+
+namespace sap::cloud {
+
+    namespace {
+        thread_local RunLoop* current_loop = nullptr;
+    } // namespace
+
+    RunLoop* RunLoop::current() { return current_loop; }
+
+    void RunLoop::post(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Ready.push_back(handle);
+        }
+        m_Wake.notify_one();
+    }
+
+    void RunLoop::run() {
+        while (true) {
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [this] { return m_Stopped || !m_Ready.empty(); });
+                if (m_Stopped) {
+                    return;
+                }
+                handle = m_Ready.front();
+                m_Ready.pop_front();
+            }
+            handle.resume();
+        }
+    }
+
+    void RunLoop::stop() {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopped = true;
+        }
+        m_Wake.notify_one();
+    }
+
+    RunLoopScope::RunLoopScope(RunLoop& loop) : m_Previous(std::exchange(current_loop, &loop)) {}
+
+    RunLoopScope::~RunLoopScope() { current_loop = m_Previous; }
+
+    namespace detail {
+        void run_driver(SyncWaitDriver driver, RunLoop& loop) {
+            driver.handle.promise().loop = &loop;
+            loop.post(driver.handle);
+            loop.run();
+            auto exception = driver.handle.promise().exception;
+            driver.handle.destroy();
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+    } // namespace detail
+
+} // namespace sap::cloud
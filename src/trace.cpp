@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sap_cloud/json_writer.h>
+#include <sap_cloud/trace.h>
+#include <sap_core/log.h>
+#include <sstream>
+#include <utility>
+
+namespace sap::cloud::trace {
+
+    namespace {
+        const auto epoch = std::chrono::steady_clock::now();
+
+        i64 now_ns() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count(); }
+
+        std::atomic<u64> next_request_id{1};
+        std::atomic<u32> next_thread_id{1};
+        std::atomic<i64> slow_threshold_ns{0};
+
+        // Only the owning thread writes; the mutex is uncontended except while exporting
+        struct Ring {
+            std::mutex mutex;
+            std::array<SpanRecord, ring_capacity> records{};
+            u64 written = 0;
+            u32 thread_id = next_thread_id.fetch_add(1, std::memory_order_relaxed);
+
+            void push(const SpanRecord& record) {
+                std::lock_guard<std::mutex> lock(mutex);
+                records[written % ring_capacity] = record;
+                ++written;
+            }
+
+            template <typename Fn>
+            void for_each(Fn&& fn) {
+                std::lock_guard<std::mutex> lock(mutex);
+                u64 count = std::min<u64>(written, ring_capacity);
+                for (u64 i = written - count; i < written; ++i) {
+                    fn(records[i % ring_capacity]);
+                }
+            }
+        };
+
+        struct RingList {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<Ring>> rings;
+        };
+
+        RingList& ring_list() {
+            static RingList list;
+            return list;
+        }
+
+        // Registers this thread's ring on first use and drops it on thread exit
+        struct LocalState {
+            std::shared_ptr<Ring> ring;
+            u64 request_id = 0;
+            u32 depth = 0;
+
+            LocalState() : ring(std::make_shared<Ring>()) {
+                auto& list = ring_list();
+                std::lock_guard<std::mutex> lock(list.mutex);
+                list.rings.push_back(ring);
+            }
+
+            ~LocalState() {
+                auto& list = ring_list();
+                std::lock_guard<std::mutex> lock(list.mutex);
+                std::erase(list.rings, ring);
+            }
+        };
+
+        LocalState& local() {
+            thread_local LocalState state;
+            return state;
+        }
+    } // namespace
+
+    Span::Span(const char* name) : m_Name(name), m_Start(now_ns()), m_Depth(local().depth++) {}
+
+    Span::~Span() {
+        auto& state = local();
+        --state.depth;
+        state.ring->push({m_Name, state.request_id, m_Start, now_ns(), m_Depth, state.ring->thread_id});
+    }
+
+    // The root span is opened after the request id is installed and closed before
+    // it is restored, so it is tagged with its own request
+    RequestScope::RequestScope(const char* name, std::string description) :
+        m_Id(next_request_id.fetch_add(1, std::memory_order_relaxed)), m_Parent(std::exchange(local().request_id, m_Id)),
+        m_Description(std::move(description)), m_Start(now_ns()) {
+        m_Root.emplace(name);
+    }
+
+    RequestScope::~RequestScope() {
+        m_Root.reset();
+        i64 threshold = slow_threshold_ns.load(std::memory_order_relaxed);
+        i64 elapsed = now_ns() - m_Start;
+        if (threshold > 0 && elapsed >= threshold) {
+            auto spans = request_spans(m_Id);
+            log::warn("Slow request {} took {:.3f} ms:\n{}", m_Description, static_cast<double>(elapsed) / 1e6, format_tree(spans));
+        }
+        local().request_id = m_Parent;
+    }
+
+    void set_slow_threshold(std::chrono::milliseconds threshold) {
+        slow_threshold_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count(), std::memory_order_relaxed);
+    }
+
+    std::vector<SpanRecord> request_spans(u64 request_id) {
+        std::vector<SpanRecord> spans;
+        local().ring->for_each([&](const SpanRecord& record) {
+            if (record.request_id == request_id) {
+                spans.push_back(record);
+            }
+        });
+        // Spans are recorded when they close, so children precede their parent
+        std::ranges::sort(spans, [](const SpanRecord& a, const SpanRecord& b) {
+            return a.start_ns != b.start_ns ? a.start_ns < b.start_ns : a.depth < b.depth;
+        });
+        return spans;
+    }
+
+    std::string format_tree(const std::vector<SpanRecord>& spans) {
+        if (spans.empty()) {
+            return {};
+        }
+        u32 base = std::ranges::min_element(spans, {}, &SpanRecord::depth)->depth;
+        std::ostringstream out;
+        for (const auto& span : spans) {
+            out << std::string(static_cast<size_t>(span.depth - base) * 2 + 2, ' ') << span.name << ' '
+                << static_cast<double>(span.end_ns - span.start_ns) / 1e6 << " ms\n";
+        }
+        return out.str();
+    }
+
+    std::string export_chrome_trace() {
+        std::vector<std::shared_ptr<Ring>> rings;
+        {
+            auto& list = ring_list();
+            std::lock_guard<std::mutex> lock(list.mutex);
+            rings = list.rings;
+        }
+        std::string out;
+        json::Writer w(out);
+        w.begin_object();
+        w.key("displayTimeUnit");
+        w.value("ms");
+        w.key("traceEvents");
+        w.begin_array();
+        for (const auto& ring : rings) {
+            ring->for_each([&](const SpanRecord& record) {
+                // Complete ("X") events with microsecond timestamps
+                w.begin_object();
+                w.key("name");
+                w.value(record.name);
+                w.key("ph");
+                w.value("X");
+                w.key("ts");
+                w.value(record.start_ns / 1000);
+                w.key("dur");
+                w.value((record.end_ns - record.start_ns) / 1000);
+                w.key("pid");
+                w.value(static_cast<i64>(1));
+                w.key("tid");
+                w.value(static_cast<i64>(record.thread_id));
+                w.key("args");
+                w.begin_object();
+                w.key("request");
+                w.value(static_cast<i64>(record.request_id));
+                w.end_object();
+                w.end_object();
+            });
+        }
+        w.end_array();
+        w.end_object();
+        return out;
+    }
+
+} // namespace sap::cloud::trace
@@ -1,11 +1,38 @@
+#include <algorithm>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
 #include <gtest/gtest.h>
+#include <latch>
+#include <limits>
+#include <sap_cloud/auth_manager.h>
+#include <sap_cloud/binary_codec.h>
+#include <sap_cloud/bloom_filter.h>
 #include <sap_cloud/services/file_service.h>
+#include <sap_cloud/services/notes_service.h>
+#include <sap_cloud/services/upload_service.h>
+#include <sap_cloud/json_reader.h>
+#include <sap_cloud/json_writer.h>
 #include <sap_cloud/metadata.h>
+#include <sap_cloud/metrics.h>
+#include <sap_cloud/router.h>
+#include <sap_cloud/task.h>
+#include <sap_cloud/trace.h>
 #include <sap_cloud/config.h>
+#include <sap_cloud/content_cache.h>
+#include <sap_cloud/executor.h>
+#include <sap_cloud/fast_hash.h>
+#include <sap_cloud/file_index.h>
+#include <sap_cloud/file_watcher.h>
+#include <sap_cloud/io_engine.h>
+#include <sap_cloud/live_indexer.h>
+#include <sap_cloud/maintenance.h>
+#include <sap_cloud/mapped_file.h>
+#include <sap_cloud/merkle_tree.h>
 #include <sap_fs/fs.h>
+#include <sap_sync/hash.h>
 #include <sap_sync/sync_types.h>
+#include <thread>
 
 using namespace sap;
 using namespace sap::cloud;
@@ -51,10 +78,14 @@ protected:
         auto store_result = storage::MetadataStore::open(m_DbPath);
         ASSERT_TRUE(store_result.has_value());
         m_Store = std::make_unique<storage::MetadataStore>(std::move(store_result.value()));
-        m_Service = std::make_unique<services::FileService>(*m_Fs, *m_Store);
+        auto io_result = IoEngine::create();
+        ASSERT_TRUE(io_result.has_value()) << io_result.error();
+        m_Io = std::move(io_result.value());
+        m_Service = std::make_unique<services::FileService>(*m_Fs, *m_Store, *m_Io, m_TestDir / "files");
     }
     void TearDown() override {
         m_Service.reset();
+        m_Io.reset();
         m_Store.reset();
         m_Fs.reset();
         sfs::remove_all(m_TestDir);
@@ -63,9 +94,68 @@ protected:
     sfs::path m_DbPath;
     std::unique_ptr<fs::Filesystem> m_Fs;
     std::unique_ptr<storage::MetadataStore> m_Store;
+    std::unique_ptr<IoEngine> m_Io;
     std::unique_ptr<services::FileService> m_Service;
 };
 
+class UploadServiceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_TestDir = sfs::temp_directory_path() / "sap_drive_upload_test";
+        m_FilesRoot = m_TestDir / "files";
+        sfs::create_directories(m_FilesRoot);
+        m_Fs = std::make_unique<fs::Filesystem>(m_FilesRoot);
+        auto store_result = storage::MetadataStore::open(m_TestDir / "test.db");
+        ASSERT_TRUE(store_result.has_value());
+        m_Store = std::make_unique<storage::MetadataStore>(std::move(store_result.value()));
+        auto io_result = IoEngine::create();
+        ASSERT_TRUE(io_result.has_value()) << io_result.error();
+        m_Io = std::move(io_result.value());
+        m_Service = std::make_unique<services::UploadService>(*m_Fs, *m_Store, *m_Io, m_FilesRoot, 3600);
+    }
+    void TearDown() override {
+        m_Service.reset();
+        m_Io.reset();
+        m_Store.reset();
+        m_Fs.reset();
+        sfs::remove_all(m_TestDir);
+    }
+    sfs::path m_TestDir;
+    sfs::path m_FilesRoot;
+    std::unique_ptr<fs::Filesystem> m_Fs;
+    std::unique_ptr<storage::MetadataStore> m_Store;
+    std::unique_ptr<IoEngine> m_Io;
+    std::unique_ptr<services::UploadService> m_Service;
+};
+
+class NoteServiceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        m_TestDir = sfs::temp_directory_path() / "sap_drive_notes_test";
+        sfs::create_directories(m_TestDir / "notes");
+        m_Fs = std::make_unique<fs::Filesystem>(m_TestDir / "notes");
+        auto store_result = storage::MetadataStore::open(m_TestDir / "test.db");
+        ASSERT_TRUE(store_result.has_value());
+        m_Store = std::make_unique<storage::MetadataStore>(std::move(store_result.value()));
+        auto io_result = IoEngine::create();
+        ASSERT_TRUE(io_result.has_value()) << io_result.error();
+        m_Io = std::move(io_result.value());
+        m_Service = std::make_unique<services::NoteService>(*m_Fs, *m_Store, *m_Io, m_TestDir / "notes");
+    }
+    void TearDown() override {
+        m_Service.reset();
+        m_Io.reset();
+        m_Store.reset();
+        m_Fs.reset();
+        sfs::remove_all(m_TestDir);
+    }
+    sfs::path m_TestDir;
+    std::unique_ptr<fs::Filesystem> m_Fs;
+    std::unique_ptr<storage::MetadataStore> m_Store;
+    std::unique_ptr<IoEngine> m_Io;
+    std::unique_ptr<services::NoteService> m_Service;
+};
+
 TEST_F(FilesystemTest, WriteAndRead) {
     std::vector<u8> content = {'H', 'e', 'l', 'l', 'o'};
     auto write_result = m_Fs->write("test.txt", content);
@@ -273,6 +363,380 @@ TEST_F(MetadataStoreTest, AuthTokenExpiry) {
     EXPECT_FALSE(result.value());
 }
 
+TEST_F(MetadataStoreTest, AuthWritesGoThroughWriter) {
+    ASSERT_TRUE(m_Store->start_writer().has_value());
+    auto now = sync::now_ms() / 1000;
+    ASSERT_TRUE(m_Store->store_token("token", now + 3600).has_value());
+    ASSERT_TRUE(m_Store->store_token("stale", now - 100).has_value());
+    EXPECT_TRUE(m_Store->validate_token("token").value());
+    ASSERT_TRUE(m_Store->store_challenge("nonce", "key", now + 60).has_value());
+    EXPECT_FALSE(m_Store->validate_challenge("nonce", "other-key").value());
+    // Challenges are consumed by the first successful check
+    EXPECT_TRUE(m_Store->validate_challenge("nonce", "key").value());
+    EXPECT_FALSE(m_Store->validate_challenge("nonce", "key").value());
+    ASSERT_TRUE(m_Store->cleanup_expired_tokens().has_value());
+    ASSERT_TRUE(m_Store->cleanup_expired_challenges().has_value());
+    auto left = m_Store->database().query("SELECT token FROM auth_tokens");
+    ASSERT_TRUE(left.has_value());
+    EXPECT_EQ(left.value().size(), 1);
+    EXPECT_TRUE(m_Store->incremental_vacuum(10).has_value());
+}
+
+namespace {
+    // "<type> <base64>" of a public key checked in under tests/fixtures
+    std::string fixture_key(std::string_view name) {
+        std::ifstream in(sfs::path(SAP_TEST_FIXTURES_DIR) / name);
+        std::string type, blob;
+        in >> type >> blob;
+        return type + " " + blob;
+    }
+} // namespace
+
+TEST_F(MetadataStoreTest, AuthorizedKeyLookup) {
+    auto alice = fixture_key("alice_ed25519.pub");
+    auto bob = fixture_key("bob_ed25519.pub");
+    auto carol = fixture_key("carol_ed25519.pub");
+    ASSERT_EQ(alice.size(), 80u);
+    auto keys_path = sfs::temp_directory_path() / "sap_drive_test_authorized_keys";
+    {
+        std::ofstream keys(keys_path);
+        keys << "# comment line\n"
+             << alice << " alice@laptop\n"
+             << "from=\"10.0.0.0/8\" " << bob << " bob@desktop\n";
+    }
+    AuthConfig config;
+    config.authorized_keys = keys_path;
+    auth::AuthManager auth(*m_Store, config);
+    ASSERT_TRUE(auth.load_authorized_keys().has_value());
+    // Comments and options don't take part in matching
+    EXPECT_TRUE(auth.is_authorized(alice));
+    EXPECT_TRUE(auth.is_authorized(alice + " other-comment"));
+    EXPECT_TRUE(auth.is_authorized(bob + " bob@desktop"));
+    EXPECT_FALSE(auth.is_authorized(carol));
+    EXPECT_FALSE(auth.is_authorized(""));
+    // Fingerprints as printed by ssh-keygen -lf for the fixtures
+    auto held = auth.find_key(alice);
+    ASSERT_NE(held, nullptr);
+    EXPECT_EQ(held->fingerprint, "SHA256:ngG+80Bc026wgzUYl4S7UojadQiOVFoM1VmvXOnHPCg");
+    EXPECT_EQ(auth.find_key(bob)->fingerprint, "SHA256:zma0wusBpBTIEHXxihwhksc3wubeP2PxOLKqk70iYwY");
+    EXPECT_EQ(auth::key_fingerprint(carol), "SHA256:Zfhs+cBufpFwXp6bTAKIb4IcEUmR/VyYy+zziD3pOp8");
+    EXPECT_EQ(auth::key_fingerprint("ssh-ed25519 not*base64"), "");
+    // A held key survives a reload that revokes it
+    {
+        std::ofstream keys(keys_path, std::ios::trunc);
+        keys << bob << " bob@desktop\n";
+    }
+    ASSERT_TRUE(auth.reload_authorized_keys().has_value());
+    EXPECT_FALSE(auth.is_authorized(alice));
+    EXPECT_EQ(held->canonical, alice);
+    sfs::remove(keys_path);
+}
+
+TEST_F(MetadataStoreTest, CompactTombstones) {
+    auto now = sync::now_ms();
+    auto make_file = [](std::string path, sync::Timestamp updated_at, bool deleted) {
+        sync::FileMetadata meta;
+        meta.path = std::move(path);
+        meta.hash = "hash";
+        meta.size = 1;
+        meta.mtime = meta.created_at = meta.updated_at = updated_at;
+        meta.is_deleted = deleted;
+        return meta;
+    };
+    auto res = m_Store->upsert_file(make_file("old_deleted.txt", 1000, true));
+    res = m_Store->upsert_file(make_file("new_deleted.txt", now, true));
+    res = m_Store->upsert_file(make_file("old_live.txt", 1000, false));
+    sync::NoteMetadata note;
+    note.id = "old-note";
+    note.path = "old-note.md";
+    note.title = "Old";
+    note.hash = "notehash";
+    note.created_at = note.updated_at = 1000;
+    note.is_deleted = true;
+    note.tags = {"archived"};
+    res = m_Store->upsert_note(note);
+    auto removed = m_Store->compact_tombstones(now - 60000, 100);
+    ASSERT_TRUE(removed.has_value()) << removed.error();
+    EXPECT_EQ(removed.value(), 2);
+    EXPECT_FALSE(m_Store->get_file("old_deleted.txt").value().has_value());
+    EXPECT_TRUE(m_Store->get_file("new_deleted.txt").value().has_value());
+    EXPECT_TRUE(m_Store->get_file("old_live.txt").value().has_value());
+    EXPECT_FALSE(m_Store->get_note("old-note").value().has_value());
+    // Nothing left to compact
+    removed = m_Store->compact_tombstones(now - 60000, 100);
+    ASSERT_TRUE(removed.has_value());
+    EXPECT_EQ(removed.value(), 0);
+    // With a writer the batch is one of its intents, and the file index hears about it
+    ASSERT_TRUE(m_Store->enable_file_index().has_value());
+    ASSERT_TRUE(m_Store->start_writer().has_value());
+    res = m_Store->upsert_file(make_file("late_deleted.txt", 2000, true));
+    removed = m_Store->compact_tombstones(now - 60000, 100);
+    ASSERT_TRUE(removed.has_value()) << removed.error();
+    EXPECT_EQ(removed.value(), 1);
+    auto files = m_Store->get_all_files();
+    ASSERT_TRUE(files.has_value());
+    EXPECT_FALSE(std::ranges::any_of(files.value(), [](const auto& f) { return f.path == "late_deleted.txt"; }));
+}
+
+TEST_F(MetadataStoreTest, CleanupExpiredChallenges) {
+    auto now = sync::now_ms() / 1000;
+    auto res = m_Store->store_challenge("expired", "key", now - 100);
+    res = m_Store->store_challenge("valid", "key", now + 100);
+    ASSERT_TRUE(m_Store->cleanup_expired_challenges().has_value());
+    auto rows = m_Store->database().query("SELECT challenge FROM auth_challenges");
+    ASSERT_TRUE(rows.has_value());
+    ASSERT_EQ(rows.value().size(), 1);
+    EXPECT_EQ(rows.value()[0].get<std::string>("challenge"), "valid");
+}
+
+TEST_F(MetadataStoreTest, GroupCommitsConcurrentWrites) {
+    storage::WriterOptions options;
+    options.max_batch = 16;
+    options.window = std::chrono::milliseconds(2);
+    ASSERT_TRUE(m_Store->start_writer(options).has_value());
+    constexpr int threads = 8;
+    constexpr int per_thread = 25;
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t) {
+        writers.emplace_back([this, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                sync::FileMetadata meta;
+                meta.path = "t" + std::to_string(t) + "/" + std::to_string(i) + ".txt";
+                meta.hash = "h";
+                meta.size = i;
+                meta.created_at = meta.updated_at = sync::now_ms();
+                EXPECT_TRUE(m_Store->upsert_file(meta).has_value());
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    // Committed before upsert_file returned, so visible on the reading connection
+    auto files = m_Store->get_all_files();
+    ASSERT_TRUE(files.has_value());
+    EXPECT_EQ(files.value().size(), threads * per_thread);
+    // A failing write is rolled back alone
+    auto failed = m_Store->transaction([](storage::MetadataStore& store) -> stl::result<> {
+        auto r = store.mark_deleted("t0/0.txt");
+        if (!r)
+            return r;
+        return stl::make_error("rejected");
+    });
+    EXPECT_FALSE(failed.has_value());
+    EXPECT_FALSE(m_Store->get_file("t0/0.txt").value()->is_deleted);
+    ASSERT_TRUE(m_Store->mark_deleted("t0/1.txt").has_value());
+    EXPECT_TRUE(m_Store->get_file("t0/1.txt").value()->is_deleted);
+}
+
+TEST(FileIndexTest, ChangedSinceScansNewestRows) {
+    auto make = [](std::string path, std::string hash, sync::Timestamp updated_at) {
+        sync::FileMetadata meta;
+        meta.path = std::move(path);
+        meta.hash = std::move(hash);
+        meta.size = static_cast<i64>(meta.path.size());
+        meta.created_at = meta.updated_at = updated_at;
+        return meta;
+    };
+    const std::string digest = sync::hash_string("a");
+    storage::FileIndex index;
+    index.load({make("a.txt", digest, 1000), make("b.txt", "", 3000), make("c.txt", "not-hex", 2000)});
+    EXPECT_EQ(index.size(), 3u);
+    EXPECT_EQ(index.find("a.txt")->hash, digest);
+    EXPECT_EQ(index.find("b.txt")->hash, "");
+    EXPECT_EQ(index.find("c.txt")->hash, "not-hex");
+
+    auto since = index.changed_since(1500);
+    ASSERT_EQ(since.size(), 2u);
+    EXPECT_EQ(since[0].path, "c.txt");
+    EXPECT_EQ(since[1].path, "b.txt");
+
+    // Updating a row moves it to the end of the scan
+    auto updated = make("a.txt", digest, 4000);
+    updated.is_deleted = true;
+    index.apply(updated);
+    since = index.changed_since(3000);
+    ASSERT_EQ(since.size(), 1u);
+    EXPECT_EQ(since[0].path, "a.txt");
+    EXPECT_TRUE(since[0].is_deleted);
+    EXPECT_EQ(index.changed_since().size(), 3u);
+
+    index.erase("b.txt");
+    index.apply(make("d.txt", digest, 2500));
+    EXPECT_FALSE(index.find("b.txt"));
+    EXPECT_EQ(index.changed_since(2000).size(), 2u);
+
+    std::vector<sync::FileMetadata> rows = {updated, make("c.txt", "not-hex", 2000), make("d.txt", digest, 2500)};
+    EXPECT_TRUE(index.diff(rows).empty());
+    rows[2].size = 99;
+    rows.push_back(make("e.txt", "", 1));
+    EXPECT_EQ(index.diff(rows).size(), 2u);
+    EXPECT_TRUE(index.diff({updated}, 3000).empty());
+}
+
+TEST(FileIndexTest, ReclaimsArenaOfErasedPaths) {
+    storage::FileIndex index;
+    auto make = [](size_t i, sync::Timestamp updated_at) {
+        sync::FileMetadata meta;
+        meta.path = "renamed/over/and/over/" + std::to_string(i) + ".bin";
+        meta.created_at = meta.updated_at = updated_at;
+        return meta;
+    };
+    index.apply(make(0, 1));
+    // Every path is erased and replaced by a new one, as a long run of moves does
+    for (size_t i = 1; i < 100000; ++i) {
+        index.erase(make(i - 1, 0).path);
+        index.apply(make(i, static_cast<sync::Timestamp>(i + 1)));
+    }
+    EXPECT_EQ(index.size(), 1u);
+    EXPECT_LE(index.arena_bytes(), 4u * 64 * 1024);
+    auto last = index.find(make(99999, 0).path);
+    ASSERT_TRUE(last.has_value());
+    EXPECT_EQ(last->updated_at, 100000);
+    auto changed = index.changed_since();
+    ASSERT_EQ(changed.size(), 1u);
+    EXPECT_EQ(changed[0].path, make(99999, 0).path);
+}
+
+TEST_F(MetadataStoreTest, FileIndexFollowsWrites) {
+    auto put = [this](const std::string& path, sync::Timestamp updated_at) {
+        sync::FileMetadata meta;
+        meta.path = path;
+        meta.hash = sync::hash_string(path);
+        meta.size = 1;
+        meta.created_at = meta.updated_at = updated_at;
+        ASSERT_TRUE(m_Store->upsert_file(meta).has_value());
+    };
+    put("old.txt", 1000);
+    ASSERT_TRUE(m_Store->enable_file_index().has_value());
+    ASSERT_TRUE(m_Store->start_writer().has_value());
+    put("dir/a.txt", 2000);
+    put("dir/b.txt", 2000);
+    put("keep.txt", 3000);
+    ASSERT_TRUE(m_Store->mark_deleted_under("dir").has_value());
+    ASSERT_TRUE(m_Store->remove_file("keep.txt").has_value());
+
+    sync::FileMetadata pending;
+    pending.path = "pending.txt";
+    pending.created_at = pending.updated_at = 5000;
+    ASSERT_TRUE(m_Store->upsert_file(pending, "fast").has_value());
+    ASSERT_TRUE(m_Store->set_strong_hash("pending.txt", "fast", sync::hash_string("pending")).value());
+    // Already hashed: nothing matches the second time
+    EXPECT_FALSE(m_Store->set_strong_hash("pending.txt", "fast", sync::hash_string("pending")).value());
+    ASSERT_TRUE(m_Store->merge_fts(16).has_value());
+    ASSERT_TRUE(m_Store->optimize_fts().has_value());
+
+    storage::UploadSession session;
+    session.id = "up";
+    session.path = "uploaded.txt";
+    session.expires_at = sync::now_ms() + 60000;
+    ASSERT_TRUE(m_Store->create_upload(session).has_value());
+    sync::FileMetadata uploaded = pending;
+    uploaded.path = "uploaded.txt";
+    ASSERT_TRUE(m_Store->commit_upload("up", uploaded).has_value());
+    // Rolled back: the index keeps the committed row
+    auto failed = m_Store->transaction([](storage::MetadataStore& store) -> stl::result<> {
+        auto r = store.mark_deleted("uploaded.txt");
+        if (!r)
+            return r;
+        return stl::make_error("rejected");
+    });
+    EXPECT_FALSE(failed.has_value());
+    EXPECT_EQ(m_Store->compact_tombstones(sync::now_ms() + 1, 1).value(), 1);
+
+    auto differences = m_Store->verify_file_index();
+    ASSERT_TRUE(differences.has_value()) << differences.error();
+    EXPECT_TRUE(differences.value().empty()) << differences.value().front();
+    auto files = m_Store->get_all_files();
+    ASSERT_TRUE(files.has_value());
+    EXPECT_EQ(files.value().size(), 4u); // old, one dir tombstone, pending, uploaded
+    auto since = m_Store->get_all_files(4000);
+    ASSERT_TRUE(since.has_value());
+    EXPECT_EQ(since.value().size(), 3u);
+}
+
+TEST(MerkleTreeTest, IncrementalUpdatesMatchFreshLoad) {
+    auto make = [](std::string path, std::string content) {
+        sync::FileMetadata meta;
+        meta.path = std::move(path);
+        meta.hash = sync::hash_string(content);
+        return meta;
+    };
+    std::vector<sync::FileMetadata> rows = {make("a/x.txt", "x"), make("a/b/y.txt", "y"), make("c/z.txt", "z"), make("top.txt", "t")};
+    MerkleTree tree;
+    tree.load(rows);
+    EXPECT_EQ(tree.size(), 4u);
+    auto root = tree.root_hash();
+    auto c_hash = tree.subtree("c")->hash;
+    auto b_hash = tree.subtree("a/b")->hash;
+
+    // A change moves the hashes on its path only
+    tree.update(make("a/x.txt", "changed"));
+    EXPECT_NE(tree.root_hash(), root);
+    EXPECT_EQ(tree.subtree("c")->hash, c_hash);
+    EXPECT_EQ(tree.subtree("a/b")->hash, b_hash);
+    tree.update(make("a/x.txt", "x"));
+    EXPECT_EQ(tree.root_hash(), root);
+
+    // Deleting the last file of a directory prunes it
+    auto deleted = make("c/z.txt", "z");
+    deleted.is_deleted = true;
+    tree.update(deleted);
+    tree.update(make("d/new.txt", "n"));
+    EXPECT_FALSE(tree.subtree("c"));
+    MerkleTree fresh;
+    fresh.load({make("a/x.txt", "x"), make("a/b/y.txt", "y"), make("top.txt", "t"), make("d/new.txt", "n")});
+    EXPECT_EQ(tree.root_hash(), fresh.root_hash());
+    EXPECT_EQ(tree.size(), 4u);
+
+    auto a = tree.subtree("/a/");
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a->path, "a");
+    EXPECT_TRUE(a->directory);
+    EXPECT_EQ(a->files, 2u);
+    ASSERT_EQ(a->children.size(), 2u);
+    EXPECT_EQ(a->children[0].name, "b");
+    EXPECT_TRUE(a->children[0].directory);
+    EXPECT_EQ(a->children[1].name, "x.txt");
+    EXPECT_EQ(a->children[1].hash, sync::hash_string("x"));
+    EXPECT_FALSE(tree.subtree("a/x.txt/more"));
+}
+
+TEST_F(MetadataStoreTest, FileObserverFollowsWrites) {
+    auto put = [this](const std::string& path, const std::string& content) {
+        sync::FileMetadata meta;
+        meta.path = path;
+        meta.hash = sync::hash_string(content);
+        meta.size = static_cast<i64>(content.size());
+        meta.created_at = meta.updated_at = sync::now_ms();
+        ASSERT_TRUE(m_Store->upsert_file(meta).has_value());
+    };
+    put("kept.txt", "kept");
+    MerkleTree tree;
+    ASSERT_TRUE(m_Store->add_file_observer(&tree).has_value());
+    EXPECT_EQ(tree.size(), 1u);
+    ASSERT_TRUE(m_Store->start_writer().has_value());
+    put("dir/a.txt", "a");
+    put("dir/b.txt", "b");
+    put("gone.txt", "gone");
+    ASSERT_TRUE(m_Store->mark_deleted_under("dir").has_value());
+    ASSERT_TRUE(m_Store->remove_file("gone.txt").has_value());
+    auto failed = m_Store->transaction([](storage::MetadataStore& store) -> stl::result<> {
+        auto r = store.mark_deleted("kept.txt");
+        if (!r)
+            return r;
+        return stl::make_error("rejected");
+    });
+    EXPECT_FALSE(failed.has_value());
+
+    auto files = m_Store->get_all_files();
+    ASSERT_TRUE(files.has_value());
+    MerkleTree fresh;
+    fresh.load(files.value());
+    EXPECT_EQ(tree.size(), 1u);
+    EXPECT_EQ(tree.root_hash(), fresh.root_hash());
+}
+
 TEST_F(FileServiceTest, PutAndGetFile) {
     std::vector<u8> content = {'H', 'e', 'l', 'l', 'o'};
     auto put_result = m_Service->put_file("test.txt", content);
@@ -301,6 +765,118 @@ TEST_F(FileServiceTest, ListFiles) {
     EXPECT_EQ(result.value().size(), 2);
 }
 
+TEST_F(FileServiceTest, FindHashesOfLiveFiles) {
+    auto kept = m_Service->put_file("kept.txt", std::vector<u8>{'k'});
+    auto gone = m_Service->put_file("gone.txt", std::vector<u8>{'g'});
+    ASSERT_TRUE(kept.has_value() && gone.has_value());
+    ASSERT_TRUE(m_Service->delete_file("gone.txt").has_value());
+    const auto& hash = kept.value().hash;
+
+    auto exact = m_Service->find_hashes({gone.value().hash, hash, sync::hash_string("missing"), hash});
+    ASSERT_TRUE(exact.has_value()) << exact.error();
+    EXPECT_EQ(exact.value(), std::vector<std::string>{hash});
+
+    BloomFilter filter(1024, 4);
+    filter.add(hash);
+    filter.add(gone.value().hash);
+    auto candidates = m_Service->find_hashes(filter);
+    ASSERT_TRUE(candidates.has_value()) << candidates.error();
+    EXPECT_EQ(candidates.value(), std::vector<std::string>{hash});
+}
+
+TEST_F(FileServiceTest, MoveAndCopyKeepContentHash) {
+    std::vector<u8> content = {'p', 'h', 'o', 't', 'o'};
+    auto put = m_Service->put_file("2024/img.jpg", content);
+    ASSERT_TRUE(put.has_value()) << put.error();
+
+    auto copied = m_Service->copy_file("2024/img.jpg", "albums/best.jpg");
+    ASSERT_TRUE(copied.has_value()) << copied.error();
+    EXPECT_EQ(copied.value().hash, put.value().hash);
+    EXPECT_EQ(copied.value().mtime, put.value().mtime);
+    EXPECT_EQ(m_Service->get_file("albums/best.jpg").value(), content);
+
+    auto moved = m_Service->move_file("2024/img.jpg", "2024/06/img.jpg");
+    ASSERT_TRUE(moved.has_value()) << moved.error();
+    EXPECT_EQ(moved.value().hash, put.value().hash);
+    EXPECT_EQ(moved.value().created_at, put.value().created_at);
+    EXPECT_EQ(m_Service->get_file("2024/06/img.jpg").value(), content);
+    // The old path stays behind as a tombstone so clients drop their copy
+    auto old = m_Service->get_metadata("2024/img.jpg");
+    ASSERT_TRUE(old.has_value() && old.value().has_value());
+    EXPECT_TRUE(old.value()->is_deleted);
+    EXPECT_FALSE(sfs::exists(m_TestDir / "files" / "2024" / "img.jpg"));
+
+    EXPECT_FALSE(m_Service->move_file("2024/img.jpg", "elsewhere.jpg").has_value());
+    EXPECT_FALSE(m_Service->copy_file("2024/06/img.jpg", "2024/./06/img.jpg").has_value());
+    EXPECT_FALSE(m_Service->move_file("2024/06/img.jpg", "../outside.jpg").has_value());
+}
+
+TEST_F(FileServiceTest, TransfersStoreNormalizedPaths) {
+    ASSERT_TRUE(m_Service->put_file("a.txt", std::vector<u8>{'a'}).has_value());
+    auto copied = m_Service->copy_file("./a.txt", "dir/./b.txt");
+    ASSERT_TRUE(copied.has_value()) << copied.error();
+    EXPECT_EQ(copied.value().path, "dir/b.txt");
+    EXPECT_TRUE(m_Service->get_metadata("dir/b.txt").value().has_value());
+    auto moved = m_Service->move_file("dir//b.txt", "x//y.txt");
+    ASSERT_TRUE(moved.has_value()) << moved.error();
+    EXPECT_EQ(moved.value().path, "x/y.txt");
+    EXPECT_TRUE(m_Service->get_metadata("dir/b.txt").value()->is_deleted);
+    EXPECT_FALSE(m_Service->get_metadata("x//y.txt").value().has_value());
+    EXPECT_EQ(m_Service->normalize("x/./y.txt").value(), "x/y.txt");
+}
+
+TEST_F(FileServiceTest, FailedTransferRestoresReplacedTarget) {
+    ASSERT_TRUE(m_Service->put_file("src.txt", std::vector<u8>{'n', 'e', 'w'}).has_value());
+    ASSERT_TRUE(m_Service->put_file("dst.txt", std::vector<u8>{'o', 'l', 'd'}).has_value());
+    auto& db = m_Store->database();
+    ASSERT_TRUE(db.execute("CREATE TRIGGER fail_insert BEFORE INSERT ON files BEGIN SELECT RAISE(ABORT, 'injected'); END").has_value());
+    ASSERT_TRUE(db.execute("CREATE TRIGGER fail_update BEFORE UPDATE ON files BEGIN SELECT RAISE(ABORT, 'injected'); END").has_value());
+
+    EXPECT_FALSE(m_Service->move_file("src.txt", "dst.txt").has_value());
+    EXPECT_EQ(m_Fs->read_string("src.txt").value(), "new");
+    EXPECT_EQ(m_Fs->read_string("dst.txt").value(), "old");
+
+    EXPECT_FALSE(m_Service->copy_file("src.txt", "dst.txt").has_value());
+    EXPECT_EQ(m_Fs->read_string("dst.txt").value(), "old");
+    // A copy the index never saw is taken off disk again
+    EXPECT_FALSE(m_Service->copy_file("src.txt", "fresh.txt").has_value());
+    EXPECT_FALSE(sfs::exists(m_TestDir / "files" / "fresh.txt"));
+
+    ASSERT_TRUE(db.execute("DROP TRIGGER fail_insert").has_value());
+    ASSERT_TRUE(db.execute("DROP TRIGGER fail_update").has_value());
+    auto moved = m_Service->move_file("src.txt", "dst.txt");
+    ASSERT_TRUE(moved.has_value()) << moved.error();
+    EXPECT_EQ(m_Fs->read_string("dst.txt").value(), "new");
+    // Nothing set aside is left behind in staging
+    for (const auto& entry : sfs::directory_iterator(m_TestDir / "files" / services::UPLOAD_STAGING_DIR)) {
+        ADD_FAILURE() << "left in staging: " << entry.path();
+    }
+}
+
+TEST_F(FileServiceTest, TransferOntoDirectoryFails) {
+    ASSERT_TRUE(m_Service->put_file("a.txt", std::vector<u8>{'a'}).has_value());
+    ASSERT_TRUE(m_Service->put_file("dir/inner.txt", std::vector<u8>{'i'}).has_value());
+    EXPECT_FALSE(m_Service->copy_file("a.txt", "dir").has_value());
+    EXPECT_FALSE(m_Service->move_file("a.txt", "dir").has_value());
+    EXPECT_EQ(m_Fs->read_string("dir/inner.txt").value(), "i");
+    EXPECT_EQ(m_Fs->read_string("a.txt").value(), "a");
+    EXPECT_FALSE(m_Service->get_metadata("dir").value().has_value());
+}
+
+TEST_F(FileServiceTest, StagingAreaIsReserved) {
+    sfs::create_directories(m_TestDir / "files" / ".uploads");
+    std::ofstream(m_TestDir / "files" / ".uploads" / "s.part") << "staged";
+    std::vector<u8> content = {'x'};
+    EXPECT_FALSE(m_Service->put_file(".uploads/s.part", content).has_value());
+    EXPECT_FALSE(m_Service->put_file("a/../.uploads/s.part", content).has_value());
+    EXPECT_FALSE(m_Service->put_file("./.uploads/s.part", content).has_value());
+    EXPECT_FALSE(m_Service->delete_file(".uploads/s.part").has_value());
+    EXPECT_FALSE(m_Service->delete_file("a/../.uploads").has_value());
+    EXPECT_FALSE(m_Service->resolve("a/../.uploads/s.part").has_value());
+    EXPECT_TRUE(sfs::exists(m_TestDir / "files" / ".uploads" / "s.part"));
+    EXPECT_TRUE(m_Service->put_file(".uploadsx/ok.txt", content).has_value());
+}
+
 TEST_F(FileServiceTest, GetMetadata) {
     std::vector<u8> content = {'D', 'a', 't', 'a'};
     auto res = m_Service->put_file("meta_test.txt", content);
@@ -311,6 +887,865 @@ TEST_F(FileServiceTest, GetMetadata) {
     EXPECT_EQ(result.value()->size, 4);
 }
 
+TEST_F(FileServiceTest, ScanDefersStrongHash) {
+    std::string content = "written behind the server's back";
+    std::ofstream(m_TestDir / "files" / "outside.txt") << content;
+    auto scanned = m_Service->scan_and_index();
+    ASSERT_TRUE(scanned.has_value()) << scanned.error();
+    EXPECT_EQ(scanned.value(), 1);
+    auto meta = m_Service->get_metadata("outside.txt");
+    ASSERT_TRUE(meta.has_value() && meta.value().has_value());
+    EXPECT_TRUE(meta.value()->hash.empty());
+    EXPECT_EQ(m_Store->get_fast_hash("outside.txt").value(), cloud::fast_hash(content));
+    // Unchanged files are skipped on the next scan
+    scanned = m_Service->scan_and_index();
+    ASSERT_TRUE(scanned.has_value());
+    EXPECT_EQ(scanned.value(), 0);
+    auto more = m_Service->hash_pending(100);
+    ASSERT_TRUE(more.has_value()) << more.error();
+    EXPECT_FALSE(more.value());
+    meta = m_Service->get_metadata("outside.txt");
+    EXPECT_EQ(meta.value()->hash, sync::hash_string(content));
+}
+
+TEST_F(FileServiceTest, MappedFileMapsLargeFiles) {
+    std::string large(cloud::MappedFile::min_map_size + 123, 'x');
+    for (size_t i = 0; i < large.size(); i += 4096) {
+        large[i] = static_cast<char>('a' + (i / 4096) % 26);
+    }
+    std::ofstream(m_TestDir / "large.bin", std::ios::binary) << large;
+    std::ofstream(m_TestDir / "small.txt", std::ios::binary) << "hi";
+    auto mapped = cloud::MappedFile::open(m_TestDir / "large.bin");
+    ASSERT_TRUE(mapped.has_value()) << mapped.error();
+    EXPECT_TRUE(mapped.value().is_mapped());
+    EXPECT_EQ(mapped.value().view(), large);
+    auto buffered = cloud::MappedFile::open(m_TestDir / "small.txt");
+    ASSERT_TRUE(buffered.has_value()) << buffered.error();
+    EXPECT_FALSE(buffered.value().is_mapped());
+    EXPECT_EQ(buffered.value().view(), "hi");
+    // Moving keeps the mapping alive; the source is left empty
+    cloud::MappedFile moved = std::move(mapped.value());
+    EXPECT_EQ(moved.size(), large.size());
+    EXPECT_EQ(mapped.value().size(), 0u);
+    EXPECT_FALSE(cloud::MappedFile::open(m_TestDir / "missing.bin").has_value());
+}
+
+TEST_F(FileServiceTest, TruncatedWhileIndexing) {
+    // Large enough that a mapping would have been used; touching a mapped page
+    // past the new end of file would kill the process with SIGBUS
+    std::string large(4 * cloud::MappedFile::min_map_size, 'x');
+    auto path = m_TestDir / "files" / "big.bin";
+    std::ofstream(path, std::ios::binary) << large;
+    auto indexed = m_Service->index_path("big.bin");
+    ASSERT_TRUE(indexed.has_value()) << indexed.error();
+    auto content = m_Service->get_file("big.bin");
+    ASSERT_TRUE(content.has_value()) << content.error();
+    // An outside tool truncates the file while the content is still held
+    sfs::resize_file(path, 16);
+    EXPECT_EQ(std::string(content.value().begin(), content.value().end()), large);
+    // Re-indexing and hashing read what is there now
+    sfs::last_write_time(path, sfs::last_write_time(path) + std::chrono::seconds(5));
+    indexed = m_Service->index_path("big.bin");
+    ASSERT_TRUE(indexed.has_value()) << indexed.error();
+    ASSERT_TRUE(m_Service->hash_pending(100).has_value());
+    auto meta = m_Store->get_file("big.bin");
+    ASSERT_TRUE(meta.has_value() && meta.value().has_value());
+    EXPECT_EQ(meta.value()->size, 16);
+    EXPECT_EQ(meta.value()->hash, sync::hash_string(std::string(16, 'x')));
+}
+
+TEST_F(NoteServiceTest, RebuildIndex) {
+    std::vector<std::string> ids;
+    for (int i = 0; i < 5; ++i) {
+        sync::NoteCreateRequest req;
+        req.title = "Note " + std::to_string(i);
+        req.content = i % 2 == 0 ? "even zebra" : "odd walrus";
+        auto created = m_Service->create_note(req);
+        ASSERT_TRUE(created.has_value()) << created.error();
+        ids.push_back(created.value().id);
+    }
+    // One note removed behind the server's back
+    sfs::remove(m_TestDir / "notes" / (ids[0] + ".md"));
+    services::NoteService::RebuildProgress progress;
+    auto rebuilt = m_Service->rebuild_index(progress);
+    ASSERT_TRUE(rebuilt.has_value()) << rebuilt.error();
+    EXPECT_EQ(rebuilt.value(), 4);
+    EXPECT_EQ(progress.total, 4);
+    EXPECT_EQ(progress.indexed, 4);
+    EXPECT_FALSE(m_Service->get_note(ids[0]).value().has_value());
+    auto found = m_Service->search_notes("zebra");
+    ASSERT_TRUE(found.has_value()) << found.error();
+    EXPECT_EQ(found.value().notes.size(), 2);
+    // A second rebuild replaces the index rather than adding to it, and leaves
+    // unchanged notes' modification times alone
+    auto before = m_Store->get_note(ids[2]).value().value();
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    rebuilt = m_Service->rebuild_index(progress);
+    ASSERT_TRUE(rebuilt.has_value());
+    EXPECT_EQ(progress.parsed, 4);
+    EXPECT_EQ(progress.indexed, 4);
+    EXPECT_EQ(m_Service->search_notes("walrus").value().notes.size(), 2);
+    EXPECT_EQ(m_Store->get_note(ids[2]).value()->updated_at, before.updated_at);
+    // A note that can't be parsed this time is kept, with its last indexed text
+    std::string original;
+    {
+        std::ifstream in(m_TestDir / "notes" / (ids[1] + ".md"));
+        original.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    std::ofstream(m_TestDir / "notes" / (ids[1] + ".md"), std::ios::trunc) << "---\ntitle: unterminated";
+    rebuilt = m_Service->rebuild_index(progress);
+    ASSERT_TRUE(rebuilt.has_value()) << rebuilt.error();
+    EXPECT_EQ(progress.failed, 1);
+    EXPECT_TRUE(m_Store->get_note(ids[1]).value().has_value());
+    EXPECT_EQ(m_Service->search_notes("walrus").value().notes.size(), 2);
+    std::ofstream(m_TestDir / "notes" / (ids[1] + ".md"), std::ios::trunc) << original;
+    // A cancelled rebuild leaves the index in place and its staging table gone
+    std::stop_source stop;
+    stop.request_stop();
+    EXPECT_FALSE(m_Service->rebuild_index(progress, stop.get_token()).has_value());
+    EXPECT_EQ(m_Service->search_notes("zebra").value().notes.size(), 2);
+    auto staging = m_Store->database().query("SELECT name FROM sqlite_master WHERE name = 'notes_fts_rebuild'");
+    ASSERT_TRUE(staging.has_value());
+    EXPECT_TRUE(staging.value().empty());
+    // Batches go through the writer like any other write
+    ASSERT_TRUE(m_Store->start_writer().has_value());
+    rebuilt = m_Service->rebuild_index(progress);
+    ASSERT_TRUE(rebuilt.has_value()) << rebuilt.error();
+    EXPECT_EQ(rebuilt.value(), 4);
+    EXPECT_EQ(m_Service->search_notes("zebra").value().notes.size(), 2);
+}
+
+TEST_F(UploadServiceTest, ChunkedUploadAndFinalize) {
+    auto session = m_Service->create_session("photos/big.bin", 10);
+    ASSERT_TRUE(session.has_value()) << session.error();
+    auto first = m_Service->append_chunk(session->id, 0, "01234");
+    ASSERT_TRUE(first.has_value()) << first.error();
+    EXPECT_EQ(first->offset, 5);
+    auto second = m_Service->append_chunk(session->id, 5, "56789");
+    ASSERT_TRUE(second.has_value()) << second.error();
+    auto meta = m_Service->finalize(session->id);
+    ASSERT_TRUE(meta.has_value()) << meta.error();
+    EXPECT_EQ(meta->size, 10);
+    auto content = m_Fs->read_string("photos/big.bin");
+    ASSERT_TRUE(content.has_value());
+    EXPECT_EQ(content.value(), "0123456789");
+    auto stored = m_Store->get_file("photos/big.bin");
+    ASSERT_TRUE(stored.has_value());
+    ASSERT_TRUE(stored.value().has_value());
+    EXPECT_EQ(stored.value()->hash, meta->hash);
+    auto gone = m_Service->get_session(session->id);
+    ASSERT_TRUE(gone.has_value());
+    EXPECT_FALSE(gone.value().has_value());
+}
+
+TEST_F(UploadServiceTest, RejectsOffsetMismatch) {
+    auto session = m_Service->create_session("file.bin", -1);
+    ASSERT_TRUE(session.has_value());
+    auto res = m_Service->append_chunk(session->id, 0, "abc");
+    ASSERT_TRUE(res.has_value());
+    auto mismatch = m_Service->append_chunk(session->id, 0, "abc");
+    EXPECT_FALSE(mismatch.has_value());
+    auto progress = m_Service->get_session(session->id);
+    ASSERT_TRUE(progress.has_value());
+    ASSERT_TRUE(progress.value().has_value());
+    EXPECT_EQ(progress.value()->offset, 3);
+}
+
+TEST_F(UploadServiceTest, IncompleteUploadNotFinalized) {
+    auto session = m_Service->create_session("partial.bin", 100);
+    ASSERT_TRUE(session.has_value());
+    auto res = m_Service->append_chunk(session->id, 0, "abc");
+    auto meta = m_Service->finalize(session->id);
+    EXPECT_FALSE(meta.has_value());
+    EXPECT_FALSE(m_Fs->exists("partial.bin"));
+}
+
+TEST_F(UploadServiceTest, FailedCommitRestoresTargetAndSession) {
+    ASSERT_TRUE(m_Fs->write("doc.txt", std::vector<u8>{'o', 'l', 'd'}).has_value());
+    auto session = m_Service->create_session("doc.txt", 3);
+    ASSERT_TRUE(session.has_value()) << session.error();
+    ASSERT_TRUE(m_Service->append_chunk(session->id, 0, "new").has_value());
+    auto& db = m_Store->database();
+    ASSERT_TRUE(db.execute("CREATE TRIGGER fail_insert BEFORE INSERT ON files BEGIN SELECT RAISE(ABORT, 'injected'); END").has_value());
+    EXPECT_FALSE(m_Service->finalize(session->id).has_value());
+    EXPECT_EQ(m_Fs->read_string("doc.txt").value(), "old");
+    ASSERT_TRUE(db.execute("DROP TRIGGER fail_insert").has_value());
+    // Still active, with its staged content intact
+    auto meta = m_Service->finalize(session->id);
+    ASSERT_TRUE(meta.has_value()) << meta.error();
+    EXPECT_EQ(m_Fs->read_string("doc.txt").value(), "new");
+    EXPECT_EQ(m_Store->get_file("doc.txt").value()->hash, meta->hash);
+}
+
+TEST_F(UploadServiceTest, AbortUnknownSessionFails) {
+    EXPECT_FALSE(m_Service->abort("no-such-upload").has_value());
+    auto session = m_Service->create_session("a.bin", 1);
+    ASSERT_TRUE(session.has_value());
+    EXPECT_TRUE(m_Service->abort(session->id).has_value());
+    EXPECT_FALSE(m_Service->abort(session->id).has_value());
+}
+
+TEST_F(UploadServiceTest, RejectsEscapingPath) {
+    EXPECT_FALSE(m_Service->create_session("../escape.bin", 1).has_value());
+    EXPECT_FALSE(m_Service->create_session(".uploads/x.part", 1).has_value());
+}
+
+TEST_F(UploadServiceTest, StoresNormalizedPath) {
+    auto session = m_Service->create_session("a/./b.txt", 2);
+    ASSERT_TRUE(session.has_value()) << session.error();
+    EXPECT_EQ(session->path, "a/b.txt");
+    ASSERT_TRUE(m_Service->append_chunk(session->id, 0, "hi").has_value());
+    auto meta = m_Service->finalize(session->id);
+    ASSERT_TRUE(meta.has_value()) << meta.error();
+    EXPECT_EQ(meta->path, "a/b.txt");
+    EXPECT_TRUE(m_Store->get_file("a/b.txt").value().has_value());
+    EXPECT_FALSE(m_Store->get_file("a/./b.txt").value().has_value());
+}
+
+TEST_F(UploadServiceTest, RejectsDirectoryTarget) {
+    sfs::create_directories(m_FilesRoot / "dir");
+    EXPECT_FALSE(m_Service->create_session("dir", 1).has_value());
+    // A directory that appears while the upload runs is left alone too
+    auto session = m_Service->create_session("later", 1);
+    ASSERT_TRUE(session.has_value()) << session.error();
+    ASSERT_TRUE(m_Service->append_chunk(session->id, 0, "x").has_value());
+    ASSERT_TRUE(m_Fs->write("later/inner.txt", std::vector<u8>{'i'}).has_value());
+    EXPECT_FALSE(m_Service->finalize(session->id).has_value());
+    EXPECT_EQ(m_Fs->read_string("later/inner.txt").value(), "i");
+}
+
+TEST_F(UploadServiceTest, SessionsProceedInParallel) {
+    auto first = m_Service->create_session("one.bin", -1);
+    auto second = m_Service->create_session("two.bin", -1);
+    ASSERT_TRUE(first.has_value() && second.has_value());
+    std::vector<std::thread> writers;
+    for (const auto* session : {&first.value(), &second.value()}) {
+        writers.emplace_back([&, id = session->id] {
+            for (i64 offset = 0; offset < 64; ++offset) {
+                EXPECT_TRUE(m_Service->append_chunk(id, offset, "x").has_value());
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    EXPECT_EQ(m_Service->finalize(first->id).value().size, 64);
+    EXPECT_EQ(m_Service->finalize(second->id).value().size, 64);
+}
+
+TEST_F(NoteServiceTest, CachesNoteBodiesByHash) {
+    ContentCache cache;
+    services::NoteService service(*m_Fs, *m_Store, *m_Io, m_TestDir / "notes", &cache);
+    sync::NoteCreateRequest req;
+    req.title = "Hot";
+    req.content = "first";
+    auto created = service.create_note(req);
+    ASSERT_TRUE(created.has_value()) << created.error();
+    auto id = created.value().id;
+    auto loaded = service.get_note(id);
+    ASSERT_TRUE(loaded.has_value() && loaded.value()) << loaded.error();
+    EXPECT_NE(loaded.value()->content.find("first"), std::string::npos);
+    EXPECT_EQ(service.get_note(id).value()->content, loaded.value()->content);
+    EXPECT_EQ(cache.stats().hits, 1);
+    // New content has a new hash, so the old entry is never served
+    sync::NoteUpdateRequest update;
+    update.content = "second";
+    auto updated = service.update_note(id, update);
+    ASSERT_TRUE(updated.has_value()) << updated.error();
+    EXPECT_NE(service.get_note(id).value()->content.find("second"), std::string::npos);
+    EXPECT_EQ(cache.stats().entries, 2);
+}
+
+TEST(ContentCacheTest, EvictsLeastRecentlyUsed) {
+    ContentCacheOptions options;
+    options.capacity_bytes = 10;
+    options.max_entry_bytes = 4;
+    options.shards = 1;
+    ContentCache cache(options);
+    cache.put(ECacheKind::File, "a", "aaaa");
+    cache.put(ECacheKind::File, "b", "bbbb");
+    EXPECT_TRUE(cache.get(ECacheKind::File, "a")); // a is now the most recent
+    cache.put(ECacheKind::File, "c", "cccc");
+    EXPECT_TRUE(cache.get(ECacheKind::File, "a"));
+    EXPECT_FALSE(cache.get(ECacheKind::File, "b"));
+    EXPECT_EQ(*cache.get(ECacheKind::File, "c"), "cccc");
+    // Kinds don't share entries, oversized values and pending hashes aren't cached
+    EXPECT_FALSE(cache.get(ECacheKind::Note, "a"));
+    cache.put(ECacheKind::File, "d", "ddddd");
+    EXPECT_FALSE(cache.get(ECacheKind::File, "d"));
+    cache.put(ECacheKind::File, "", "e");
+    auto stats = cache.stats();
+    EXPECT_EQ(stats.entries, 2);
+    EXPECT_EQ(stats.bytes, 8);
+    EXPECT_EQ(stats.hits, 3);
+    EXPECT_EQ(stats.misses, 3);
+}
+
+TEST(FastHashTest, MatchesReferenceVectors) {
+    EXPECT_EQ(cloud::xxh64("", 0), 0xEF46DB3751D8E999ULL);
+    EXPECT_EQ(cloud::xxh64("a", 1), 0xD24EC4F1A98C6E5BULL);
+    EXPECT_EQ(cloud::xxh64("abc", 3), 0x44BC2CF5AD770999ULL);
+    // Long enough for the four-lane loop and every tail path
+    std::string text = "Nobody inspects the spammish repetition";
+    EXPECT_EQ(cloud::xxh64(text.data(), text.size()), 0xFBCEA83C8A378BF1ULL);
+    EXPECT_EQ(cloud::fast_hash("abc"), "44bc2cf5ad770999");
+}
+
+TEST(IoEngineTest, ReadWriteFsyncRename) {
+    auto dir = sfs::temp_directory_path() / "sap_drive_io_test";
+    sfs::remove_all(dir);
+    for (auto backend : {EIoBackend::Threads, EIoBackend::Uring}) {
+        IoOptions options;
+        options.backend = backend;
+        options.queue_depth = 4;
+        auto engine = IoEngine::create(options);
+        if (!engine) {
+            continue; // io_uring compiled out or refused by the kernel
+        }
+        SCOPED_TRACE(std::string(engine.value()->backend()));
+        auto& io = *engine.value();
+        std::vector<u8> data(300000);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<u8>(i * 7);
+        }
+        ASSERT_TRUE(io.write(dir / "sub" / "a.bin", data).has_value());
+        auto read = io.read(dir / "sub" / "a.bin");
+        ASSERT_TRUE(read.has_value()) << read.error();
+        EXPECT_EQ(read.value(), data);
+        EXPECT_TRUE(io.fsync(dir / "sub" / "a.bin").has_value());
+        EXPECT_TRUE(io.fsync(dir / "sub").has_value());
+        ASSERT_TRUE(io.rename(dir / "sub" / "a.bin", dir / "b.bin").has_value());
+        EXPECT_FALSE(io.read(dir / "sub" / "a.bin").has_value());
+        EXPECT_FALSE(io.rename(dir / "missing", dir / "c.bin").has_value());
+        ASSERT_TRUE(io.write(dir / "empty", {}).has_value());
+        EXPECT_TRUE(io.read(dir / "empty").value().empty());
+        // More reads in flight than the queue depth
+        std::atomic<int> matched{0};
+        std::latch finished(32);
+        for (int i = 0; i < 32; ++i) {
+            io.async_read(dir / "b.bin", [&](stl::result<std::vector<u8>> r) {
+                matched += r && r.value() == data ? 1 : 0;
+                finished.count_down();
+            });
+        }
+        finished.wait();
+        EXPECT_EQ(matched, 32);
+        sfs::remove_all(dir);
+    }
+}
+
+TEST(IoEngineTest, CopyAndMove) {
+    auto dir = sfs::temp_directory_path() / "sap_drive_io_copy_test";
+    sfs::remove_all(dir);
+    auto engine = IoEngine::create();
+    ASSERT_TRUE(engine.has_value()) << engine.error();
+    auto& io = *engine.value();
+    std::vector<u8> data(3 * 1024 * 1024 + 17);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<u8>(i * 13);
+    }
+    ASSERT_TRUE(io.write(dir / "a.bin", data).has_value());
+    ASSERT_TRUE(io.write(dir / "x" / "b.bin", std::vector<u8>{1, 2, 3}).has_value());
+    // Replaces the existing, shorter target and creates missing directories
+    ASSERT_TRUE(io.copy(dir / "a.bin", dir / "x" / "b.bin").has_value());
+    ASSERT_TRUE(io.copy(dir / "a.bin", dir / "y" / "z" / "c.bin").has_value());
+    EXPECT_EQ(io.read(dir / "x" / "b.bin").value(), data);
+    EXPECT_EQ(io.read(dir / "y" / "z" / "c.bin").value(), data);
+    EXPECT_FALSE(io.copy(dir / "missing", dir / "d.bin").has_value());
+
+    ASSERT_TRUE(io.move(dir / "a.bin", dir / "y" / "moved.bin").has_value());
+    EXPECT_FALSE(sfs::exists(dir / "a.bin"));
+    EXPECT_EQ(io.read(dir / "y" / "moved.bin").value(), data);
+    sfs::remove_all(dir);
+}
+
+TEST(IoEngineTest, DurabilityModes) {
+    auto dir = sfs::temp_directory_path() / "sap_drive_durability_test";
+    sfs::create_directories(dir);
+    const std::pair<std::string, i64> modes[] = {{"strict", 2}, {"balanced", 1}, {"fast", 0}};
+    for (const auto& [name, synchronous] : modes) {
+        auto durability = parse_durability(name);
+        ASSERT_TRUE(durability.has_value()) << durability.error();
+        // Metadata: WAL with the mode's sync level
+        auto store = storage::MetadataStore::open(dir / (name + ".db"), durability.value());
+        ASSERT_TRUE(store.has_value()) << store.error();
+        auto mode = store.value().database().query("PRAGMA journal_mode");
+        ASSERT_TRUE(mode.has_value());
+        EXPECT_EQ(mode.value()[0].get<std::string>("journal_mode"), "wal");
+        auto sync_level = store.value().database().query("PRAGMA synchronous");
+        ASSERT_TRUE(sync_level.has_value());
+        EXPECT_EQ(sync_level.value()[0].get<i64>("synchronous"), synchronous) << name;
+        EXPECT_TRUE(store.value().checkpoint().has_value());
+        // Files: staged content replaces the target
+        IoOptions options;
+        options.durability = durability.value();
+        auto io = IoEngine::create(options);
+        ASSERT_TRUE(io.has_value()) << io.error();
+        EXPECT_EQ(io.value()->durability(), durability.value());
+        std::vector<u8> data = {'o', 'k'};
+        ASSERT_TRUE(io.value()->write(dir / "staged", data).has_value());
+        // Parent directories are the caller's job
+        EXPECT_FALSE(io.value()->commit(dir / "staged", dir / name / "target").has_value());
+        sfs::create_directories(dir / name);
+        ASSERT_TRUE(io.value()->commit(dir / "staged", dir / name / "target").has_value());
+        EXPECT_FALSE(sfs::exists(dir / "staged"));
+        EXPECT_EQ(io.value()->read(dir / name / "target").value(), data);
+        EXPECT_TRUE(io.value()->sync_file(dir / name / "target").has_value());
+    }
+    EXPECT_FALSE(parse_durability("paranoid").has_value());
+    sfs::remove_all(dir);
+}
+
+TEST(IoEngineTest, ResolveUnderRejectsEscapes) {
+    EXPECT_EQ(resolve_under("/data", "a/b.txt").value(), sfs::path("/data/a/b.txt"));
+    EXPECT_EQ(resolve_under("/data", "a/../b.txt").value(), sfs::path("/data/b.txt"));
+    EXPECT_FALSE(resolve_under("/data", "../etc/passwd").has_value());
+    EXPECT_FALSE(resolve_under("/data", "a/../../x").has_value());
+    EXPECT_FALSE(resolve_under("/data", "/etc/passwd").has_value());
+    EXPECT_FALSE(resolve_under("/data", "").has_value());
+}
+
+namespace {
+    Task<int> add_later(Executor& executor, int a, int b) {
+        int sum = co_await run_on(executor, [a, b] { return a + b; });
+        co_return sum;
+    }
+
+    Task<> collect(Executor& executor, std::vector<int>& out, std::thread::id& resumed_on) {
+        out.push_back(co_await add_later(executor, 1, 2));
+        out.push_back(co_await add_later(executor, 3, 4));
+        resumed_on = std::this_thread::get_id();
+    }
+} // namespace
+
+TEST(TaskTest, ResumesOnTheWaitingThread) {
+    Executor executor(2);
+    std::vector<int> out;
+    std::thread::id resumed_on;
+    sync_wait(collect(executor, out, resumed_on));
+    EXPECT_EQ(out, (std::vector<int>{3, 7}));
+    // Work ran on the executor, but the coroutine continued where sync_wait was called
+    EXPECT_EQ(resumed_on, std::this_thread::get_id());
+    EXPECT_EQ(sync_wait(add_later(executor, 20, 22)), 42);
+}
+
+TEST(TaskTest, AwaitsFileIo) {
+    auto dir = sfs::temp_directory_path() / "sap_drive_task_test";
+    auto io = IoEngine::create();
+    ASSERT_TRUE(io.has_value()) << io.error();
+    std::vector<u8> data = {'o', 'k'};
+    auto roundtrip = [&]() -> Task<stl::result<std::vector<u8>>> {
+        auto written = co_await co_write(*io.value(), dir / "a.txt", data);
+        if (!written) {
+            co_return stl::make_error<std::vector<u8>>("{}", written.error());
+        }
+        co_return co_await co_read(*io.value(), dir / "a.txt");
+    };
+    auto content = sync_wait(roundtrip());
+    ASSERT_TRUE(content.has_value()) << content.error();
+    EXPECT_EQ(content.value(), data);
+    EXPECT_FALSE(sync_wait([&]() -> Task<stl::result<std::vector<u8>>> { co_return co_await co_read(*io.value(), dir / "missing"); }())
+                     .has_value());
+    sfs::remove_all(dir);
+}
+
+TEST(RouterTest, LiteralAndCaptures) {
+    Router router;
+    std::string hit;
+    router.add(http::EMethod::GET, "/api/v1/notes", [&](const http::Request&, const RouteParams&) {
+        hit = "list";
+        return http::Response(200);
+    });
+    router.add(http::EMethod::GET, "/api/v1/notes/tags", [&](const http::Request&, const RouteParams&) {
+        hit = "tags";
+        return http::Response(200);
+    });
+    router.add(http::EMethod::GET, "/api/v1/notes/{id}", [&](const http::Request&, const RouteParams& p) {
+        hit = std::string(p.get("id"));
+        return http::Response(200);
+    });
+    router.add(http::EMethod::GET, "/api/v1/files/{path*}", [&](const http::Request&, const RouteParams& p) {
+        hit = std::string(p.get("path"));
+        return http::Response(200);
+    });
+    http::Request req;
+    auto run = [&](std::string_view path) {
+        auto match = router.match(http::EMethod::GET, path);
+        if (!match.route)
+            return std::string("<none>");
+        match.route->handler(req, match.params);
+        return hit;
+    };
+    EXPECT_EQ(run("/api/v1/notes"), "list");
+    EXPECT_EQ(run("/api/v1/notes/"), "list");
+    EXPECT_EQ(run("/api/v1/notes/tags"), "tags");
+    EXPECT_EQ(run("/api/v1/notes/abc-123"), "abc-123");
+    EXPECT_EQ(run("/api/v1/files/a/b/c.txt"), "a/b/c.txt");
+    EXPECT_EQ(run("/api/v1/files"), "<none>");
+    EXPECT_EQ(run("/api/v1/notes/abc/extra"), "<none>");
+}
+
+TEST(RouterTest, LiteralOnlyShadowsItsOwnMethods) {
+    Router router;
+    std::string hit;
+    router.add(http::EMethod::GET, "/api/v1/files/{path*}", [&](const http::Request&, const RouteParams& p) {
+        hit = std::string(p.get("path"));
+        return http::Response(200);
+    });
+    router.add(http::EMethod::POST, "/api/v1/files/move", [&](const http::Request&, const RouteParams&) {
+        hit = "move endpoint";
+        return http::Response(200);
+    });
+    http::Request req;
+    auto get = router.match(http::EMethod::GET, "/api/v1/files/move");
+    ASSERT_TRUE(get.route);
+    get.route->handler(req, get.params);
+    EXPECT_EQ(hit, "move");
+    auto post = router.match(http::EMethod::POST, "/api/v1/files/move");
+    ASSERT_TRUE(post.route);
+    post.route->handler(req, post.params);
+    EXPECT_EQ(hit, "move endpoint");
+    auto del = router.match(http::EMethod::DELETE, "/api/v1/files/move");
+    EXPECT_FALSE(del.route);
+    EXPECT_TRUE(del.path_matched);
+}
+
+TEST(RouterTest, MethodNotAllowed) {
+    Router router;
+    router.add(http::EMethod::GET, "/api/v1/sync/state", [](const http::Request&, const RouteParams&) { return http::Response(200); },
+               RouteOptions{.requires_auth = false});
+    auto match = router.match(http::EMethod::POST, "/api/v1/sync/state");
+    EXPECT_EQ(match.route, nullptr);
+    EXPECT_TRUE(match.path_matched);
+    auto get = router.match(http::EMethod::GET, "/api/v1/sync/state");
+    ASSERT_NE(get.route, nullptr);
+    EXPECT_FALSE(get.route->options.requires_auth);
+}
+
+TEST(RouterTest, QueryParam) {
+    EXPECT_EQ(query_param("?since=100&tag=work", "since"), "100");
+    EXPECT_EQ(query_param("since=100&tag=work", "tag"), "work");
+    EXPECT_EQ(query_param("faq=1&q=search", "q"), "search");
+    EXPECT_EQ(query_param("tag=work", "missing"), "");
+}
+
+TEST(JsonWriterTest, SyncStateMatchesNlohmann) {
+    sync::SyncState state;
+    state.server_time = 1700000000000;
+    sync::FileMetadata f;
+    f.path = "dir/\"quoted\" \\ name\n\x01.txt";
+    f.hash = "abc";
+    f.size = 42;
+    f.mtime = f.created_at = f.updated_at = -5;
+    f.is_deleted = true;
+    state.files = {f, f};
+    std::string out;
+    cloud::json::serialize(state, out);
+    EXPECT_EQ(nlohmann::json::parse(out), nlohmann::json(state));
+    sync::SyncState empty;
+    cloud::json::serialize(empty, out);
+    EXPECT_EQ(nlohmann::json::parse(out), nlohmann::json(empty));
+}
+
+TEST(BinaryCodecTest, RoundTripsSyncState) {
+    sync::SyncState state;
+    state.server_time = 1700000000000;
+    for (int i = 0; i < 200; ++i) {
+        sync::FileMetadata f;
+        f.path = "photos/2024/" + std::to_string(199 - i) + "/IMG_\xc3\xa9.jpg";
+        f.hash = i % 3 == 0 ? sync::hash_string(f.path) : (i % 3 == 1 ? "" : "ABC");
+        f.size = i * 1000;
+        f.updated_at = 1700000000000 + (i % 7) * 1000 - i;
+        f.created_at = f.updated_at - 86400000;
+        f.mtime = i == 5 ? std::numeric_limits<i64>::min() : f.updated_at + 3;
+        f.is_deleted = i % 11 == 0;
+        state.files.push_back(f);
+    }
+    std::string out;
+    cloud::binary::encode(state, out);
+    auto decoded = cloud::binary::decode_sync_state(out);
+    ASSERT_TRUE(decoded.has_value()) << decoded.error();
+    EXPECT_EQ(decoded.value().server_time, state.server_time);
+    // Files come back sorted by path
+    auto expected = nlohmann::json(state.files);
+    std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a["path"] < b["path"]; });
+    EXPECT_EQ(nlohmann::json(decoded.value().files), expected);
+
+    std::string json;
+    cloud::json::serialize(state, json);
+    EXPECT_LT(out.size() * 3, json.size());
+
+    // A file list is its own payload type
+    EXPECT_FALSE(cloud::binary::decode_files(out).has_value());
+    cloud::binary::encode(state.files, out);
+    auto files = cloud::binary::decode_files(out);
+    ASSERT_TRUE(files.has_value()) << files.error();
+    EXPECT_EQ(files.value().size(), state.files.size());
+    for (size_t cut : {size_t{0}, size_t{5}, out.size() / 2, out.size() - 1}) {
+        EXPECT_FALSE(cloud::binary::decode_files(std::string_view(out).substr(0, cut)).has_value()) << cut;
+    }
+    EXPECT_FALSE(cloud::binary::decode_files(out + "x").has_value());
+}
+
+TEST(BinaryCodecTest, AcceptNegotiation) {
+    EXPECT_TRUE(cloud::binary::accepts("application/vnd.sapcloud.sync"));
+    EXPECT_TRUE(cloud::binary::accepts("application/json;q=0.5, application/vnd.sapcloud.sync"));
+    EXPECT_TRUE(cloud::binary::accepts("application/vnd.sapcloud.sync; q=0.8"));
+    EXPECT_FALSE(cloud::binary::accepts("application/vnd.sapcloud.sync;q=0"));
+    EXPECT_FALSE(cloud::binary::accepts("application/json"));
+    EXPECT_FALSE(cloud::binary::accepts("*/*"));
+    EXPECT_FALSE(cloud::binary::accepts(""));
+}
+
+TEST(JsonWriterTest, NoteAndTagListsMatchNlohmann) {
+    sync::NoteListResponse notes;
+    sync::NoteListItem item;
+    item.id = "id-1";
+    item.title = "Title \u00e9";
+    item.tags = {"a", "b"};
+    item.updated_at = 7;
+    item.preview = "line\tone";
+    notes.notes = {item};
+    notes.total = 1;
+    std::string out;
+    cloud::json::serialize(notes, out);
+    EXPECT_EQ(nlohmann::json::parse(out), nlohmann::json(notes));
+    sync::TagListResponse tags;
+    tags.tags = {{"work", 3}, {"home", 1}};
+    cloud::json::serialize(tags, out);
+    EXPECT_EQ(nlohmann::json::parse(out), nlohmann::json(tags));
+}
+
+TEST(JsonReaderTest, NoteCreate) {
+    auto req = cloud::json::parse_note_create(
+        R"({"title":"Hello \"world\"","extra":{"nested":[1,2,{"x":null}]},"content":"Body\nline","tags":["a","b"]})");
+    ASSERT_TRUE(req.has_value()) << req.error();
+    EXPECT_EQ(req->title, "Hello \"world\"");
+    EXPECT_EQ(req->content, "Body\nline");
+    EXPECT_EQ(req->tags, (std::vector<std::string>{"a", "b"}));
+    EXPECT_FALSE(cloud::json::parse_note_create(R"({"content":"no title"})").has_value());
+    EXPECT_FALSE(cloud::json::parse_note_create(R"({"title":5})").has_value());
+    EXPECT_FALSE(cloud::json::parse_note_create(R"({"title":"t","tags":[1]})").has_value());
+    EXPECT_FALSE(cloud::json::parse_note_create(R"(["title"])").has_value());
+    EXPECT_FALSE(cloud::json::parse_note_create(R"({"title":"t")").has_value());
+}
+
+TEST(JsonReaderTest, NoteUpdateOptionalFields) {
+    auto req = cloud::json::parse_note_update(R"({"content":"new","title":null})");
+    ASSERT_TRUE(req.has_value()) << req.error();
+    EXPECT_FALSE(req->title.has_value());
+    ASSERT_TRUE(req->content.has_value());
+    EXPECT_EQ(*req->content, "new");
+    EXPECT_FALSE(req->tags.has_value());
+    auto empty_tags = cloud::json::parse_note_update(R"({"tags":[]})");
+    ASSERT_TRUE(empty_tags.has_value());
+    ASSERT_TRUE(empty_tags->tags.has_value());
+    EXPECT_TRUE(empty_tags->tags->empty());
+}
+
+TEST(JsonReaderTest, AuthRequests) {
+    auto chall = cloud::json::parse_challenge_request(R"({"public_key":"ssh-ed25519 AAAA test"})");
+    ASSERT_TRUE(chall.has_value());
+    EXPECT_EQ(chall->public_key, "ssh-ed25519 AAAA test");
+    auto verify = cloud::json::parse_verify_request(R"({"public_key":"k","challenge":"c","signature":"s"})");
+    ASSERT_TRUE(verify.has_value());
+    EXPECT_EQ(verify->signature, "s");
+    EXPECT_FALSE(cloud::json::parse_verify_request(R"({"public_key":"k","challenge":"c"})").has_value());
+}
+
+TEST(JsonReaderTest, HashQuery) {
+    auto list = cloud::json::parse_hash_query(R"({"hashes":["a","b"]})");
+    ASSERT_TRUE(list.has_value()) << list.error();
+    EXPECT_EQ(list->hashes.size(), 2u);
+    auto bloom = cloud::json::parse_hash_query(R"({"bloom":"AAEC","bloom_hashes":7})");
+    ASSERT_TRUE(bloom.has_value()) << bloom.error();
+    EXPECT_EQ(bloom->bloom, "AAEC");
+    EXPECT_EQ(bloom->bloom_hashes, 7);
+    EXPECT_FALSE(cloud::json::parse_hash_query(R"({"bloom":"AAEC"})").has_value());
+    EXPECT_FALSE(cloud::json::parse_hash_query(R"({"hashes":[],"bloom":"AAEC","bloom_hashes":7})").has_value());
+    EXPECT_FALSE(cloud::json::parse_hash_query(R"({"bloom":"AAEC","bloom_hashes":"7"})").has_value());
+}
+
+TEST(JsonReaderTest, FileTransfer) {
+    auto transfer = cloud::json::parse_file_transfer(R"({"from":"a.txt","to":"b/a.txt","overwrite":true})");
+    ASSERT_TRUE(transfer.has_value()) << transfer.error();
+    EXPECT_EQ(transfer->to, "b/a.txt");
+    EXPECT_TRUE(transfer->overwrite);
+    EXPECT_FALSE(cloud::json::parse_file_transfer(R"({"from":"a.txt"})").has_value());
+    EXPECT_FALSE(cloud::json::parse_file_transfer(R"({"from":"a.txt","to":"b","overwrite":1})").has_value());
+}
+
+TEST(BloomFilterTest, RoundTripsThroughWireFormat) {
+    BloomFilter filter(10 * 1000, 7);
+    for (int i = 0; i < 1000; ++i) {
+        filter.add(sync::hash_string("in" + std::to_string(i)));
+    }
+    filter.add("short");
+    auto decoded = BloomFilter::decode(filter.encode(), filter.hash_count());
+    ASSERT_TRUE(decoded.has_value()) << decoded.error();
+    EXPECT_EQ(decoded->bit_count(), filter.bit_count());
+    EXPECT_EQ(decoded->encode(), filter.encode());
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_TRUE(decoded->may_contain(sync::hash_string("in" + std::to_string(i))));
+    }
+    EXPECT_TRUE(decoded->may_contain("short"));
+    // About 1% at 10 bits per hash
+    int false_positives = 0;
+    for (int i = 0; i < 1000; ++i) {
+        false_positives += decoded->may_contain(sync::hash_string("out" + std::to_string(i)));
+    }
+    EXPECT_LT(false_positives, 50);
+
+    EXPECT_TRUE(BloomFilter::decode("AAE", 1).has_value()); // Unpadded
+    EXPECT_FALSE(BloomFilter::decode("AA*A", 1).has_value());
+    EXPECT_FALSE(BloomFilter::decode("AAAA", 0).has_value());
+    EXPECT_FALSE(BloomFilter::decode("", 1).has_value());
+}
+
+#ifdef __linux__
+TEST(FileWatcherTest, ReportsReplaceByRename) {
+    auto dir = sfs::temp_directory_path() / "sap_drive_watch_test";
+    sfs::remove_all(dir);
+    sfs::create_directories(dir);
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<cloud::WatchEvent> events;
+    auto watcher = cloud::FileWatcher::create([&](const cloud::WatchEvent& event) {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(event);
+        cv.notify_all();
+    });
+    ASSERT_TRUE(watcher.has_value()) << watcher.error();
+    ASSERT_TRUE(watcher.value()->add_directory(dir).has_value());
+    // Editors save by writing a temp file and renaming it over the target
+    std::ofstream(dir / "keys.tmp") << "ssh-ed25519 AAAA\n";
+    sfs::rename(dir / "keys.tmp", dir / "keys");
+    std::unique_lock<std::mutex> lock(mutex);
+    bool seen = cv.wait_for(lock, std::chrono::seconds(5), [&] {
+        return std::ranges::any_of(events, [&](const auto& e) { return e.kind == cloud::EWatchEvent::Written && e.path == dir / "keys"; });
+    });
+    lock.unlock();
+    EXPECT_TRUE(seen);
+    watcher.value()->stop();
+    sfs::remove_all(dir);
+}
+
+TEST_F(FileServiceTest, LiveIndexerTracksOutsideChanges) {
+    sfs::create_directories(m_TestDir / "notes");
+    fs::Filesystem notes_fs(m_TestDir / "notes");
+    services::NoteService notes(notes_fs, *m_Store, *m_Io, m_TestDir / "notes");
+    cloud::LiveIndexer::Options options;
+    options.debounce = std::chrono::milliseconds(20);
+    auto indexer = cloud::LiveIndexer::create(*m_Service, m_TestDir / "files", notes, m_TestDir / "notes", options);
+    ASSERT_TRUE(indexer.has_value()) << indexer.error();
+    auto wait_for = [&](auto predicate) {
+        for (int i = 0; i < 250 && !predicate(); ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        return predicate();
+    };
+    auto indexed = [&](std::string_view path) {
+        auto meta = m_Service->get_metadata(path);
+        return meta && meta.value() && !meta.value()->is_deleted ? std::optional<i64>(meta.value()->size) : std::nullopt;
+    };
+    // A directory created after the watch started is followed
+    sfs::create_directories(m_TestDir / "files" / "sub");
+    std::ofstream(m_TestDir / "files" / "sub" / "a.txt") << "hello";
+    EXPECT_TRUE(wait_for([&] { return indexed("sub/a.txt") == 5; }));
+    std::ofstream(m_TestDir / "files" / "sub" / "a.txt", std::ios::app) << " world";
+    EXPECT_TRUE(wait_for([&] { return indexed("sub/a.txt") == 11; }));
+    // Removing the directory removes everything below it
+    sfs::rename(m_TestDir / "files" / "sub", m_TestDir / "moved_out");
+    EXPECT_TRUE(wait_for([&] { return !indexed("sub/a.txt").has_value(); }));
+    indexer.value()->stop();
+}
+#endif
+
+TEST(MaintenanceTest, RunsJobInSlicesUntilDone) {
+    MaintenanceScheduler scheduler(std::chrono::milliseconds(5));
+    std::mutex mutex;
+    std::condition_variable done;
+    int remaining = 1000;
+    scheduler.add_job("countdown", std::chrono::milliseconds(1), [&]() -> stl::result<bool> {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--remaining == 0) {
+            done.notify_all();
+        }
+        return remaining > 0;
+    });
+    scheduler.start();
+    std::unique_lock<std::mutex> lock(mutex);
+    EXPECT_TRUE(done.wait_for(lock, std::chrono::seconds(10), [&] { return remaining <= 0; }));
+    lock.unlock();
+    scheduler.stop();
+}
+
+TEST(MetricsTest, CountersSumAcrossThreads) {
+    auto& reg = cloud::metrics::registry();
+    auto counter = reg.counter("test_counter_total", "Test counter", {{"case", "threads"}});
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([counter] {
+            for (int i = 0; i < 1000; ++i) {
+                counter.inc();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // Registering the same name and labels again yields the same series
+    reg.counter("test_counter_total", "Test counter", {{"case", "threads"}}).inc(5);
+    EXPECT_EQ(reg.value(counter), 4005u);
+}
+
+TEST(MetricsTest, HistogramQuantilesAndRender) {
+    auto& reg = cloud::metrics::registry();
+    auto histogram = reg.histogram("test_duration_seconds", "Test histogram", {{"op", "render"}});
+    for (u64 i = 1; i <= 1000; ++i) {
+        histogram.record(i * 10);
+    }
+    auto q = reg.quantiles(histogram);
+    EXPECT_EQ(q.count, 1000u);
+    // Bucket bounds are within 12.5% of the true value
+    EXPECT_NEAR(static_cast<double>(q.p50), 5000.0, 5000.0 * 0.125);
+    EXPECT_NEAR(static_cast<double>(q.p99), 9900.0, 9900.0 * 0.125);
+    auto text = reg.render();
+    EXPECT_NE(text.find("# TYPE test_duration_seconds summary"), std::string::npos);
+    EXPECT_NE(text.find("test_duration_seconds_count{op=\"render\"} 1000"), std::string::npos);
+}
+
+TEST(TraceTest, RequestSpanTree) {
+    u64 request_id = 0;
+    {
+        cloud::trace::RequestScope scope("/api/v1/test", "GET /api/v1/test");
+        request_id = scope.id();
+        {
+            cloud::trace::Span outer("outer");
+            cloud::trace::Span inner("inner");
+        }
+        cloud::trace::Span sibling("sibling");
+    }
+    { cloud::trace::Span untagged("untagged"); }
+    auto spans = cloud::trace::request_spans(request_id);
+    ASSERT_EQ(spans.size(), 4u);
+    EXPECT_STREQ(spans[0].name, "/api/v1/test");
+    EXPECT_STREQ(spans[1].name, "outer");
+    EXPECT_STREQ(spans[2].name, "inner");
+    EXPECT_STREQ(spans[3].name, "sibling");
+    EXPECT_EQ(spans[2].depth, spans[0].depth + 2);
+    EXPECT_EQ(spans[3].depth, spans[0].depth + 1);
+    auto tree = cloud::trace::format_tree(spans);
+    EXPECT_NE(tree.find("\n    outer"), std::string::npos);
+    auto chrome = nlohmann::json::parse(cloud::trace::export_chrome_trace());
+    bool found = false;
+    for (const auto& event : chrome["traceEvents"]) {
+        found |= event["name"] == "inner" && event["args"]["request"] == request_id;
+    }
+    EXPECT_TRUE(found);
+}
+
 TEST(ConfigTest, GetDataDir) {
     auto data_dir = sap::cloud::get_data_dir();
     EXPECT_FALSE(data_dir.empty());
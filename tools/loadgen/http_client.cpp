@@ -0,0 +1,229 @@
+#include "http_client.h"
+#include <arpa/inet.h>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sap::cloud::loadgen {
+
+    namespace {
+        bool iequals(std::string_view a, std::string_view b) {
+            if (a.size() != b.size()) {
+                return false;
+            }
+            for (size_t i = 0; i < a.size(); ++i) {
+                if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i]))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::string_view trim(std::string_view s) {
+            while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+                s.remove_prefix(1);
+            }
+            while (!s.empty() && (s.back() == ' ' || s.back() == '\t' || s.back() == '\r')) {
+                s.remove_suffix(1);
+            }
+            return s;
+        }
+    } // namespace
+
+    HttpClient::HttpClient(std::string host, u16 port) : m_Host(std::move(host)), m_Port(port) {}
+
+    HttpClient::~HttpClient() { disconnect(); }
+
+    stl::result<> HttpClient::connect() {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return stl::make_error("socket: {}", std::strerror(errno));
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(m_Port);
+        if (::inet_pton(AF_INET, m_Host.c_str(), &addr.sin_addr) != 1) {
+            ::close(fd);
+            return stl::make_error("Invalid host: {}", m_Host);
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            int err = errno;
+            ::close(fd);
+            return stl::make_error("connect: {}", std::strerror(err));
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        m_Fd = fd;
+        m_Buffer.clear();
+        return stl::success;
+    }
+
+    void HttpClient::disconnect() {
+        if (m_Fd >= 0) {
+            ::close(m_Fd);
+            m_Fd = -1;
+        }
+        m_Buffer.clear();
+    }
+
+    bool HttpClient::probe() {
+        disconnect();
+        return connect().has_value();
+    }
+
+    stl::result<> HttpClient::send_all(std::string_view data) {
+        while (!data.empty()) {
+            ssize_t n = ::send(m_Fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return stl::make_error("send: {}", std::strerror(errno));
+            }
+            data.remove_prefix(static_cast<size_t>(n));
+        }
+        return stl::success;
+    }
+
+    stl::result<> HttpClient::fill(size_t n) {
+        char chunk[16384];
+        while (m_Buffer.size() < n) {
+            ssize_t got = ::recv(m_Fd, chunk, sizeof(chunk), 0);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                return stl::make_error("Connection closed");
+            }
+            m_Buffer.append(chunk, static_cast<size_t>(got));
+        }
+        return stl::success;
+    }
+
+    stl::result<HttpResult> HttpClient::read_response() {
+        // Headers
+        size_t header_end;
+        while ((header_end = m_Buffer.find("\r\n\r\n")) == std::string::npos) {
+            auto r = fill(m_Buffer.size() + 1);
+            if (!r) {
+                return stl::make_error<HttpResult>("{}", r.error());
+            }
+        }
+        std::string_view head(m_Buffer.data(), header_end);
+        HttpResult result;
+        auto line_end = head.find("\r\n");
+        std::string_view status_line = head.substr(0, line_end);
+        auto space = status_line.find(' ');
+        if (space == std::string_view::npos ||
+            std::from_chars(status_line.data() + space + 1, status_line.data() + status_line.size(), result.status).ec != std::errc{}) {
+            return stl::make_error<HttpResult>("Malformed status line");
+        }
+        std::optional<size_t> content_length;
+        bool chunked = false;
+        bool close_after = false;
+        while (line_end != std::string_view::npos) {
+            head.remove_prefix(line_end + 2);
+            line_end = head.find("\r\n");
+            std::string_view line = head.substr(0, line_end);
+            auto colon = line.find(':');
+            if (colon == std::string_view::npos) {
+                continue;
+            }
+            auto name = trim(line.substr(0, colon));
+            auto value = trim(line.substr(colon + 1));
+            if (iequals(name, "Content-Length")) {
+                size_t length = 0;
+                std::from_chars(value.data(), value.data() + value.size(), length);
+                content_length = length;
+            } else if (iequals(name, "Transfer-Encoding")) {
+                chunked = iequals(value, "chunked");
+            } else if (iequals(name, "Connection")) {
+                close_after = iequals(value, "close");
+            }
+        }
+        m_Buffer.erase(0, header_end + 4);
+        // Body
+        if (chunked) {
+            while (true) {
+                size_t size_end;
+                while ((size_end = m_Buffer.find("\r\n")) == std::string::npos) {
+                    auto r = fill(m_Buffer.size() + 1);
+                    if (!r) {
+                        return stl::make_error<HttpResult>("{}", r.error());
+                    }
+                }
+                size_t size = 0;
+                std::from_chars(m_Buffer.data(), m_Buffer.data() + size_end, size, 16);
+                auto r = fill(size_end + 2 + size + 2);
+                if (!r) {
+                    return stl::make_error<HttpResult>("{}", r.error());
+                }
+                result.body.append(m_Buffer, size_end + 2, size);
+                m_Buffer.erase(0, size_end + 2 + size + 2);
+                if (size == 0) {
+                    break;
+                }
+            }
+        } else if (content_length) {
+            auto r = fill(*content_length);
+            if (!r) {
+                return stl::make_error<HttpResult>("{}", r.error());
+            }
+            result.body = m_Buffer.substr(0, *content_length);
+            m_Buffer.erase(0, *content_length);
+        } else {
+            // Body runs to end of connection
+            while (fill(m_Buffer.size() + 1)) {
+            }
+            result.body = std::move(m_Buffer);
+            close_after = true;
+        }
+        if (close_after) {
+            disconnect();
+        }
+        return result;
+    }
+
+    stl::result<HttpResult> HttpClient::request(std::string_view method, std::string_view target, std::string_view body,
+                                                std::string_view content_type) {
+        std::string req;
+        req.reserve(256 + body.size());
+        req.append(method).append(" ").append(target).append(" HTTP/1.1\r\nHost: ").append(m_Host).append("\r\n");
+        req.append("Connection: keep-alive\r\n");
+        if (!m_Token.empty()) {
+            req.append("Authorization: Bearer ").append(m_Token).append("\r\n");
+        }
+        if (!content_type.empty()) {
+            req.append("Content-Type: ").append(content_type).append("\r\n");
+        }
+        req.append("Content-Length: ").append(std::to_string(body.size())).append("\r\n\r\n");
+        req.append(body);
+        // A reused connection may have been closed by the server; retry once on a fresh one
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            bool reused = m_Fd >= 0;
+            if (!reused) {
+                auto c = connect();
+                if (!c) {
+                    return stl::make_error<HttpResult>("{}", c.error());
+                }
+            }
+            auto sent = send_all(req);
+            auto resp = sent ? read_response() : stl::make_error<HttpResult>("{}", sent.error());
+            if (resp || !reused) {
+                if (!resp) {
+                    disconnect();
+                }
+                return resp;
+            }
+            disconnect();
+        }
+        return stl::make_error<HttpResult>("Request failed");
+    }
+
+} // namespace sap::cloud::loadgen
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <sap_core/result.h>
+#include <sap_core/types.h>
+#include <string>
+#include <string_view>
+
+namespace sap::cloud::loadgen {
+
+    struct HttpResult {
+        i32 status = 0;
+        std::string body;
+    };
+
+    // Minimal blocking HTTP/1.1 client over one keep-alive connection.
+    // Reconnects transparently when the server closes the connection.
+    class HttpClient {
+    public:
+        HttpClient(std::string host, u16 port);
+        ~HttpClient();
+        HttpClient(const HttpClient&) = delete;
+        HttpClient& operator=(const HttpClient&) = delete;
+
+        // Sent as a Bearer token with every request once set
+        void set_token(std::string token) { m_Token = std::move(token); }
+
+        [[nodiscard]] stl::result<HttpResult> request(std::string_view method, std::string_view target, std::string_view body = {},
+                                                      std::string_view content_type = {});
+
+        // Try to connect once (used to wait for the server to come up)
+        [[nodiscard]] bool probe();
+
+    private:
+        stl::result<> connect();
+
+        void disconnect();
+
+        stl::result<> send_all(std::string_view data);
+
+        stl::result<HttpResult> read_response();
+
+        // Read until the buffer holds at least n bytes
+        stl::result<> fill(size_t n);
+
+        std::string m_Host;
+        u16 m_Port;
+        std::string m_Token;
+        int m_Fd = -1;
+        std::string m_Buffer;
+    };
+
+} // namespace sap::cloud::loadgen
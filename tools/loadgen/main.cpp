@@ -0,0 +1,440 @@
+// =============================================================================
+// sap_cloud_loadgen
+// =============================================================================
+// Starts a Server in-process on a loopback port with a throwaway data
+// directory, authenticates with a generated Ed25519 key, then drives a
+// weighted mix of API operations from many concurrent keep-alive
+// connections and reports throughput and latency percentiles per operation.
+// =============================================================================
+
+#include "http_client.h"
+#include "ssh_key.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <sap_cloud/config.h>
+#include <sap_cloud/server.h>
+#include <sap_core/log.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace sap;
+using namespace sap::cloud::loadgen;
+
+namespace {
+
+    enum class EOp : u8 { SyncState, FileGet, FilePut, NoteCreate, NoteGet, NoteUpdate, NoteDelete, Count };
+
+    constexpr size_t op_count = static_cast<size_t>(EOp::Count);
+
+    constexpr std::array<std::string_view, op_count> op_names = {"sync_state", "file_get",    "file_put",   "note_create",
+                                                                 "note_get",   "note_update", "note_delete"};
+
+    struct Options {
+        u32 connections = 32;
+        u32 duration_s = 10;
+        u32 preload_files = 1000;
+        u32 preload_notes = 200;
+        size_t file_size = 4096;
+        u16 port = 0; // 0 = pick a free port
+        bool multithreaded = true;
+        bool keep_data = false;
+        std::array<u32, op_count> weights = {10, 40, 15, 10, 15, 5, 5};
+    };
+
+    struct OpStats {
+        std::vector<u32> latencies_us;
+        u64 errors = 0;
+    };
+
+    using WorkerStats = std::array<OpStats, op_count>;
+
+    void print_usage(const char* progname) {
+        std::cout << "Usage: " << progname << " [options]\n"
+                  << "\nOptions:\n"
+                  << "  -c, --connections <n>   Concurrent connections (default 32)\n"
+                  << "  -d, --duration <s>      Measurement duration in seconds (default 10)\n"
+                  << "  -m, --mix <spec>        Operation weights, e.g. sync_state=10,file_get=40\n"
+                  << "      --files <n>         Files uploaded before measuring (default 1000)\n"
+                  << "      --notes <n>         Notes created before measuring (default 200)\n"
+                  << "      --file-size <bytes> Size of uploaded files (default 4096)\n"
+                  << "      --port <n>          Loopback port (default: any free port)\n"
+                  << "      --single-threaded   Run the server with multithreaded = false\n"
+                  << "      --keep-data         Keep the temporary data directory\n"
+                  << "  -h, --help              Show this help message\n"
+                  << "\nOperations: ";
+        for (size_t i = 0; i < op_count; ++i) {
+            std::cout << (i ? ", " : "") << op_names[i];
+        }
+        std::cout << "\n";
+    }
+
+    stl::result<> parse_mix(std::string_view spec, std::array<u32, op_count>& weights) {
+        weights.fill(0);
+        while (!spec.empty()) {
+            auto comma = spec.find(',');
+            auto item = spec.substr(0, comma);
+            spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+            auto eq = item.find('=');
+            if (eq == std::string_view::npos) {
+                return stl::make_error("Expected op=weight, got '{}'", item);
+            }
+            auto name = item.substr(0, eq);
+            auto it = std::ranges::find(op_names, name);
+            if (it == op_names.end()) {
+                return stl::make_error("Unknown operation '{}'", name);
+            }
+            weights[static_cast<size_t>(it - op_names.begin())] = static_cast<u32>(std::stoul(std::string(item.substr(eq + 1))));
+        }
+        return stl::success;
+    }
+
+    stl::result<Options> parse_args(int argc, char* argv[]) {
+        Options opts;
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument(std::string(arg) + " requires a value");
+                }
+                return argv[++i];
+            };
+            try {
+                if (arg == "-c" || arg == "--connections") {
+                    opts.connections = static_cast<u32>(std::stoul(next()));
+                } else if (arg == "-d" || arg == "--duration") {
+                    opts.duration_s = static_cast<u32>(std::stoul(next()));
+                } else if (arg == "-m" || arg == "--mix") {
+                    auto r = parse_mix(next(), opts.weights);
+                    if (!r) {
+                        return stl::make_error<Options>("{}", r.error());
+                    }
+                } else if (arg == "--files") {
+                    opts.preload_files = static_cast<u32>(std::stoul(next()));
+                } else if (arg == "--notes") {
+                    opts.preload_notes = static_cast<u32>(std::stoul(next()));
+                } else if (arg == "--file-size") {
+                    opts.file_size = std::stoul(next());
+                } else if (arg == "--port") {
+                    opts.port = static_cast<u16>(std::stoul(next()));
+                } else if (arg == "--single-threaded") {
+                    opts.multithreaded = false;
+                } else if (arg == "--keep-data") {
+                    opts.keep_data = true;
+                } else {
+                    return stl::make_error<Options>("Unknown option '{}'", arg);
+                }
+            } catch (const std::exception& e) {
+                return stl::make_error<Options>("Invalid value for {}: {}", arg, e.what());
+            }
+        }
+        if (opts.connections == 0 || std::ranges::all_of(opts.weights, [](u32 w) { return w == 0; })) {
+            return stl::make_error<Options>("Need at least one connection and one weighted operation");
+        }
+        // file_get reads one of the preloaded files
+        if (opts.preload_files == 0 && opts.weights[static_cast<size_t>(EOp::FileGet)] != 0) {
+            return stl::make_error<Options>("file_get needs --files of at least 1 (or leave it out of --mix)");
+        }
+        return opts;
+    }
+
+    u16 pick_free_port() {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        u16 port = 0;
+        if (fd >= 0 && ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+            ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+            port = ntohs(addr.sin_port);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return port;
+    }
+
+    stl::result<std::string> authenticate(HttpClient& client, const SshKey& key) {
+        auto challenge = client.request("POST", "/api/v1/auth/challenge", nlohmann::json{{"public_key", key.public_key()}}.dump(),
+                                        "application/json");
+        if (!challenge || challenge->status != 200) {
+            return stl::make_error<std::string>("Challenge failed: {}", challenge ? challenge->body : challenge.error());
+        }
+        std::string nonce = nlohmann::json::parse(challenge->body).at("challenge").get<std::string>();
+        auto signature = key.sign(nonce);
+        if (!signature) {
+            return stl::make_error<std::string>("{}", signature.error());
+        }
+        nlohmann::json verify_body = {{"public_key", key.public_key()}, {"challenge", nonce}, {"signature", signature.value()}};
+        auto verify = client.request("POST", "/api/v1/auth/verify", verify_body.dump(), "application/json");
+        if (!verify || verify->status != 200) {
+            return stl::make_error<std::string>("Verify failed: {}", verify ? verify->body : verify.error());
+        }
+        return nlohmann::json::parse(verify->body).at("token").get<std::string>();
+    }
+
+    std::string note_body(std::mt19937_64& rng) {
+        nlohmann::json body = {{"title", "Load test note " + std::to_string(rng() % 100000)},
+                               {"content", "Generated by sap_cloud_loadgen. " + std::string(200, 'x')},
+                               {"tags", {"loadgen", rng() % 2 ? "even" : "odd"}}};
+        return body.dump();
+    }
+
+    // Runs operations until the deadline; each worker owns its connection and note ids
+    class Worker {
+    public:
+        Worker(u16 port, std::string token, const Options& opts, u32 index, std::vector<std::string> seed_notes) :
+            m_Client("127.0.0.1", port), m_Opts(opts), m_Index(index), m_Rng(0x10adULL + index), m_Notes(std::move(seed_notes)),
+            m_Payload(opts.file_size, static_cast<char>('a' + index % 26)) {
+            m_Client.set_token(std::move(token));
+        }
+
+        void run(std::chrono::steady_clock::time_point deadline) {
+            std::discrete_distribution<size_t> pick(m_Opts.weights.begin(), m_Opts.weights.end());
+            while (std::chrono::steady_clock::now() < deadline) {
+                auto op = static_cast<EOp>(pick(m_Rng));
+                auto start = std::chrono::steady_clock::now();
+                bool ok = execute(op);
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+                auto& stats = m_Stats[static_cast<size_t>(op)];
+                stats.latencies_us.push_back(static_cast<u32>(elapsed.count()));
+                if (!ok) {
+                    ++stats.errors;
+                }
+            }
+        }
+
+        [[nodiscard]] WorkerStats& stats() { return m_Stats; }
+
+    private:
+        bool check(const stl::result<HttpResult>& r) { return r && r->status < 400; }
+
+        bool execute(EOp op) {
+            switch (op) {
+                case EOp::SyncState:
+                    return check(m_Client.request("GET", "/api/v1/sync/state"));
+                case EOp::FileGet:
+                    return check(m_Client.request("GET", "/api/v1/files/loadgen/seed_" + std::to_string(m_Rng() % m_Opts.preload_files) + ".bin"));
+                case EOp::FilePut:
+                    return check(m_Client.request("PUT",
+                                                  "/api/v1/files/loadgen/w" + std::to_string(m_Index) + "_" + std::to_string(m_Puts++ % 256) + ".bin",
+                                                  m_Payload, "application/octet-stream"));
+                case EOp::NoteCreate:
+                    return create_note();
+                case EOp::NoteGet:
+                    if (m_Notes.empty()) {
+                        return create_note();
+                    }
+                    return check(m_Client.request("GET", "/api/v1/notes/" + m_Notes[m_Rng() % m_Notes.size()]));
+                case EOp::NoteUpdate:
+                    if (m_Notes.empty()) {
+                        return create_note();
+                    }
+                    return check(m_Client.request("PUT", "/api/v1/notes/" + m_Notes[m_Rng() % m_Notes.size()], note_body(m_Rng),
+                                                  "application/json"));
+                case EOp::NoteDelete: {
+                    if (m_Notes.empty()) {
+                        return create_note();
+                    }
+                    size_t victim = m_Rng() % m_Notes.size();
+                    std::swap(m_Notes[victim], m_Notes.back());
+                    auto r = m_Client.request("DELETE", "/api/v1/notes/" + m_Notes.back());
+                    m_Notes.pop_back();
+                    return check(r);
+                }
+                case EOp::Count:
+                    break;
+            }
+            return false;
+        }
+
+        bool create_note() {
+            auto r = m_Client.request("POST", "/api/v1/notes", note_body(m_Rng), "application/json");
+            if (!check(r)) {
+                return false;
+            }
+            auto id = nlohmann::json::parse(r->body, nullptr, false);
+            if (id.is_object() && id.contains("id")) {
+                m_Notes.push_back(id["id"].get<std::string>());
+            }
+            return true;
+        }
+
+        HttpClient m_Client;
+        const Options& m_Opts;
+        u32 m_Index;
+        std::mt19937_64 m_Rng;
+        std::vector<std::string> m_Notes;
+        std::string m_Payload;
+        u64 m_Puts = 0;
+        WorkerStats m_Stats;
+    };
+
+    u32 percentile(const std::vector<u32>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0;
+        }
+        auto rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+    void print_report(std::vector<WorkerStats>& all, double seconds) {
+        std::printf("\n%-12s %9s %7s %10s %9s %9s %9s %9s %9s\n", "operation", "count", "errors", "req/s", "p50 ms", "p90 ms", "p99 ms",
+                    "p99.9 ms", "max ms");
+        std::vector<u32> total;
+        u64 total_errors = 0;
+        auto row = [&](std::string_view name, std::vector<u32>& lat, u64 errors) {
+            std::ranges::sort(lat);
+            auto ms = [](u32 us) { return static_cast<double>(us) / 1000.0; };
+            std::printf("%-12.*s %9zu %7llu %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f\n", static_cast<int>(name.size()), name.data(), lat.size(),
+                        static_cast<unsigned long long>(errors), static_cast<double>(lat.size()) / seconds, ms(percentile(lat, 0.5)),
+                        ms(percentile(lat, 0.9)), ms(percentile(lat, 0.99)), ms(percentile(lat, 0.999)), ms(lat.empty() ? 0 : lat.back()));
+        };
+        for (size_t op = 0; op < op_count; ++op) {
+            std::vector<u32> merged;
+            u64 errors = 0;
+            for (auto& worker : all) {
+                merged.insert(merged.end(), worker[op].latencies_us.begin(), worker[op].latencies_us.end());
+                errors += worker[op].errors;
+            }
+            if (merged.empty()) {
+                continue;
+            }
+            total.insert(total.end(), merged.begin(), merged.end());
+            total_errors += errors;
+            row(op_names[op], merged, errors);
+        }
+        row("total", total, total_errors);
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "-h" || std::string_view(argv[i]) == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    auto opts_result = parse_args(argc, argv);
+    if (!opts_result) {
+        std::cerr << opts_result.error() << "\n";
+        print_usage(argv[0]);
+        return 1;
+    }
+    auto& opts = opts_result.value();
+    // Throwaway data directory and identity
+    auto data_dir = std::filesystem::temp_directory_path() / ("sap_cloud_loadgen_" + std::to_string(::getpid()));
+    std::filesystem::remove_all(data_dir);
+    std::filesystem::create_directories(data_dir);
+    auto key = SshKey::generate("loadgen@localhost");
+    if (!key) {
+        log::error("{}", key.error());
+        return 1;
+    }
+    {
+        std::ofstream keys(data_dir / "authorized_keys");
+        keys << key->public_key() << "\n";
+    }
+    cloud::Config config;
+    config.server.host = "127.0.0.1";
+    config.server.port = opts.port ? opts.port : pick_free_port();
+    config.server.multithreaded = opts.multithreaded;
+    config.storage.files_root = data_dir / "files";
+    config.storage.notes_root = data_dir / "notes";
+    config.storage.database = data_dir / "sap_drive.db";
+    config.auth.authorized_keys = data_dir / "authorized_keys";
+    config.logging.slow_request_ms = 0;
+    auto server_result = cloud::Server::create(config);
+    if (!server_result) {
+        log::error("Failed to create server: {}", server_result.error());
+        return 1;
+    }
+    auto& server = server_result.value();
+    std::thread server_thread([&] { server->run(); });
+    int exit_code = 0;
+    [&] {
+        HttpClient setup("127.0.0.1", config.server.port);
+        bool up = false;
+        for (int attempt = 0; attempt < 100 && !(up = setup.probe()); ++attempt) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (!up) {
+            log::error("Server did not start on port {}", config.server.port);
+            exit_code = 1;
+            return;
+        }
+        auto token = authenticate(setup, key.value());
+        if (!token) {
+            log::error("{}", token.error());
+            exit_code = 1;
+            return;
+        }
+        setup.set_token(token.value());
+        // Seed data for the read operations
+        std::string payload(opts.file_size, 's');
+        for (u32 i = 0; i < opts.preload_files; ++i) {
+            auto r = setup.request("PUT", "/api/v1/files/loadgen/seed_" + std::to_string(i) + ".bin", payload, "application/octet-stream");
+            if (!r || r->status >= 400) {
+                log::error("Failed to seed files");
+                exit_code = 1;
+                return;
+            }
+        }
+        std::vector<std::vector<std::string>> seed_notes(opts.connections);
+        std::mt19937_64 rng(1);
+        for (u32 i = 0; i < opts.preload_notes; ++i) {
+            auto r = setup.request("POST", "/api/v1/notes", note_body(rng), "application/json");
+            if (!r || r->status >= 400) {
+                log::error("Failed to seed notes");
+                exit_code = 1;
+                return;
+            }
+            seed_notes[i % opts.connections].push_back(nlohmann::json::parse(r->body).at("id").get<std::string>());
+        }
+        std::printf("Running %u connections for %us against 127.0.0.1:%u (%s server)\n", opts.connections, opts.duration_s,
+                    config.server.port, opts.multithreaded ? "multithreaded" : "single-threaded");
+        // Measure
+        std::vector<std::unique_ptr<Worker>> workers;
+        for (u32 i = 0; i < opts.connections; ++i) {
+            workers.push_back(std::make_unique<Worker>(config.server.port, token.value(), opts, i, std::move(seed_notes[i])));
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::seconds(opts.duration_s);
+        std::vector<std::thread> threads;
+        for (auto& worker : workers) {
+            threads.emplace_back([&worker, deadline] { worker->run(deadline); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::vector<WorkerStats> stats;
+        for (auto& worker : workers) {
+            stats.push_back(std::move(worker->stats()));
+        }
+        print_report(stats, seconds);
+    }();
+    server->stop();
+    server_thread.join();
+    if (!opts.keep_data) {
+        std::error_code ec;
+        std::filesystem::remove_all(data_dir, ec);
+    } else {
+        std::printf("Data kept in %s\n", data_dir.c_str());
+    }
+    return exit_code;
+}
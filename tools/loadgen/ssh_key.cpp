@@ -0,0 +1,62 @@
+#include "ssh_key.h"
+#include <openssl/evp.h>
+#include <sap_core/types.h>
+#include <vector>
+
+namespace sap::cloud::loadgen {
+
+    namespace {
+        std::string base64(const u8* data, size_t size) {
+            std::string out(4 * ((size + 2) / 3), '\0');
+            int written = EVP_EncodeBlock(reinterpret_cast<unsigned char*>(out.data()), data, static_cast<int>(size));
+            out.resize(static_cast<size_t>(written));
+            return out;
+        }
+
+        // SSH wire string: u32 big-endian length followed by the bytes
+        void put_string(std::vector<u8>& out, const void* data, size_t size) {
+            for (int shift = 24; shift >= 0; shift -= 8) {
+                out.push_back(static_cast<u8>(size >> shift));
+            }
+            auto* bytes = static_cast<const u8*>(data);
+            out.insert(out.end(), bytes, bytes + size);
+        }
+    } // namespace
+
+    void SshKey::KeyDeleter::operator()(EVP_PKEY* key) const { EVP_PKEY_free(key); }
+
+    SshKey::SshKey(std::unique_ptr<EVP_PKEY, KeyDeleter> key, std::string public_key) :
+        m_Key(std::move(key)), m_PublicKey(std::move(public_key)) {}
+
+    stl::result<SshKey> SshKey::generate(std::string_view comment) {
+        std::unique_ptr<EVP_PKEY_CTX, decltype(&EVP_PKEY_CTX_free)> ctx(EVP_PKEY_CTX_new_id(EVP_PKEY_ED25519, nullptr), EVP_PKEY_CTX_free);
+        EVP_PKEY* raw = nullptr;
+        if (!ctx || EVP_PKEY_keygen_init(ctx.get()) != 1 || EVP_PKEY_keygen(ctx.get(), &raw) != 1) {
+            return stl::make_error<SshKey>("Ed25519 key generation failed");
+        }
+        std::unique_ptr<EVP_PKEY, KeyDeleter> key(raw);
+        u8 pub[32];
+        size_t pub_len = sizeof(pub);
+        if (EVP_PKEY_get_raw_public_key(key.get(), pub, &pub_len) != 1 || pub_len != sizeof(pub)) {
+            return stl::make_error<SshKey>("Failed to export public key");
+        }
+        constexpr std::string_view type = "ssh-ed25519";
+        std::vector<u8> wire;
+        put_string(wire, type.data(), type.size());
+        put_string(wire, pub, pub_len);
+        std::string line = std::string(type) + " " + base64(wire.data(), wire.size()) + " " + std::string(comment);
+        return SshKey(std::move(key), std::move(line));
+    }
+
+    stl::result<std::string> SshKey::sign(std::string_view message) const {
+        std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx(EVP_MD_CTX_new(), EVP_MD_CTX_free);
+        u8 sig[64];
+        size_t sig_len = sizeof(sig);
+        if (!ctx || EVP_DigestSignInit(ctx.get(), nullptr, nullptr, nullptr, m_Key.get()) != 1 ||
+            EVP_DigestSign(ctx.get(), sig, &sig_len, reinterpret_cast<const u8*>(message.data()), message.size()) != 1) {
+            return stl::make_error<std::string>("Signing failed");
+        }
+        return base64(sig, sig_len);
+    }
+
+} // namespace sap::cloud::loadgen
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <sap_core/result.h>
+#include <string>
+#include <string_view>
+
+using EVP_PKEY = struct evp_pkey_st;
+
+namespace sap::cloud::loadgen {
+
+    // Throwaway Ed25519 identity for authenticating against the server
+    class SshKey {
+    public:
+        static stl::result<SshKey> generate(std::string_view comment);
+
+        // authorized_keys line: "ssh-ed25519 <base64 wire key> <comment>"
+        [[nodiscard]] const std::string& public_key() const { return m_PublicKey; }
+
+        // Base64 of the raw 64-byte Ed25519 signature over message, the format
+        // expected by /api/v1/auth/verify
+        [[nodiscard]] stl::result<std::string> sign(std::string_view message) const;
+
+    private:
+        struct KeyDeleter {
+            void operator()(EVP_PKEY* key) const;
+        };
+
+        SshKey(std::unique_ptr<EVP_PKEY, KeyDeleter> key, std::string public_key);
+
+        std::unique_ptr<EVP_PKEY, KeyDeleter> m_Key;
+        std::string m_PublicKey;
+    };
+
+} // namespace sap::cloud::loadgen